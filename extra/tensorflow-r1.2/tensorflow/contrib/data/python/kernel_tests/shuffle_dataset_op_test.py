@@ -18,6 +18,7 @@ from __future__ import division
 from __future__ import print_function
 
 import collections
+import os
 
 import numpy as np
 
@@ -147,6 +148,49 @@ class ShuffleDatasetTest(test.TestCase):
     for i in range(5):
       self.assertEqual(10, counts[i])
 
+  def _testSpillingShuffleDataset(self, max_buffer_bytes, spill_directory):
+    components = np.arange(100, dtype=np.int64)
+    dataset = dataset_ops.Dataset.from_tensor_slices(components).repeat(2)
+    iterator = dataset.shuffle(
+        50, seed=37, max_buffer_bytes=max_buffer_bytes,
+        spill_directory=spill_directory).make_initializable_iterator()
+    init_op = iterator.initializer
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      sess.run(init_op)
+      shuffled_elements = []
+      for _ in range(200):
+        shuffled_elements.append(sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+      self.assertAllEqual(
+          sorted(np.concatenate([components, components])),
+          sorted(shuffled_elements))
+      self.assertNotEqual(
+          list(np.concatenate([components, components])), shuffled_elements)
+
+      # Assert that reinitializing with the same seed reproduces the order.
+      sess.run(init_op)
+      reshuffled_elements = []
+      for _ in range(200):
+        reshuffled_elements.append(sess.run(get_next))
+      self.assertEqual(shuffled_elements, reshuffled_elements)
+
+  def testSpillingShuffleDatasetWithSpilling(self):
+    spill_directory = self.get_temp_dir()
+    # Each element is an 8-byte scalar, so most of the buffer is spilled.
+    self._testSpillingShuffleDataset(64, spill_directory)
+    self.assertFalse(
+        [f for f in os.listdir(spill_directory)
+         if f.startswith("shuffle_spill_")])
+
+  def testSpillingShuffleDatasetWithoutSpilling(self):
+    self._testSpillingShuffleDataset(64, None)
+
+  def testSpillingShuffleDatasetEverythingResident(self):
+    self._testSpillingShuffleDataset(None, self.get_temp_dir())
+
 
 if __name__ == "__main__":
   test.main()
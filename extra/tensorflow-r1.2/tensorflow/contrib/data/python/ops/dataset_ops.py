@@ -640,7 +640,8 @@ class Dataset(object):
     max_value = np.iinfo(dtypes.int64.as_numpy_dtype).max
     return Dataset.zip((Dataset.range(start, max_value), self))
 
-  def shuffle(self, buffer_size, seed=None):
+  def shuffle(self, buffer_size, seed=None, max_buffer_bytes=None,
+              spill_directory=None):
     """Randomly shuffles the elements of this dataset.
 
     Args:
@@ -650,11 +651,21 @@ class Dataset(object):
       seed: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the
         random seed that will be used to create the distribution. See
         @{tf.set_random_seed} for behavior.
+      max_buffer_bytes: (Optional.) A `tf.int64` scalar `tf.Tensor`,
+        representing the maximum number of bytes of element data that the
+        shuffle buffer keeps in memory.
+      spill_directory: (Optional.) A `tf.string` scalar `tf.Tensor`, naming a
+        local directory where elements that exceed `max_buffer_bytes` are
+        written while they wait in the buffer. If not set, the buffer holds
+        fewer than `buffer_size` elements once `max_buffer_bytes` is reached.
 
     Returns:
       A `Dataset`.
     """
-    return ShuffleDataset(self, buffer_size, seed)
+    if max_buffer_bytes is None and spill_directory is None:
+      return ShuffleDataset(self, buffer_size, seed)
+    return SpillingShuffleDataset(self, buffer_size, seed, max_buffer_bytes,
+                                  spill_directory)
 
   def take(self, count):
     """Creates a `Dataset` with at most `count` elements from this dataset.
@@ -1089,6 +1100,35 @@ class ShuffleDataset(Dataset):
     return self._input_dataset.output_types
 
 
+class SpillingShuffleDataset(ShuffleDataset):
+  """A `ShuffleDataset` whose buffer is bounded in bytes and may spill."""
+
+  def __init__(self, input_dataset, buffer_size, seed=None,
+               max_buffer_bytes=None, spill_directory=None):
+    """See `Dataset.shuffle()` for details."""
+    super(SpillingShuffleDataset, self).__init__(input_dataset, buffer_size,
+                                                 seed)
+    if max_buffer_bytes is None:
+      max_buffer_bytes = np.iinfo(dtypes.int64.as_numpy_dtype).max
+    self._max_buffer_bytes = ops.convert_to_tensor(
+        max_buffer_bytes, dtype=dtypes.int64, name="max_buffer_bytes")
+    if spill_directory is None:
+      spill_directory = ""
+    self._spill_directory = ops.convert_to_tensor(
+        spill_directory, dtype=dtypes.string, name="spill_directory")
+
+  def make_dataset_resource(self):
+    return gen_dataset_ops.spilling_shuffle_dataset(
+        self._input_dataset.make_dataset_resource(),
+        buffer_size=self._buffer_size,
+        max_buffer_bytes=self._max_buffer_bytes,
+        spill_directory=self._spill_directory,
+        seed=self._seed,
+        seed2=self._seed2,
+        output_shapes=nest.flatten(self.output_shapes),
+        output_types=nest.flatten(self.output_types))
+
+
 class TakeDataset(Dataset):
   """A `Dataset` containing the first `count` elements from its input."""
 
@@ -0,0 +1,126 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Converts a frozen float GraphDef to use eight-bit kernels, calibrating the
+// ranges of its activations on sample inputs. See quantize_inference.h.
+//
+// bazel build tensorflow/contrib/quantization/tools:quantize_inference &&
+// bazel-bin/tensorflow/contrib/quantization/tools/quantize_inference \
+// --in_graph=inception_v3.pb --out_graph=inception_v3_quantized.pb \
+// --input_names=input \
+// --calibration_files=sample0.tensor.pb,sample1.tensor.pb
+//
+// Each calibration file holds a binary TensorProto. The files are read in
+// groups of one per input name, each group forming one calibration run.
+
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/graph/quantize_inference.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace {
+
+Status ReadCalibrationFeeds(
+    const std::vector<string>& input_names,
+    const std::vector<string>& files,
+    std::vector<std::vector<std::pair<string, Tensor>>>* feeds) {
+  if (input_names.empty() || files.size() % input_names.size() != 0) {
+    return errors::InvalidArgument(
+        "Expected one calibration file per input name for each sample, got ",
+        files.size(), " files for ", input_names.size(), " inputs");
+  }
+  for (size_t i = 0; i < files.size(); i += input_names.size()) {
+    std::vector<std::pair<string, Tensor>> sample;
+    for (size_t j = 0; j < input_names.size(); ++j) {
+      TensorProto proto;
+      TF_RETURN_IF_ERROR(
+          ReadBinaryProto(Env::Default(), files[i + j], &proto));
+      Tensor tensor;
+      if (!tensor.FromProto(proto)) {
+        return errors::InvalidArgument("Invalid tensor in ", files[i + j]);
+      }
+      sample.emplace_back(input_names[j], tensor);
+    }
+    feeds->push_back(std::move(sample));
+  }
+  return Status::OK();
+}
+
+int QuantizeInferenceMain(int argc, char** argv) {
+  string in_graph;
+  string out_graph;
+  string input_names;
+  string calibration_files;
+  std::vector<Flag> flag_list = {
+      Flag("in_graph", &in_graph, "frozen float graph file name"),
+      Flag("out_graph", &out_graph, "output graph file name"),
+      Flag("input_names", &input_names,
+           "comma-separated names of the tensors fed with calibration data"),
+      Flag("calibration_files", &calibration_files,
+           "comma-separated binary TensorProto files, one per input name for "
+           "each calibration sample"),
+  };
+  string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_ok = Flags::Parse(&argc, argv, flag_list);
+  // We need to call this to set up global state for TensorFlow.
+  port::InitMain(argv[0], &argc, &argv);
+  if (!parse_ok || in_graph.empty() || out_graph.empty() ||
+      calibration_files.empty()) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+
+  GraphDef graph_def;
+  Status status = ReadBinaryProto(Env::Default(), in_graph, &graph_def);
+  std::vector<std::vector<std::pair<string, Tensor>>> feeds;
+  if (status.ok()) {
+    status = ReadCalibrationFeeds(
+        str_util::Split(input_names, ',', str_util::SkipEmpty()),
+        str_util::Split(calibration_files, ',', str_util::SkipEmpty()),
+        &feeds);
+  }
+  GraphDef quantized_graph_def;
+  if (status.ok()) {
+    status = DoQuantizeInference(graph_def, feeds, &quantized_graph_def);
+  }
+  if (status.ok()) {
+    status = WriteBinaryProto(Env::Default(), out_graph, quantized_graph_def);
+  }
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return -1;
+  }
+  LOG(INFO) << "Wrote " << quantized_graph_def.node_size() << " nodes to "
+            << out_graph;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  return tensorflow::QuantizeInferenceMain(argc, argv);
+}
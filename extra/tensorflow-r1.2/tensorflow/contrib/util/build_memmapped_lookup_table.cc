@@ -0,0 +1,110 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Utility that converts a vocabulary text file into a table file that the
+// MemmappedHashTable op memory-maps instead of parsing at startup.
+//
+//  tensorflow/contrib/util/build_memmapped_lookup_table
+//        --in_file=vocab.txt --out_file=vocab.mmtable
+//
+// Parameters:
+// in_file - name of the vocabulary text file.
+// out_file - name of the table file to write.
+// vocab_size - number of lines to read, or -1 to read the whole file.
+// delimiter - column delimiter within a line.
+// key_index, value_index - column used for keys and values; -1 selects the
+// line number and -2 the whole line, as in InitializeTableFromTextFile.
+// key_dtype, value_dtype - "int64" or "string".
+
+#include <vector>
+
+#include "tensorflow/contrib/util/build_memmapped_lookup_table_lib.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace {
+
+int ParseFlagsAndBuildTable(int argc, char* argv[]) {
+  string in_file = "";
+  string out_file = "";
+  int64 vocab_size = -1;
+  string delimiter = "\t";
+  int32 key_index = -2;
+  int32 value_index = -1;
+  string key_dtype_name = "string";
+  string value_dtype_name = "int64";
+  std::vector<Flag> flag_list = {
+      Flag("in_file", &in_file, "input vocabulary text file"),
+      Flag("out_file", &out_file, "output table file"),
+      Flag("vocab_size", &vocab_size,
+           "number of lines to read, or -1 for the whole file"),
+      Flag("delimiter", &delimiter, "column delimiter, a single character"),
+      Flag("key_index", &key_index,
+           "column of the keys; -1 is the line number, -2 the whole line"),
+      Flag("value_index", &value_index,
+           "column of the values; -1 is the line number, -2 the whole line"),
+      Flag("key_dtype", &key_dtype_name, "key type, int64 or string"),
+      Flag("value_dtype", &value_dtype_name, "value type, int64 or string"),
+  };
+  string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_result = Flags::Parse(&argc, argv, flag_list);
+  // We need to call this to set up global state for TensorFlow.
+  port::InitMain(usage.c_str(), &argc, &argv);
+  if (!parse_result) {
+    LOG(ERROR) << "\n" << usage;
+    return -1;
+  }
+  if (argc > 1) {
+    LOG(ERROR) << "Unknown argument " << argv[1] << "\n" << usage;
+    return -1;
+  }
+  if (in_file.empty()) {
+    LOG(ERROR) << "in_file can't be empty";
+    return -1;
+  }
+  if (out_file.empty()) {
+    LOG(ERROR) << "out_file can't be empty";
+    return -1;
+  }
+  if (delimiter.size() != 1) {
+    LOG(ERROR) << "delimiter must be a single character";
+    return -1;
+  }
+  DataType key_dtype;
+  DataType value_dtype;
+  if (!DataTypeFromString(key_dtype_name, &key_dtype) ||
+      !DataTypeFromString(value_dtype_name, &value_dtype)) {
+    LOG(ERROR) << "Unknown key_dtype or value_dtype";
+    return -1;
+  }
+  const auto result = BuildMemmappedLookupTableFromTextFile(
+      in_file, vocab_size, delimiter[0], key_index, value_index, key_dtype,
+      value_dtype, out_file);
+  if (!result.ok()) {
+    LOG(ERROR) << "Building the table failed " << result.error_message();
+    return -1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tensorflow
+
+int main(int argc, char* argv[]) {
+  return tensorflow::ParseFlagsAndBuildTable(argc, argv);
+}
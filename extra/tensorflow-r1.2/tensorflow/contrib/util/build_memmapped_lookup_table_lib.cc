@@ -0,0 +1,85 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/util/build_memmapped_lookup_table_lib.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/initializable_lookup_table.h"
+#include "tensorflow/core/kernels/lookup_table_init_op.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/util/memmapped_lookup_table.h"
+
+namespace tensorflow {
+namespace {
+
+// An initializable table that forwards its entries to a
+// MemmappedLookupTableBuilder, so that the text file is read by the same
+// code that initializes in-memory tables.
+class BuilderTable : public lookup::InitializableLookupTable {
+ public:
+  BuilderTable(DataType key_dtype, DataType value_dtype)
+      : key_dtype_(key_dtype),
+        value_dtype_(value_dtype),
+        builder_(key_dtype, value_dtype) {}
+
+  MemmappedLookupTableBuilder* builder() { return &builder_; }
+
+  size_t size() const override { return builder_.size(); }
+
+  DataType key_dtype() const override { return key_dtype_; }
+
+  DataType value_dtype() const override { return value_dtype_; }
+
+ protected:
+  Status DoPrepare(size_t expected_num_elements) override {
+    return Status::OK();
+  }
+
+  Status DoInsert(const Tensor& keys, const Tensor& values) override {
+    return builder_.Add(keys, values);
+  }
+
+  Status DoFind(OpKernelContext* ctx, const Tensor& keys, Tensor* values,
+                const Tensor& default_value) override {
+    return errors::Unimplemented("BuilderTable does not support lookups");
+  }
+
+ private:
+  const DataType key_dtype_;
+  const DataType value_dtype_;
+  MemmappedLookupTableBuilder builder_;
+};
+
+}  // namespace
+
+Status BuildMemmappedLookupTableFromTextFile(const string& text_filename,
+                                             int64 vocab_size, char delimiter,
+                                             int32 key_index,
+                                             int32 value_index,
+                                             DataType key_dtype,
+                                             DataType value_dtype,
+                                             const string& table_filename) {
+  Env* env = Env::Default();
+  BuilderTable* table = new BuilderTable(key_dtype, value_dtype);
+  core::ScopedUnref unref(table);
+  TF_RETURN_IF_ERROR(lookup::InitializeTableFromTextFile(
+      text_filename, vocab_size, delimiter, key_index, value_index, env,
+      table));
+  return table->builder()->Finish(env, table_filename);
+}
+
+}  // namespace tensorflow
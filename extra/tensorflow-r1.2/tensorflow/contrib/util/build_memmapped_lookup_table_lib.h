@@ -0,0 +1,41 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_CONTRIB_UTIL_BUILD_MEMMAPPED_LOOKUP_TABLE_LIB_H_
+#define THIRD_PARTY_TENSORFLOW_CONTRIB_UTIL_BUILD_MEMMAPPED_LOOKUP_TABLE_LIB_H_
+
+#include <string>
+
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+// Reads a vocabulary text file and writes it as a table file for the
+// MemmappedHashTable op. The text file is parsed exactly as by the
+// InitializeTableFromTextFile op: key_index and value_index select a column
+// split by `delimiter`, -1 selects the line number and -2 the whole line.
+// Unlike HashTable, the table rejects repeated keys.
+Status BuildMemmappedLookupTableFromTextFile(const string& text_filename,
+                                             int64 vocab_size, char delimiter,
+                                             int32 key_index,
+                                             int32 value_index,
+                                             DataType key_dtype,
+                                             DataType value_dtype,
+                                             const string& table_filename);
+
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_CONTRIB_UTIL_BUILD_MEMMAPPED_LOOKUP_TABLE_LIB_H_
@@ -0,0 +1,68 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/util/build_memmapped_lookup_table_lib.h"
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/memmapped_lookup_table.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(BuildMemmappedLookupTableTest, WordToLineNumber) {
+  Env* env = Env::Default();
+  const string vocab = io::JoinPath(testing::TmpDir(), "vocab.txt");
+  const string table_file = io::JoinPath(testing::TmpDir(), "vocab.mmtable");
+  TF_ASSERT_OK(WriteStringToFile(env, vocab, "brain\nsalad\nsurgery\n"));
+  TF_ASSERT_OK(BuildMemmappedLookupTableFromTextFile(
+      vocab, -1, '\t', -2, -1, DT_STRING, DT_INT64, table_file));
+
+  std::unique_ptr<MemmappedLookupTable> table;
+  TF_ASSERT_OK(MemmappedLookupTable::Open(env, table_file, &table));
+  EXPECT_EQ(3, table->size());
+  EXPECT_EQ(0, table->Int64Value(table->FindSlot(StringPiece("brain"))));
+  EXPECT_EQ(1, table->Int64Value(table->FindSlot(StringPiece("salad"))));
+  EXPECT_EQ(2, table->Int64Value(table->FindSlot(StringPiece("surgery"))));
+  EXPECT_EQ(-1, table->FindSlot(StringPiece("tank")));
+}
+
+TEST(BuildMemmappedLookupTableTest, Columns) {
+  Env* env = Env::Default();
+  const string vocab = io::JoinPath(testing::TmpDir(), "columns.txt");
+  const string table_file = io::JoinPath(testing::TmpDir(), "columns.mmtable");
+  TF_ASSERT_OK(WriteStringToFile(env, vocab, "42,answer\n7,lucky\n"));
+  TF_ASSERT_OK(BuildMemmappedLookupTableFromTextFile(
+      vocab, -1, ',', 0, 1, DT_INT64, DT_STRING, table_file));
+
+  std::unique_ptr<MemmappedLookupTable> table;
+  TF_ASSERT_OK(MemmappedLookupTable::Open(env, table_file, &table));
+  EXPECT_EQ("answer", table->StringValue(table->FindSlot(int64{42})));
+  EXPECT_EQ("lucky", table->StringValue(table->FindSlot(int64{7})));
+}
+
+TEST(BuildMemmappedLookupTableTest, DuplicateLine) {
+  Env* env = Env::Default();
+  const string vocab = io::JoinPath(testing::TmpDir(), "duplicate.txt");
+  TF_ASSERT_OK(WriteStringToFile(env, vocab, "a\nb\na\n"));
+  EXPECT_TRUE(errors::IsInvalidArgument(BuildMemmappedLookupTableFromTextFile(
+      vocab, -1, '\t', -2, -1, DT_STRING, DT_INT64,
+      io::JoinPath(testing::TmpDir(), "duplicate.mmtable"))));
+}
+
+}  // namespace
+}  // namespace tensorflow
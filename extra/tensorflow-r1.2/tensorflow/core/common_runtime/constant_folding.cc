@@ -23,12 +23,17 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/fingerprint_memo.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/common_runtime/graph_runner.h"
 #include "tensorflow/core/common_runtime/memory_types.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/node_builder.h"
@@ -37,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/flatset.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -82,6 +88,23 @@ bool IsConstantFoldable(const Node* n,
   return true;
 }
 
+// Adds "n" to "refiner" and returns true if one of its outputs is known to
+// be larger than "max_bytes". The inputs of "n" must have been added to
+// "refiner" before.
+bool HasLargeOutput(const Node* n, int64 max_bytes, ShapeRefiner* refiner) {
+  if (!refiner->AddNode(n).ok()) return false;
+  shape_inference::InferenceContext* c = refiner->GetContext(n);
+  for (int i = 0; i < c->num_outputs(); ++i) {
+    shape_inference::ShapeHandle shape = c->output(i);
+    const int64 element_size = DataTypeSize(n->output_type(i));
+    if (element_size > 0 && c->FullyDefined(shape) &&
+        c->Value(c->NumElements(shape)) * element_size > max_bytes) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Returns the constant foldable nodes in `nodes` in topological order.
 // Populates `constant_control_deps` with the non-constant control depedencies
 // of each constant node.
@@ -90,10 +113,16 @@ void FindConstantFoldableNodes(
     std::unordered_map<const Node*, gtl::FlatSet<Node*>>*
         constant_control_deps) {
   bool internal_node_inserted = false;
+  // Shapes of the constant foldable nodes found so far, to avoid evaluating
+  // nodes whose outputs would be too large to become constants anyway. Only
+  // the shapes known without evaluating constants are used, since that would
+  // run the subgraphs that are about to be folded.
+  ShapeRefiner refiner(graph->versions().producer(), graph->op_registry());
+  refiner.set_disable_constant_propagation(true);
   // Walk the nodes in data flow order
   ReverseDFS(
-      *graph, nullptr,
-      [nodes, constant_control_deps, &internal_node_inserted, opts](Node* n) {
+      *graph, nullptr, [nodes, constant_control_deps, &internal_node_inserted,
+                        &refiner, opts](Node* n) {
         if (IsConstantFoldable(n, opts.consider)) {
           // A node is constant provided all of its non-control
           // incoming Tensors come from constant nodes.
@@ -110,6 +139,15 @@ void FindConstantFoldableNodes(
               break;
             }
           }
+          if (all_parents_constant && !n->IsConstant() &&
+              HasLargeOutput(n, opts.max_constant_size_in_bytes, &refiner)) {
+            VLOG(1) << "Not folding " << n->name()
+                    << ", which has an output larger than "
+                    << opts.max_constant_size_in_bytes << " bytes";
+            all_parents_constant = false;
+          } else if (all_parents_constant && n->IsConstant()) {
+            refiner.AddNode(n).IgnoreError();
+          }
           if (all_parents_constant) {
             gtl::FlatSet<Node*>& control_deps = (*constant_control_deps)[n];
             for (const Edge* e : n->in_edges()) {
@@ -182,6 +220,38 @@ Graph* GetConstantGraph(const Graph* orig_graph,
   return constant_graph;
 }
 
+// Fingerprints the nodes of "constant_graph" and the names of the tensors
+// fetched from it.
+Fprint128 ConstantGraphFingerprint(const Graph& constant_graph,
+                                   const std::vector<string>& fetch_names) {
+  GraphDef graph_def;
+  constant_graph.ToGraphDef(&graph_def);
+  string serialized;
+  SerializeToStringDeterministic(graph_def, &serialized);
+  for (const string& name : fetch_names) {
+    strings::StrAppend(&serialized, "\n", name);
+  }
+  return Fingerprint128(serialized);
+}
+
+int64 TotalBytes(const std::vector<Tensor>& tensors) {
+  int64 bytes = 0;
+  for (const Tensor& t : tensors) {
+    bytes += t.TotalBytes();
+  }
+  return bytes;
+}
+
+// The tensors fetched from constant graphs, by the fingerprints of the graphs.
+// The oldest entries are evicted once the cached tensors exceed a total size.
+FingerprintMemo<std::vector<Tensor>>* ConstantFoldingCache() {
+  static FingerprintMemo<std::vector<Tensor>>* cache =
+      new FingerprintMemo<std::vector<Tensor>>(
+          16384 /* max_entries */, 64 * 1024 * 1024 /* max_bytes */,
+          TotalBytes);
+  return cache;
+}
+
 int64 UniqueConstantId() {
   static std::atomic_int_fast64_t id;
   return id.fetch_add(1);
@@ -195,7 +265,8 @@ int64 UniqueConstantId() {
 // new constant node.
 bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
                                NodeAndOutput tensor, const Tensor& constant,
-                               const gtl::FlatSet<Node*>& control_deps) {
+                               const gtl::FlatSet<Node*>& control_deps,
+                               int64 max_constant_size_in_bytes) {
   // Be conservative when replacing a tensor with a constant, when not
   // running on CPU.
   // 1) If the destination tensor is not an int32 tensor, and has HOST_MEMORY
@@ -204,8 +275,9 @@ bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
   // constraint, do not replace it.
   // 3) If the constant op created does not have a kernel implementation
   // for the device, do not use it.
-  // 4) If the size of the constant in bytes is too large (> 10M), do not
-  // replace it. This prevents the size of the Graph from growing too large.
+  // 4) If the size of the constant in bytes is too large (>
+  // max_constant_size_in_bytes), do not replace it. This prevents the size of
+  // the Graph from growing too large.
   // TODO(keveman): Consider adding a new constant op that has a kernel
   // implementation for all types, but with HostMemory constraint on it's
   // output.
@@ -229,7 +301,7 @@ bool ReplaceTensorWithConstant(Graph* graph, Device* partition_device,
       return false;
     }
   }
-  if (constant.TotalBytes() > 10 * 1024 * 1024) {
+  if (constant.TotalBytes() > max_constant_size_in_bytes) {
     return false;
   }
 
@@ -322,8 +394,7 @@ Status ConstantFold(const ConstantFoldingOptions& opts,
     tensors_to_replace.push_back({n.second, n.first.second});
   }
 
-  auto graph_runner = std::unique_ptr<GraphRunner>(new GraphRunner(env));
-  // Evaluate the constant foldable nodes.
+  std::unique_ptr<GraphRunner> graph_runner;
   std::vector<Tensor> outputs;
   auto delete_tensors = gtl::MakeCleanup([&graph_runner, &outputs] {
     // Output tensors need to be cleared before the GraphRunner is deleted.
@@ -331,14 +402,31 @@ Status ConstantFold(const ConstantFoldingOptions& opts,
     graph_runner.reset(nullptr);
   });
 
-  Status s =
-      graph_runner->Run(constant_graph.get(), function_library, {} /* inputs*/,
-                        tensors_to_fetch_names, &outputs);
-  if (!s.ok()) {
-    VLOG(1) << "Could not fetch constants: " << s;
-    *was_mutated = false;
-    // This is not an error, so return the status as OK.
-    return s;
+  // Evaluate the constant foldable nodes, unless the same constant graph has
+  // been evaluated before.
+  const bool cacheable = CanMemoizeValuesOf(*constant_graph);
+  Fprint128 fingerprint = {0, 0};
+  if (cacheable) {
+    fingerprint =
+        ConstantGraphFingerprint(*constant_graph, tensors_to_fetch_names);
+  }
+  if (cacheable &&
+      ConstantFoldingCache()->Lookup(fingerprint, &outputs)) {
+    VLOG(1) << "Reusing " << outputs.size() << " cached constants";
+  } else {
+    graph_runner.reset(new GraphRunner(env, opts.use_cpu_thread_pool));
+    Status s = graph_runner->Run(constant_graph.get(), function_library,
+                                 {} /* inputs*/, tensors_to_fetch_names,
+                                 &outputs);
+    if (!s.ok()) {
+      VLOG(1) << "Could not fetch constants: " << s;
+      *was_mutated = false;
+      // This is not an error, so return the status as OK.
+      return s;
+    }
+    if (cacheable) {
+      ConstantFoldingCache()->Insert(fingerprint, outputs);
+    }
   }
 
   // Fetch the constant tensors and replace the corresponding tensors in the
@@ -349,7 +437,8 @@ Status ConstantFold(const ConstantFoldingOptions& opts,
         constant_control_deps[tensors_to_replace[c].first];
     if (ReplaceTensorWithConstant(graph, partition_device,
                                   tensors_to_replace[c], outputs[c],
-                                  control_deps)) {
+                                  control_deps,
+                                  opts.max_constant_size_in_bytes)) {
       ++num_nodes_replaced;
     }
   }
@@ -360,4 +449,10 @@ Status ConstantFold(const ConstantFoldingOptions& opts,
   return Status::OK();
 }
 
+void ClearConstantFoldingCache() { ConstantFoldingCache()->Clear(); }
+
+int64 ConstantFoldingCacheHits() {
+  return ConstantFoldingCache()->hits();
+}
+
 }  // namespace tensorflow
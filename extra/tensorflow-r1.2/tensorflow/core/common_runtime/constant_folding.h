@@ -29,6 +29,17 @@ struct ConstantFoldingOptions {
   // If "consider" is not a nullptr, then only constant fold a node "n" if
   // consider(n) returns true.
   std::function<bool(const Node*)> consider = nullptr;
+
+  // The largest constant, in bytes, to replace a tensor with. Nodes whose
+  // outputs are known from shape inference to be larger are not folded, so
+  // that they are not evaluated either.
+  int64 max_constant_size_in_bytes = 10 * 1024 * 1024;
+
+  // If true, evaluates the constant foldable nodes concurrently on the CPU
+  // thread pool shared by the local devices of the process. Only safe when
+  // none of the kernels folded shard their work onto that same pool, since
+  // they would block its threads waiting for each other.
+  bool use_cpu_thread_pool = false;
 };
 
 // Perform constant folding optimization on "graph".
@@ -40,10 +51,21 @@ struct ConstantFoldingOptions {
 // Sets `was_mutated` to true if and only if "graph" has been mutated.
 // The status is only set to a non-OK state if an unexpected error is hit
 // running the graph.
+// The evaluated constants are cached within the process, keyed by a
+// fingerprint of the nodes evaluated, so that folding the same graph again,
+// e.g. when creating another session for the same model, does not run them.
 Status ConstantFold(const ConstantFoldingOptions& opts,
                     FunctionLibraryRuntime* function_library, Env* env,
                     Device* partition_device, Graph* graph, bool* was_mutated);
 
+// Empties the cache of evaluated constants used by ConstantFold(), and resets
+// its count of hits. Mainly useful for tests.
+void ClearConstantFoldingCache();
+
+// Returns the number of times ConstantFold() reused cached constants instead
+// of evaluating them since the cache was last cleared.
+int64 ConstantFoldingCacheHits();
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_COMMON_RUNTIME_CONSTANT_FOLDING_H_
@@ -34,7 +34,9 @@ limitations under the License.
 #include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -261,6 +263,93 @@ TEST_F(ConstantFoldingTest, TestNoReplaceLargeConstant) {
   EXPECT_FALSE(was_mutated);
 }
 
+TEST_F(ConstantFoldingTest, TestNoFoldLargeIntermediate) {
+  Graph g(OpRegistry::Global());
+  {
+    Scope s = Scope::NewRootScope();
+    auto dims = ops::Const<int>(s, {4 * 1024 * 1024});
+    auto fill = ops::Fill(s, dims, ops::Const<int>(s, 1));
+    auto sum = ops::Sum(s, fill, ops::Const<int>(s, 0));
+    auto sum_send = ops::_Send(s.WithOpName("sum_send"), sum, "sum_send",
+                               "sender", 0, "receiver");
+    TF_ASSERT_OK(s.ToGraph(&g));
+  }
+
+  // The fill would be 16MB, so neither it nor the sum reducing it to a scalar
+  // should have been constant folded.
+  bool was_mutated;
+  TF_EXPECT_OK(ConstantFold(ConstantFoldingOptions{}, nullptr, Env::Default(),
+                            nullptr, &g, &was_mutated));
+  EXPECT_FALSE(was_mutated);
+
+  ConstantFoldingOptions opts;
+  opts.max_constant_size_in_bytes = 32 * 1024 * 1024;
+  TF_EXPECT_OK(
+      ConstantFold(opts, nullptr, Env::Default(), nullptr, &g, &was_mutated));
+  EXPECT_TRUE(was_mutated);
+  Node* sum_send = NodeNameIndex(g).at("sum_send");
+  ASSERT_EQ(1, sum_send->num_inputs());
+  ExpectNodeEqual<int>(*(sum_send->in_nodes().begin()), {4 * 1024 * 1024},
+                       {});
+}
+
+TEST_F(ConstantFoldingTest, FoldSameGraphTwice) {
+  // Folding the same graph again reuses the cached constants.
+  for (bool use_cpu_thread_pool : {true, false}) {
+    ClearConstantFoldingCache();
+    for (int64 expected_hits : {0, 1}) {
+      Scope s = Scope::NewRootScope();
+      BuildSimpleGraph(&s);
+      Graph g(OpRegistry::Global());
+      TF_ASSERT_OK(s.ToGraph(&g));
+
+      ConstantFoldingOptions opts;
+      opts.use_cpu_thread_pool = use_cpu_thread_pool;
+      bool was_mutated;
+      TF_ASSERT_OK(ConstantFold(opts, nullptr, Env::Default(), nullptr, &g,
+                                &was_mutated));
+      EXPECT_TRUE(was_mutated);
+      EXPECT_EQ(expected_hits, ConstantFoldingCacheHits());
+
+      std::unordered_map<string, Node*> index = NodeNameIndex(g);
+      Node* s1 = index.at("s1");
+      Node* s2 = index.at("s2");
+      EXPECT_EQ(1, s1->num_inputs());
+      ExpectNodeClose<float>(*(s1->in_nodes().begin()), {1.0, 2.0, 3.0, 4.0},
+                             {2, 2});
+      EXPECT_EQ(1, s2->num_inputs());
+      ExpectNodeClose<float>(*(s2->in_nodes().begin()), {2.0, 1.0, 4.0, 3.0},
+                             {2, 2});
+    }
+  }
+}
+
+TEST_F(ConstantFoldingTest, FoldChangedFileAgain) {
+  // ReadFile is not stateful, so it is folded, but its value must not be
+  // reused once the file has changed.
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "constant_folding_read_file");
+  ClearConstantFoldingCache();
+  for (const string& contents : {"first", "second"}) {
+    TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, contents));
+    Scope s = Scope::NewRootScope();
+    auto read = ops::ReadFile(s.WithOpName("read"), filename);
+    auto send =
+        ops::_Send(s.WithOpName("send"), read, "read", "sender", 0, "receiver");
+    Graph g(OpRegistry::Global());
+    TF_ASSERT_OK(s.ToGraph(&g));
+
+    bool was_mutated;
+    TF_ASSERT_OK(ConstantFold(ConstantFoldingOptions{}, nullptr,
+                              Env::Default(), nullptr, &g, &was_mutated));
+    EXPECT_TRUE(was_mutated);
+    Node* send_node = NodeNameIndex(g).at("send");
+    ASSERT_EQ(1, send_node->num_inputs());
+    ExpectNodeEqual<string>(*(send_node->in_nodes().begin()), {contents}, {});
+    EXPECT_EQ(0, ConstantFoldingCacheHits());
+  }
+}
+
 TEST_F(ConstantFoldingTest, TestNoReplaceFunctionCall) {
   FunctionDefLibrary flib;
   *flib.add_function() = test::function::XTimesTwo();
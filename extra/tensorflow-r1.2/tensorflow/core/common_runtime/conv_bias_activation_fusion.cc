@@ -0,0 +1,196 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+// A Conv2D -> BiasAdd [-> Relu | Relu6] chain that can be replaced by a single
+// _FusedConv2DBiasActivation node.
+struct ConvChain {
+  Node* conv;
+  Node* bias_add;
+  Node* activation;  // May be nullptr.
+};
+
+// The fusion is off unless the environment variable
+// TF_CPU_FUSE_CONV_BIAS_ACTIVATION is set to 1. Fused nodes bypass the
+// Conv2D kernel, so they do not use its algorithm autotuner or its cache of
+// packed constant filters, and are not faster for every model.
+bool FusionEnabled() {
+  bool enabled;
+  Status status =
+      ReadBoolFromEnvVar("TF_CPU_FUSE_CONV_BIAS_ACTIVATION", false, &enabled);
+  if (!status.ok()) {
+    LOG(ERROR) << status.error_message();
+    return false;
+  }
+  return enabled;
+}
+
+bool IsCpuFloatNhwc(const Node* n) {
+  DeviceNameUtils::ParsedName device;
+  if (!DeviceNameUtils::ParseFullName(n->assigned_device_name(), &device) ||
+      device.type != DEVICE_CPU) {
+    return false;
+  }
+  DataType dtype;
+  if (!GetNodeAttr(n->def(), "T", &dtype).ok() || dtype != DT_FLOAT) {
+    return false;
+  }
+  string data_format;
+  return !GetNodeAttr(n->def(), "data_format", &data_format).ok() ||
+         data_format == "NHWC";
+}
+
+// Returns the node of type `op` that consumes output 0 of `n` through its
+// input 0, if that is the only edge out of `n` and both nodes run on the same
+// device. Returns nullptr otherwise.
+Node* SoleConsumer(const Node* n, StringPiece op) {
+  if (n->out_edges().size() != 1) return nullptr;
+  const Edge* e = *n->out_edges().begin();
+  if (e->IsControlEdge() || e->src_output() != 0 || e->dst_input() != 0 ||
+      e->dst()->type_string() != op ||
+      e->dst()->assigned_device_name() != n->assigned_device_name() ||
+      !IsCpuFloatNhwc(e->dst())) {
+    return nullptr;
+  }
+  return e->dst();
+}
+
+bool MatchConvChain(Node* conv, ConvChain* chain) {
+  if (conv->type_string() != "Conv2D" || !IsCpuFloatNhwc(conv)) return false;
+  chain->conv = conv;
+  chain->bias_add = SoleConsumer(conv, "BiasAdd");
+  if (chain->bias_add == nullptr) return false;
+  chain->activation = SoleConsumer(chain->bias_add, "Relu");
+  if (chain->activation == nullptr) {
+    chain->activation = SoleConsumer(chain->bias_add, "Relu6");
+  }
+  return true;
+}
+
+Status FuseConvChain(const ConvChain& chain, Graph* g) {
+  Node* last = chain.activation != nullptr ? chain.activation : chain.bias_add;
+  const Edge* input;
+  const Edge* filter;
+  const Edge* bias;
+  TF_RETURN_IF_ERROR(chain.conv->input_edge(0, &input));
+  TF_RETURN_IF_ERROR(chain.conv->input_edge(1, &filter));
+  TF_RETURN_IF_ERROR(chain.bias_add->input_edge(1, &bias));
+  std::vector<int32> strides;
+  TF_RETURN_IF_ERROR(GetNodeAttr(chain.conv->def(), "strides", &strides));
+  string padding;
+  TF_RETURN_IF_ERROR(GetNodeAttr(chain.conv->def(), "padding", &padding));
+
+  // The fused node takes over the name of the last node in the chain, so
+  // that it still shows up under that name in step stats and timelines.
+  NodeBuilder builder(last->name(), "_FusedConv2DBiasActivation");
+  builder.Input(input->src(), input->src_output())
+      .Input(filter->src(), filter->src_output())
+      .Input(bias->src(), bias->src_output())
+      .Attr("T", DT_FLOAT)
+      .Attr("strides", strides)
+      .Attr("padding", padding)
+      .Attr("activation", chain.activation != nullptr
+                              ? chain.activation->type_string()
+                              : "None")
+      .Device(chain.conv->def().device());
+  for (Node* n : {chain.conv, chain.bias_add, chain.activation}) {
+    if (n == nullptr) continue;
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge()) builder.ControlInput(e->src());
+    }
+  }
+  Node* fused;
+  TF_RETURN_IF_ERROR(builder.Finalize(g, &fused));
+  if (!FindKernelDef(DeviceType(DEVICE_CPU), fused->def(), nullptr, nullptr)
+           .ok()) {
+    // The fused kernel is not linked into this binary.
+    g->RemoveNode(fused);
+    return Status::OK();
+  }
+  fused->set_assigned_device_name(chain.conv->assigned_device_name());
+
+  for (const Edge* e : last->out_edges()) {
+    if (e->IsControlEdge()) {
+      g->AddControlEdge(fused, e->dst());
+    } else {
+      g->AddEdge(fused, 0, e->dst(), e->dst_input());
+    }
+  }
+  g->RemoveNode(last);
+  if (chain.activation != nullptr) g->RemoveNode(chain.bias_add);
+  g->RemoveNode(chain.conv);
+  return Status::OK();
+}
+
+// Replaces Conv2D -> BiasAdd [-> Relu | Relu6] chains that run on a CPU device
+// in float and NHWC format, and whose intermediate results are not used
+// elsewhere, by _FusedConv2DBiasActivation. This saves two passes over the
+// convolution output. Runs after placement, so that only chains placed on a
+// CPU are rewritten, and after the feeds and fetches have been rewritten, so
+// that fetched intermediate results show up as extra consumers. Runs before
+// MarkConstantWeightsPass, so that only the Conv2D nodes that remain are
+// marked. Opt-in, see FusionEnabled(), and disabled at OptimizerOptions::L0.
+class FuseConv2DBiasActivationPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override {
+    if (options.graph == nullptr || !FusionEnabled()) return Status::OK();
+    if (options.session_options != nullptr &&
+        options.session_options->config.graph_options()
+                .optimizer_options()
+                .opt_level() == OptimizerOptions::L0) {
+      return Status::OK();
+    }
+    Graph* g = options.graph->get();
+    const OpDef* op_def;
+    if (!g->op_registry()
+             ->LookUpOpDef("_FusedConv2DBiasActivation", &op_def)
+             .ok()) {
+      return Status::OK();
+    }
+    std::vector<ConvChain> chains;
+    for (Node* n : g->nodes()) {
+      ConvChain chain;
+      if (MatchConvChain(n, &chain)) chains.push_back(chain);
+    }
+    for (const ConvChain& chain : chains) {
+      TF_RETURN_IF_ERROR(FuseConvChain(chain, g));
+    }
+    if (!chains.empty()) {
+      VLOG(1) << "Fused " << chains.size()
+              << " Conv2D + BiasAdd + activation chains";
+    }
+    return Status::OK();
+  }
+};
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_REWRITE_FOR_EXEC, 1,
+                      FuseConv2DBiasActivationPass);
+
+}  // namespace
+}  // namespace tensorflow
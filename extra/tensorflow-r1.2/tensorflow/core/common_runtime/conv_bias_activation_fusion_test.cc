@@ -0,0 +1,310 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <stdlib.h>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+const char kCpu[] = "/job:localhost/replica:0/task:0/cpu:0";
+const char kFusionEnvVar[] = "TF_CPU_FUSE_CONV_BIAS_ACTIVATION";
+
+Tensor RandomTensor(const TensorShape& shape) {
+  Tensor t(DT_FLOAT, shape);
+  t.flat<float>().setRandom();
+  // Center the values on zero so that Relu clamps some of the outputs.
+  t.flat<float>() = t.flat<float>() - 0.5f;
+  return t;
+}
+
+// Adds input -> Conv2D -> BiasAdd -> `activation` to `g` and returns the
+// last node.  `activation` may be empty.
+Node* AddConvChain(Graph* g, const TensorShape& input_shape,
+                   const TensorShape& filter_shape, int stride,
+                   const string& padding, const string& activation) {
+  Node* input = test::graph::Constant(g, RandomTensor(input_shape));
+  Node* filter = test::graph::Constant(g, RandomTensor(filter_shape));
+  Node* bias = test::graph::Constant(
+      g, RandomTensor(TensorShape({filter_shape.dim_size(3)})));
+  Node* conv;
+  TF_CHECK_OK(NodeBuilder("conv", "Conv2D")
+                  .Input(input)
+                  .Input(filter)
+                  .Attr("T", DT_FLOAT)
+                  .Attr("strides", {1, stride, stride, 1})
+                  .Attr("padding", padding)
+                  .Finalize(g, &conv));
+  Node* bias_add;
+  TF_CHECK_OK(NodeBuilder("bias_add", "BiasAdd")
+                  .Input(conv)
+                  .Input(bias)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &bias_add));
+  if (activation.empty()) return bias_add;
+  Node* act;
+  TF_CHECK_OK(NodeBuilder("activation", activation)
+                  .Input(bias_add)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &act));
+  return act;
+}
+
+void AssignDevice(Graph* g, const string& device) {
+  for (Node* n : g->nodes()) {
+    if (n->IsOp()) n->set_assigned_device_name(device);
+  }
+}
+
+Status RunFusionPass(std::unique_ptr<Graph>* g) {
+  GraphOptimizationPassOptions options;
+  options.graph = g;
+  return OptimizationPassRegistry::Global()->RunGrouping(
+      OptimizationPassRegistry::POST_REWRITE_FOR_EXEC, options);
+}
+
+int CountNodes(const Graph& g, const string& op) {
+  int count = 0;
+  for (const Node* n : g.nodes()) {
+    if (n->type_string() == op) ++count;
+  }
+  return count;
+}
+
+// The fusion is opt-in, so the tests turn it on.
+class ConvBiasActivationFusionTest : public ::testing::Test {
+ protected:
+  ConvBiasActivationFusionTest() { setenv(kFusionEnvVar, "1", 1); }
+  ~ConvBiasActivationFusionTest() override { unsetenv(kFusionEnvVar); }
+};
+
+TEST_F(ConvBiasActivationFusionTest, DisabledByDefault) {
+  unsetenv(kFusionEnvVar);
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* relu = AddConvChain(g.get(), TensorShape({1, 4, 4, 2}),
+                            TensorShape({3, 3, 2, 3}), 1, "SAME", "Relu");
+  test::graph::Identity(g.get(), relu);
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunFusionPass(&g));
+
+  EXPECT_EQ(1, CountNodes(*g, "Conv2D"));
+  EXPECT_EQ(0, CountNodes(*g, "_FusedConv2DBiasActivation"));
+}
+
+TEST_F(ConvBiasActivationFusionTest, FusesChain) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* relu = AddConvChain(g.get(), TensorShape({1, 4, 4, 2}),
+                            TensorShape({3, 3, 2, 3}), 1, "SAME", "Relu");
+  Node* identity = test::graph::Identity(g.get(), relu);
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunFusionPass(&g));
+
+  EXPECT_EQ(0, CountNodes(*g, "Conv2D"));
+  EXPECT_EQ(0, CountNodes(*g, "BiasAdd"));
+  EXPECT_EQ(0, CountNodes(*g, "Relu"));
+  ASSERT_EQ(1, CountNodes(*g, "_FusedConv2DBiasActivation"));
+  for (const Node* n : g->nodes()) {
+    if (n->type_string() != "_FusedConv2DBiasActivation") continue;
+    EXPECT_EQ("activation", n->name());
+    EXPECT_EQ(kCpu, n->assigned_device_name());
+    string activation;
+    TF_ASSERT_OK(GetNodeAttr(n->def(), "activation", &activation));
+    EXPECT_EQ("Relu", activation);
+    ASSERT_EQ(1, n->out_edges().size());
+    EXPECT_EQ(identity, (*n->out_edges().begin())->dst());
+  }
+}
+
+TEST_F(ConvBiasActivationFusionTest, RunsBeforeMarkingConstantWeights) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  // The filter is a Const, so a Conv2D would be marked.
+  Node* relu = AddConvChain(g.get(), TensorShape({1, 4, 4, 2}),
+                            TensorShape({3, 3, 2, 3}), 1, "SAME", "Relu");
+  test::graph::Identity(g.get(), relu);
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunFusionPass(&g));
+
+  ASSERT_EQ(1, CountNodes(*g, "_FusedConv2DBiasActivation"));
+  for (const Node* n : g->nodes()) {
+    if (n->type_string() != "_FusedConv2DBiasActivation") continue;
+    EXPECT_EQ(0, n->def().attr().count(kConstantWeightsAttr));
+  }
+}
+
+TEST_F(ConvBiasActivationFusionTest, FusesConvAndBiasOnly) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* bias_add = AddConvChain(g.get(), TensorShape({1, 4, 4, 2}),
+                                TensorShape({3, 3, 2, 3}), 1, "SAME", "");
+  test::graph::Identity(g.get(), bias_add);
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunFusionPass(&g));
+
+  EXPECT_EQ(0, CountNodes(*g, "Conv2D"));
+  ASSERT_EQ(1, CountNodes(*g, "_FusedConv2DBiasActivation"));
+  for (const Node* n : g->nodes()) {
+    if (n->type_string() != "_FusedConv2DBiasActivation") continue;
+    string activation;
+    TF_ASSERT_OK(GetNodeAttr(n->def(), "activation", &activation));
+    EXPECT_EQ("None", activation);
+  }
+}
+
+TEST_F(ConvBiasActivationFusionTest, KeepsUsedIntermediateResults) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* relu = AddConvChain(g.get(), TensorShape({1, 4, 4, 2}),
+                            TensorShape({3, 3, 2, 3}), 1, "SAME", "Relu");
+  test::graph::Identity(g.get(), relu);
+  // The convolution output has a second consumer.
+  Node* conv = nullptr;
+  for (Node* n : g->nodes()) {
+    if (n->type_string() == "Conv2D") conv = n;
+  }
+  ASSERT_NE(nullptr, conv);
+  test::graph::Identity(g.get(), conv);
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunFusionPass(&g));
+
+  EXPECT_EQ(1, CountNodes(*g, "Conv2D"));
+  EXPECT_EQ(0, CountNodes(*g, "_FusedConv2DBiasActivation"));
+}
+
+TEST_F(ConvBiasActivationFusionTest, SkipsNonCpuDevices) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* relu = AddConvChain(g.get(), TensorShape({1, 4, 4, 2}),
+                            TensorShape({3, 3, 2, 3}), 1, "SAME", "Relu");
+  test::graph::Identity(g.get(), relu);
+  AssignDevice(g.get(), "/job:localhost/replica:0/task:0/gpu:0");
+  TF_ASSERT_OK(RunFusionPass(&g));
+
+  EXPECT_EQ(1, CountNodes(*g, "Conv2D"));
+  EXPECT_EQ(0, CountNodes(*g, "_FusedConv2DBiasActivation"));
+}
+
+// Runs the graph built by AddConvChain() with and without the fusion, and
+// checks that the results match.
+void ExpectFusedMatchesUnfused(const TensorShape& input_shape,
+                               const TensorShape& filter_shape, int stride,
+                               const string& padding,
+                               const string& activation) {
+  Graph g(OpRegistry::Global());
+  Node* output = AddConvChain(&g, input_shape, filter_shape, stride, padding,
+                              activation);
+  GraphDef graph_def;
+  g.ToGraphDef(&graph_def);
+
+  std::vector<Tensor> results;
+  for (bool optimize : {false, true}) {
+    SessionOptions options;
+    if (!optimize) {
+      options.config.mutable_graph_options()
+          ->mutable_optimizer_options()
+          ->set_opt_level(OptimizerOptions::L0);
+    }
+    std::unique_ptr<Session> session(NewSession(options));
+    TF_ASSERT_OK(session->Create(graph_def));
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {output->name()}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    results.push_back(outputs[0]);
+  }
+  test::ExpectTensorNear<float>(results[0], results[1], 1e-4);
+}
+
+TEST_F(ConvBiasActivationFusionTest, MatchesUnfusedResults) {
+  ExpectFusedMatchesUnfused(TensorShape({2, 7, 6, 3}),
+                            TensorShape({3, 3, 3, 4}), 1, "SAME", "Relu");
+  ExpectFusedMatchesUnfused(TensorShape({1, 9, 8, 2}),
+                            TensorShape({3, 2, 2, 5}), 2, "VALID", "Relu6");
+  ExpectFusedMatchesUnfused(TensorShape({2, 5, 5, 16}),
+                            TensorShape({1, 1, 16, 8}), 1, "SAME", "Relu");
+  ExpectFusedMatchesUnfused(TensorShape({1, 35, 35, 32}),
+                            TensorShape({5, 5, 32, 64}), 1, "SAME", "");
+}
+
+// Runs a SAME convolution of a batch of 8 56x56x64 images with a
+// `filter_size` x `filter_size` x 64 x 64 filter, followed by a bias add and
+// Relu, either as separate Conv2D, BiasAdd and Relu kernels or as one
+// _FusedConv2DBiasActivation kernel.
+static void BM_ConvBiasRelu(int iters, int filter_size, int fused) {
+  testing::StopTiming();
+  const int64 batch = 8, rows = 56, cols = 56, depth = 64;
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* input =
+      test::graph::Constant(g, RandomTensor({batch, rows, cols, depth}));
+  Node* filter = test::graph::Constant(
+      g, RandomTensor({filter_size, filter_size, depth, depth}));
+  Node* bias = test::graph::Constant(g, RandomTensor({depth}));
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("fused"), "_FusedConv2DBiasActivation")
+                    .Input(input)
+                    .Input(filter)
+                    .Input(bias)
+                    .Attr("T", DT_FLOAT)
+                    .Attr("strides", {1, 1, 1, 1})
+                    .Attr("padding", "SAME")
+                    .Attr("activation", "Relu")
+                    .Finalize(g, nullptr));
+  } else {
+    Node* conv;
+    TF_CHECK_OK(NodeBuilder(g->NewName("conv"), "Conv2D")
+                    .Input(input)
+                    .Input(filter)
+                    .Attr("T", DT_FLOAT)
+                    .Attr("strides", {1, 1, 1, 1})
+                    .Attr("padding", "SAME")
+                    .Finalize(g, &conv));
+    Node* bias_add;
+    TF_CHECK_OK(NodeBuilder(g->NewName("bias_add"), "BiasAdd")
+                    .Input(conv)
+                    .Input(bias)
+                    .Attr("T", DT_FLOAT)
+                    .Finalize(g, &bias_add));
+    TF_CHECK_OK(NodeBuilder(g->NewName("relu"), "Relu")
+                    .Input(bias_add)
+                    .Attr("T", DT_FLOAT)
+                    .Finalize(g, nullptr));
+  }
+  // Multiply-adds of the convolution.
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch * rows * cols *
+                          filter_size * filter_size * depth * depth);
+  testing::UseRealTime();
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+BENCHMARK(BM_ConvBiasRelu)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(3, 0)
+    ->ArgPair(3, 1);
+
+}  // namespace
+}  // namespace tensorflow
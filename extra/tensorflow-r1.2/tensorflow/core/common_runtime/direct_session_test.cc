@@ -1221,5 +1221,59 @@ void BM_FeedFetch(int iters, int num_feeds) {
 
 BENCHMARK(BM_FeedFetch)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
 
+// A benchmark for the step time of a wide graph: one long chain of matrix
+// products next to many independent single products, as in the towers of
+// inception. When the executor starts the nodes of the chain first, the
+// short branches fill the idle threads instead of delaying the chain.
+void WideGraphBenchmarkHelper(int iters, bool critical_path_priority) {
+  testing::StopTiming();
+  const int kChainLength = 16;
+  const int kNumBranches = 32;
+
+  Tensor value(DT_FLOAT, TensorShape({128, 128}));
+  value.flat<float>().setRandom();
+
+  Graph g(OpRegistry::Global());
+  Node* x = test::graph::Constant(&g, value);
+  std::vector<NodeBuilder::NodeOut> outputs;
+  for (int i = 0; i < kNumBranches; ++i) {
+    outputs.emplace_back(test::graph::Matmul(&g, x, x, false, false));
+  }
+  Node* chain = x;
+  for (int i = 0; i < kChainLength; ++i) {
+    chain = test::graph::Matmul(&g, chain, x, false, false);
+  }
+  outputs.emplace_back(chain);
+  Node* sum;
+  TF_CHECK_OK(NodeBuilder(g.NewName("sum"), "AddN")
+                  .Input(outputs)
+                  .Finalize(&g, &sum));
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+
+  SessionOptions opts;
+  opts.config.set_inter_op_parallelism_threads(2);
+  opts.config.set_intra_op_parallelism_threads(1);
+  opts.config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_critical_path_priority(critical_path_priority);
+  std::unique_ptr<Session> sess(NewSession(opts));
+  TF_CHECK_OK(sess->Create(gd));
+  std::vector<Tensor> output_values;
+  // Ignore the first run, which optimizes and partitions the graph.
+  TF_CHECK_OK(sess->Run({}, {sum->name() + ":0"}, {}, &output_values));
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(sess->Run({}, {sum->name() + ":0"}, {}, &output_values));
+  }
+  testing::StopTiming();
+}
+
+void BM_WideGraph(int iters, int critical_path_priority) {
+  WideGraphBenchmarkHelper(iters, critical_path_priority != 0);
+}
+
+BENCHMARK(BM_WideGraph)->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace tensorflow
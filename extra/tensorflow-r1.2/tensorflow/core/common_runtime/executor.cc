@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/executor.h"
 
+#include <algorithm>
 #include <atomic>
 #include <deque>
 #include <memory>
@@ -236,6 +237,10 @@ struct NodeItem {
 
   PendingCounts::Handle pending_id;
 
+  // Predicted time from the start of this node to the end of the graph, from
+  // the "_critical_path_ns" attribute set by grappler. Zero if unknown.
+  int64 critical_path_ns = 0;
+
   const EdgeInfo* output_edge_list() const { return output_edge_base(); }
 
   // ith output edge.
@@ -417,6 +422,10 @@ class ExecutorImpl : public Executor {
   // A cached value of params_
   bool device_record_tensor_accesses_ = false;
 
+  // True iff some node carries a critical path length, in which case batches
+  // of ready nodes are started in order of decreasing critical path.
+  bool prioritize_critical_path_ = false;
+
   // Root nodes (with no in edges) that should form the initial ready queue
   std::vector<const Node*> root_nodes_;
 
@@ -654,6 +663,11 @@ Status ExecutorImpl::Initialize() {
     item->is_sink = IsSink(n);
     item->is_enter_exit_or_next_iter =
         (IsEnter(n) || IsExit(n) || IsNextIteration(n));
+    const auto critical_path = n->def().attr().find(kCriticalPathAttr);
+    if (critical_path != n->def().attr().end()) {
+      item->critical_path_ns = critical_path->second.i();
+      prioritize_critical_path_ = true;
+    }
 
     // Compute the maximum values we'll store for this node in the
     // pending counts data structure, and allocate a handle in
@@ -1261,6 +1275,12 @@ class ExecutorState {
   void ScheduleReady(const TaggedNodeSeq& ready,
                      TaggedNodeReadyQueue* inline_ready);
 
+  // Like ScheduleReady(), but starts the nodes with the longest critical
+  // paths first.
+  void ScheduleReadyByCriticalPath(const TaggedNodeSeq& ready,
+                                   int64 scheduled_usec,
+                                   TaggedNodeReadyQueue* inline_ready);
+
   // For debugging/logging only.
   inline void MaybeMarkCompleted(FrameState* frame, int64 iter, int64 id);
 
@@ -2050,6 +2070,10 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   if (stats_collector_) {
     scheduled_usec = nodestats::NowInUsec();
   }
+  if (impl_->prioritize_critical_path_ && ready.size() > 1) {
+    ScheduleReadyByCriticalPath(ready, scheduled_usec, inline_ready);
+    return;
+  }
   if (inline_ready == nullptr) {
     // Schedule to run all the ready ops in thread pool.
     for (auto& tagged_node : ready) {
@@ -2087,6 +2111,50 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   }
 }
 
+void ExecutorState::ScheduleReadyByCriticalPath(
+    const TaggedNodeSeq& ready, int64 scheduled_usec,
+    TaggedNodeReadyQueue* inline_ready) {
+  const GraphView& gview = impl_->gview_;
+  TaggedNodeSeq sorted(ready);
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [&gview](const TaggedNode& a, const TaggedNode& b) {
+                     return gview.node(a.node->id())->critical_path_ns >
+                            gview.node(b.node->id())->critical_path_ns;
+                   });
+
+  // The nodes are handed to the thread pool in order of decreasing critical
+  // path. Idle threads steal the oldest closures first, so the longest chains
+  // are picked up first when the pool has spare threads.
+  if (inline_ready == nullptr) {
+    for (auto& tagged_node : sorted) {
+      runner_([=]() { Process(tagged_node, scheduled_usec); });
+    }
+    return;
+  }
+  for (auto& tagged_node : sorted) {
+    const NodeItem& item = *gview.node(tagged_node.node->id());
+    if (tagged_node.is_dead || !item.kernel_is_expensive) {
+      inline_ready->push_back(tagged_node);
+    }
+  }
+  // Keep the most critical expensive node on this thread if there is nothing
+  // else for it to run, as ScheduleReady() does.
+  bool run_inline = inline_ready->empty();
+  for (auto& tagged_node : sorted) {
+    const NodeItem& item = *gview.node(tagged_node.node->id());
+    if (tagged_node.is_dead || !item.kernel_is_expensive) {
+      continue;
+    }
+    if (run_inline) {
+      inline_ready->push_back(tagged_node);
+      run_inline = false;
+    } else {
+      runner_(std::bind(&ExecutorState::Process, this, tagged_node,
+                        scheduled_usec));
+    }
+  }
+}
+
 inline void ExecutorState::MaybeMarkCompleted(FrameState* frame, int64 iter,
                                               int64 node_id) {
   // TODO(misard) Replace with a finer-grain enabling flag once we
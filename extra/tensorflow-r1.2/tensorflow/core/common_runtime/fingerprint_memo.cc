@@ -0,0 +1,35 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/fingerprint_memo.h"
+
+#include <unordered_set>
+
+namespace tensorflow {
+
+bool CanMemoizeValuesOf(const Graph& graph) {
+  // The ops whose outputs depend on the file system, although they are not
+  // stateful.
+  static const std::unordered_set<string>* external_state_ops =
+      new std::unordered_set<string>({"ImmutableConst", "MatchingFiles",
+                                      "ReadFile", "Restore", "RestoreSlice",
+                                      "RestoreV2"});
+  for (const Node* n : graph.nodes()) {
+    if (external_state_ops->count(n->type_string()) > 0) return false;
+  }
+  return true;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,117 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_FINGERPRINT_MEMO_H_
+#define TENSORFLOW_COMMON_RUNTIME_FINGERPRINT_MEMO_H_
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A thread-safe memo of values keyed by fingerprint, meant to be shared
+// within a process so that the same work, e.g. on graphs that are imported
+// or optimized repeatedly, is only done once. The oldest entries are evicted
+// first once the memo is full.
+template <typename T>
+class FingerprintMemo {
+ public:
+  // Holds at most "max_entries" values. If "max_bytes" is positive, also
+  // evicts entries while the values take more than "max_bytes" as measured
+  // by "byte_size", and never holds a value larger than that.
+  explicit FingerprintMemo(
+      size_t max_entries, int64 max_bytes = 0,
+      std::function<int64(const T&)> byte_size = nullptr)
+      : max_entries_(max_entries),
+        max_bytes_(max_bytes),
+        byte_size_(std::move(byte_size)) {}
+
+  // Sets *value to the value memoized for "key", and returns true if there
+  // is one.
+  bool Lookup(const Fprint128& key, T* value) {
+    mutex_lock l(mu_);
+    auto iter = entries_.find(key);
+    if (iter == entries_.end()) return false;
+    *value = iter->second;
+    ++hits_;
+    return true;
+  }
+
+  // Memoizes "value" for "key", unless there already is a value for it.
+  void Insert(const Fprint128& key, const T& value) {
+    const int64 bytes = max_bytes_ > 0 ? byte_size_(value) : 0;
+    if (max_bytes_ > 0 && bytes > max_bytes_) return;
+    mutex_lock l(mu_);
+    if (!entries_.insert({key, value}).second) return;
+    keys_.push_back(key);
+    total_bytes_ += bytes;
+    while (keys_.size() > max_entries_ ||
+           (max_bytes_ > 0 && total_bytes_ > max_bytes_)) {
+      auto oldest = entries_.find(keys_.front());
+      if (max_bytes_ > 0) total_bytes_ -= byte_size_(oldest->second);
+      entries_.erase(oldest);
+      keys_.pop_front();
+    }
+  }
+
+  // Removes all the entries, and resets the count of hits.
+  void Clear() {
+    mutex_lock l(mu_);
+    entries_.clear();
+    keys_.clear();
+    total_bytes_ = 0;
+    hits_ = 0;
+  }
+
+  // Returns the number of successful lookups since the memo was created or
+  // last cleared.
+  int64 hits() {
+    mutex_lock l(mu_);
+    return hits_;
+  }
+
+ private:
+  const size_t max_entries_;
+  const int64 max_bytes_;
+  const std::function<int64(const T&)> byte_size_;
+
+  mutex mu_;
+  std::unordered_map<Fprint128, T, Fprint128Hasher> entries_ GUARDED_BY(mu_);
+  // The keys of entries_ in insertion order.
+  std::deque<Fprint128> keys_ GUARDED_BY(mu_);
+  int64 total_bytes_ GUARDED_BY(mu_) = 0;
+  int64 hits_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FingerprintMemo);
+};
+
+// Returns false if the values computed by "graph" depend on more than the
+// graph, e.g. on the contents of files read by ops that are not stateful but
+// can still be evaluated ahead of time. Such values must not be memoized
+// across graphs.
+bool CanMemoizeValuesOf(const Graph& graph);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_FINGERPRINT_MEMO_H_
@@ -0,0 +1,67 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/fingerprint_memo.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+Fprint128 Key(uint64 i) { return {i, i}; }
+
+TEST(FingerprintMemoTest, LookupAndHits) {
+  FingerprintMemo<int> memo(10);
+  int value = 0;
+  EXPECT_FALSE(memo.Lookup(Key(1), &value));
+  memo.Insert(Key(1), 5);
+  // The first value inserted for a key is kept.
+  memo.Insert(Key(1), 6);
+  EXPECT_TRUE(memo.Lookup(Key(1), &value));
+  EXPECT_EQ(5, value);
+  EXPECT_EQ(1, memo.hits());
+
+  memo.Clear();
+  EXPECT_EQ(0, memo.hits());
+  EXPECT_FALSE(memo.Lookup(Key(1), &value));
+}
+
+TEST(FingerprintMemoTest, EvictsOldestEntries) {
+  FingerprintMemo<int> memo(2);
+  memo.Insert(Key(1), 1);
+  memo.Insert(Key(2), 2);
+  memo.Insert(Key(3), 3);
+  int value;
+  EXPECT_FALSE(memo.Lookup(Key(1), &value));
+  EXPECT_TRUE(memo.Lookup(Key(2), &value));
+  EXPECT_TRUE(memo.Lookup(Key(3), &value));
+}
+
+TEST(FingerprintMemoTest, EvictsByBytes) {
+  FingerprintMemo<int> memo(10, 10, [](const int& v) -> int64 { return v; });
+  // Larger than the whole memo.
+  memo.Insert(Key(1), 11);
+  memo.Insert(Key(2), 4);
+  memo.Insert(Key(3), 4);
+  memo.Insert(Key(4), 4);
+  int value;
+  EXPECT_FALSE(memo.Lookup(Key(1), &value));
+  EXPECT_FALSE(memo.Lookup(Key(2), &value));
+  EXPECT_TRUE(memo.Lookup(Key(3), &value));
+  EXPECT_TRUE(memo.Lookup(Key(4), &value));
+}
+
+}  // namespace
+}  // namespace tensorflow
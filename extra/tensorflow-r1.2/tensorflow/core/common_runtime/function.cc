@@ -16,14 +16,18 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/function.h"
 
 #include <deque>
+#include <unordered_map>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/fingerprint_memo.h"
 #include "tensorflow/core/common_runtime/graph_optimizer.h"
 #include "tensorflow/core/common_runtime/memory_types.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
+#include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -32,7 +36,10 @@ limitations under the License.
 #include "tensorflow/core/graph/graph_constructor.h"
 #include "tensorflow/core/graph/optimizer_cse.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 
 // See core/kernels/function_ops.cc for related kernels.
 
@@ -183,6 +190,7 @@ class FunctionLibraryRuntimeImpl : public FunctionLibraryRuntime {
   const int graph_def_version_;
   const FunctionLibraryDefinition* const lib_def_;
   GraphOptimizer optimizer_;
+  const OptimizerOptions optimizer_options_;
   const CustomKernelCreator custom_kernel_creator_;
 
   std::function<Status(const string&, const OpDef**)> get_func_sig_;
@@ -203,6 +211,9 @@ class FunctionLibraryRuntimeImpl : public FunctionLibraryRuntime {
   struct Item : public core::RefCounted {
     const Graph* graph = nullptr;  // Owned by exec.
     Executor* exec = nullptr;
+    // True iff the graph contains send or recv nodes, which need a
+    // rendezvous to run.
+    bool has_send_recv = false;
 
     ~Item() override { delete this->exec; }
   };
@@ -211,6 +222,10 @@ class FunctionLibraryRuntimeImpl : public FunctionLibraryRuntime {
   Status FunctionDefToBody(const FunctionDef& fdef,
                            const InstantiateAttrValueMap& attrs,
                            FunctionBody** fbody);
+  bool IsCacheable(const Graph& g) const;
+  Fprint128 GraphFingerprint(const Graph& g) const;
+  Status OptimizeItemGraph(const FunctionBody* fbody,
+                           std::unique_ptr<Graph>* g);
   Status CreateItem(Handle handle, Item** item);
   Status GetOrCreateItem(Handle handle, Item** item);
   Status InstantiateSymbolicGradient(const NameAttrList& func,
@@ -230,6 +245,7 @@ FunctionLibraryRuntimeImpl::FunctionLibraryRuntimeImpl(
       graph_def_version_(graph_def_version),
       lib_def_(lib_def),
       optimizer_(optimizer_options),
+      optimizer_options_(optimizer_options),
       custom_kernel_creator_(std::move(custom_kernel_creator)) {
   get_func_sig_ = [this](const string& op, const OpDef** sig) {
     return lib_def_->LookUpOpDef(op, sig);
@@ -473,13 +489,79 @@ void OptimizeGraph(FunctionLibraryRuntime* lib, std::unique_ptr<Graph>* g) {
   optimizer.Optimize(lib, lib->env(), lib->device(), g);
 }
 
+namespace {
+
+// The optimized graphs of function bodies, by their fingerprints.
+FingerprintMemo<GraphDef>* FunctionGraphCache() {
+  static FingerprintMemo<GraphDef>* cache =
+      new FingerprintMemo<GraphDef>(1024 /* max_entries */);
+  return cache;
+}
+
+}  // end namespace
+
+// The optimized graph only depends on the function body, unless the body
+// calls other functions of the library, which may be inlined.
+bool FunctionLibraryRuntimeImpl::IsCacheable(const Graph& g) const {
+  if (!optimizer_options_.cache_function_graphs()) return false;
+  for (const Node* n : g.nodes()) {
+    if (n->type_string() == kGradientOp ||
+        lib_def_->Find(n->type_string()) != nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Fprint128 FunctionLibraryRuntimeImpl::GraphFingerprint(const Graph& g) const {
+  GraphDef graph_def;
+  g.ToGraphDef(&graph_def);
+  string serialized;
+  SerializeToStringDeterministic(graph_def, &serialized);
+  strings::StrAppend(&serialized, "\n", device_->device_type(), "\n",
+                     device_->name(), "\n", graph_def_version_, "\n",
+                     optimizer_options_.SerializeAsString());
+  return Fingerprint128(serialized);
+}
+
+void ClearFunctionGraphCache() { FunctionGraphCache()->Clear(); }
+
+int64 FunctionGraphCacheHits() { return FunctionGraphCache()->hits(); }
+
+// Sets *g to the optimized graph of "fbody", reusing the graph optimized by
+// another runtime when possible.
+Status FunctionLibraryRuntimeImpl::OptimizeItemGraph(
+    const FunctionBody* fbody, std::unique_ptr<Graph>* g) {
+  const bool cacheable = IsCacheable(*fbody->graph);
+  Fprint128 fingerprint = {0, 0};
+  GraphDef graph_def;
+  if (cacheable) {
+    fingerprint = GraphFingerprint(*fbody->graph);
+    if (FunctionGraphCache()->Lookup(fingerprint, &graph_def)) {
+      VLOG(1) << "Reusing the optimized graph of a function body";
+      GraphConstructorOptions opts;
+      opts.allow_internal_ops = true;
+      opts.expect_device_spec = false;
+      g->reset(new Graph(lib_def_));
+      return ConvertGraphDefToGraph(opts, graph_def, g->get());
+    }
+  }
+
+  g->reset(new Graph(lib_def_));
+  CopyGraph(*fbody->graph, g->get());
+  optimizer_.Optimize(this, env(), device(), g);
+  if (cacheable) {
+    (*g)->ToGraphDef(&graph_def);
+    FunctionGraphCache()->Insert(fingerprint, graph_def);
+  }
+  return Status::OK();
+}
+
 Status FunctionLibraryRuntimeImpl::CreateItem(Handle handle, Item** item) {
   const FunctionBody* fbody = GetFunctionBody(handle);
   CHECK_NOTNULL(fbody);
-  std::unique_ptr<Graph> g(new Graph(lib_def_));
-  CopyGraph(*fbody->graph, g.get());
-
-  optimizer_.Optimize(this, env(), device(), &g);
+  std::unique_ptr<Graph> g;
+  TF_RETURN_IF_ERROR(OptimizeItemGraph(fbody, &g));
   TF_RETURN_IF_ERROR(EnsureMemoryTypes(DeviceType(device()->device_type()),
                                        device()->name(), g.get()));
 
@@ -493,12 +575,20 @@ Status FunctionLibraryRuntimeImpl::CreateItem(Handle handle, Item** item) {
     DeleteNonCachedKernel(kernel);
   };
   Graph* graph = g.get();
+  bool has_send_recv = false;
+  for (const Node* n : graph->nodes()) {
+    if (n->IsSend() || n->IsRecv()) {
+      has_send_recv = true;
+      break;
+    }
+  }
   Executor* exec;
   TF_RETURN_IF_ERROR(NewLocalExecutor(params, g.release(), &exec));
 
   *item = new Item;
   (*item)->graph = graph;
   (*item)->exec = exec;
+  (*item)->has_send_recv = has_send_recv;
   return Status::OK();
 }
 
@@ -560,9 +650,11 @@ void FunctionLibraryRuntimeImpl::Run(const Options& opts, Handle handle,
   exec_args.call_frame = frame;
   exec_args.cancellation_manager = opts.cancellation_manager;
   exec_args.runner = *opts.runner;
-  // TODO(zhifengc): we can avoid creating rendez here if we know
-  // there is no send/recv nodes in the graph.
-  auto* rendez = new IntraProcessRendezvous(device_mgr_);
+  // Only functions with send/recv nodes need a rendezvous.
+  IntraProcessRendezvous* rendez = nullptr;
+  if (item->has_send_recv) {
+    rendez = new IntraProcessRendezvous(device_mgr_);
+  }
   exec_args.rendezvous = rendez;
   item->exec->RunAsync(
       // Executor args
@@ -570,7 +662,7 @@ void FunctionLibraryRuntimeImpl::Run(const Options& opts, Handle handle,
       // Done callback.
       [item, frame, rets, rendez, done](const Status& status) {
         item->Unref();
-        rendez->Unref();
+        if (rendez != nullptr) rendez->Unref();
         Status s = status;
         if (s.ok()) {
           s = frame->GetRetvals(rets);
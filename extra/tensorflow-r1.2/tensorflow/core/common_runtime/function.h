@@ -62,6 +62,15 @@ FunctionLibraryRuntime* NewFunctionLibraryRuntime(
     int graph_def_version, const FunctionLibraryDefinition* lib_def,
     const OptimizerOptions& optimizer_options);
 
+// Empties the cache of optimized function graphs shared by the runtimes
+// created with OptimizerOptions.cache_function_graphs, and resets its count
+// of hits. Mainly useful for tests.
+void ClearFunctionGraphCache();
+
+// Returns the number of times a runtime reused a cached optimized graph
+// instead of optimizing a function body since the cache was last cleared.
+int64 FunctionGraphCacheHits();
+
 // FunctionLibraryRuntime::GetFunctionBody returns a description of an
 // instantiated function that is represented as a Graph with arg/ret
 // nodes annotated.
@@ -140,11 +140,11 @@ class FunctionLibraryRuntimeTest : public ::testing::Test {
       : device_(DeviceFactory::NewDevice("CPU", {},
                                          "/job:localhost/replica:0/task:0")) {}
 
-  void Init(const std::vector<FunctionDef>& flib) {
+  void Init(const std::vector<FunctionDef>& flib,
+            const OptimizerOptions& opts = OptimizerOptions()) {
     FunctionDefLibrary proto;
     for (const auto& fdef : flib) *(proto.add_function()) = fdef;
     lib_def_.reset(new FunctionLibraryDefinition(OpRegistry::Global(), proto));
-    OptimizerOptions opts;
     lib_.reset(NewFunctionLibraryRuntime(nullptr, Env::Default(), device_.get(),
                                          TF_GRAPH_DEF_VERSION, lib_def_.get(),
                                          opts));
@@ -921,6 +921,31 @@ TEST_F(FunctionLibraryRuntimeTest, Gradient_AddSum) {
   }
 }
 
+TEST_F(FunctionLibraryRuntimeTest, CacheFunctionGraphs) {
+  OptimizerOptions opts;
+  opts.set_cache_function_graphs(true);
+  auto x = test::AsTensor<float>({1, 2, 3, 4});
+  ClearFunctionGraphCache();
+  // The second runtime runs the graph optimized by the first one.
+  for (int i = 0; i < 2; ++i) {
+    Init({test::function::XTimesTwo(), test::function::XTimesFour()}, opts);
+    Tensor y;
+    TF_CHECK_OK(Run("XTimesTwo", {{"T", DT_FLOAT}}, {x}, {&y}));
+    test::ExpectTensorEqual<float>(y, test::AsTensor<float>({2, 4, 6, 8}));
+    EXPECT_EQ(i, FunctionGraphCacheHits());
+    // XTimesFour calls XTimesTwo, so its graph is not cached.
+    TF_CHECK_OK(Run("XTimesFour", {{"T", DT_FLOAT}}, {x}, {&y}));
+    test::ExpectTensorEqual<float>(y, test::AsTensor<float>({4, 8, 12, 16}));
+    EXPECT_EQ(i, FunctionGraphCacheHits());
+  }
+
+  // Without the option, the cache is not used.
+  Init({test::function::XTimesTwo()});
+  Tensor y;
+  TF_CHECK_OK(Run("XTimesTwo", {{"T", DT_FLOAT}}, {x}, {&y}));
+  EXPECT_EQ(1, FunctionGraphCacheHits());
+}
+
 namespace {
 
 bool DoNothing(Graph* g) { return false; }
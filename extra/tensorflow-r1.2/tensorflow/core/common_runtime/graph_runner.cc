@@ -96,7 +96,11 @@ class SimpleRendezvous : public Rendezvous {
 
 }  // namespace
 
-GraphRunner::GraphRunner(Env* env) : cpu_device_(GetCPUDevice(env)) {}
+GraphRunner::GraphRunner(Env* env) : GraphRunner(env, false) {}
+
+GraphRunner::GraphRunner(Env* env, bool use_cpu_thread_pool)
+    : cpu_device_(GetCPUDevice(env)),
+      use_cpu_thread_pool_(use_cpu_thread_pool) {}
 
 GraphRunner::~GraphRunner() {}
 
@@ -140,9 +144,22 @@ Status GraphRunner::Run(Graph* graph, FunctionLibraryRuntime* function_library,
   // Create the local executor and the Rendezvous for fetching back the
   // constants.
 
-  // Run operators on the local thread. We should not need concurrency here; we
-  // should not be running expensive operators.
-  auto runner = [](Executor::Args::Closure c) { c(); };
+  // Run operators on the local thread by default. We should not need
+  // concurrency here; we should not be running expensive operators. Callers
+  // evaluating many of them at once can opt into the CPU thread pool, unless
+  // this is already running on it and would block one of its threads.
+  thread::ThreadPool* pool = nullptr;
+  if (use_cpu_thread_pool_) {
+    pool = cpu_device_->tensorflow_cpu_worker_threads()->workers;
+    if (pool->CurrentThreadId() != -1) pool = nullptr;
+  }
+  auto runner = [pool](Executor::Args::Closure c) {
+    if (pool != nullptr) {
+      pool->Schedule(std::move(c));
+    } else {
+      c();
+    }
+  };
 
   // Take ownership and pass to NewLocalExecutor
   Graph* g = graph_to_run.release();
@@ -42,6 +42,11 @@ class GraphRunner {
  public:
   // REQUIRES: `env` is not nullptr.
   GraphRunner(Env* env);
+  // If `use_cpu_thread_pool` is true, independent operators are run
+  // concurrently on the intra-op thread pool of the CPU device, which is
+  // shared by the local devices of the process, instead of one at a time on
+  // the calling thread.
+  GraphRunner(Env* env, bool use_cpu_thread_pool);
   ~GraphRunner();
 
   // Function semantics for `inputs`, `output_names` and `outputs`
@@ -60,6 +65,7 @@ class GraphRunner {
 
  private:
   std::unique_ptr<Device> cpu_device_;
+  const bool use_cpu_thread_pool_;
 };
 
 }  // namespace tensorflow
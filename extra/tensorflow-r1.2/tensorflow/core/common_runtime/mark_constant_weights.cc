@@ -0,0 +1,79 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns true if input `index` of `n` is produced by a Const node, possibly
+// through Identity nodes, all of which run on the device of `n`. Such an
+// input is the same immutable buffer on every step.
+bool IsConstantInput(const Node* n, int index) {
+  const Edge* edge;
+  if (!n->input_edge(index, &edge).ok()) return false;
+  const Node* src = edge->src();
+  while (src->type_string() == "Identity") {
+    if (src->assigned_device_name() != n->assigned_device_name() ||
+        !src->input_edge(0, &edge).ok()) {
+      return false;
+    }
+    src = edge->src();
+  }
+  return src->type_string() == "Const" &&
+         src->assigned_device_name() == n->assigned_device_name();
+}
+
+// Sets kConstantWeightsAttr on MatMul and Conv2D nodes whose weights are
+// constant, so that their kernels can cache a repacked copy of the weights
+// across steps. Runs after placement, since a constant on another device
+// arrives in a new buffer on every step, and after the Conv2D fusion pass
+// (conv_bias_activation_fusion.cc), since fused convolutions do not use the
+// cache. Disabled at OptimizerOptions::L0.
+class MarkConstantWeightsPass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override {
+    if (options.graph == nullptr) return Status::OK();
+    if (options.session_options != nullptr &&
+        options.session_options->config.graph_options()
+                .optimizer_options()
+                .opt_level() == OptimizerOptions::L0) {
+      return Status::OK();
+    }
+    int num_marked = 0;
+    for (Node* n : options.graph->get()->nodes()) {
+      if (n->type_string() != "MatMul" && n->type_string() != "Conv2D") {
+        continue;
+      }
+      if (IsConstantInput(n, 1)) {
+        n->AddAttr(kConstantWeightsAttr, true);
+        ++num_marked;
+      }
+    }
+    if (num_marked > 0) {
+      VLOG(1) << "Marked " << num_marked << " nodes with constant weights";
+    }
+    return Status::OK();
+  }
+};
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::POST_REWRITE_FOR_EXEC, 2,
+                      MarkConstantWeightsPass);
+
+}  // namespace
+}  // namespace tensorflow
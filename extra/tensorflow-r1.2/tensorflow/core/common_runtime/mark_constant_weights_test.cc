@@ -0,0 +1,108 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+const char kCpu[] = "/job:localhost/replica:0/task:0/cpu:0";
+const char kOtherCpu[] = "/job:localhost/replica:0/task:1/cpu:0";
+
+void AssignDevice(Graph* g, const string& device) {
+  for (Node* n : g->nodes()) {
+    if (n->IsOp()) n->set_assigned_device_name(device);
+  }
+}
+
+Status RunPasses(std::unique_ptr<Graph>* g) {
+  GraphOptimizationPassOptions options;
+  options.graph = g;
+  return OptimizationPassRegistry::Global()->RunGrouping(
+      OptimizationPassRegistry::POST_REWRITE_FOR_EXEC, options);
+}
+
+bool HasConstantWeights(const Graph& g, const string& name) {
+  for (const Node* n : g.nodes()) {
+    if (n->name() != name) continue;
+    bool constant_weights = false;
+    return GetNodeAttr(n->def(), kConstantWeightsAttr, &constant_weights)
+               .ok() &&
+           constant_weights;
+  }
+  ADD_FAILURE() << "No node named " << name;
+  return false;
+}
+
+Node* MatMul(Graph* g, const string& name, Node* a, Node* b) {
+  Node* n;
+  TF_CHECK_OK(NodeBuilder(name, "MatMul")
+                  .Input(a)
+                  .Input(b)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &n));
+  return n;
+}
+
+TEST(MarkConstantWeightsTest, MarksConstantWeights) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* input = test::graph::Constant(g.get(), Tensor(DT_FLOAT, {2, 3}));
+  Node* weights = test::graph::Constant(g.get(), Tensor(DT_FLOAT, {3, 4}));
+  MatMul(g.get(), "direct", input, weights);
+  MatMul(g.get(), "through_identity", input,
+         test::graph::Identity(g.get(), weights));
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunPasses(&g));
+
+  EXPECT_TRUE(HasConstantWeights(*g, "direct"));
+  EXPECT_TRUE(HasConstantWeights(*g, "through_identity"));
+}
+
+TEST(MarkConstantWeightsTest, SkipsComputedWeights) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* input = test::graph::Constant(g.get(), Tensor(DT_FLOAT, {3, 3}));
+  Node* weights = test::graph::Constant(g.get(), Tensor(DT_FLOAT, {3, 3}));
+  Node* first = MatMul(g.get(), "first", input, weights);
+  MatMul(g.get(), "second", input, first);
+  AssignDevice(g.get(), kCpu);
+  TF_ASSERT_OK(RunPasses(&g));
+
+  EXPECT_TRUE(HasConstantWeights(*g, "first"));
+  EXPECT_FALSE(HasConstantWeights(*g, "second"));
+}
+
+TEST(MarkConstantWeightsTest, SkipsWeightsOnOtherDevices) {
+  std::unique_ptr<Graph> g(new Graph(OpRegistry::Global()));
+  Node* input = test::graph::Constant(g.get(), Tensor(DT_FLOAT, {2, 3}));
+  Node* weights = test::graph::Constant(g.get(), Tensor(DT_FLOAT, {3, 4}));
+  Node* matmul = MatMul(g.get(), "matmul", input, weights);
+  AssignDevice(g.get(), kOtherCpu);
+  matmul->set_assigned_device_name(kCpu);
+  TF_ASSERT_OK(RunPasses(&g));
+
+  EXPECT_FALSE(HasConstantWeights(*g, "matmul"));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,15 +14,25 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/shape_refiner.h"
 
+#include <algorithm>
 #include <deque>
 #include <memory>
 #include <unordered_set>
 #include <vector>
 
+#include "tensorflow/core/common_runtime/fingerprint_memo.h"
+#include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/common_shape_fns.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
@@ -31,6 +41,180 @@ using shape_inference::DimensionHandle;
 using shape_inference::InferenceContext;
 using shape_inference::ShapeHandle;
 
+namespace {
+
+// Describes how to rebuild an output of a shape function from the shapes
+// known to it: its inputs, the partial shapes of its input tensors, and the
+// outputs rebuilt before it. Dimensions are taken from the known shapes when
+// they are unknown, so that their identity is preserved.
+struct MemoizedShape {
+  // The index of the known shape that is the output, or -1.
+  int shape_index = -1;
+  // If shape_index is -1, the rank of the output, or -1 if unknown.
+  int32 rank = -1;
+  // For each dimension, the (shape index, dimension index) it is taken
+  // from, or (-1, value) for a new dimension. The shape index of the output
+  // itself refers to one of its own previous dimensions.
+  std::vector<std::pair<int, int64>> dims;
+};
+
+typedef std::vector<MemoizedShape> MemoizedShapeFnResult;
+
+// The memos below are shared by the ShapeRefiners of the process, so that
+// graphs that are imported repeatedly, e.g. in variants for several batch
+// sizes, do not repeat the same work.
+const size_t kMaxMemoEntries = 16384;
+
+// Tensors evaluated from constant subgraphs.
+FingerprintMemo<Tensor>* ConstantTensorMemo() {
+  static FingerprintMemo<Tensor>* memo =
+      new FingerprintMemo<Tensor>(kMaxMemoEntries);
+  return memo;
+}
+
+// The outputs of shape functions that use the values of their inputs.
+FingerprintMemo<MemoizedShapeFnResult>* ShapeFnMemo() {
+  static FingerprintMemo<MemoizedShapeFnResult>* memo =
+      new FingerprintMemo<MemoizedShapeFnResult>(kMaxMemoEntries);
+  return memo;
+}
+
+// Appends a deterministic serialization of 'message' to 'key', so that the
+// order of its maps does not change the key.
+void AppendToKey(const protobuf::MessageLite& message, string* key) {
+  string serialized;
+  SerializeToStringDeterministic(message, &serialized);
+  key->append(serialized);
+}
+
+void AppendToKey(const Tensor& tensor, string* key) {
+  TensorProto proto;
+  tensor.AsProtoTensorContent(&proto);
+  AppendToKey(proto, key);
+}
+
+// Finds the first dimension of 'shapes' that is 'dim'. Returns false if
+// there is none.
+bool FindDim(InferenceContext* c, const std::vector<ShapeHandle>& shapes,
+             DimensionHandle dim, std::pair<int, int64>* source) {
+  for (int k = 0; k < shapes.size(); ++k) {
+    if (!shapes[k].IsSet() || !c->RankKnown(shapes[k])) continue;
+    for (int j = 0; j < c->Rank(shapes[k]); ++j) {
+      if (c->Dim(shapes[k], j).SameHandle(dim)) {
+        *source = std::make_pair(k, j);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Appends the ranks and dimensions of 'shapes' to 'key'. Unknown dimensions
+// are identified by the first dimension of 'shapes' that they are, so that
+// the key captures which unknown dimensions are the same.
+void AppendToKey(InferenceContext* c, const std::vector<ShapeHandle>& shapes,
+                 string* key) {
+  for (ShapeHandle shape : shapes) {
+    if (!shape.IsSet()) {
+      key->append("|-");
+    } else if (!c->RankKnown(shape)) {
+      key->append("|?");
+    } else {
+      key->append("|");
+      for (int j = 0; j < c->Rank(shape); ++j) {
+        DimensionHandle dim = c->Dim(shape, j);
+        std::pair<int, int64> source;
+        if (c->ValueKnown(dim)) {
+          strings::StrAppend(key, c->Value(dim), ",");
+        } else if (FindDim(c, shapes, dim, &source)) {
+          strings::StrAppend(key, "?", source.first, ".", source.second, ",");
+        }
+      }
+    }
+  }
+}
+
+MemoizedShape MemoizeShape(InferenceContext* c,
+                           const std::vector<ShapeHandle>& known_shapes,
+                           ShapeHandle shape) {
+  MemoizedShape memoized;
+  for (int k = 0; k < known_shapes.size(); ++k) {
+    if (known_shapes[k].SameHandle(shape)) {
+      memoized.shape_index = k;
+      return memoized;
+    }
+  }
+  if (!c->RankKnown(shape)) return memoized;
+  memoized.rank = c->Rank(shape);
+  for (int j = 0; j < memoized.rank; ++j) {
+    DimensionHandle dim = c->Dim(shape, j);
+    std::pair<int, int64> source(-1, c->Value(dim));
+    if (!c->ValueKnown(dim) && !FindDim(c, known_shapes, dim, &source)) {
+      for (int i = 0; i < j; ++i) {
+        if (c->Dim(shape, i).SameHandle(dim)) {
+          source = std::make_pair(static_cast<int>(known_shapes.size()), i);
+          break;
+        }
+      }
+    }
+    memoized.dims.push_back(source);
+  }
+  return memoized;
+}
+
+ShapeHandle RebuildShape(InferenceContext* c,
+                         const std::vector<ShapeHandle>& known_shapes,
+                         const MemoizedShape& memoized) {
+  if (memoized.shape_index >= 0) return known_shapes[memoized.shape_index];
+  if (memoized.rank < 0) return c->UnknownShape();
+  std::vector<DimensionHandle> dims;
+  for (const auto& source : memoized.dims) {
+    if (source.first < 0) {
+      dims.push_back(c->MakeDim(source.second));
+    } else if (source.first == known_shapes.size()) {
+      dims.push_back(dims[source.second]);
+    } else {
+      dims.push_back(c->Dim(known_shapes[source.first], source.second));
+    }
+  }
+  return c->MakeShape(dims);
+}
+
+// Returns the shapes known to the shape function of 'c', which are indexed
+// by MemoizedShape.
+std::vector<ShapeHandle> KnownShapes(
+    InferenceContext* c,
+    const std::vector<ShapeHandle>& input_tensors_as_shapes,
+    const std::vector<bool>& attempted_tensor_as_shape_conversion) {
+  std::vector<ShapeHandle> known_shapes;
+  known_shapes.reserve(2 * c->num_inputs() + c->num_outputs());
+  for (int i = 0; i < c->num_inputs(); ++i) {
+    known_shapes.push_back(c->input(i));
+  }
+  for (int i = 0; i < c->num_inputs(); ++i) {
+    known_shapes.push_back(attempted_tensor_as_shape_conversion[i]
+                               ? input_tensors_as_shapes[i]
+                               : ShapeHandle());
+  }
+  return known_shapes;
+}
+
+// Shape functions are memoized by op name, so this excludes the ops of
+// function libraries, which have no shape function, as well as ops on
+// resources, whose handle shapes are not memoized.
+bool IsMemoizable(const Node* node, const OpRegistrationData* op_reg_data) {
+  if (op_reg_data->shape_inference_fn == nullptr) return false;
+  for (DataType dtype : node->input_types()) {
+    if (dtype == DT_RESOURCE) return false;
+  }
+  for (DataType dtype : node->output_types()) {
+    if (dtype == DT_RESOURCE) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
 ShapeRefiner::ShapeRefiner(int graph_def_version,
                            const OpRegistryInterface* ops)
     : graph_def_version_(graph_def_version),
@@ -231,11 +415,38 @@ Status ShapeRefiner::EvaluateConstantTensorForEdge(const Node* node,
   }
   const string output_tensor_name =
       strings::StrCat(input_edge->src()->name(), ":", input_edge->src_output());
-  std::vector<Tensor> outputs;
-  // NOTE; we should pass in a function library runtime if we want
-  // to support constant-expression evaluation on functions.
-  Status s = graph_runner_.Run(&subgraph, nullptr /* function_library */,
-                               const_inputs, {output_tensor_name}, &outputs);
+
+  // Graphs that are imported again evaluate the same subgraphs, unless their
+  // values come from outside of the graph.
+  const bool memoizable = CanMemoizeValuesOf(subgraph);
+  Fprint128 fingerprint = {0, 0};
+  if (memoizable) {
+    string key;
+    {
+      GraphDef subgraph_def;
+      subgraph.ToGraphDef(&subgraph_def);
+      AppendToKey(subgraph_def, &key);
+    }
+    for (const auto& const_input : const_inputs) {
+      strings::StrAppend(&key, "\n", const_input.first, "\n");
+      AppendToKey(const_input.second, &key);
+    }
+    strings::StrAppend(&key, "\n", output_tensor_name);
+    fingerprint = Fingerprint128(key);
+  }
+
+  std::vector<Tensor> outputs(1);
+  Status s;
+  if (!memoizable || !ConstantTensorMemo()->Lookup(fingerprint, &outputs[0])) {
+    // NOTE; we should pass in a function library runtime if we want
+    // to support constant-expression evaluation on functions.
+    s = graph_runner_.Run(&subgraph, nullptr /* function_library */,
+                          const_inputs, {output_tensor_name}, &outputs);
+    if (memoizable && s.ok() && outputs[0].TotalBytes() <= kMaxTensorSize) {
+      // The memo outlives graph_runner_, so it keeps its own copy.
+      ConstantTensorMemo()->Insert(fingerprint, tensor::DeepCopy(outputs[0]));
+    }
+  }
 
   // If all kernels in the constant graph are not registered
   // in the process, GraphRunner::Run may fail, in which case
@@ -476,6 +687,14 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
     TF_RETURN_IF_ERROR(c->Run(shape_inference::UnknownShape));
   }
 
+  // The outputs of shape functions that use the values of their inputs are
+  // memoized when they are known after a single rerun, which makes them a
+  // function of the input shapes and of the values requested by the first
+  // run.
+  const bool memoizable = IsMemoizable(node, op_reg_data);
+  Fprint128 memo_key = {0, 0};
+  int num_reruns = 0;
+
   // We must run the shape function repeatedly, in case users write
   // shape functions where they only conditionally call input_tensor()
   // based on the values of another input tensor.
@@ -507,8 +726,16 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
 
         Tensor result;
         bool evaluated = false;
-        TF_RETURN_IF_ERROR(
-            EvaluateConstantTensorForEdge(node, i, &evaluated, &result));
+        if (disable_constant_propagation_) {
+          const Edge* input_edge;
+          TF_RETURN_IF_ERROR(node->input_edge(i, &input_edge));
+          evaluated = input_edge->src()->IsConstant() &&
+                      GetNodeAttr(input_edge->src()->def(), "value", &result)
+                          .ok();
+        } else {
+          TF_RETURN_IF_ERROR(
+              EvaluateConstantTensorForEdge(node, i, &evaluated, &result));
+        }
         if (evaluated) {
           real_tensors[i] = result;
           input_tensors[i] = &real_tensors[i];
@@ -518,6 +745,7 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
         }
       }
       if (c->requested_input_tensor_as_partial_shape(i) &&
+          !disable_constant_propagation_ &&
           !attempted_tensor_as_shape_conversion[i]) {
         attempted_tensor_as_shape_conversion[i] = true;
         if (i >= input_tensors_as_shapes.size()) {
@@ -530,7 +758,27 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
       }
     }
 
+    if (rerun_shape_fn && memoizable && num_reruns == 0) {
+      memo_key = ShapeFnMemoKey(node, c, input_tensors,
+                                attempted_materialization,
+                                input_tensors_as_shapes,
+                                attempted_tensor_as_shape_conversion);
+      MemoizedShapeFnResult memoized;
+      if (ShapeFnMemo()->Lookup(memo_key, &memoized)) {
+        std::vector<ShapeHandle> known_shapes =
+            KnownShapes(c, input_tensors_as_shapes,
+                        attempted_tensor_as_shape_conversion);
+        for (int i = 0; i < c->num_outputs(); ++i) {
+          ShapeHandle output = RebuildShape(c, known_shapes, memoized[i]);
+          c->set_output(i, output);
+          known_shapes.push_back(output);
+        }
+        return Status::OK();
+      }
+    }
+
     if (rerun_shape_fn) {
+      ++num_reruns;
       // We have more information about the shapes on this pass,
       // so re-run shape inference.
       c->set_input_tensors(input_tensors);
@@ -543,7 +791,53 @@ Status ShapeRefiner::RunShapeFn(const Node* node,
     }
   } while (rerun_shape_fn);
 
+  if (memoizable && num_reruns == 1) {
+    std::vector<ShapeHandle> known_shapes = KnownShapes(
+        c, input_tensors_as_shapes, attempted_tensor_as_shape_conversion);
+    MemoizedShapeFnResult memoized;
+    for (int i = 0; i < c->num_outputs(); ++i) {
+      memoized.push_back(MemoizeShape(c, known_shapes, c->output(i)));
+      known_shapes.push_back(c->output(i));
+    }
+    ShapeFnMemo()->Insert(memo_key, memoized);
+  }
+
   return Status::OK();
 }
 
+Fprint128 ShapeRefiner::ShapeFnMemoKey(
+    const Node* node, InferenceContext* c,
+    const std::vector<const Tensor*>& input_tensors,
+    const std::vector<bool>& attempted_materialization,
+    const std::vector<ShapeHandle>& input_tensors_as_shapes,
+    const std::vector<bool>& attempted_tensor_as_shape_conversion) {
+  string key = strings::StrCat(node->type_string(), "\n", graph_def_version_);
+  std::vector<const AttrValueMap::value_type*> attrs;
+  for (const auto& attr : node->def().attr()) {
+    attrs.push_back(&attr);
+  }
+  std::sort(attrs.begin(), attrs.end(),
+            [](const AttrValueMap::value_type* a,
+               const AttrValueMap::value_type* b) {
+              return a->first < b->first;
+            });
+  for (const auto* attr : attrs) {
+    strings::StrAppend(&key, "\n", attr->first, "=");
+    AppendToKey(attr->second, &key);
+  }
+  key.append("\n");
+  AppendToKey(c,
+              KnownShapes(c, input_tensors_as_shapes,
+                          attempted_tensor_as_shape_conversion),
+              &key);
+  for (int i = 0; i < c->num_inputs(); ++i) {
+    if (!attempted_materialization[i]) continue;
+    strings::StrAppend(&key, "\n", i, ":");
+    if (input_tensors[i] != nullptr) {
+      AppendToKey(*input_tensors[i], &key);
+    }
+  }
+  return Fingerprint128(key);
+}
+
 }  // namespace tensorflow
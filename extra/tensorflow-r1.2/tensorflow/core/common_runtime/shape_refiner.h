@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/macros.h"
 
 namespace tensorflow {
@@ -30,6 +31,12 @@ namespace tensorflow {
 // Node in the Graph, and providing/storing the 'input_tensor' Tensors
 // used by Shape Inference functions, when available at graph
 // construction time.
+//
+// The constants evaluated for shape functions, and the outputs of shape
+// functions that depend on the values of their inputs, are memoized across
+// the ShapeRefiners of the process, keyed by the fingerprints of the
+// constant subgraphs and of the op, attrs, input shapes and input values
+// respectively.
 class ShapeRefiner {
  public:
   ShapeRefiner(int graph_def_version, const OpRegistryInterface* ops);
@@ -77,6 +84,14 @@ class ShapeRefiner {
     require_shape_inference_fns_ = require_shape_inference_fns;
   }
 
+  // If true, shape functions are only given the values of the inputs that
+  // come straight from Const nodes, so that no constant subgraph is
+  // evaluated. The outputs of shape functions that need other values are
+  // then left less refined.
+  void set_disable_constant_propagation(bool disable) {
+    disable_constant_propagation_ = disable;
+  }
+
  private:
   // Extracts the subgraph ending at 'node' that is statically
   // computable and inserts into 'out_graph'. If statically computable,
@@ -116,6 +131,15 @@ class ShapeRefiner {
   Status RunShapeFn(const Node* node, const OpRegistrationData* op_reg_data,
                     shape_inference::InferenceContext* c);
 
+  // Returns the key under which the outputs of the shape function of 'node'
+  // are memoized, given the input values and partial shapes it was given.
+  Fprint128 ShapeFnMemoKey(
+      const Node* node, shape_inference::InferenceContext* c,
+      const std::vector<const Tensor*>& input_tensors,
+      const std::vector<bool>& attempted_materialization,
+      const std::vector<shape_inference::ShapeHandle>& input_tensors_as_shapes,
+      const std::vector<bool>& attempted_tensor_as_shape_conversion);
+
   int32 graph_def_version_;
   const OpRegistryInterface* const ops_registry_;
 
@@ -142,6 +166,7 @@ class ShapeRefiner {
   std::unordered_map<string, Tensor> const_tensor_map_;
 
   bool require_shape_inference_fns_ = true;
+  bool disable_constant_propagation_ = false;
 
   TF_DISALLOW_COPY_AND_ASSIGN(ShapeRefiner);
 };
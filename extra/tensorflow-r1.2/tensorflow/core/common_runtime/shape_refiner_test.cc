@@ -22,6 +22,9 @@ limitations under the License.
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/public/version.h"
 
@@ -801,5 +804,106 @@ TEST(ShapeRefinerTest, IncrementalUpdates) {
   EXPECT_EQ("[3,7]", ctx->DebugString(ctx->output(0)));
 }
 
+// Shape functions are memoized across refiners, so the second of two
+// identically named graphs must still see its own input values.
+TEST(ShapeRefinerTest, MemoizedShapeFnUsesInputValues) {
+  for (int32 dim : {2, 4}) {
+    Scope root = Scope::NewRootScope();
+    auto input = ops::Const(root, {dim, dim + 1});
+    Node* shape_data;
+    TF_ASSERT_OK(NodeBuilder("Test", "ShapeData")
+                     .Input(input.node())
+                     .Finalize(root.graph(), &shape_data));
+
+    ShapeRefiner m(TF_GRAPH_DEF_VERSION, OpRegistry::Global());
+    TF_ASSERT_OK(m.AddNode(input.node()));
+    TF_ASSERT_OK(m.AddNode(shape_data));
+
+    shape_inference::InferenceContext* ctx = m.GetContext(shape_data);
+    EXPECT_EQ(strings::StrCat("[", dim, ",", dim + 1, "]"),
+              ctx->DebugString(ctx->output(0)));
+  }
+}
+
+// Memoized outputs keep the unknown dimensions of the inputs they were
+// taken from.
+TEST(ShapeRefinerTest, MemoizedShapeFnKeepsDimensions) {
+  for (int pass = 0; pass < 2; ++pass) {
+    Scope root = Scope::NewRootScope();
+    Node* input;
+    TF_ASSERT_OK(
+        NodeBuilder("in", "WithPartialShape").Finalize(root.graph(), &input));
+    auto shape = ops::Shape(root, Output(input));
+    auto reshape = ops::Reshape(root, Output(input), shape);
+
+    ShapeRefiner m(TF_GRAPH_DEF_VERSION, OpRegistry::Global());
+    TF_ASSERT_OK(m.AddNode(input));
+    TF_ASSERT_OK(m.AddNode(shape.node()));
+    TF_ASSERT_OK(m.AddNode(reshape.node()));
+
+    shape_inference::InferenceContext* in_ctx = m.GetContext(input);
+    shape_inference::InferenceContext* ctx = m.GetContext(reshape.node());
+    EXPECT_EQ("[1,?,3,?,5]", ctx->DebugString(ctx->output(0)));
+    EXPECT_TRUE(ctx->Dim(ctx->output(0), 1)
+                    .SameHandle(in_ctx->Dim(in_ctx->output(0), 1)));
+    EXPECT_TRUE(ctx->Dim(ctx->output(0), 3)
+                    .SameHandle(in_ctx->Dim(in_ctx->output(0), 3)));
+  }
+}
+
+// Without constant propagation, shape functions are only given the values
+// of their Const inputs.
+TEST(ShapeRefinerTest, DisableConstantPropagation) {
+  Scope root = Scope::NewRootScope();
+  auto input = ops::Const(root, {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f});
+  auto dims = ops::Const(root, {2, 3});
+  auto from_const = ops::Reshape(root, input, dims);
+  auto shape = ops::Shape(root, from_const);
+  auto from_shape = ops::Reshape(root, input, shape);
+
+  ShapeRefiner m(TF_GRAPH_DEF_VERSION, OpRegistry::Global());
+  m.set_disable_constant_propagation(true);
+  TF_ASSERT_OK(m.AddNode(input.node()));
+  TF_ASSERT_OK(m.AddNode(dims.node()));
+  TF_ASSERT_OK(m.AddNode(from_const.node()));
+  TF_ASSERT_OK(m.AddNode(shape.node()));
+  TF_ASSERT_OK(m.AddNode(from_shape.node()));
+
+  shape_inference::InferenceContext* ctx = m.GetContext(from_const.node());
+  EXPECT_EQ("[2,3]", ctx->DebugString(ctx->output(0)));
+  ctx = m.GetContext(from_shape.node());
+  EXPECT_EQ("[?,?]", ctx->DebugString(ctx->output(0)));
+}
+
+// Values read from files are not memoized, since the files may change
+// between two imports of the same graph.
+TEST(ShapeRefinerTest, ConstantValueFromChangedFiles) {
+  const string dir = io::JoinPath(testing::TmpDir(), "shape_refiner_files");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(dir));
+  for (int num_files : {1, 2}) {
+    TF_ASSERT_OK(WriteStringToFile(
+        Env::Default(), io::JoinPath(dir, strings::StrCat("file", num_files)),
+        ""));
+    Scope root = Scope::NewRootScope();
+    auto pattern = ops::Const(root, io::JoinPath(dir, "file*"));
+    auto files = ops::MatchingFiles(root, pattern);
+    auto shape = ops::Shape(root, files);
+    Node* shape_data;
+    TF_ASSERT_OK(NodeBuilder("Test", "ShapeData")
+                     .Input(shape.node())
+                     .Finalize(root.graph(), &shape_data));
+
+    ShapeRefiner m(TF_GRAPH_DEF_VERSION, OpRegistry::Global());
+    TF_ASSERT_OK(m.AddNode(pattern.node()));
+    TF_ASSERT_OK(m.AddNode(files.node()));
+    TF_ASSERT_OK(m.AddNode(shape.node()));
+    TF_ASSERT_OK(m.AddNode(shape_data));
+
+    shape_inference::InferenceContext* ctx = m.GetContext(shape_data);
+    EXPECT_EQ(strings::StrCat("[", num_files, "]"),
+              ctx->DebugString(ctx->output(0)));
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
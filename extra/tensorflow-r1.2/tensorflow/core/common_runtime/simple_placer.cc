@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/simple_placer.h"
 
+#include <bitset>
 #include <memory>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -39,63 +41,43 @@ namespace {
 const StringPiece kColocationAttrNameStringPiece(kColocationAttrName);
 const StringPiece kColocationGroupPrefixStringPiece(kColocationGroupPrefix);
 
-// Returns a list of devices sorted by preferred type and then name
-// from 'devices' whose type is in 'supported_device_types'.  This
-// function searches the device types in 'supported_device_types' and
-// returns the subset of devices that match.
-std::vector<Device*> FilterSupportedDevices(
-    const std::vector<Device*>& devices,
-    const DeviceTypeVector& supported_device_types) {
-  std::vector<Device*> filtered_devices;
-  for (const DeviceType& d : supported_device_types) {
-    for (Device* device : devices) {
-      if (DeviceType(device->attributes().device_type()) == d) {
-        filtered_devices.emplace_back(device);
-      }
-    }
+// The most device types a DeviceSet may have. Sets of device types are
+// represented as bitsets indexed by the priority of the type.
+const int kMaxDeviceTypes = 64;
+typedef std::bitset<kMaxDeviceTypes> DeviceTypeMask;
+
+// Returns true if device 'a' is preferred to device 'b': devices are sorted
+// by prioritized device type (higher is preferred) and then by device name
+// (lexicographically).
+bool DevicePreferred(const Device* a, const Device* b) {
+  auto a_priority = DeviceSet::DeviceTypeOrder(DeviceType(a->device_type()));
+  auto b_priority = DeviceSet::DeviceTypeOrder(DeviceType(b->device_type()));
+  if (a_priority != b_priority) {
+    return a_priority > b_priority;
   }
-
-  auto device_sort = [](const Device* a, const Device* b) {
-    auto a_priority = DeviceSet::DeviceTypeOrder(DeviceType(a->device_type()));
-    auto b_priority = DeviceSet::DeviceTypeOrder(DeviceType(b->device_type()));
-    // First sort by prioritized device type (higher is preferred) and
-    // then by device name (lexicographically).
-    if (a_priority != b_priority) {
-      return a_priority > b_priority;
-    }
-    return StringPiece(a->name()) < StringPiece(b->name());
-  };
-  std::sort(filtered_devices.begin(), filtered_devices.end(), device_sort);
-  return filtered_devices;
+  return StringPiece(a->name()) < StringPiece(b->name());
 }
 
-// Returns the name of the colocation group of the node by inspecting
-// the kColocationAttrName attribute of the NodeDef.
+// Returns the names of the colocation groups of the node, without the
+// kColocationGroupPrefix, by inspecting the kColocationAttrName attribute of
+// the NodeDef. The names refer to strings owned by the node.
 void ColocationGroups(const Node& node,
-                      std::vector<string>* colocation_groups) {
-  std::vector<string> class_specs;
-  // TODO(vrv): We should consider adding a GetNodeAttr that returns a
-  // StringPiece, to avoid a copy.
-  if (!GetNodeAttrSimple(node.def(), kColocationAttrNameStringPiece,
-                         &class_specs)) {
-    // No attribute value is equivalent to the empty colocation_group.
-    *colocation_groups = {
-        strings::StrCat(kColocationGroupPrefixStringPiece, node.name())};
-    return;
-  }
-
-  bool found_spec = false;
-  for (const string& class_spec : class_specs) {
-    StringPiece spec(class_spec);
-    if (spec.Consume(kColocationGroupPrefixStringPiece)) {
-      found_spec = true;
-      colocation_groups->emplace_back(class_spec);
+                      std::vector<StringPiece>* colocation_groups) {
+  colocation_groups->clear();
+  const AttrValue* class_specs =
+      AttrSlice(node.def()).Find(kColocationAttrNameStringPiece);
+  if (class_specs != nullptr) {
+    for (const string& class_spec : class_specs->list().s()) {
+      StringPiece spec(class_spec);
+      if (spec.Consume(kColocationGroupPrefixStringPiece)) {
+        colocation_groups->push_back(spec);
+      }
     }
   }
 
-  if (!found_spec) {
-    *colocation_groups = {
-        strings::StrCat(kColocationGroupPrefixStringPiece, node.name())};
+  if (colocation_groups->empty()) {
+    // No attribute value is equivalent to the empty colocation_group.
+    colocation_groups->push_back(node.name());
   }
 }
 
@@ -129,12 +111,29 @@ void ColocationGroups(const Node& node,
 // (implied by ColocationGraph::ColocateNodes() invocations) are added.
 class ColocationGraph {
  public:
+  //
+  // REQUIRES: 'device_set' has at most kMaxDeviceTypes device types.
   ColocationGraph(Graph* graph, const DeviceSet* device_set,
                   const SessionOptions* options)
-      : device_set_(device_set),
+      : graph_(graph),
+        device_set_(device_set),
         device_types_(device_set->PrioritizedDeviceTypeList()),
         options_(options) {
-    members_.reserve(graph->num_node_ids());
+    CHECK_LE(device_types_.size(), kMaxDeviceTypes);
+    members_.resize(graph->num_node_ids());
+
+    // Precompute the type of every device, and the order of preference of
+    // all devices, which is shared by all colocation groups.
+    std::unordered_map<string, int> type_indices;
+    for (int i = 0; i < device_types_.size(); ++i) {
+      type_indices[device_types_[i].type()] = i;
+    }
+    for (Device* device : device_set_->devices()) {
+      device_type_indices_[device] = type_indices[device->device_type()];
+    }
+    sorted_devices_ = device_set_->devices();
+    std::sort(sorted_devices_.begin(), sorted_devices_.end(),
+              DevicePreferred);
   }
 
   // Adds the given node to this ColocationGraph as a singleton.
@@ -148,15 +147,13 @@ class ColocationGraph {
     Member member;
     TF_RETURN_IF_ERROR(InitializeMember(node, &member));
     CHECK_GE(member.parent, 0);
-    members_.resize(member.parent + 1);
     members_[member.parent] = std::move(member);
 
     // When adding the node, identify whether it is part of a
     // colocation group.
-    std::vector<string> colocation_groups;
-    ColocationGroups(node, &colocation_groups);
+    ColocationGroups(node, &colocation_groups_);
     Status s;
-    for (const string& colocation_group : colocation_groups) {
+    for (StringPiece colocation_group : colocation_groups_) {
       auto it = colocation_group_root_.find(colocation_group);
       if (it == colocation_group_root_.end()) {
         // This is the first node of the colocation group, so
@@ -223,28 +220,24 @@ class ColocationGraph {
       // TODO(mrry): Consider enriching the error message by pointing
       // out which nodes have the explicit partial device
       // specifications that caused this conflict.
-      s = DeviceNameUtils::MergeDevNames(
-          &members_[new_root].device_name, members_[old_root].device_name,
-          options_ == nullptr || options_->config.allow_soft_placement());
-      if (!s.ok()) {
-        return errors::InvalidArgument("Cannot colocate nodes '", x.name(),
-                                       "' and '", y.name(), ": ",
-                                       s.error_message());
+      if (DeviceNameUtils::HasSomeDetails(members_[old_root].device_name)) {
+        s = DeviceNameUtils::MergeDevNames(
+            &members_[new_root].device_name, members_[old_root].device_name,
+            options_ == nullptr || options_->config.allow_soft_placement());
+        if (!s.ok()) {
+          return errors::InvalidArgument("Cannot colocate nodes '", x.name(),
+                                         "' and '", y.name(), ": ",
+                                         s.error_message());
+        }
       }
 
-      // Transfer ids in the old group to the new one.
-      members_[new_root].ids_in_group.insert(
-          members_[old_root].ids_in_group.begin(),
-          members_[old_root].ids_in_group.end());
-      members_[old_root].ids_in_group.clear();
-
       // Ensure that the common root has at least one supported device
       // type, by computing the intersection of
       // members_[new_root].supported_device_types and
       // members_[old_root].supported_device_types.
-      MergeSupportedDevices(&members_[new_root].supported_device_types,
-                            members_[old_root].supported_device_types);
-      if (members_[new_root].supported_device_types.size() == 0) {
+      members_[new_root].supported_device_types &=
+          members_[old_root].supported_device_types;
+      if (members_[new_root].supported_device_types.none()) {
         string debug_info;
         AddDebugInfo(x_root, &debug_info);
         AddDebugInfo(y_root, &debug_info);
@@ -259,7 +252,7 @@ class ColocationGraph {
   }
 
   // Returns the device name associated with 'node'.
-  DeviceNameUtils::ParsedName DeviceForNode(const Node& node) {
+  const DeviceNameUtils::ParsedName& DeviceForNode(const Node& node) {
     int node_root = FindRoot(node.id());
     return members_[node_root].device_name;
   }
@@ -300,8 +293,8 @@ class ColocationGraph {
       if (!devices.empty()) {
         // Filter devices into those that are compatible with the root
         // node (and its children).
-        devices = FilterSupportedDevices(
-            devices, members_[node_root].supported_device_types);
+        FilterSupportedDevices(members_[node_root].supported_device_types,
+                               &devices);
       }
 
       // Perform soft placement if allow_soft_placement is set.  options_
@@ -317,8 +310,8 @@ class ColocationGraph {
         soft_device_name.has_id = false;
         device_set_->FindMatchingDevices(soft_device_name, &devices);
         if (!devices.empty()) {
-          devices = FilterSupportedDevices(
-              devices, members_[node_root].supported_device_types);
+          FilterSupportedDevices(members_[node_root].supported_device_types,
+                                 &devices);
         }
       }
 
@@ -382,8 +375,14 @@ class ColocationGraph {
       if (device_set_->devices().empty()) {
         return errors::Internal("No devices are registered");
       }
-      devices = FilterSupportedDevices(
-          device_set_->devices(), members_[node_root].supported_device_types);
+      // sorted_devices_ is already in order of preference.
+      const DeviceTypeMask& supported_device_types =
+          members_[node_root].supported_device_types;
+      for (Device* device : sorted_devices_) {
+        if (supported_device_types.test(device_type_indices_[device])) {
+          devices.push_back(device);
+        }
+      }
 
       if (devices.empty()) {
         AddDebugInfo(node_root, &debug_info);
@@ -409,24 +408,15 @@ class ColocationGraph {
     // id if it is a root. parent <= 0 indicates that this member is invalid.
     int parent = -1;
 
-    // The set of ids that are part of the disjoint node set forest.
-    //
-    // This is only fully specified in the root of a disjoint
-    // node set forest.
-    std::set<int> ids_in_group;
-
-    // The type of the op for this node.
-    string op_type;
-
     // A proxy for the depth of the tree that is used to prefer
     // connecting smaller trees to larger trees when merging disjoint
     // sets.
     int rank = 0;
 
     // The intersection of all device types supported by this node,
-    // and those of all of its children, in priority order
-    // of the preferred device.
-    DeviceTypeVector supported_device_types;
+    // and those of all of its children, indexed by the priority of the
+    // device type in device_types_.
+    DeviceTypeMask supported_device_types;
 
     // The merged form of the device requested for this node, with
     // those of all of its children.
@@ -441,7 +431,15 @@ class ColocationGraph {
   // Adds debugging info to 'output' for the node referred to by
   // 'node_root'.
   void AddDebugInfo(const int node_root, string* output) {
-    if (members_[node_root].ids_in_group.size() > 1) {
+    // The group is only enumerated here, when reporting an error, rather
+    // than maintained while merging groups.
+    std::vector<int> ids_in_group;
+    for (int id = 0; id < members_.size(); ++id) {
+      if (members_[id].parent >= 0 && FindRoot(id) == node_root) {
+        ids_in_group.push_back(id);
+      }
+    }
+    if (ids_in_group.size() > 1) {
       strings::StrAppend(output, "\nColocation Debug Info:\n");
 
       // If this node is part of a colocation group, then we want to
@@ -451,12 +449,14 @@ class ColocationGraph {
           output, "Colocation group had the following types and devices: ");
 
       std::unordered_map<string, string> type_to_devices;
-      for (const int id : members_[node_root].ids_in_group) {
-        const string& op_type = members_[id].op_type;
+      for (const int id : ids_in_group) {
+        const string& op_type = graph_->FindNodeId(id)->type_string();
         string devices_registered;
-        for (const auto& device_type : members_[id].supported_device_types) {
-          strings::StrAppend(&devices_registered, DeviceTypeString(device_type),
-                             " ");
+        for (int i = 0; i < device_types_.size(); ++i) {
+          if (members_[id].supported_device_types.test(i)) {
+            strings::StrAppend(&devices_registered,
+                               DeviceTypeString(device_types_[i]), " ");
+          }
         }
 
         type_to_devices[op_type] = devices_registered;
@@ -470,15 +470,22 @@ class ColocationGraph {
 
   Status InitializeMember(const Node& node, Member* member) {
     const int id = node.id();
-    member->ids_in_group.insert(id);
-    member->op_type = node.type_string();
-
     if (id < 0) {
       return errors::InvalidArgument("Node id was not positive: ", id);
     }
     member->parent = id;
+    DeviceTypeVector supported_device_types;
     TF_RETURN_IF_ERROR(SupportedDeviceTypesForNode(
-        device_types_, node.def(), &member->supported_device_types));
+        device_types_, node.def(), &supported_device_types));
+    // SupportedDeviceTypesForNode() returns a subsequence of device_types_.
+    for (int i = 0, j = 0; i < device_types_.size() &&
+                           j < supported_device_types.size();
+         ++i) {
+      if (device_types_[i] == supported_device_types[j]) {
+        member->supported_device_types.set(i);
+        ++j;
+      }
+    }
 
     if (!node.assigned_device_name().empty()) {
       // This node has already been assigned to a device, so we
@@ -490,8 +497,8 @@ class ColocationGraph {
       // NOTE: Since any assignment must have been performed by
       // the TensorFlow runtime, we consider errors in this branch to
       // be INTERNAL.
-      if (!DeviceNameUtils::ParseFullName(node.assigned_device_name(),
-                                          &member->device_name)) {
+      if (!ParseDeviceName(node.assigned_device_name(),
+                           &member->device_name)) {
         return errors::Internal("Malformed assigned device '",
                                 node.assigned_device_name(), "'");
       }
@@ -504,10 +511,9 @@ class ColocationGraph {
                                 "' does not match any device");
       }
 
-      for (const DeviceType& d : member->supported_device_types) {
-        if (DeviceType(assigned_device->attributes().device_type()) == d) {
-          return Status::OK();
-        }
+      if (member->supported_device_types.test(
+              device_type_indices_[assigned_device])) {
+        return Status::OK();
       }
 
       return errors::Internal("Assigned device '", node.assigned_device_name(),
@@ -521,7 +527,7 @@ class ColocationGraph {
       // in the NodeDef.
 
       // If no kernels are registered for this op type, fail with an error.
-      if (member->supported_device_types.empty()) {
+      if (member->supported_device_types.none()) {
         std::set<string> registered_device_types;
         for (Device* d : device_set_->devices()) {
           registered_device_types.insert(d->device_type());
@@ -542,8 +548,7 @@ class ColocationGraph {
         // devices.
         // NOTE: The full name may specify a device that is not in
         // n.supported_device_types(), but we check that in AssignDevice().
-        if (!DeviceNameUtils::ParseFullName(node.def().device(),
-                                            &member->device_name)) {
+        if (!ParseDeviceName(node.def().device(), &member->device_name)) {
           return errors::InvalidArgument("Malformed device specification '",
                                          node.def().device(), "'");
         }
@@ -552,26 +557,33 @@ class ColocationGraph {
     return Status::OK();
   }
 
-  // Updates target to contain the intersection of the device types in
-  // "target" and "other".
-  static void MergeSupportedDevices(DeviceTypeVector* target,
-                                    const DeviceTypeVector& other) {
-    DeviceTypeVector temp = *target;
-    target->clear();
-
-    // Iterate in priority order.
-    for (const DeviceType& device_type : temp) {
-      bool found = false;
-      for (const DeviceType& other_device_type : other) {
-        if (device_type == other_device_type) {
-          found = true;
-          break;
-        }
-      }
-      if (found) {
-        target->push_back(device_type);
+  // Parses the device name 'name' into 'parsed'. Graphs use few distinct
+  // device names, so each is only parsed once. Returns false if the name is
+  // malformed.
+  bool ParseDeviceName(const string& name,
+                       DeviceNameUtils::ParsedName* parsed) {
+    auto it = parsed_device_names_.find(name);
+    if (it == parsed_device_names_.end()) {
+      DeviceNameUtils::ParsedName parsed_name;
+      if (!DeviceNameUtils::ParseFullName(name, &parsed_name)) {
+        return false;
       }
+      it = parsed_device_names_.emplace(name, std::move(parsed_name)).first;
     }
+    *parsed = it->second;
+    return true;
+  }
+
+  // Replaces 'devices' with those of its devices whose type is in 'types',
+  // sorted by preference.
+  void FilterSupportedDevices(const DeviceTypeMask& types,
+                              std::vector<Device*>* devices) {
+    auto end = std::remove_if(
+        devices->begin(), devices->end(), [this, &types](Device* device) {
+          return !types.test(device_type_indices_[device]);
+        });
+    devices->erase(end, devices->end());
+    std::sort(devices->begin(), devices->end(), DevicePreferred);
   }
 
   // Returns the root node of the disjoint tree to which the node with the
@@ -587,13 +599,27 @@ class ColocationGraph {
   }
 
   std::vector<Member> members_;
+  const Graph* graph_;           // Not owned.
   const DeviceSet* device_set_;  // Not owned.
   const std::vector<DeviceType> device_types_;
   const SessionOptions* options_;  // Not owned;
 
-  // Maps from a colocation group identifier to the 'root' of that
-  // colocation group.
-  std::unordered_map<string, const Node*> colocation_group_root_;
+  // The index in device_types_ of the type of each device.
+  std::unordered_map<const Device*, int> device_type_indices_;
+
+  // The devices of device_set_, sorted by preference.
+  std::vector<Device*> sorted_devices_;
+
+  // The parsed form of the device names seen so far.
+  std::unordered_map<string, DeviceNameUtils::ParsedName> parsed_device_names_;
+
+  // Maps from a colocation group identifier, which refers to a string owned
+  // by a node of the graph, to the 'root' of that colocation group.
+  std::unordered_map<StringPiece, const Node*, StringPiece::Hasher>
+      colocation_group_root_;
+
+  // Scratch space for the colocation groups of a node.
+  std::vector<StringPiece> colocation_groups_;
 };
 
 // Returns true if the node only depends on its input's metadata
@@ -631,6 +657,10 @@ Status SimplePlacer::Run() {
   if (devices_->devices().empty()) {
     return errors::FailedPrecondition("No devices are registered");
   }
+  if (devices_->PrioritizedDeviceTypeList().size() > kMaxDeviceTypes) {
+    return errors::Unimplemented("Cannot place a graph on more than ",
+                                 kMaxDeviceTypes, " device types");
+  }
 
   ColocationGraph colocation_graph(graph_, devices_, options_);
   Status status;
@@ -664,8 +694,11 @@ Status SimplePlacer::Run() {
         // specified a device, then 'node's device should be
         // cleared: the reference edge forces 'node' to be on the
         // same device as the source node.
-        auto source_parsed_name = colocation_graph.DeviceForNode(*edge->src());
-        auto dest_parsed_name = colocation_graph.DeviceForNode(*node);
+        // Copied, because SetDeviceForNode() may overwrite the names.
+        const DeviceNameUtils::ParsedName source_parsed_name =
+            colocation_graph.DeviceForNode(*edge->src());
+        const DeviceNameUtils::ParsedName dest_parsed_name =
+            colocation_graph.DeviceForNode(*node);
         if (DeviceNameUtils::HasSomeDetails(source_parsed_name) &&
             DeviceNameUtils::HasSomeDetails(dest_parsed_name)) {
           // Add a log saying that we are ignoring a specified device
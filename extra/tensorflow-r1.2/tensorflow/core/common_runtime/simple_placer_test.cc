@@ -30,12 +30,14 @@ limitations under the License.
 #include "tensorflow/core/framework/op_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/graph_constructor.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
 #include "tensorflow/core/lib/core/error_codes.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
@@ -1282,5 +1284,50 @@ TEST_F(SimplePlacerTest, TestGeneratorNodeDoesntFollowNonColocatedConsumers) {
   EXPECT_DEVICE_TYPE(g, "in", "FakeGPU");
 }
 
+// Places a graph of 'num_nodes' TestRelu nodes in chains of ten, where each
+// chain is colocated with the TestInput at its head, and every other chain
+// has a partial device specification.
+static void BM_PlaceColocatedChains(int iters, int num_nodes) {
+  testing::StopTiming();
+  std::vector<std::unique_ptr<Device>> local_devices;
+  DeviceSet devices;
+  for (int i = 0; i < 10; ++i) {
+    local_devices.emplace_back(FakeDevice::MakeCPU(
+        strings::StrCat("/job:a/replica:0/task:0/device:fakecpu:", i)));
+    devices.AddDevice(local_devices.back().get());
+    local_devices.emplace_back(FakeDevice::MakeGPU(
+        strings::StrCat("/job:a/replica:0/task:0/device:fakegpu:", i)));
+    devices.AddDevice(local_devices.back().get());
+  }
+
+  GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+  for (int chain = 0; chain < num_nodes / 10; ++chain) {
+    const string head = strings::StrCat("in_", chain);
+    const string device = chain % 2 == 0 ? "/job:a" : "";
+    Node* node = ops::SourceOp("TestInput",
+                               b.opts().WithName(head).WithDevice(device));
+    for (int i = 0; i < 10; ++i) {
+      node = ops::UnaryOp(
+          "TestRelu", node,
+          b.opts()
+              .WithName(strings::StrCat("relu_", chain, "_", i))
+              .WithAttr("_class", {strings::StrCat("loc:@", head)}));
+    }
+  }
+  GraphDef graph_def;
+  TF_CHECK_OK(b.ToGraphDef(&graph_def));
+
+  for (int i = 0; i < iters; ++i) {
+    Graph g(OpRegistry::Global());
+    GraphConstructorOptions opts;
+    TF_CHECK_OK(ConvertGraphDefToGraph(opts, graph_def, &g));
+    testing::StartTiming();
+    SimplePlacer placer(&g, &devices);
+    TF_CHECK_OK(placer.Run());
+    testing::StopTiming();
+  }
+}
+BENCHMARK(BM_PlaceColocatedChains)->Arg(1000)->Arg(10000);
+
 }  // namespace
 }  // namespace tensorflow
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/platform/protobuf.h"
 
 namespace tensorflow {
 
@@ -84,6 +85,12 @@ inline void SetAttrValue(const AttrValue& value, AttrValue* out) {
   *out = value;
 }
 
+// Wrapper around protocol buffer serialization that requests deterministic
+// serialization, in particular for Map fields, which serialize in a random
+// order by default. Returns true on success.
+bool SerializeToStringDeterministic(const protobuf::MessageLite& message,
+                                    string* result);
+
 // Returns true if a and b have the same value.
 // NOTE: May return false negatives for tensor values.
 bool AreAttrValuesEqual(const AttrValue& a, const AttrValue& b);
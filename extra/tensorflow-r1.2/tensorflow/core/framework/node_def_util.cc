@@ -35,6 +35,8 @@ namespace tensorflow {
 
 const char* const kColocationAttrName = "_class";
 const char* const kColocationGroupPrefix = "loc:@";
+const char* const kConstantWeightsAttr = "_constant_weights";
+const char* const kCriticalPathAttr = "_critical_path_ns";
 
 AttrSlice::AttrSlice(const NodeDef& node_def)
     : ndef_(&node_def), attrs_(&ndef_->attr()) {}
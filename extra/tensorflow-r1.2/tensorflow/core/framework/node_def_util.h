@@ -39,6 +39,18 @@ extern const char* const kColocationAttrName;
 // String prefix applied to the operation name for colocation constraints.
 extern const char* const kColocationGroupPrefix;
 
+// Name of the boolean attribute that marks MatMul and Conv2D nodes whose
+// weights (input 1) come straight from a Const node on the same device, and
+// therefore hold the same, never mutated, buffer on every step. Set by
+// MarkConstantWeightsPass and read by the kernels, see
+// kernels/packed_weights_cache.h.
+extern const char* const kConstantWeightsAttr;
+
+// Name of the int attribute holding the predicted critical path length of a
+// node, in nanoseconds. Set by grappler's CriticalPathPriority optimizer and
+// read by the executor to order ready nodes.
+extern const char* const kCriticalPathAttr;
+
 // Produce a human-readable version of a NodeDef that is more concise
 // than a text-format proto.
 string SummarizeNodeDef(const NodeDef& node_def);
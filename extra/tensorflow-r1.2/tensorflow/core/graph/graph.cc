@@ -232,6 +232,15 @@ Node::Properties::Properties(const OpDef* op_def, const NodeDef& node_def,
       input_types_(inputs.begin(), inputs.end()),
       output_types_(outputs.begin(), outputs.end()) {}
 
+Node::Properties::Properties(const OpDef* op_def, NodeDef* node_def,
+                             const DataTypeSlice inputs,
+                             const DataTypeSlice outputs)
+    : op_def_(op_def),
+      input_types_(inputs.begin(), inputs.end()),
+      output_types_(outputs.begin(), outputs.end()) {
+  node_def_.Swap(node_def);
+}
+
 Node::Properties::~Properties() {}
 
 // Graph
@@ -297,6 +306,12 @@ Node* Graph::AddNode(const NodeDef& node_def, Status* status) {
   return node;
 }
 
+Node* Graph::AddNode(NodeDef* node_def, const OpDef* op_def,
+                     const DataTypeSlice inputs, const DataTypeSlice outputs) {
+  return AllocateNode(new Node::Properties(op_def, node_def, inputs, outputs),
+                      nullptr);
+}
+
 Node* Graph::CopyNode(Node* node) {
   DCHECK(!node->IsSource());
   DCHECK(!node->IsSink());
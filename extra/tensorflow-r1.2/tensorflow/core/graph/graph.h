@@ -170,6 +170,9 @@ class Node {
    public:
     Properties(const OpDef* op_def, const NodeDef& node_def,
                const DataTypeSlice inputs, const DataTypeSlice outputs);
+    // Takes the contents of *node_def instead of copying them.
+    Properties(const OpDef* op_def, NodeDef* node_def,
+               const DataTypeSlice inputs, const DataTypeSlice outputs);
 
     const OpDef* op_def_;  // not owned
     NodeDef node_def_;
@@ -365,6 +368,13 @@ class Graph {
   // Returns nullptr and sets *status on error.
   Node* AddNode(const NodeDef& node_def, Status* status);
 
+  // Adds a new node to this graph, and returns it. The Op and input/output
+  // types of the node must already have been inferred from *node_def, e.g.
+  // by the caller while resolving many nodes concurrently. The contents of
+  // *node_def are moved into the node. *this owns the returned instance.
+  Node* AddNode(NodeDef* node_def, const OpDef* op_def,
+                const DataTypeSlice inputs, const DataTypeSlice outputs);
+
   // Copies *node, which may belong to another graph, to a new node,
   // which is returned.  Does not copy any edges.  *this owns the
   // returned instance.
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/graph/graph_constructor.h"
 
 #include <algorithm>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -32,14 +33,25 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/tensor_id.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/scanner.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
 
 namespace {
+// GraphDefs with fewer nodes are processed on the calling thread only, since
+// starting the threads would outweigh the work done on them.
+const int kMinNodesForParallelism = 4096;
+
+// Rough costs, in cycles, of validating and of resolving a single NodeDef.
+const int64 kValidateNodeCost = 1000;
+const int64 kResolveNodeCost = 10000;
+
 inline bool IsMerge(const NodeDef& node_def) {
   return node_def.op() == "Merge" || node_def.op() == "RefMerge";
 }
@@ -138,11 +150,20 @@ class GraphConstructor {
 
   void Undo();
 
+  // Calls fn(begin, end) on ranges covering the indices of the NodeDefs in
+  // gdef_, in parallel shards if gdef_ is large. cost_per_node estimates the
+  // cycles fn spends on a single NodeDef.
+  void ForEachNodeDefShard(int64 cost_per_node,
+                           const std::function<void(int64, int64)>& fn);
+  // Fills in resolved_ for all NodeDefs of gdef_.
+  void ResolveNodeDefs();
+
+  struct ResolvedNodeDef;
   Status ValidateColocationConstraints(const NodeDef& node_def);
-  Status MakeNode(const NodeDef& node_def, Node** node);
+  Status MakeNode(ResolvedNodeDef* resolved, Node** node);
   Status MakeEdge(Node* src, int output_index, Node* dst, int input_index);
   Status ValidateShape(Node* node);
-  Status ModifyNodeDefForImport(NodeDef* node_def);
+  Status ValidateNodeDefForImport(const ResolvedNodeDef& resolved);
   // Modifies node_def's inputs according to opts_.input_map.
   // input_already_exists is a pre-initialized vector of length
   // node_def->input_size(). This function will mark inputs that are remapped to
@@ -168,6 +189,26 @@ class GraphConstructor {
   // May be null. Not owned.
   std::vector<std::pair<Node*, int>>* return_tensors_;
 
+  // Only started for large GraphDefs, see ForEachNodeDefShard().
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+
+  // A copy of a NodeDef in gdef_ along with its Op and input/output types,
+  // which do not depend on the other nodes and are thus resolved for all
+  // nodes up front, possibly in parallel. When importing, the defaults of the
+  // attrs of the Op have been added to node_def.
+  struct ResolvedNodeDef {
+    NodeDef node_def;
+    const OpDef* op_def = nullptr;
+    DataTypeVector input_types;
+    DataTypeVector output_types;
+    // Errors are only reported once Convert() reaches the node, so that they
+    // are the same as when converting the nodes one at a time.
+    Status op_status;
+    Status types_status;
+  };
+  // Indexed like gdef_. The NodeDefs are moved into g_ by MakeNode().
+  std::vector<ResolvedNodeDef> resolved_;
+
   // Mapping from node name to the index within gdef_
   struct NodeInfo {
     explicit NodeInfo(int i) : gdef_index(i), node(nullptr) {}
@@ -311,7 +352,42 @@ Status GraphConstructor::ValidateInputMapAndControlDependencies() {
 }
 
 Status GraphConstructor::BuildNodeIndex() {
+  // Validate each NodeDef on its own first. The errors are returned in the
+  // order of the nodes below, after those of the preceding nodes' names.
+  std::vector<Status> node_status(gdef_->node_size());
+  ForEachNodeDefShard(kValidateNodeCost, [this, &node_status](int64 begin,
+                                                              int64 end) {
+    for (int64 n = begin; n < end; ++n) {
+      const NodeDef& node_def(gdef_->node(n));
+      // Validate the operation's type.
+      if (node_def.op().empty()) {
+        node_status[n] = errors::InvalidArgument(
+            "Node '", node_def.name(), "' does not specify an operation");
+        continue;
+      }
+      if (opts_.expect_device_spec && node_def.device().empty()) {
+        node_status[n] = errors::InvalidArgument(
+            "Node '", node_def.name(), "' is missing a device specification");
+        continue;
+      }
+      // Validate control edges at end
+      bool in_control_dependence = false;
+      for (int i = 0; i < node_def.input_size(); ++i) {
+        StringPiece input_name = node_def.input(i);
+        if (!input_name.empty() && input_name.starts_with("^")) {
+          in_control_dependence = true;
+        } else if (in_control_dependence) {
+          node_status[n] = errors::InvalidArgument(
+              "Node '", node_def.name(),
+              "': Control dependencies must come after regular dependencies");
+          break;
+        }
+      }
+    }
+  });
+
   // Validate the node names and add them to gdef_nodes_.
+  gdef_nodes_.reserve(gdef_->node_size());
   for (int n = 0; n < gdef_->node_size(); ++n) {
     const NodeDef& node_def(gdef_->node(n));
     if (!IsValidNodeName(node_def.name(), opts_.allow_internal_ops)) {
@@ -325,27 +401,7 @@ Status GraphConstructor::BuildNodeIndex() {
       return errors::InvalidArgument("Node '", node_def.name(),
                                      "' is not unique");
     }
-    // Validate the operation's type.
-    if (node_def.op().empty()) {
-      return errors::InvalidArgument("Node '", node_def.name(),
-                                     "' does not specify an operation");
-    }
-    if (opts_.expect_device_spec && node_def.device().empty()) {
-      return errors::InvalidArgument("Node '", node_def.name(),
-                                     "' is missing a device specification");
-    }
-    // Validate control edges at end
-    bool in_control_dependence = false;
-    for (int i = 0; i < node_def.input_size(); ++i) {
-      StringPiece input_name = node_def.input(i);
-      if (!input_name.empty() && input_name.starts_with("^")) {
-        in_control_dependence = true;
-      } else if (in_control_dependence) {
-        return errors::InvalidArgument(
-            "Node '", node_def.name(),
-            "': Control dependencies must come after regular dependencies");
-      }
-    }
+    TF_RETURN_IF_ERROR(node_status[n]);
   }
   return Status::OK();
 }
@@ -407,13 +463,62 @@ Status GraphConstructor::ValidateColocationConstraints(
   return Status::OK();
 }
 
-Status GraphConstructor::MakeNode(const NodeDef& node_def, Node** node) {
+void GraphConstructor::ForEachNodeDefShard(
+    int64 cost_per_node, const std::function<void(int64, int64)>& fn) {
+  const int num_nodes = gdef_->node_size();
+  const int num_threads = port::NumSchedulableCPUs();
+  if (num_nodes < kMinNodesForParallelism || num_threads <= 1) {
+    fn(0, num_nodes);
+    return;
+  }
+  if (thread_pool_ == nullptr) {
+    thread_pool_.reset(new thread::ThreadPool(
+        Env::Default(), "graph_constructor", num_threads));
+  }
+  thread_pool_->ParallelFor(num_nodes, cost_per_node, fn);
+}
+
+void GraphConstructor::ResolveNodeDefs() {
+  resolved_.resize(gdef_->node_size());
+  ForEachNodeDefShard(kResolveNodeCost, [this](int64 begin, int64 end) {
+    // Graphs use few distinct ops, so look each one up only once per shard
+    // instead of contending for the lock of the op registry.
+    std::unordered_map<StringPiece, std::pair<const OpDef*, Status>,
+                       StringPiece::Hasher>
+        op_defs;
+    for (int64 n = begin; n < end; ++n) {
+      const NodeDef& node_def = gdef_->node(n);
+      ResolvedNodeDef* resolved = &resolved_[n];
+      resolved->node_def = node_def;
+      auto iter = op_defs.find(node_def.op());
+      if (iter == op_defs.end()) {
+        const OpDef* op_def = nullptr;
+        Status status = g_->op_registry()->LookUpOpDef(node_def.op(), &op_def);
+        iter = op_defs.insert({node_def.op(), {op_def, status}}).first;
+      }
+      resolved->op_def = iter->second.first;
+      resolved->op_status = iter->second.second;
+      if (!resolved->op_status.ok()) continue;
+      if (opts_.importing) {
+        AddDefaultsToNodeDef(*resolved->op_def, &resolved->node_def);
+      }
+      resolved->types_status = InOutTypesForNode(
+          resolved->node_def, *resolved->op_def, &resolved->input_types,
+          &resolved->output_types);
+    }
+  });
+}
+
+Status GraphConstructor::MakeNode(ResolvedNodeDef* resolved, Node** node) {
+  TF_RETURN_IF_ERROR(resolved->op_status);
+  if (!resolved->types_status.ok()) {
+    return AttachDef(resolved->types_status, resolved->node_def);
+  }
   // Add the node to the graph.
-  Status status;
-  *node = g_->AddNode(node_def, &status);
-  if (!status.ok()) return status;
+  *node = g_->AddNode(&resolved->node_def, resolved->op_def,
+                      resolved->input_types, resolved->output_types);
   if (opts_.expect_device_spec) {
-    (*node)->set_assigned_device_name(node_def.device());
+    (*node)->set_assigned_device_name((*node)->def().device());
   }
   return Status::OK();
 }
@@ -484,12 +589,13 @@ Status GraphConstructor::ValidateShape(Node* node) {
   return Status::OK();
 }
 
-Status GraphConstructor::ModifyNodeDefForImport(NodeDef* node_def) {
-  const OpDef* op_def;
-  TF_RETURN_IF_ERROR(g_->op_registry()->LookUpOpDef(node_def->op(), &op_def));
-  AddDefaultsToNodeDef(*op_def, node_def);
-  TF_RETURN_IF_ERROR(ValidateNodeDef(*node_def, *op_def));
-  TF_RETURN_IF_ERROR(CheckOpDeprecation(*op_def, gdef_->versions().producer()));
+Status GraphConstructor::ValidateNodeDefForImport(
+    const ResolvedNodeDef& resolved) {
+  TF_RETURN_IF_ERROR(resolved.op_status);
+  // The defaults of the attrs were added by ResolveNodeDefs().
+  const OpDef& op_def = *resolved.op_def;
+  TF_RETURN_IF_ERROR(ValidateNodeDef(resolved.node_def, op_def));
+  TF_RETURN_IF_ERROR(CheckOpDeprecation(op_def, gdef_->versions().producer()));
   return Status::OK();
 }
 
@@ -608,6 +714,7 @@ Status GraphConstructor::Convert() {
   // Import functions before adding nodes, since imported nodes may refer to
   // functions
   TF_RETURN_IF_ERROR(g_->AddFunctionLibrary(gdef_->library()));
+  ResolveNodeDefs();
 
   std::vector<InputInfo> inputs;
   int processed = 0;
@@ -623,8 +730,8 @@ Status GraphConstructor::Convert() {
     bool has_data_back_edge = false;
 
     const NodeDef& original_node_def = gdef_->node(o);
-    NodeDef imported_node_def;
-    const NodeDef* node_def;
+    ResolvedNodeDef* resolved = &resolved_[o];
+    NodeDef* node_def = &resolved->node_def;
 
     // input_already_exists[i] is true iff the i-th input of the node we're
     // importing refers to a preexisting node in g_ (i.e. input[i] existed prior
@@ -633,22 +740,16 @@ Status GraphConstructor::Convert() {
     std::vector<bool> input_already_exists(original_node_def.input_size(),
                                            false);
 
+    // The inputs of node_def are rewritten here rather than when resolving
+    // it, since which inputs are back edges depends on the conversion order.
     if (opts_.importing) {
-      // TODO(ashankar): The line below means an additional copy of the NodeDef,
-      // which can be expensive if the NodeDef contains large tensors in it.
-      // Might make sense to change the API for ImportGraphDef to take a mutable
-      // GraphDef* and avoid the copying.
-      imported_node_def = original_node_def;
       if (!opts_.input_map.empty()) {
-        RemapNodeDefInputs(&imported_node_def, &input_already_exists);
+        RemapNodeDefInputs(node_def, &input_already_exists);
       }
       if (!opts_.control_dependencies.empty()) {
         // Note that input_already_exists can grow here
-        AddControlDependencies(&imported_node_def, &input_already_exists);
+        AddControlDependencies(node_def, &input_already_exists);
       }
-      node_def = &imported_node_def;
-    } else {
-      node_def = &original_node_def;
     }
 
     TF_RETURN_IF_ERROR(ValidateColocationConstraints(*node_def));
@@ -690,10 +791,11 @@ Status GraphConstructor::Convert() {
 
     Node* node;
     if (opts_.importing) {
-      AddPrefixToNodeDef(input_already_exists, &imported_node_def);
-      TF_RETURN_IF_ERROR(ModifyNodeDefForImport(&imported_node_def));
+      AddPrefixToNodeDef(input_already_exists, node_def);
+      TF_RETURN_IF_ERROR(ValidateNodeDefForImport(*resolved));
     }
-    TF_RETURN_IF_ERROR(MakeNode(*node_def, &node));
+    // Moves *node_def into node.
+    TF_RETURN_IF_ERROR(MakeNode(resolved, &node));
     // Use original_node_def so name StringPiece remains valid
     gdef_nodes_[original_node_def.name()].node = node;
 
@@ -713,7 +815,7 @@ Status GraphConstructor::Convert() {
 
     // TODO(skyewm): remove conditional when b/35715995 ("Functions lack shape
     // inference") is resolved.
-    if (g_->flib_def().Find(node_def->name()) == nullptr) {
+    if (g_->flib_def().Find(node->name()) == nullptr) {
       TF_RETURN_IF_ERROR(ValidateShape(node));
     }
 
@@ -731,6 +833,7 @@ Status GraphConstructor::Convert() {
     return errors::InvalidArgument(gdef_->node_size() - processed,
                                    " nodes in a cycle");
   }
+  resolved_.clear();
   return Status::OK();
 }
 
@@ -21,16 +21,19 @@ limitations under the License.
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/version.h"
 
@@ -2442,5 +2445,100 @@ versions {
   EXPECT_EQ(17, refiner.graph_def_version());
 }
 
+// Returns a GraphDef of 10 constants followed by num_nodes - 10 Add nodes,
+// each adding two random earlier nodes.
+GraphDef LargeGraphDef(int num_nodes) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor value(DT_FLOAT, TensorShape({}));
+  value.scalar<float>()() = 1.0f;
+  GraphDef gdef;
+  for (int n = 0; n < num_nodes; ++n) {
+    const string name = strings::StrCat("n", n);
+    if (n < 10) {
+      TF_CHECK_OK(NodeDefBuilder(name, "Const")
+                      .Attr("dtype", DT_FLOAT)
+                      .Attr("value", value)
+                      .Finalize(gdef.add_node()));
+    } else {
+      TF_CHECK_OK(NodeDefBuilder(name, "Add")
+                      .Input(strings::StrCat("n", rnd.Uniform(n)), 0, DT_FLOAT)
+                      .Input(strings::StrCat("n", rnd.Uniform(n)), 0, DT_FLOAT)
+                      .Finalize(gdef.add_node()));
+    }
+  }
+  return gdef;
+}
+
+TEST_F(GraphConstructorTest, LargeGraphDef) {
+  // Large enough for the nodes to be resolved in parallel.
+  const GraphDef gdef = LargeGraphDef(10000);
+  GraphConstructorOptions opts;
+  TF_EXPECT_OK(ConvertGraphDefToGraph(opts, gdef, &graph_));
+  EXPECT_EQ(10002, graph_.num_nodes());
+  for (const NodeDef& node_def : gdef.node()) {
+    const Node* node = FindNode(node_def.name());
+    ASSERT_TRUE(node != nullptr);
+    EXPECT_EQ(node_def.op(), node->type_string());
+    ASSERT_EQ(node_def.input_size(), node->num_inputs());
+    for (int i = 0; i < node_def.input_size(); ++i) {
+      const Node* input;
+      TF_ASSERT_OK(node->input_node(i, &input));
+      EXPECT_EQ(node_def.input(i), input->name());
+    }
+  }
+}
+
+TEST_F(GraphConstructorTest, LargeGraphDefErrorsInOrder) {
+  // The nodes are validated in parallel, but an invalid node is still only
+  // reported after the duplicate name of an earlier node.
+  GraphDef gdef = LargeGraphDef(10000);
+  gdef.mutable_node(9000)->clear_op();
+  gdef.mutable_node(5000)->set_name("n4000");
+  GraphConstructorOptions opts;
+  Status s = ConvertGraphDefToGraph(opts, gdef, &graph_);
+  EXPECT_EQ("Node 'n4000' is not unique", s.error_message());
+
+  gdef = LargeGraphDef(10000);
+  gdef.mutable_node(9000)->set_op("UnknownOp");
+  s = ConvertGraphDefToGraph(opts, gdef, &graph_);
+  EXPECT_TRUE(StringPiece(s.error_message())
+                  .contains("Op type not registered 'UnknownOp'"))
+      << s;
+  // Errors don't change the graph.
+  EXPECT_EQ(2, graph_.num_nodes());
+}
+
+static void BM_ConvertGraphDefToGraph(int iters, int num_nodes) {
+  testing::StopTiming();
+  testing::UseRealTime();
+  const GraphDef gdef = LargeGraphDef(num_nodes);
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_nodes);
+  for (int i = 0; i < iters; ++i) {
+    Graph graph(OpRegistry::Global());
+    GraphConstructorOptions opts;
+    testing::StartTiming();
+    TF_CHECK_OK(ConvertGraphDefToGraph(opts, gdef, &graph));
+    testing::StopTiming();
+  }
+}
+BENCHMARK(BM_ConvertGraphDefToGraph)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void BM_ImportGraphDef(int iters, int num_nodes) {
+  testing::StopTiming();
+  testing::UseRealTime();
+  const GraphDef gdef = LargeGraphDef(num_nodes);
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_nodes);
+  for (int i = 0; i < iters; ++i) {
+    Graph graph(OpRegistry::Global());
+    ImportGraphDefOptions opts;
+    opts.prefix = "import";
+    testing::StartTiming();
+    TF_CHECK_OK(ImportGraphDef(opts, gdef, &graph, nullptr));
+    testing::StopTiming();
+  }
+}
+BENCHMARK(BM_ImportGraphDef)->Arg(1000)->Arg(10000)->Arg(100000);
+
 }  // namespace
 }  // namespace tensorflow
@@ -28,6 +28,13 @@ limitations under the License.
 //     if available[h] does not exist
 //       available[h] = n
 //
+// NodeHash(n) combines the op, the output types, the attrs in the order of
+// their names and the (node, output) pairs feeding n. Since the inputs of n
+// have already been replaced by their available equivalents, the input
+// nodes act as value numbers and the whole pass takes linear time. Tensor
+// attrs are hashed and compared by content rather than by encoding, so that
+// e.g. Const nodes holding the same values are merged.
+//
 // This is similar to the global value number algorithm describe in this
 // paper:
 //
@@ -38,14 +45,23 @@ limitations under the License.
 
 #include "tensorflow/core/graph/optimizer_cse.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/protobuf.h"
 
 namespace tensorflow {
 
@@ -56,11 +72,9 @@ class OptimizerCSE {
   bool Optimize(const std::function<bool(const Node*)>& consider_fn);
 
  private:
-  struct Scratch;
-
   static size_t NodeHash(const Node* n);
-  static bool Equivalent(const Node* a, const Node* b, Scratch* s);
-  static bool EqualAttrs(const Node* a, const Node* b, Scratch* s);
+  static bool Equivalent(const Node* a, const Node* b);
+  static bool EqualAttrs(const Node* a, const Node* b);
 
   Graph* g_;
 };
@@ -86,35 +100,210 @@ static void FillInputs(const Node* n,
   }
 }
 
+// Tensors stored in the repeated value fields of their protos are parsed to
+// be compared by value only up to this size, since a single value can encode
+// a tensor of any size. Larger ones are compared by their encodings.
+static const int64 kMaxParsedTensorBytes = 64 * 1024;
+
+// Returns true if "proto" is compared by its encoding rather than by the
+// values of its tensor.
+static bool ComparedByEncoding(const TensorProto& proto) {
+  if (!DataTypeCanUseMemcpy(proto.dtype()) ||
+      !TensorShape::IsValid(proto.tensor_shape()) ||
+      !proto.tensor_content().empty()) {
+    return false;
+  }
+  const TensorShape shape(proto.tensor_shape());
+  return shape.num_elements() * DataTypeSize(proto.dtype()) >
+         kMaxParsedTensorBytes;
+}
+
+// Removes the trailing copies of the last value of "values", which is made of
+// "stride" numbers, since the last value is repeated to fill the tensor
+// anyway. Values are compared bitwise, so that 0.0 and -0.0 differ.
+template <typename T>
+static void RemoveRepeatedTail(int stride,
+                               protobuf::RepeatedField<T>* values) {
+  if (values->size() < 2 * stride) return;
+  const int num_bytes = stride * sizeof(T);
+  const T* last = values->data() + values->size() - stride;
+  int size = values->size();
+  while (size >= 2 * stride &&
+         memcmp(values->data() + size - 2 * stride, last, num_bytes) == 0) {
+    size -= stride;
+  }
+  values->Truncate(size);
+}
+
+// Serializes "proto" without the repetitions of its last value, so that the
+// different lengths of the repeated encoding of a tensor compare equal.
+static string CanonicalSerialization(const TensorProto& proto) {
+  TensorProto canonical = proto;
+  RemoveRepeatedTail(1, canonical.mutable_half_val());
+  RemoveRepeatedTail(1, canonical.mutable_float_val());
+  RemoveRepeatedTail(1, canonical.mutable_double_val());
+  RemoveRepeatedTail(1, canonical.mutable_int_val());
+  RemoveRepeatedTail(2, canonical.mutable_scomplex_val());
+  RemoveRepeatedTail(1, canonical.mutable_int64_val());
+  RemoveRepeatedTail(1, canonical.mutable_bool_val());
+  RemoveRepeatedTail(2, canonical.mutable_dcomplex_val());
+  string result;
+  SerializeToStringDeterministic(canonical, &result);
+  return result;
+}
+
+// Sets *content to the bytes of the values of the tensor in "proto", which
+// are the same for all encodings of the tensor. "storage" holds the parsed
+// tensor if "proto" does not store its bytes directly. Returns false for
+// tensors without such a representation, such as strings, or invalid ones.
+// Must not be called on the tensors that are ComparedByEncoding().
+static bool TensorContent(const TensorProto& proto, Tensor* storage,
+                          StringPiece* content) {
+  if (!DataTypeCanUseMemcpy(proto.dtype()) ||
+      !TensorShape::IsValid(proto.tensor_shape())) {
+    return false;
+  }
+  if (!proto.tensor_content().empty()) {
+    const TensorShape shape(proto.tensor_shape());
+    if (proto.tensor_content().size() !=
+        shape.num_elements() * DataTypeSize(proto.dtype())) {
+      return false;
+    }
+    *content = proto.tensor_content();
+    return true;
+  }
+  if (!storage->FromProto(proto)) return false;
+  *content = storage->tensor_data();
+  return true;
+}
+
+static string DeterministicSerialization(
+    const protobuf::MessageLite& message) {
+  string result;
+  SerializeToStringDeterministic(message, &result);
+  return result;
+}
+
+static uint64 TensorHash(const TensorProto& proto) {
+  if (ComparedByEncoding(proto)) {
+    return Hash64(CanonicalSerialization(proto));
+  }
+  Tensor storage;
+  StringPiece content;
+  if (!TensorContent(proto, &storage, &content)) {
+    return Hash64(DeterministicSerialization(proto));
+  }
+  uint64 h = Hash64Combine(proto.dtype(), proto.tensor_shape().dim_size());
+  for (const auto& dim : proto.tensor_shape().dim()) {
+    h = Hash64Combine(h, dim.size());
+  }
+  return Hash64Combine(h, Hash64(content.data(), content.size()));
+}
+
+static bool TensorsEquivalent(const TensorProto& a, const TensorProto& b) {
+  const bool a_by_encoding = ComparedByEncoding(a);
+  const bool b_by_encoding = ComparedByEncoding(b);
+  if (a_by_encoding || b_by_encoding) {
+    return a_by_encoding == b_by_encoding &&
+           CanonicalSerialization(a) == CanonicalSerialization(b);
+  }
+  Tensor a_storage;
+  Tensor b_storage;
+  StringPiece a_content;
+  StringPiece b_content;
+  const bool a_has_content = TensorContent(a, &a_storage, &a_content);
+  const bool b_has_content = TensorContent(b, &b_storage, &b_content);
+  if (a_has_content != b_has_content) return false;
+  if (!a_has_content) {
+    return DeterministicSerialization(a) == DeterministicSerialization(b);
+  }
+  return a.dtype() == b.dtype() &&
+         TensorShape(a.tensor_shape()) == TensorShape(b.tensor_shape()) &&
+         a_content == b_content;
+}
+
+// Returns "list" without its tensors, which are compared separately.
+static AttrValue::ListValue ListWithoutTensors(
+    const AttrValue::ListValue& list) {
+  AttrValue::ListValue result = list;
+  result.clear_tensor();
+  return result;
+}
+
+// Hashes "value" such that values equal under AttrValuesEquivalent() have
+// equal hashes.
+static uint64 AttrValueHash(const AttrValue& value) {
+  if (value.value_case() == AttrValue::kTensor) {
+    return TensorHash(value.tensor());
+  }
+  if (value.value_case() == AttrValue::kList &&
+      value.list().tensor_size() > 0) {
+    uint64 h =
+        Hash64(DeterministicSerialization(ListWithoutTensors(value.list())));
+    for (const TensorProto& tensor : value.list().tensor()) {
+      h = Hash64Combine(h, TensorHash(tensor));
+    }
+    return h;
+  }
+  return Hash64(DeterministicSerialization(value));
+}
+
+// Like AreAttrValuesEqual(), but compares tensors by their values.
+static bool AttrValuesEquivalent(const AttrValue& a, const AttrValue& b) {
+  if (a.value_case() != b.value_case()) return false;
+  if (a.value_case() == AttrValue::kTensor) {
+    return TensorsEquivalent(a.tensor(), b.tensor());
+  }
+  if (a.value_case() == AttrValue::kList &&
+      (a.list().tensor_size() > 0 || b.list().tensor_size() > 0)) {
+    if (a.list().tensor_size() != b.list().tensor_size()) return false;
+    for (int i = 0; i < a.list().tensor_size(); ++i) {
+      if (!TensorsEquivalent(a.list().tensor(i), b.list().tensor(i))) {
+        return false;
+      }
+    }
+    return DeterministicSerialization(ListWithoutTensors(a.list())) ==
+           DeterministicSerialization(ListWithoutTensors(b.list()));
+  }
+  return AreAttrValuesEqual(a, b);
+}
+
 static size_t kIllegalNodeHash = 0;
 
 size_t OptimizerCSE::NodeHash(const Node* n) {
+  uint64 h = Hash64(n->type_string());
   const DataTypeVector& out = n->output_types();
-  string str_to_hash = strings::StrCat(n->type_string(), out.size());
+  h = Hash64Combine(h, out.size());
   for (DataType dt : out) {
-    strings::StrAppend(&str_to_hash, dt);
+    h = Hash64Combine(h, dt);
   }
 
   const int N_in = n->num_inputs();
-  strings::StrAppend(&str_to_hash, N_in);
+  h = Hash64Combine(h, N_in);
   gtl::InlinedVector<Node*, 4> control_edges;
   gtl::InlinedVector<std::pair<Node*, int>, 4> in(N_in);
   FillInputs(n, &control_edges, &in);
   for (const auto& edge : in) {
-    strings::StrAppend(&str_to_hash, edge.first->id(), edge.second);
+    h = Hash64Combine(h, edge.first->id());
+    h = Hash64Combine(h, edge.second);
   }
 
-  size_t h = Hash64(str_to_hash);
-
 #if !defined(__ANDROID__)
-  // Hash the attrs.  For example, this makes sure different constants
+  // Hash the attrs in the order of their names, since the order of a proto
+  // map is unspecified.  For example, this makes sure different constants
   // end up in different hash buckets.
-  string tmp;
+  gtl::InlinedVector<const AttrValueMap::value_type*, 8> attrs;
   for (const auto& attr : n->def().attr()) {
-    tmp = attr.first;
-    attr.second.AppendToString(&tmp);
-    // Add hashes of attrs, so the order of attrs doesn't matter.
-    h += Hash32(tmp.data(), tmp.size(), 0x87341245);
+    attrs.push_back(&attr);
+  }
+  std::sort(attrs.begin(), attrs.end(),
+            [](const AttrValueMap::value_type* a,
+               const AttrValueMap::value_type* b) {
+              return a->first < b->first;
+            });
+  for (const auto* attr : attrs) {
+    h = Hash64Combine(h, Hash64(attr->first));
+    h = Hash64Combine(h, AttrValueHash(attr->second));
   }
 #endif
 
@@ -122,24 +311,13 @@ size_t OptimizerCSE::NodeHash(const Node* n) {
   return h;
 }
 
-struct OptimizerCSE::Scratch {
-  // For EqualAttrs():
-  string a;
-  string b;
-};
-
-bool OptimizerCSE::EqualAttrs(const Node* a, const Node* b, Scratch* scratch) {
+bool OptimizerCSE::EqualAttrs(const Node* a, const Node* b) {
   if (a->def().attr_size() != b->def().attr_size()) return false;
 
   for (const auto& attr : b->def().attr()) {
     auto iter = a->def().attr().find(attr.first);
     if (iter == a->def().attr().end()) return false;
-    // Note: it should be safe to compare proto serializations of the attr
-    // values since at most one field should be set in each (indeed, it
-    // should be the same field).
-    iter->second.SerializeToString(&scratch->a);
-    attr.second.SerializeToString(&scratch->b);
-    if (scratch->a != scratch->b) return false;
+    if (!AttrValuesEquivalent(iter->second, attr.second)) return false;
   }
   return true;
 }
@@ -151,7 +329,7 @@ static bool HasRefInput(const Node* n) {
   return false;
 }
 
-bool OptimizerCSE::Equivalent(const Node* a, const Node* b, Scratch* scratch) {
+bool OptimizerCSE::Equivalent(const Node* a, const Node* b) {
   // Different op names are different
   if (a->type_string() != b->type_string()) return false;
 
@@ -164,7 +342,7 @@ bool OptimizerCSE::Equivalent(const Node* a, const Node* b, Scratch* scratch) {
 
   // Compare attrs.  Note that equal attrs implies equal input and
   // output types.
-  if (!EqualAttrs(a, b, scratch)) return false;
+  if (!EqualAttrs(a, b)) return false;
 
   // Compare input sources
   if (a->num_inputs() != b->num_inputs()) return false;
@@ -202,11 +380,9 @@ bool OptimizerCSE::Optimize(
   // hash collisions, but it allows us to avoid having the value
   // be a set<Node*> (or equivalent).
   std::unordered_map<size_t, Node*> available;
+  available.reserve(order.size());
 
-  // Scratch space for Equivalent calls.  Allocated here and passed in to
-  // Equivalent to avoid allocation inside the loop below.
   bool changed = false;
-  Scratch scratch;
   for (Node* n : order) {
     if (!n->IsOp()) continue;
 
@@ -218,7 +394,7 @@ bool OptimizerCSE::Optimize(
     if (*candidate == nullptr) {
       // No existing match: insert "n" into the hash table under "h"
       *candidate = n;
-    } else if (Equivalent(*candidate, n, &scratch)) {
+    } else if (Equivalent(*candidate, n)) {
       VLOG(1) << "CSE: equivalent: " << (*candidate)->name() << " and "
               << n->name();
       // *candidate and n are equivalent.  Therefore, we can replace
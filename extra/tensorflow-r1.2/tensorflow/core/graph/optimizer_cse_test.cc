@@ -273,6 +273,89 @@ TEST_F(OptimizerCSETest, DifferentConstants) {
             "A->D;B->D:1");
 }
 
+TEST_F(OptimizerCSETest, SameConstants_DifferentEncodings) {
+  // Constants are compared by value, not by the encoding of their tensors.
+  InitGraph(
+      "node { name: 'A' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_INT32 } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_INT32 tensor_shape { dim { size: 2 } } "
+      "    int_val: 7 } } } }"
+      "node { name: 'B' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_INT32 } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_INT32 tensor_shape { dim { size: 2 } } "
+      "    int_val: [7, 7] } } } }"
+      "node { name: 'C' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_INT32 } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_INT32 tensor_shape { dim { size: 2 } } "
+      "    tensor_content: '\\007\\000\\000\\000\\007\\000\\000\\000' } } } }"
+      "node { name: 'D' op: 'Mul' attr { key: 'T' value { type: DT_INT32 } }"
+      " input: ['A', 'B'] }"
+      "node { name: 'E' op: 'Mul' attr { key: 'T' value { type: DT_INT32 } }"
+      " input: ['C', 'C'] }");
+  DoCSE();
+  // Only one Const and one Mul remain, besides the source and sink.
+  EXPECT_EQ(4, graph_.num_nodes());
+}
+
+TEST_F(OptimizerCSETest, DifferentConstants_SameContent) {
+  // The same bytes with a different shape are a different constant.
+  InitGraph(
+      "node { name: 'A' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_INT32 } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_INT32 tensor_shape { dim { size: 2 } } "
+      "    tensor_content: '\\007\\000\\000\\000\\007\\000\\000\\000' } } } }"
+      "node { name: 'B' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_INT32 } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_INT32 tensor_shape { dim { size: 1 } "
+      "    dim { size: 2 } } "
+      "    tensor_content: '\\007\\000\\000\\000\\007\\000\\000\\000' } } } }");
+  EXPECT_EQ(DoCSE(), OriginalGraph());
+}
+
+TEST_F(OptimizerCSETest, SameLargeConstants_DifferentLengths) {
+  // Large constants stored as repeated values are compared by their
+  // encodings, without the repetitions of their last value.
+  InitGraph(
+      "node { name: 'A' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_FLOAT } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_FLOAT tensor_shape { dim { size: 1000000 } } "
+      "    float_val: [3, 7] } } } }"
+      "node { name: 'B' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_FLOAT } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_FLOAT tensor_shape { dim { size: 1000000 } } "
+      "    float_val: [3, 7, 7, 7] } } } }"
+      "node { name: 'D' op: 'Mul' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['A', 'B'] }");
+  EXPECT_EQ(DoCSE(),
+            "B(Const);D(Mul)|"
+            "B->D;B->D:1");
+}
+
+TEST_F(OptimizerCSETest, DifferentLargeConstants) {
+  // The repeated values are compared bitwise, so 0 and -0 differ.
+  InitGraph(
+      "node { name: 'A' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_FLOAT } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_FLOAT tensor_shape { dim { size: 1000000 } } "
+      "    float_val: [1, 0] } } } }"
+      "node { name: 'B' op: 'Const' "
+      "  attr { key: 'dtype' value { type: DT_FLOAT } }"
+      "  attr { key: 'value' value {"
+      "    tensor { dtype: DT_FLOAT tensor_shape { dim { size: 1000000 } } "
+      "    float_val: [1, -0] } } } }"
+      "node { name: 'D' op: 'Mul' attr { key: 'T' value { type: DT_FLOAT } }"
+      " input: ['A', 'B'] }");
+  EXPECT_EQ(DoCSE(), OriginalGraph());
+}
+
 TEST_F(OptimizerCSETest, SameOps_DifferentAttrs1) {
   InitGraph(
       "node { name: 'A' op: 'Input'}"
@@ -0,0 +1,577 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/graph/quantize_inference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <set>
+#include <unordered_set>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Describes how a float op is rewritten.
+struct QuantizableOp {
+  const char* op;
+  const char* quantized_op;
+  // Whether input 1 holds constant weights that are quantized offline.
+  bool has_weights;
+  // Whether the weights get one range per output channel.
+  bool per_channel_weights;
+  // Whether the quantized op produces 32-bit results that must be
+  // requantized to eight bits.
+  bool requantize;
+};
+
+const QuantizableOp kQuantizableOps[] = {
+    {"Conv2D", "QuantizedConv2D", true, true, true},
+    {"MatMul", "QuantizedMatMul", true, true, true},
+    {"BiasAdd", "QuantizedBiasAdd", true, false, true},
+    {"Relu", "QuantizedRelu", false, false, false},
+    {"Relu6", "QuantizedRelu6", false, false, false},
+    {"MaxPool", "QuantizedMaxPool", false, false, false},
+    {"AvgPool", "QuantizedAvgPool", false, false, false},
+};
+
+typedef std::unordered_map<string, const NodeDef*> NodeMap;
+
+NodeMap MakeNodeMap(const GraphDef& graph) {
+  NodeMap node_map;
+  for (const NodeDef& node : graph.node()) {
+    node_map[node.name()] = &node;
+  }
+  return node_map;
+}
+
+// Returns `input`, a NodeDef input, in "node:output" form.
+string CanonicalTensorName(const string& input) {
+  return ParseTensorName(input).ToString();
+}
+
+bool IsControlInput(const string& input) {
+  return !input.empty() && input[0] == '^';
+}
+
+// Returns the Const node that `input` reads, possibly through Identity
+// nodes, or null.
+const NodeDef* FindConstInput(const NodeMap& node_map, const string& input) {
+  const TensorId id = ParseTensorName(input);
+  if (id.second != 0) return nullptr;
+  auto it = node_map.find(id.first.ToString());
+  while (it != node_map.end() && it->second->op() == "Identity" &&
+         it->second->input_size() > 0 &&
+         !IsControlInput(it->second->input(0))) {
+    it = node_map.find(ParseTensorName(it->second->input(0)).first.ToString());
+  }
+  if (it == node_map.end() || it->second->op() != "Const") return nullptr;
+  return it->second;
+}
+
+// Returns true if the strides of Conv2D `node` are supported by
+// QuantizedConv2D, which requires equal row and column strides and unit batch
+// and depth strides.
+bool HasQuantizableStrides(const NodeDef& node) {
+  std::vector<int32> strides;
+  return GetNodeAttr(node, "strides", &strides).ok() && strides.size() == 4 &&
+         strides[0] == 1 && strides[1] == strides[2] && strides[3] == 1;
+}
+
+// Returns how `node` can be rewritten, or null if it can't.
+const QuantizableOp* FindQuantizableOp(const NodeMap& node_map,
+                                       const NodeDef& node) {
+  const QuantizableOp* op = nullptr;
+  for (const QuantizableOp& candidate : kQuantizableOps) {
+    if (node.op() == candidate.op) op = &candidate;
+  }
+  if (op == nullptr || node.input_size() < (op->has_weights ? 2 : 1) ||
+      IsControlInput(node.input(0))) {
+    return nullptr;
+  }
+  DataType type;
+  if (!GetNodeAttr(node, "T", &type).ok() || type != DT_FLOAT) return nullptr;
+  string data_format;
+  if (GetNodeAttr(node, "data_format", &data_format).ok() &&
+      data_format != "NHWC") {
+    return nullptr;
+  }
+  if (node.op() == "Conv2D" && !HasQuantizableStrides(node)) return nullptr;
+  if (op->has_weights) {
+    const NodeDef* weights = FindConstInput(node_map, node.input(1));
+    if (weights == nullptr || !GetNodeAttr(*weights, "dtype", &type).ok() ||
+        type != DT_FLOAT) {
+      return nullptr;
+    }
+  }
+  return op;
+}
+
+// Returns the names of the tensors whose ranges QuantizeGraphForInference()
+// uses.
+std::vector<string> TensorsToCalibrate(const GraphDef& graph) {
+  const NodeMap node_map = MakeNodeMap(graph);
+  std::set<string> tensors;
+  for (const NodeDef& node : graph.node()) {
+    const QuantizableOp* op = FindQuantizableOp(node_map, node);
+    if (op == nullptr) continue;
+    tensors.insert(CanonicalTensorName(node.input(0)));
+    if (op->requantize) tensors.insert(strings::StrCat(node.name(), ":0"));
+  }
+  return std::vector<string>(tensors.begin(), tensors.end());
+}
+
+Tensor ScalarTensor(float value) {
+  Tensor tensor(DT_FLOAT, TensorShape({}));
+  tensor.scalar<float>()() = value;
+  return tensor;
+}
+
+// Widens [min, max] to include zero, which the quantized kernels need to
+// represent exactly, and makes it non-empty.
+void NormalizeRange(float* min, float* max) {
+  *min = std::min(*min, 0.0f);
+  *max = std::max(*max, 0.0f);
+  if (*max <= *min) *max = *min + 1.0f;
+}
+
+// Quantizes `weights` to quint8 the way FloatToQuantized() does, giving each
+// of `channels` output channels its own range. Element i belongs to channel
+// (i / stride) % channels. The ranges are returned as scalars if `channels`
+// is 1 and as vectors otherwise.
+void QuantizeWeights(const Tensor& weights, int64 channels, int64 stride,
+                     Tensor* quantized, Tensor* mins, Tensor* maxes) {
+  auto values = weights.flat<float>();
+  std::vector<float> channel_mins(channels, 0.0f);
+  std::vector<float> channel_maxes(channels, 0.0f);
+  for (int64 i = 0; i < values.size(); ++i) {
+    const int64 c = (i / stride) % channels;
+    channel_mins[c] = std::min(channel_mins[c], values(i));
+    channel_maxes[c] = std::max(channel_maxes[c], values(i));
+  }
+  const TensorShape range_shape =
+      channels == 1 ? TensorShape({}) : TensorShape({channels});
+  *mins = Tensor(DT_FLOAT, range_shape);
+  *maxes = Tensor(DT_FLOAT, range_shape);
+  for (int64 c = 0; c < channels; ++c) {
+    NormalizeRange(&channel_mins[c], &channel_maxes[c]);
+    mins->flat<float>()(c) = channel_mins[c];
+    maxes->flat<float>()(c) = channel_maxes[c];
+  }
+  *quantized = Tensor(DT_QUINT8, weights.shape());
+  auto quantized_values = quantized->flat<quint8>();
+  for (int64 i = 0; i < values.size(); ++i) {
+    const int64 c = (i / stride) % channels;
+    const double range_scale = 255.0 / (channel_maxes[c] - channel_mins[c]);
+    const int64 value =
+        static_cast<int64>(std::round(values(i) * range_scale)) -
+        static_cast<int64>(std::round(channel_mins[c] * range_scale));
+    quantized_values(i) =
+        static_cast<uint8>(std::max<int64>(0, std::min<int64>(255, value)));
+  }
+}
+
+// Rewrites a GraphDef in place, see QuantizeGraphForInference().
+class InferenceQuantizer {
+ public:
+  InferenceQuantizer(const CalibrationRanges& ranges, GraphDef* graph)
+      : ranges_(ranges), graph_(graph) {
+    for (const NodeDef& node : graph_->node()) {
+      names_.insert(node.name());
+    }
+  }
+
+  Status Run() {
+    // The candidates are found up front, on the original graph. Rewriting
+    // only appends nodes and turns candidates into Dequantize nodes, so
+    // node_map_ stays valid for finding the weights.
+    node_map_ = MakeNodeMap(*graph_);
+    std::vector<std::pair<int, const QuantizableOp*>> candidates;
+    for (int i = 0; i < graph_->node_size(); ++i) {
+      const QuantizableOp* op = FindQuantizableOp(node_map_, graph_->node(i));
+      if (op != nullptr) candidates.emplace_back(i, op);
+    }
+    int num_rewritten = 0;
+    for (const auto& candidate : candidates) {
+      bool rewritten = false;
+      TF_RETURN_IF_ERROR(
+          RewriteNode(*candidate.second, candidate.first, &rewritten));
+      if (rewritten) ++num_rewritten;
+    }
+    BypassDequantizeQuantizePairs();
+    RemoveUnusedNodes();
+    VLOG(1) << "Rewrote " << num_rewritten << " of " << candidates.size()
+            << " quantizable nodes";
+    return Status::OK();
+  }
+
+ private:
+  bool GetRange(const string& tensor, float* min, float* max) const {
+    auto it = ranges_.find(CanonicalTensorName(tensor));
+    if (it == ranges_.end()) return false;
+    *min = it->second.first;
+    *max = it->second.second;
+    NormalizeRange(min, max);
+    return true;
+  }
+
+  string UniqueName(const string& base) {
+    string name = base;
+    for (int i = 1; names_.count(name) > 0; ++i) {
+      name = strings::StrCat(base, "_", i);
+    }
+    names_.insert(name);
+    return name;
+  }
+
+  NodeDef* AddNode(const string& name, const string& op,
+                   const string& device) {
+    NodeDef* node = graph_->add_node();
+    node->set_name(UniqueName(name));
+    node->set_op(op);
+    node->set_device(device);
+    return node;
+  }
+
+  string AddConst(const string& name, const Tensor& value,
+                  const string& device) {
+    NodeDef* node = AddNode(name, "Const", device);
+    AddNodeAttr("dtype", value.dtype(), node);
+    AddNodeAttr("value", value, node);
+    return node->name();
+  }
+
+  // Returns the name of a QuantizeV2 node that quantizes the float tensor
+  // `input` to [min, max], shared by all the consumers of the tensor.
+  string QuantizeActivation(const string& input, float min, float max,
+                            const string& device) {
+    const TensorId id = ParseTensorName(input);
+    const string tensor = id.ToString();
+    auto it = quantized_tensors_.find(tensor);
+    if (it != quantized_tensors_.end()) return it->second;
+    const string base =
+        id.second == 0
+            ? strings::StrCat(id.first, "/eightbit_quantize")
+            : strings::StrCat(id.first, "/eightbit_quantize_", id.second);
+    NodeDef* quantize = AddNode(base, "QuantizeV2", device);
+    const string& name = quantize->name();
+    quantize->add_input(input);
+    quantize->add_input(
+        AddConst(strings::StrCat(name, "/min"), ScalarTensor(min), device));
+    quantize->add_input(
+        AddConst(strings::StrCat(name, "/max"), ScalarTensor(max), device));
+    AddNodeAttr("T", DT_QUINT8, quantize);
+    AddNodeAttr("mode", "MIN_FIRST", quantize);
+    quantized_tensors_[tensor] = name;
+    return name;
+  }
+
+  // Replaces node `index` by its quantized version if the ranges it needs
+  // are known.
+  Status RewriteNode(const QuantizableOp& op, int index, bool* rewritten) {
+    const NodeDef original = graph_->node(index);
+    const string& device = original.device();
+    float input_min, input_max, output_min = 0.0f, output_max = 0.0f;
+    if (!GetRange(original.input(0), &input_min, &input_max) ||
+        (op.requantize &&
+         !GetRange(original.name(), &output_min, &output_max))) {
+      return Status::OK();
+    }
+
+    // The quantized weights, and their ranges.
+    string weights_name, weights_min_name, weights_max_name;
+    if (op.has_weights) {
+      const NodeDef* weights_node =
+          FindConstInput(node_map_, original.input(1));
+      Tensor weights;
+      TF_RETURN_IF_ERROR(GetNodeAttr(*weights_node, "value", &weights));
+      int64 channels = 1;
+      int64 stride = 1;
+      if (op.per_channel_weights) {
+        bool transpose_b = false;
+        if (original.op() == "MatMul") {
+          GetNodeAttr(original, "transpose_b", &transpose_b).IgnoreError();
+        }
+        if (weights.dims() < 1) {
+          return errors::InvalidArgument("Weights of ", original.name(),
+                                         " are not a matrix or filter");
+        }
+        const int channel_dim = transpose_b ? 0 : weights.dims() - 1;
+        channels = weights.dim_size(channel_dim);
+        if (transpose_b) stride = weights.NumElements() / channels;
+      }
+      Tensor quantized, mins, maxes;
+      QuantizeWeights(weights, channels, stride, &quantized, &mins, &maxes);
+      const string prefix = strings::StrCat(original.name(), "/eightbit");
+      weights_name =
+          AddConst(strings::StrCat(prefix, "/weights"), quantized, device);
+      weights_min_name =
+          AddConst(strings::StrCat(prefix, "/weights_min"), mins, device);
+      weights_max_name =
+          AddConst(strings::StrCat(prefix, "/weights_max"), maxes, device);
+      replaced_weights_.push_back(original.input(1));
+    }
+
+    const string input_name =
+        QuantizeActivation(original.input(0), input_min, input_max, device);
+
+    NodeDef* quantized_node = AddNode(
+        strings::StrCat(original.name(), "/eightbit"), op.quantized_op, device);
+    quantized_node->add_input(strings::StrCat(input_name, ":0"));
+    if (op.has_weights) quantized_node->add_input(weights_name);
+    quantized_node->add_input(strings::StrCat(input_name, ":1"));
+    quantized_node->add_input(strings::StrCat(input_name, ":2"));
+    if (op.has_weights) {
+      quantized_node->add_input(weights_min_name);
+      quantized_node->add_input(weights_max_name);
+    }
+    for (const string& input : original.input()) {
+      if (IsControlInput(input)) quantized_node->add_input(input);
+    }
+    const string node_op = original.op();
+    if (node_op == "Conv2D") {
+      AddNodeAttr("Tinput", DT_QUINT8, quantized_node);
+      AddNodeAttr("Tfilter", DT_QUINT8, quantized_node);
+      AddNodeAttr("out_type", DT_QINT32, quantized_node);
+    } else if (node_op == "MatMul") {
+      AddNodeAttr("T1", DT_QUINT8, quantized_node);
+      AddNodeAttr("T2", DT_QUINT8, quantized_node);
+      AddNodeAttr("Toutput", DT_QINT32, quantized_node);
+    } else if (node_op == "BiasAdd") {
+      AddNodeAttr("T1", DT_QUINT8, quantized_node);
+      AddNodeAttr("T2", DT_QUINT8, quantized_node);
+      AddNodeAttr("out_type", DT_QINT32, quantized_node);
+    } else if (node_op == "Relu" || node_op == "Relu6") {
+      AddNodeAttr("Tinput", DT_QUINT8, quantized_node);
+      AddNodeAttr("out_type", DT_QUINT8, quantized_node);
+    } else {
+      AddNodeAttr("T", DT_QUINT8, quantized_node);
+    }
+    for (const char* attr :
+         {"strides", "padding", "ksize", "transpose_a", "transpose_b"}) {
+      auto it = original.attr().find(attr);
+      if (it != original.attr().end()) {
+        (*quantized_node->mutable_attr())[attr] = it->second;
+      }
+    }
+    string result = quantized_node->name();
+
+    if (op.requantize) {
+      const string prefix = strings::StrCat(original.name(), "/eightbit");
+      const string requested_min = AddConst(
+          strings::StrCat(prefix, "/requested_min"), ScalarTensor(output_min),
+          device);
+      const string requested_max = AddConst(
+          strings::StrCat(prefix, "/requested_max"), ScalarTensor(output_max),
+          device);
+      NodeDef* requantize = AddNode(strings::StrCat(prefix, "/requantize"),
+                                    "Requantize", device);
+      requantize->add_input(strings::StrCat(result, ":0"));
+      requantize->add_input(strings::StrCat(result, ":1"));
+      requantize->add_input(strings::StrCat(result, ":2"));
+      requantize->add_input(requested_min);
+      requantize->add_input(requested_max);
+      AddNodeAttr("Tinput", DT_QINT32, requantize);
+      AddNodeAttr("out_type", DT_QUINT8, requantize);
+      result = requantize->name();
+    }
+
+    // The original node becomes a Dequantize of the result, so that its
+    // float consumers and fetches still find it.
+    NodeDef* dequantize = graph_->mutable_node(index);
+    dequantize->Clear();
+    dequantize->set_name(original.name());
+    dequantize->set_op("Dequantize");
+    dequantize->set_device(device);
+    dequantize->add_input(strings::StrCat(result, ":0"));
+    dequantize->add_input(strings::StrCat(result, ":1"));
+    dequantize->add_input(strings::StrCat(result, ":2"));
+    AddNodeAttr("T", DT_QUINT8, dequantize);
+    AddNodeAttr("mode", "MIN_FIRST", dequantize);
+    *rewritten = true;
+    return Status::OK();
+  }
+
+  // Makes the consumers of each QuantizeV2 that reads the output of a
+  // Dequantize, with the same type and mode, read the Dequantize's inputs
+  // instead. The quantized consumers take the range of their input as inputs
+  // too, so they compute the same result from the unconverted tensor.
+  void BypassDequantizeQuantizePairs() {
+    const NodeMap node_map = MakeNodeMap(*graph_);
+    std::unordered_map<string, string> forwarded;
+    for (const NodeDef& node : graph_->node()) {
+      if (node.op() != "QuantizeV2" || !IsEightBitMinFirst(node) ||
+          node.input_size() != 3) {
+        continue;
+      }
+      const TensorId id = ParseTensorName(node.input(0));
+      auto it = node_map.find(id.first.ToString());
+      if (id.second != 0 || it == node_map.end() ||
+          it->second->op() != "Dequantize" ||
+          !IsEightBitMinFirst(*it->second) || it->second->input_size() < 3) {
+        continue;
+      }
+      for (int i = 0; i < 3; ++i) {
+        forwarded[strings::StrCat(node.name(), ":", i)] =
+            it->second->input(i);
+      }
+      removable_.insert(node.name());
+    }
+    if (forwarded.empty()) return;
+    for (NodeDef& node : *graph_->mutable_node()) {
+      for (string& input : *node.mutable_input()) {
+        if (IsControlInput(input)) continue;
+        // A bypassed QuantizeV2 may read a Dequantize of another one.
+        for (auto it = forwarded.find(CanonicalTensorName(input));
+             it != forwarded.end();
+             it = forwarded.find(CanonicalTensorName(input))) {
+          input = it->second;
+        }
+      }
+    }
+    VLOG(1) << "Bypassed " << forwarded.size() / 3
+            << " Dequantize/QuantizeV2 pairs";
+  }
+
+  static bool IsEightBitMinFirst(const NodeDef& node) {
+    DataType type;
+    string mode;
+    return GetNodeAttr(node, "T", &type).ok() && type == DT_QUINT8 &&
+           GetNodeAttr(node, "mode", &mode).ok() && mode == "MIN_FIRST";
+  }
+
+  // Removes the bypassed QuantizeV2 nodes and the float weights that were
+  // replaced, along with the Const and Identity nodes that only they used.
+  void RemoveUnusedNodes() {
+    const NodeMap node_map = MakeNodeMap(*graph_);
+    for (const string& input : replaced_weights_) {
+      auto it = node_map.find(ParseTensorName(input).first.ToString());
+      while (it != node_map.end() &&
+             (it->second->op() == "Identity" || it->second->op() == "Const")) {
+        removable_.insert(it->first);
+        if (it->second->op() == "Const") break;
+        it = node_map.find(
+            ParseTensorName(it->second->input(0)).first.ToString());
+      }
+    }
+    std::unordered_map<string, int> num_consumers;
+    for (const NodeDef& node : graph_->node()) {
+      for (const string& input : node.input()) {
+        ++num_consumers[ParseTensorName(input).first.ToString()];
+      }
+    }
+    std::vector<string> ready;
+    for (const string& name : removable_) {
+      if (num_consumers[name] == 0) ready.push_back(name);
+    }
+    std::unordered_set<string> removed;
+    while (!ready.empty()) {
+      const string name = ready.back();
+      ready.pop_back();
+      if (!removed.insert(name).second) continue;
+      for (const string& input : node_map.at(name)->input()) {
+        const string src = ParseTensorName(input).first.ToString();
+        auto src_node = node_map.find(src);
+        if (--num_consumers[src] == 0 && src_node != node_map.end() &&
+            (removable_.count(src) > 0 || src_node->second->op() == "Const")) {
+          ready.push_back(src);
+        }
+      }
+    }
+    if (removed.empty()) return;
+    int kept = 0;
+    for (int i = 0; i < graph_->node_size(); ++i) {
+      if (removed.count(graph_->node(i).name()) > 0) continue;
+      if (kept != i) graph_->mutable_node()->SwapElements(kept, i);
+      ++kept;
+    }
+    graph_->mutable_node()->DeleteSubrange(kept, graph_->node_size() - kept);
+  }
+
+  const CalibrationRanges& ranges_;
+  GraphDef* graph_;
+  NodeMap node_map_;
+  std::unordered_set<string> names_;
+  // QuantizeV2 nodes created so far, by the tensor they quantize.
+  std::unordered_map<string, string> quantized_tensors_;
+  // Weights inputs of the rewritten nodes.
+  std::vector<string> replaced_weights_;
+  // Nodes to remove once nothing uses them.
+  std::unordered_set<string> removable_;
+};
+
+}  // namespace
+
+Status CalibrateForQuantizedInference(
+    const GraphDef& graph_def,
+    const std::vector<std::vector<std::pair<string, Tensor>>>&
+        calibration_feeds,
+    CalibrationRanges* ranges) {
+  ranges->clear();
+  const std::vector<string> tensors = TensorsToCalibrate(graph_def);
+  if (tensors.empty() || calibration_feeds.empty()) return Status::OK();
+
+  Session* session_ptr;
+  TF_RETURN_IF_ERROR(NewSession(SessionOptions(), &session_ptr));
+  std::unique_ptr<Session> session(session_ptr);
+  TF_RETURN_IF_ERROR(session->Create(graph_def));
+  for (const auto& feeds : calibration_feeds) {
+    std::vector<Tensor> outputs;
+    TF_RETURN_IF_ERROR(session->Run(feeds, tensors, {}, &outputs));
+    for (int i = 0; i < tensors.size(); ++i) {
+      if (outputs[i].dtype() != DT_FLOAT || outputs[i].NumElements() == 0) {
+        continue;
+      }
+      auto values = outputs[i].flat<float>();
+      auto it = ranges->emplace(tensors[i], std::make_pair(0.0f, 0.0f)).first;
+      for (int64 j = 0; j < values.size(); ++j) {
+        if (!std::isfinite(values(j))) continue;
+        it->second.first = std::min(it->second.first, values(j));
+        it->second.second = std::max(it->second.second, values(j));
+      }
+    }
+  }
+  return session->Close();
+}
+
+Status QuantizeGraphForInference(const GraphDef& input_graph,
+                                 const CalibrationRanges& ranges,
+                                 GraphDef* output_graph) {
+  *output_graph = input_graph;
+  InferenceQuantizer quantizer(ranges, output_graph);
+  return quantizer.Run();
+}
+
+Status DoQuantizeInference(
+    const GraphDef& input_graph,
+    const std::vector<std::vector<std::pair<string, Tensor>>>&
+        calibration_feeds,
+    GraphDef* output_graph) {
+  CalibrationRanges ranges;
+  TF_RETURN_IF_ERROR(
+      CalibrateForQuantizedInference(input_graph, calibration_feeds, &ranges));
+  return QuantizeGraphForInference(input_graph, ranges, output_graph);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,79 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPH_QUANTIZE_INFERENCE_H_
+#define TENSORFLOW_GRAPH_QUANTIZE_INFERENCE_H_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// The float range observed for tensors during calibration, keyed by tensor
+// name in "node:output" form.
+typedef std::unordered_map<string, std::pair<float, float>>
+    CalibrationRanges;
+
+// Runs the frozen float graph `graph_def` once for each set of feeds in
+// `calibration_feeds`, and stores in `ranges` the range of every tensor that
+// QuantizeGraphForInference() needs: the float input of each node it can
+// rewrite, and the output of each one whose quantized version produces 32-bit
+// results. The ranges are widened to include zero.
+Status CalibrateForQuantizedInference(
+    const GraphDef& graph_def,
+    const std::vector<std::vector<std::pair<string, Tensor>>>&
+        calibration_feeds,
+    CalibrationRanges* ranges);
+
+// Rewrites the frozen float graph `input_graph` for eight-bit inference on
+// CPU, using the tensor ranges from CalibrateForQuantizedInference().
+//
+// Conv2D, MatMul and BiasAdd nodes whose weights (input 1) are Const nodes,
+// possibly read through Identity nodes, and Relu, Relu6, MaxPool and AvgPool
+// nodes, are rewritten when they are float, NHWC, and the ranges they need
+// are known:
+//  - The float input is quantized with QuantizeV2 to its calibrated range.
+//  - The weights are quantized offline, with one range per output channel for
+//    Conv2D and MatMul.
+//  - The node is replaced by its quantized version, followed by a Requantize
+//    to the calibrated range of its output if that version produces 32-bit
+//    results.
+//  - A Dequantize node that takes the original node's name provides the float
+//    result to the remaining float consumers and to fetches.
+// A QuantizeV2 that reads the output of a Dequantize is then bypassed, so
+// that chains of rewritten nodes pass eight-bit tensors and their ranges
+// directly to each other, and weights that are no longer used are removed.
+// Other nodes are left unchanged.
+Status QuantizeGraphForInference(const GraphDef& input_graph,
+                                 const CalibrationRanges& ranges,
+                                 GraphDef* output_graph);
+
+// Calibrates `input_graph` on `calibration_feeds` and rewrites it, as
+// CalibrateForQuantizedInference() and QuantizeGraphForInference() do.
+Status DoQuantizeInference(
+    const GraphDef& input_graph,
+    const std::vector<std::vector<std::pair<string, Tensor>>>&
+        calibration_feeds,
+    GraphDef* output_graph);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPH_QUANTIZE_INFERENCE_H_
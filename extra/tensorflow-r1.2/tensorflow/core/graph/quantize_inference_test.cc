@@ -0,0 +1,225 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/graph/quantize_inference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor RandomTensor(const TensorShape& shape) {
+  Tensor tensor(DT_FLOAT, shape);
+  tensor.flat<float>().setRandom();
+  return tensor;
+}
+
+// Builds input -> Conv2D -> BiasAdd -> Relu -> MaxPool -> Reshape -> MatMul,
+// with the filter read through an Identity node as in frozen graphs.
+GraphDef MakeFloatGraph() {
+  Graph g(OpRegistry::Global());
+  Node* input;
+  TF_CHECK_OK(NodeBuilder("input", "Placeholder")
+                  .Attr("dtype", DT_FLOAT)
+                  .Attr("shape", TensorShape({1, 6, 6, 3}))
+                  .Finalize(&g, &input));
+  Node* filter = test::graph::Constant(&g, RandomTensor({3, 3, 3, 4}));
+  Node* filter_read;
+  TF_CHECK_OK(NodeBuilder("filter/read", "Identity")
+                  .Input(filter)
+                  .Finalize(&g, &filter_read));
+  Node* conv;
+  TF_CHECK_OK(NodeBuilder("conv", "Conv2D")
+                  .Input(input)
+                  .Input(filter_read)
+                  .Attr("T", DT_FLOAT)
+                  .Attr("strides", {1, 1, 1, 1})
+                  .Attr("padding", "SAME")
+                  .Finalize(&g, &conv));
+  Node* bias_add;
+  TF_CHECK_OK(NodeBuilder("bias_add", "BiasAdd")
+                  .Input(conv)
+                  .Input(test::graph::Constant(&g, RandomTensor({4})))
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(&g, &bias_add));
+  Node* relu;
+  TF_CHECK_OK(NodeBuilder("relu", "Relu")
+                  .Input(bias_add)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(&g, &relu));
+  Node* pool;
+  TF_CHECK_OK(NodeBuilder("pool", "MaxPool")
+                  .Input(relu)
+                  .Attr("T", DT_FLOAT)
+                  .Attr("ksize", {1, 2, 2, 1})
+                  .Attr("strides", {1, 2, 2, 1})
+                  .Attr("padding", "VALID")
+                  .Finalize(&g, &pool));
+  Node* shape = test::graph::Constant(&g, test::AsTensor<int32>({1, 36}));
+  Node* reshape;
+  TF_CHECK_OK(NodeBuilder("reshape", "Reshape")
+                  .Input(pool)
+                  .Input(shape)
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(&g, &reshape));
+  Node* logits;
+  TF_CHECK_OK(NodeBuilder("logits", "MatMul")
+                  .Input(reshape)
+                  .Input(test::graph::Constant(&g, RandomTensor({5, 36})))
+                  .Attr("T", DT_FLOAT)
+                  .Attr("transpose_b", true)
+                  .Finalize(&g, &logits));
+  GraphDef graph_def;
+  g.ToGraphDef(&graph_def);
+  return graph_def;
+}
+
+Tensor RunGraph(const GraphDef& graph_def, const Tensor& input) {
+  Session* session_ptr;
+  TF_CHECK_OK(NewSession(SessionOptions(), &session_ptr));
+  std::unique_ptr<Session> session(session_ptr);
+  TF_CHECK_OK(session->Create(graph_def));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({{"input", input}}, {"logits"}, {}, &outputs));
+  TF_CHECK_OK(session->Close());
+  return outputs[0];
+}
+
+std::map<string, int> CountOps(const GraphDef& graph_def) {
+  std::map<string, int> counts;
+  for (const NodeDef& node : graph_def.node()) {
+    ++counts[node.op()];
+  }
+  return counts;
+}
+
+TEST(QuantizeInferenceTest, RewritesCalibratedGraph) {
+  const GraphDef float_graph = MakeFloatGraph();
+  std::vector<std::vector<std::pair<string, Tensor>>> feeds;
+  for (int i = 0; i < 4; ++i) {
+    feeds.push_back({{"input", RandomTensor({1, 6, 6, 3})}});
+  }
+  GraphDef quantized_graph;
+  TF_ASSERT_OK(DoQuantizeInference(float_graph, feeds, &quantized_graph));
+
+  std::map<string, int> counts = CountOps(quantized_graph);
+  EXPECT_EQ(1, counts["QuantizedConv2D"]);
+  EXPECT_EQ(1, counts["QuantizedBiasAdd"]);
+  EXPECT_EQ(1, counts["QuantizedRelu"]);
+  EXPECT_EQ(1, counts["QuantizedMaxPool"]);
+  EXPECT_EQ(1, counts["QuantizedMatMul"]);
+  EXPECT_EQ(3, counts["Requantize"]);
+  EXPECT_EQ(0, counts["Conv2D"] + counts["BiasAdd"] + counts["Relu"] +
+                   counts["MaxPool"] + counts["MatMul"]);
+  // Only the graph input and the float Reshape output are quantized; the
+  // quantized nodes pass eight-bit tensors to each other directly.
+  EXPECT_EQ(2, counts["QuantizeV2"]);
+  EXPECT_EQ(0, counts["Identity"]);
+
+  for (const NodeDef& node : quantized_graph.node()) {
+    // The MatMul weights are transposed, with one range per output column.
+    if (node.name() == "logits/eightbit/weights_min") {
+      Tensor mins;
+      TF_ASSERT_OK(GetNodeAttr(node, "value", &mins));
+      EXPECT_EQ(TensorShape({5}), mins.shape());
+    }
+  }
+
+  const Tensor& input = feeds[0][0].second;
+  const Tensor expected = RunGraph(float_graph, input);
+  const Tensor actual = RunGraph(quantized_graph, input);
+  auto expected_values = expected.flat<float>();
+  float largest = 0.0f;
+  for (int i = 0; i < expected_values.size(); ++i) {
+    largest = std::max(largest, std::abs(expected_values(i)));
+  }
+  test::ExpectTensorNear<float>(expected, actual, 0.05f * largest);
+}
+
+TEST(QuantizeInferenceTest, KeepsNodesWithoutRanges) {
+  const GraphDef float_graph = MakeFloatGraph();
+  GraphDef quantized_graph;
+  TF_ASSERT_OK(QuantizeGraphForInference(float_graph, {}, &quantized_graph));
+  EXPECT_EQ(float_graph.DebugString(), quantized_graph.DebugString());
+
+  // With only the input of the convolution known, nothing downstream of it
+  // can be rewritten either, since the convolution's output range is missing.
+  CalibrationRanges ranges;
+  ranges["input:0"] = {0.0f, 1.0f};
+  TF_ASSERT_OK(
+      QuantizeGraphForInference(float_graph, ranges, &quantized_graph));
+  EXPECT_EQ(float_graph.DebugString(), quantized_graph.DebugString());
+}
+
+TEST(QuantizeInferenceTest, KeepsConvolutionsWithUnequalStrides) {
+  // QuantizedConv2D only supports equal row and column strides.
+  Graph g(OpRegistry::Global());
+  Node* input;
+  TF_CHECK_OK(NodeBuilder("input", "Placeholder")
+                  .Attr("dtype", DT_FLOAT)
+                  .Attr("shape", TensorShape({1, 6, 6, 3}))
+                  .Finalize(&g, &input));
+  Node* conv;
+  TF_CHECK_OK(NodeBuilder("conv", "Conv2D")
+                  .Input(input)
+                  .Input(test::graph::Constant(&g, RandomTensor({3, 3, 3, 4})))
+                  .Attr("T", DT_FLOAT)
+                  .Attr("strides", {1, 1, 2, 1})
+                  .Attr("padding", "SAME")
+                  .Finalize(&g, &conv));
+  GraphDef float_graph;
+  g.ToGraphDef(&float_graph);
+
+  CalibrationRanges ranges;
+  ranges["input:0"] = {0.0f, 1.0f};
+  ranges["conv:0"] = {-1.0f, 1.0f};
+  GraphDef quantized_graph;
+  TF_ASSERT_OK(
+      QuantizeGraphForInference(float_graph, ranges, &quantized_graph));
+  EXPECT_EQ(float_graph.DebugString(), quantized_graph.DebugString());
+}
+
+TEST(QuantizeInferenceTest, CalibratesRangesIncludingZero) {
+  const GraphDef float_graph = MakeFloatGraph();
+  Tensor input(DT_FLOAT, {1, 6, 6, 3});
+  input.flat<float>().setConstant(2.0f);
+  CalibrationRanges ranges;
+  TF_ASSERT_OK(CalibrateForQuantizedInference(
+      float_graph, {{{"input", input}}}, &ranges));
+  ASSERT_EQ(1, ranges.count("input:0"));
+  EXPECT_EQ(0.0f, ranges["input:0"].first);
+  EXPECT_EQ(2.0f, ranges["input:0"].second);
+  EXPECT_EQ(1, ranges.count("conv:0"));
+  EXPECT_EQ(1, ranges.count("logits:0"));
+  // Relu and MaxPool don't need their output ranges.
+  EXPECT_EQ(0, ranges.count("pool:0"));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -79,6 +79,9 @@ Status AnalyticalCostEstimator::PredictCosts(const GraphDef& optimized_graph,
     for (auto& input : inputs) {
       op_info.add_inputs()->Swap(&input);
     }
+    for (const auto& output : properties.GetOutputProperties(node->name())) {
+      *op_info.add_outputs() = output;
+    }
     op_info.mutable_device()->Swap(&device);
 
     node_costs = node_estimator_.PredictCosts(op_info);
@@ -102,9 +105,7 @@ Status AnalyticalCostEstimator::PredictCosts(const GraphDef& optimized_graph,
           node_costs.compute_time.asMicroSeconds().count());
       cost_node->set_memory_time(
           node_costs.memory_time.asMicroSeconds().count());
-      std::vector<OpInfo::TensorProperties> outputs =
-          properties.GetOutputProperties(node->name());
-      for (const auto& output : outputs) {
+      for (const auto& output : op_info.outputs()) {
         auto output_info = cost_node->add_output_info();
         output_info->set_dtype(output.dtype());
         auto shape = output_info->mutable_shape();
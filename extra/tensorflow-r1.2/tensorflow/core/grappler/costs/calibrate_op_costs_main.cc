@@ -0,0 +1,114 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Fits the per-op scales of the OpLevelCostEstimator against the times
+// measured by running a model on the local CPU. See op_cost_calibration.h.
+//
+// bazel build tensorflow/core/grappler/costs:calibrate_op_costs &&
+// bazel-bin/tensorflow/core/grappler/costs/calibrate_op_costs \
+// --metagraph=model.meta --out_scales=op_time_scales.txt
+//
+// The scales can then be loaded with ReadOpTimeScales() and passed to
+// OpLevelCostEstimator::set_op_time_scales().
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/grappler/clusters/single_machine.h"
+#include "tensorflow/core/grappler/costs/op_cost_calibration.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/grappler_item_builder.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/protobuf/meta_graph.pb.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+Status Calibrate(const string& metagraph, int measurement_steps,
+                 int num_cpu_cores, const string& out_scales) {
+  MetaGraphDef meta_graph;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(Env::Default(), metagraph, &meta_graph));
+  std::unique_ptr<GrapplerItem> item =
+      GrapplerItemFromMetaGraphDef(metagraph, meta_graph, ItemConfig());
+  if (!item) {
+    return errors::InvalidArgument("Could not build a grappler item from ",
+                                   metagraph);
+  }
+
+  if (num_cpu_cores <= 0) {
+    num_cpu_cores = port::NumSchedulableCPUs();
+  }
+  SingleMachine cluster(/*timeout_s=*/3600, num_cpu_cores, /*num_gpus=*/0);
+  TF_RETURN_IF_ERROR(cluster.Provision());
+  std::map<string, double> op_time_scales;
+  Status status =
+      CalibrateOpCosts(*item, &cluster, measurement_steps, &op_time_scales);
+  TF_RETURN_IF_ERROR(cluster.Shutdown());
+  TF_RETURN_IF_ERROR(status);
+
+  for (const auto& scale : op_time_scales) {
+    LOG(INFO) << scale.first << ": " << scale.second;
+  }
+  return WriteOpTimeScales(Env::Default(), out_scales, op_time_scales);
+}
+
+int CalibrateOpCostsMain(int argc, char** argv) {
+  string metagraph;
+  string out_scales;
+  int32 measurement_steps = 10;
+  int32 num_cpu_cores = 0;
+  std::vector<Flag> flag_list = {
+      Flag("metagraph", &metagraph, "binary MetaGraphDef of the model to run"),
+      Flag("out_scales", &out_scales, "file to write the fitted scales to"),
+      Flag("measurement_steps", &measurement_steps,
+           "number of timed runs of the model"),
+      Flag("num_cpu_cores", &num_cpu_cores,
+           "number of CPU cores to run on, or 0 for all of them"),
+  };
+  string usage = Flags::Usage(argv[0], flag_list);
+  const bool parse_ok = Flags::Parse(&argc, argv, flag_list);
+  // We need to call this to set up global state for TensorFlow.
+  port::InitMain(argv[0], &argc, &argv);
+  if (!parse_ok || metagraph.empty() || out_scales.empty() ||
+      measurement_steps < 1) {
+    LOG(ERROR) << usage;
+    return -1;
+  }
+
+  Status status =
+      Calibrate(metagraph, measurement_steps, num_cpu_cores, out_scales);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return -1;
+  }
+  LOG(INFO) << "Wrote op time scales to " << out_scales;
+  return 0;
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+int main(int argc, char** argv) {
+  return tensorflow::grappler::CalibrateOpCostsMain(argc, argv);
+}
@@ -0,0 +1,162 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_calibration.h"
+
+#include <unordered_map>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/grappler/costs/measuring_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+namespace grappler {
+
+std::vector<OpMeasurement> CollectOpMeasurements(
+    const GraphDef& graph, const CostGraphDef& cost_graph) {
+  std::unordered_map<string, const NodeDef*> name_to_node;
+  for (const auto& node : graph.node()) {
+    name_to_node[node.name()] = &node;
+  }
+  std::unordered_map<string, const CostGraphDef::Node*> name_to_cost;
+  for (const auto& cost_node : cost_graph.node()) {
+    name_to_cost[cost_node.name()] = &cost_node;
+  }
+
+  // BuildOpInfo only needs the graph to append the values of Const inputs
+  // after the regular inputs; they are attached in place below instead.
+  const std::unordered_map<string, const NodeDef*> no_nodes;
+  std::vector<OpMeasurement> measurements;
+  for (const auto& cost_node : cost_graph.node()) {
+    auto it = name_to_node.find(cost_node.name());
+    if (it == name_to_node.end() || cost_node.compute_cost() <= 0) {
+      continue;
+    }
+    const NodeDef& node = *it->second;
+    OpInfo op_info =
+        BuildOpInfo(node, cost_node.device(), no_nodes,
+                    FindInputFeatures(node, name_to_cost, name_to_node));
+
+    int input_index = 0;
+    for (const string& input : node.input()) {
+      const TensorId input_id = ParseTensorName(input);
+      if (input_id.second == Graph::kControlSlot) {
+        continue;
+      }
+      auto input_node = name_to_node.find(input_id.first.ToString());
+      if (input_node != name_to_node.end() &&
+          input_node->second->op() == "Const" &&
+          input_index < op_info.inputs_size()) {
+        auto value = input_node->second->attr().find("value");
+        if (value != input_node->second->attr().end()) {
+          *op_info.mutable_inputs(input_index)->mutable_value() =
+              value->second.tensor();
+        }
+      }
+      ++input_index;
+    }
+    for (const auto& output_info : cost_node.output_info()) {
+      OpInfo::TensorProperties* output = op_info.add_outputs();
+      output->set_dtype(output_info.dtype());
+      *output->mutable_shape() = output_info.shape();
+    }
+
+    // Compute costs are measured in microseconds.
+    measurements.emplace_back(std::move(op_info),
+                              cost_node.compute_cost() * 1e3);
+  }
+  return measurements;
+}
+
+std::map<string, double> FitOpTimeScales(
+    const std::vector<OpMeasurement>& measurements,
+    const OpLevelCostEstimator& estimator) {
+  // The scale s minimizing sum((s * predicted - measured)^2) over the nodes
+  // of an op type is sum(predicted * measured) / sum(predicted^2).
+  std::map<string, std::pair<double, double>> sums;
+  for (const auto& measurement : measurements) {
+    const Costs costs = estimator.PredictCosts(measurement.first);
+    const double predicted = costs.execution_time.count();
+    if (costs.inaccurate || predicted <= 0) {
+      continue;
+    }
+    auto& sum = sums[measurement.first.op()];
+    sum.first += predicted * measurement.second;
+    sum.second += predicted * predicted;
+  }
+
+  std::map<string, double> op_time_scales;
+  for (const auto& sum : sums) {
+    op_time_scales[sum.first] = sum.second.first / sum.second.second;
+    VLOG(1) << "Op " << sum.first << " scale "
+            << op_time_scales[sum.first];
+  }
+  return op_time_scales;
+}
+
+Status CalibrateOpCosts(const GrapplerItem& item, Cluster* cluster,
+                        int measurement_steps,
+                        std::map<string, double>* op_time_scales) {
+  MeasuringCostEstimator measuring_estimator(cluster, measurement_steps, 0);
+  TF_RETURN_IF_ERROR(measuring_estimator.Initialize(item));
+  CostGraphDef cost_graph;
+  Costs costs;
+  TF_RETURN_IF_ERROR(
+      measuring_estimator.PredictCosts(item.graph, &cost_graph, &costs));
+
+  OpLevelCostEstimator estimator;
+  *op_time_scales = FitOpTimeScales(
+      CollectOpMeasurements(item.graph, cost_graph), estimator);
+  return Status::OK();
+}
+
+Status ReadOpTimeScales(Env* env, const string& filename,
+                        std::map<string, double>* op_time_scales) {
+  string contents;
+  TF_RETURN_IF_ERROR(ReadFileToString(env, filename, &contents));
+  op_time_scales->clear();
+  for (const string& line :
+       str_util::Split(contents, '\n', str_util::SkipEmpty())) {
+    std::vector<string> fields =
+        str_util::Split(line, ' ', str_util::SkipEmpty());
+    double scale;
+    if (fields.size() != 2 ||
+        !strings::safe_strtod(fields[1].c_str(), &scale)) {
+      return errors::InvalidArgument("Invalid op time scale \"", line,
+                                     "\" in ", filename);
+    }
+    (*op_time_scales)[fields[0]] = scale;
+  }
+  return Status::OK();
+}
+
+Status WriteOpTimeScales(Env* env, const string& filename,
+                         const std::map<string, double>& op_time_scales) {
+  string contents;
+  for (const auto& scale : op_time_scales) {
+    strings::StrAppend(&contents, scale.first, " ", scale.second, "\n");
+  }
+  return WriteStringToFile(env, filename, contents);
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
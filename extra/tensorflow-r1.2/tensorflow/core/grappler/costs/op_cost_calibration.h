@@ -0,0 +1,69 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATION_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/cost_graph.pb.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace grappler {
+
+class Cluster;
+struct GrapplerItem;
+
+// Features of a node along with its measured execution time in nanoseconds.
+typedef std::pair<OpInfo, double> OpMeasurement;
+
+// Returns the features and measured time of every node of `graph` that has a
+// compute cost in `cost_graph`. The values of Const inputs are attached to
+// the corresponding inputs, so that e.g. the dimensions of a reduction are
+// known to the estimator.
+std::vector<OpMeasurement> CollectOpMeasurements(
+    const GraphDef& graph, const CostGraphDef& cost_graph);
+
+// Fits a scale per op type such that the times predicted by `estimator`,
+// multiplied by the scale, best match the measurements in the least squares
+// sense. Measurements whose prediction is inaccurate or zero are ignored.
+std::map<string, double> FitOpTimeScales(
+    const std::vector<OpMeasurement>& measurements,
+    const OpLevelCostEstimator& estimator);
+
+// Runs `item` on `cluster` `measurement_steps` times with a
+// MeasuringCostEstimator and fits the scales of the op types it contains
+// against the predictions of an OpLevelCostEstimator.
+Status CalibrateOpCosts(const GrapplerItem& item, Cluster* cluster,
+                        int measurement_steps,
+                        std::map<string, double>* op_time_scales);
+
+// Reads and writes scales as text, one "<op> <scale>" pair per line.
+Status ReadOpTimeScales(Env* env, const string& filename,
+                        std::map<string, double>* op_time_scales);
+Status WriteOpTimeScales(Env* env, const string& filename,
+                         const std::map<string, double>& op_time_scales);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATION_H_
@@ -0,0 +1,135 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_calibration.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// Runs at one billion operations and one billion bytes per second, so that
+// predicted times in nanoseconds are operation and byte counts.
+class UnitDeviceCostEstimator : public OpLevelCostEstimator {
+ protected:
+  std::pair<double, double> GetDeviceInfo(
+      const DeviceProperties& device) const override {
+    return std::make_pair(1.0, 1.0);
+  }
+};
+
+OpMeasurement Measurement(const string& op, const std::vector<int64>& dims,
+                          double measured) {
+  OpInfo op_info;
+  op_info.set_op(op);
+  op_info.mutable_device()->set_type("CPU");
+  auto input = op_info.add_inputs();
+  input->set_dtype(DT_FLOAT);
+  for (int64 dim : dims) {
+    input->mutable_shape()->add_dim()->set_size(dim);
+  }
+  return OpMeasurement(op_info, measured);
+}
+
+void AddCostNode(const string& name, const std::vector<int64>& dims,
+                 DataType dtype, int64 compute_cost, CostGraphDef* cost_graph) {
+  auto node = cost_graph->add_node();
+  node->set_name(name);
+  node->set_device("/job:localhost/replica:0/task:0/cpu:0");
+  node->set_compute_cost(compute_cost);
+  auto output = node->add_output_info();
+  output->set_dtype(dtype);
+  for (int64 dim : dims) {
+    output->mutable_shape()->add_dim()->set_size(dim);
+  }
+}
+
+TEST(OpCostCalibrationTest, CollectsMeasurements) {
+  GraphDef graph;
+  Tensor axes(DT_INT32, TensorShape({1}));
+  axes.flat<int32>()(0) = 1;
+  TF_ASSERT_OK(NodeDefBuilder("x", "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Finalize(graph.add_node()));
+  TF_ASSERT_OK(NodeDefBuilder("axes", "Const")
+                   .Attr("dtype", DT_INT32)
+                   .Attr("value", axes)
+                   .Finalize(graph.add_node()));
+  TF_ASSERT_OK(NodeDefBuilder("sum", "Sum")
+                   .Input("x", 0, DT_FLOAT)
+                   .Input("axes", 0, DT_INT32)
+                   .ControlInput("x")
+                   .Finalize(graph.add_node()));
+
+  CostGraphDef cost_graph;
+  AddCostNode("x", {100, 10}, DT_FLOAT, 5, &cost_graph);
+  AddCostNode("axes", {1}, DT_INT32, 0, &cost_graph);
+  AddCostNode("sum", {100}, DT_FLOAT, 7, &cost_graph);
+  AddCostNode("_SOURCE", {}, DT_FLOAT, 1, &cost_graph);
+
+  std::vector<OpMeasurement> measurements =
+      CollectOpMeasurements(graph, cost_graph);
+  ASSERT_EQ(2, measurements.size());
+  EXPECT_EQ("Placeholder", measurements[0].first.op());
+  EXPECT_EQ(5000, measurements[0].second);
+
+  const OpInfo& sum = measurements[1].first;
+  EXPECT_EQ("Sum", sum.op());
+  EXPECT_EQ(7000, measurements[1].second);
+  ASSERT_EQ(2, sum.inputs_size());
+  EXPECT_EQ(2, sum.inputs(0).shape().dim_size());
+  EXPECT_FALSE(sum.inputs(0).has_value());
+  EXPECT_EQ(1, sum.inputs(1).value().int_val(0));
+}
+
+TEST(OpCostCalibrationTest, FitsLeastSquaresScales) {
+  // The unit device predicts 200000ns and 400000ns for the exponentials.
+  std::vector<OpMeasurement> measurements = {
+      Measurement("Exp", {100, 100}, 400000),
+      Measurement("Exp", {100, 200}, 1000000),
+      Measurement("Relu", {1000}, 3000),
+      Measurement("SomeUnknownOp", {1000}, 3000),
+  };
+  UnitDeviceCostEstimator estimator;
+  std::map<string, double> scales = FitOpTimeScales(measurements, estimator);
+  EXPECT_EQ(2, scales.size());
+  EXPECT_NEAR(2.4, scales["Exp"], 1e-9);
+  // Relu is bound by its 8000 bytes of memory traffic.
+  EXPECT_NEAR(3000.0 / 8000, scales["Relu"], 1e-9);
+
+  estimator.set_op_time_scales(scales);
+  const Costs costs = estimator.PredictCosts(measurements[1].first);
+  EXPECT_NEAR(960000, costs.execution_time.count(), 1);
+}
+
+TEST(OpCostCalibrationTest, ReadsAndWritesScales) {
+  const string filename = io::JoinPath(testing::TmpDir(), "op_time_scales");
+  std::map<string, double> scales = {{"Exp", 2.4}, {"MaxPool", 0.125}};
+  TF_ASSERT_OK(WriteOpTimeScales(Env::Default(), filename, scales));
+  std::map<string, double> read_scales;
+  TF_ASSERT_OK(ReadOpTimeScales(Env::Default(), filename, &read_scales));
+  EXPECT_EQ(scales, read_scales);
+
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, "Exp two\n"));
+  EXPECT_FALSE(ReadOpTimeScales(Env::Default(), filename, &read_scales).ok());
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
 #include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/grappler/clusters/utils.h"
 
 namespace tensorflow {
@@ -29,6 +30,48 @@ constexpr char kSparseMatMul[] = "SparseMatMul";
 constexpr char kIdentity[] = "Identity";
 constexpr char kNoOp[] = "NoOp";
 constexpr char kReshape[] = "Reshape";
+constexpr char kFusedCwise[] = "_FusedCwise";
+constexpr char kMaxPool[] = "MaxPool";
+constexpr char kAvgPool[] = "AvgPool";
+constexpr char kMaxPoolGrad[] = "MaxPoolGrad";
+constexpr char kAvgPoolGrad[] = "AvgPoolGrad";
+constexpr char kConcat[] = "Concat";
+constexpr char kConcatV2[] = "ConcatV2";
+constexpr char kPack[] = "Pack";
+constexpr char kSlice[] = "Slice";
+constexpr char kGather[] = "Gather";
+constexpr char kTranspose[] = "Transpose";
+constexpr char kSoftmax[] = "Softmax";
+constexpr char kLogSoftmax[] = "LogSoftmax";
+constexpr char kDecodeSegmentsLinks[] = "DecodeSegmentsLinks";
+constexpr char kCombineSegments[] = "CombineSegments";
+constexpr char kEncodeGroundtruth[] = "EncodeGroundtruth";
+
+// Reductions whose second input holds the dimensions to reduce.
+constexpr const char* kReductionOps[] = {
+    "Sum", "Mean", "Prod", "Max", "Min", "All", "Any", "ArgMax", "ArgMin"};
+
+// Operations per element beyond the exponential for Softmax and LogSoftmax:
+// the running max, the subtraction, the sum and the normalization.
+constexpr int kSoftmaxOpsPerElement = 4;
+
+// Rough operation counts of the SegLink ops, per element of their inputs.
+// Decoding a positive node turns its 6 regression offsets into a rotated
+// segment, and each link is a union-find step between two nodes.
+constexpr int kDecodeOpsPerNode = 30;
+constexpr int kDecodeOpsPerLink = 4;
+// Combining fits a line through the centers of each group of segments, which
+// have 6 values each.
+constexpr int kCombineOpsPerSegment = 40;
+constexpr int kSegmentDim = 6;
+// Encoding tests every map position against every groundtruth box, then
+// compares the match of each position with its neighbours for the links.
+constexpr int kEncodeOpsPerMatch = 20;
+constexpr int kEncodeOpsPerLink = 4;
+constexpr int kEncodeWithinLinks = 8;
+constexpr int kEncodeCrossLinks = 4;
+// Offsets written per map position by EncodeGroundtruth.
+constexpr int kEncodeOffsetsDim = 6;
 
 OpLevelCostEstimator::OpLevelCostEstimator() {
   // Syntactic sugar to build and return a lambda that takes an OpInfo and
@@ -49,7 +92,52 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
       {kSparseMatMul, wrap(&OpLevelCostEstimator::PredictMatMul)},
       {kIdentity, wrap(&OpLevelCostEstimator::PredictNoOp)},
       {kNoOp, wrap(&OpLevelCostEstimator::PredictNoOp)},
-      {kReshape, wrap(&OpLevelCostEstimator::PredictNoOp)}};
+      {kReshape, wrap(&OpLevelCostEstimator::PredictNoOp)},
+      {kFusedCwise, wrap(&OpLevelCostEstimator::PredictCwiseOp)},
+      {kMaxPool, wrap(&OpLevelCostEstimator::PredictPooling)},
+      {kAvgPool, wrap(&OpLevelCostEstimator::PredictPooling)},
+      {kMaxPoolGrad, wrap(&OpLevelCostEstimator::PredictPoolingGrad)},
+      {kAvgPoolGrad, wrap(&OpLevelCostEstimator::PredictPoolingGrad)},
+      {kConcat, wrap(&OpLevelCostEstimator::PredictConcat)},
+      {kConcatV2, wrap(&OpLevelCostEstimator::PredictConcat)},
+      {kPack, wrap(&OpLevelCostEstimator::PredictConcat)},
+      {kSlice, wrap(&OpLevelCostEstimator::PredictSlice)},
+      {kGather, wrap(&OpLevelCostEstimator::PredictGather)},
+      {kTranspose, wrap(&OpLevelCostEstimator::PredictTranspose)},
+      {kSoftmax, wrap(&OpLevelCostEstimator::PredictSoftmax)},
+      {kLogSoftmax, wrap(&OpLevelCostEstimator::PredictSoftmax)},
+      {kDecodeSegmentsLinks,
+       wrap(&OpLevelCostEstimator::PredictDecodeSegmentsLinks)},
+      {kCombineSegments, wrap(&OpLevelCostEstimator::PredictCombineSegments)},
+      {kEncodeGroundtruth,
+       wrap(&OpLevelCostEstimator::PredictEncodeGroundtruth)}};
+
+  for (const char* op : kReductionOps) {
+    device_cost_impl_[op] = wrap(&OpLevelCostEstimator::PredictReduction);
+  }
+
+  // Transcendental functions are expanded into polynomial approximations and
+  // cost an order of magnitude more than plain arithmetic.
+  elementwise_ops_ = {
+      // Unary ops.
+      {"Abs", 1}, {"Cast", 1}, {"Ceil", 1}, {"Cos", 20}, {"Elu", 20},
+      {"Exp", 20}, {"Floor", 1}, {"Inv", 5}, {"Log", 20}, {"Neg", 1},
+      {"Reciprocal", 5}, {"Relu", 1}, {"Relu6", 2}, {"Round", 1},
+      {"Rsqrt", 10}, {"Sigmoid", 25}, {"Sign", 1}, {"Sin", 20},
+      {"Softplus", 40}, {"Sqrt", 5}, {"Square", 1}, {"Tanh", 25},
+      // Binary ops.
+      {"Add", 1}, {"AddN", 1}, {"BiasAdd", 1}, {"Div", 5}, {"Equal", 1},
+      {"FloorDiv", 10}, {"Greater", 1}, {"GreaterEqual", 1}, {"Less", 1},
+      {"LessEqual", 1}, {"LogicalAnd", 1}, {"LogicalOr", 1}, {"Maximum", 1},
+      {"Minimum", 1}, {"Mul", 1}, {"NotEqual", 1}, {"Pow", 40},
+      {"RealDiv", 5}, {"Relu6Grad", 2}, {"ReluGrad", 1}, {"Select", 1},
+      {"SigmoidGrad", 3}, {"SquaredDifference", 2}, {"Sub", 1},
+      {"TanhGrad", 3},
+      // Scalar variants only found in _FusedCwise chains.
+      {"RDiv", 5}, {"RSub", 1}};
+  for (const auto& op : elementwise_ops_) {
+    device_cost_impl_[op.first] = wrap(&OpLevelCostEstimator::PredictCwiseOp);
+  }
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpInfo& op_features) const {
@@ -63,6 +151,15 @@ Costs OpLevelCostEstimator::PredictCosts(const OpInfo& op_features) const {
 
   std::function<Costs(const OpInfo&)> estimator = it->second;
   Costs costs = estimator(op_features);
+  auto scale = op_time_scales_.find(op_features.op());
+  if (scale != op_time_scales_.end()) {
+    costs.compute_time =
+        Costs::Duration(costs.compute_time.count() * scale->second);
+    costs.memory_time =
+        Costs::Duration(costs.memory_time.count() * scale->second);
+    costs.execution_time =
+        Costs::Duration(costs.execution_time.count() * scale->second);
+  }
   VLOG(1) << "Operation " << op_features.op() << " takes "
           << costs.execution_time.count() << " ns.";
   return costs;
@@ -156,6 +253,23 @@ Costs OpLevelCostEstimator::PredictOpCountBasedCost(
   return costs;
 }
 
+Costs OpLevelCostEstimator::PredictRooflineCost(
+    double operations, double io_bytes, const OpInfo& op_features) const {
+  std::pair<double, double> device_perf = GetDeviceInfo(op_features.device());
+  Costs::NanoSeconds compute_cost(SafeDiv(operations, device_perf.first));
+  Costs::NanoSeconds memory_cost(SafeDiv(io_bytes, device_perf.second));
+  VLOG(1) << "Op:" << op_features.op() << " GOps:" << operations / 1e9
+          << " Size (KB):" << io_bytes / 1e3
+          << " Compute Time (ns):" << compute_cost.count()
+          << " Memory Time (ns):" << memory_cost.count();
+
+  Costs costs;
+  costs.compute_time = compute_cost;
+  costs.memory_time = memory_cost;
+  costs.execution_time = std::max(compute_cost, memory_cost);
+  return costs;
+}
+
 int64 OpLevelCostEstimator::CountConv2DOperations(
     const OpInfo& op_features, bool* found_unknown_shapes) const {
   return CountConv2DOperations(op_features, nullptr, found_unknown_shapes);
@@ -228,6 +342,30 @@ TensorShapeProto MaybeGetMinimumShape(const TensorShapeProto& original_shape,
   }
   return shape;
 }
+
+// Returns the values of an integer input that was folded into the op
+// features, e.g. the dimensions to reduce, or false if they are unknown.
+bool GetInputValues(const OpInfo::TensorProperties& input,
+                    std::vector<int64>* values) {
+  if (!input.has_value()) {
+    return false;
+  }
+  Tensor tensor;
+  if (!tensor.FromProto(input.value())) {
+    return false;
+  }
+  values->clear();
+  if (tensor.dtype() == DT_INT32) {
+    const auto flat = tensor.flat<int32>();
+    values->assign(flat.data(), flat.data() + flat.size());
+  } else if (tensor.dtype() == DT_INT64) {
+    const auto flat = tensor.flat<int64>();
+    values->assign(flat.data(), flat.data() + flat.size());
+  } else {
+    return false;
+  }
+  return true;
+}
 }  // namespace
 
 // Helper to translate the positional arguments into named fields.
@@ -286,6 +424,36 @@ OpLevelCostEstimator::ConvolutionDimensionsFromInputs(
   return conv_dims;
 }
 
+OpLevelCostEstimator::ConvolutionDimensions
+OpLevelCostEstimator::PoolingDimensionsFromInputs(
+    const TensorShapeProto& original_image_shape, const OpInfo& op_features,
+    bool* found_unknown_shapes) {
+  int x_index = 1;
+  int y_index = 2;
+  if (GetDataFormat(op_features) == "NCHW") {
+    x_index = 2;
+    y_index = 3;
+  }
+  int64 kx = 1;
+  int64 ky = 1;
+  auto ksize = op_features.attr().find("ksize");
+  if (ksize != op_features.attr().end() &&
+      ksize->second.list().i_size() == 4) {
+    kx = ksize->second.list().i(x_index);
+    ky = ksize->second.list().i(y_index);
+  }
+  // Describe the window as a filter that maps each channel onto itself.
+  TensorShapeProto window_shape;
+  window_shape.add_dim()->set_size(kx);
+  window_shape.add_dim()->set_size(ky);
+  window_shape.add_dim()->set_size(1);
+  window_shape.add_dim()->set_size(1);
+  ConvolutionDimensions pool_dims = ConvolutionDimensionsFromInputs(
+      original_image_shape, window_shape, op_features, found_unknown_shapes);
+  pool_dims.oz = pool_dims.iz;
+  return pool_dims;
+}
+
 int64 OpLevelCostEstimator::CountConv2DOperations(
     const OpInfo& op_features, ConvolutionDimensions* conv_info,
     bool* found_unknown_shapes) const {
@@ -458,18 +626,24 @@ int64 OpLevelCostEstimator::CountConv2DBackPropFilterOperations(
   return ops;
 }
 
+int64 OpLevelCostEstimator::CalculateTensorElementCount(
+    const OpInfo::TensorProperties& tensor, bool* found_unknown_shapes) const {
+  int64 num_elements = 1;
+  int num_dims = std::max(1, tensor.shape().dim_size());
+  auto tensor_shape =
+      MaybeGetMinimumShape(tensor.shape(), num_dims, found_unknown_shapes);
+  for (const auto& dim : tensor_shape.dim()) {
+    num_elements *= dim.size();
+  }
+  return num_elements;
+}
+
 int64 OpLevelCostEstimator::CalculateSingleInputSize(
     const OpInfo::TensorProperties& input, bool* found_unknown_shapes) const {
   VLOG(1) << "   with " << input.dtype() << " input of shape "
           << input.shape().DebugString();
-  int64 input_size = 1;
-  int num_dims = std::max(1, input.shape().dim_size());
-  auto input_shape =
-      MaybeGetMinimumShape(input.shape(), num_dims, found_unknown_shapes);
-  for (const auto& dim : input_shape.dim()) {
-    input_size *= dim.size();
-  }
-  return input_size * DataTypeSize(input.dtype());
+  return CalculateTensorElementCount(input, found_unknown_shapes) *
+         DataTypeSize(input.dtype());
 }
 
 int64 OpLevelCostEstimator::CalculateInputSize(
@@ -557,5 +731,359 @@ Costs OpLevelCostEstimator::PredictNoOp(const OpInfo& op_features) const {
   return Costs::ZeroCosts();
 }
 
+Costs OpLevelCostEstimator::PredictCwiseOp(const OpInfo& op_features) const {
+  if (op_features.inputs_size() == 0) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  // Broadcasting makes the output as large as the largest input.
+  int64 output_elements = 0;
+  for (const auto& input : op_features.inputs()) {
+    output_elements = std::max(
+        output_elements,
+        CalculateTensorElementCount(input, &found_unknown_shapes));
+  }
+
+  int ops_per_element = 0;
+  if (op_features.op() == kFusedCwise) {
+    auto ops = op_features.attr().find("ops");
+    if (ops != op_features.attr().end()) {
+      for (const string& op : ops->second.list().s()) {
+        auto it = elementwise_ops_.find(op);
+        ops_per_element += it != elementwise_ops_.end() ? it->second : 1;
+      }
+    }
+  } else {
+    ops_per_element = elementwise_ops_.at(op_features.op());
+    if (op_features.op() == "AddN") {
+      // Summing n inputs takes n - 1 additions.
+      ops_per_element *= std::max(1, op_features.inputs_size() - 1);
+    }
+  }
+
+  // Comparisons and Cast change the type. Without output properties, the
+  // last input has the type of the output: the first input of Select is the
+  // boolean condition.
+  const DataType dtype =
+      op_features.outputs_size() > 0
+          ? op_features.outputs(0).dtype()
+          : op_features.inputs(op_features.inputs_size() - 1).dtype();
+  const double io_size =
+      CalculateInputSize(op_features, &found_unknown_shapes) +
+      output_elements * DataTypeSize(dtype);
+  auto costs = PredictRooflineCost(output_elements * ops_per_element, io_size,
+                                   op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictReduction(const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 2) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  const auto& input = op_features.inputs(0);
+  const int64 input_elements =
+      CalculateTensorElementCount(input, &found_unknown_shapes);
+
+  // Without constant reduction indices, assume a reduction to a scalar.
+  int64 output_elements = 1;
+  std::vector<int64> axes;
+  if (!input.shape().unknown_rank() &&
+      GetInputValues(op_features.inputs(1), &axes)) {
+    const int rank = input.shape().dim_size();
+    std::vector<bool> reduced(rank, false);
+    output_elements = input_elements;
+    for (int64 axis : axes) {
+      if (axis < 0) {
+        axis += rank;
+      }
+      if (axis >= 0 && axis < rank && !reduced[axis]) {
+        reduced[axis] = true;
+        output_elements /= std::max<int64>(1, input.shape().dim(axis).size());
+      }
+    }
+  }
+
+  const double io_size =
+      CalculateSingleInputSize(input, &found_unknown_shapes) +
+      output_elements * DataTypeSize(input.dtype());
+  auto costs = PredictRooflineCost(input_elements, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictPooling(const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 1) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  const auto& input = op_features.inputs(0);
+  ConvolutionDimensions pool_dims = PoolingDimensionsFromInputs(
+      input.shape(), op_features, &found_unknown_shapes);
+  const int64 output_elements =
+      pool_dims.batch * pool_dims.ox * pool_dims.oy * pool_dims.oz;
+
+  // Every output element reads its whole window.
+  const double ops = output_elements * pool_dims.kx * pool_dims.ky;
+  const double io_size =
+      CalculateSingleInputSize(input, &found_unknown_shapes) +
+      output_elements * DataTypeSize(input.dtype());
+  auto costs = PredictRooflineCost(ops, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictPoolingGrad(
+    const OpInfo& op_features) const {
+  // MaxPoolGrad takes the original input, output and the gradient, while
+  // AvgPoolGrad only takes the shape of the original input and the gradient.
+  const bool max_pool = op_features.op() == kMaxPoolGrad;
+  if (op_features.inputs_size() < (max_pool ? 3 : 2)) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  TensorShapeProto image_shape;
+  std::vector<int64> image_dims;
+  if (max_pool) {
+    image_shape = op_features.inputs(0).shape();
+  } else if (GetInputValues(op_features.inputs(0), &image_dims)) {
+    for (int64 dim : image_dims) {
+      image_shape.add_dim()->set_size(dim);
+    }
+  } else {
+    image_shape.set_unknown_rank(true);
+  }
+  ConvolutionDimensions pool_dims = PoolingDimensionsFromInputs(
+      image_shape, op_features, &found_unknown_shapes);
+
+  // The gradient is spread over the window of every output element, and the
+  // result has the shape of the original input.
+  const double ops = pool_dims.batch * pool_dims.ox * pool_dims.oy *
+                     pool_dims.oz * pool_dims.kx * pool_dims.ky;
+  const int64 output_elements =
+      pool_dims.batch * pool_dims.ix * pool_dims.iy * pool_dims.iz;
+  const auto& grad = op_features.inputs(op_features.inputs_size() - 1);
+  const double io_size =
+      CalculateInputSize(op_features, &found_unknown_shapes) +
+      output_elements * DataTypeSize(grad.dtype());
+  auto costs = PredictRooflineCost(ops, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictConcat(const OpInfo& op_features) const {
+  // The axis is the first input of Concat and the last one of ConcatV2.
+  int begin = 0;
+  int end = op_features.inputs_size();
+  if (op_features.op() == kConcat) {
+    begin = 1;
+  } else if (op_features.op() == kConcatV2) {
+    end -= 1;
+  }
+  if (begin >= end) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  int64 num_elements = 0;
+  double input_size = 0;
+  for (int i = begin; i < end; ++i) {
+    const auto& input = op_features.inputs(i);
+    num_elements += CalculateTensorElementCount(input, &found_unknown_shapes);
+    input_size += CalculateSingleInputSize(input, &found_unknown_shapes);
+  }
+
+  // Every element is copied once into the output.
+  auto costs = PredictRooflineCost(num_elements, 2 * input_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictSlice(const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 3) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  const auto& input = op_features.inputs(0);
+  const int rank = input.shape().dim_size();
+  int64 output_elements = 1;
+  std::vector<int64> begin;
+  std::vector<int64> size;
+  if (!input.shape().unknown_rank() &&
+      GetInputValues(op_features.inputs(1), &begin) &&
+      GetInputValues(op_features.inputs(2), &size) && begin.size() == rank &&
+      size.size() == rank) {
+    for (int i = 0; i < rank; ++i) {
+      // A size of -1 takes all the remaining elements of the dimension.
+      const int64 dim = input.shape().dim(i).size();
+      if (size[i] >= 0) {
+        output_elements *= size[i];
+      } else if (dim >= 0) {
+        output_elements *= dim - begin[i];
+      } else {
+        found_unknown_shapes = true;
+      }
+    }
+  } else {
+    // The whole input is an upper bound of the slice.
+    output_elements = CalculateTensorElementCount(input, &found_unknown_shapes);
+    found_unknown_shapes = true;
+  }
+
+  const double io_size = 2.0 * output_elements * DataTypeSize(input.dtype());
+  auto costs = PredictRooflineCost(output_elements, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictGather(const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 2) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  const auto& params = op_features.inputs(0);
+  const auto& indices = op_features.inputs(1);
+  int64 num_rows = 1;
+  if (params.shape().dim_size() > 0 && params.shape().dim(0).size() > 0) {
+    num_rows = params.shape().dim(0).size();
+  }
+  const int64 row_elements =
+      CalculateTensorElementCount(params, &found_unknown_shapes) / num_rows;
+  const int64 output_elements =
+      CalculateTensorElementCount(indices, &found_unknown_shapes) *
+      row_elements;
+
+  // Each gathered row is read once from params and written to the output.
+  const double io_size =
+      CalculateSingleInputSize(indices, &found_unknown_shapes) +
+      2.0 * output_elements * DataTypeSize(params.dtype());
+  auto costs = PredictRooflineCost(output_elements, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictTranspose(const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 1) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  const auto& input = op_features.inputs(0);
+  const int64 num_elements =
+      CalculateTensorElementCount(input, &found_unknown_shapes);
+  const double io_size =
+      2.0 * CalculateSingleInputSize(input, &found_unknown_shapes);
+  auto costs = PredictRooflineCost(num_elements, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictSoftmax(const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 1) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  const auto& input = op_features.inputs(0);
+  const int64 num_elements =
+      CalculateTensorElementCount(input, &found_unknown_shapes);
+  const double ops =
+      num_elements * (elementwise_ops_.at("Exp") + kSoftmaxOpsPerElement);
+  const double io_size =
+      2.0 * CalculateSingleInputSize(input, &found_unknown_shapes);
+  auto costs = PredictRooflineCost(ops, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictDecodeSegmentsLinks(
+    const OpInfo& op_features) const {
+  // The inputs are the image size, followed by N node status maps, N link
+  // status maps and N regression maps.
+  const int num_layers = (op_features.inputs_size() - 1) / 3;
+  if (num_layers < 1) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  int64 num_nodes = 0;
+  int64 num_links = 0;
+  for (int i = 0; i < num_layers; ++i) {
+    num_nodes += CalculateTensorElementCount(op_features.inputs(1 + i),
+                                             &found_unknown_shapes);
+    num_links += CalculateTensorElementCount(
+        op_features.inputs(1 + num_layers + i), &found_unknown_shapes);
+  }
+
+  // Segments are only written for the positive nodes, which are few compared
+  // to the maps, so only the reads are counted.
+  const double ops =
+      num_nodes * kDecodeOpsPerNode + num_links * kDecodeOpsPerLink;
+  const double io_size = CalculateInputSize(op_features, &found_unknown_shapes);
+  auto costs = PredictRooflineCost(ops, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictCombineSegments(
+    const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 3) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  // The segments have shape [batch, n, 6].
+  const auto& segments = op_features.inputs(0);
+  const int64 num_segments =
+      CalculateTensorElementCount(segments, &found_unknown_shapes) /
+      kSegmentDim;
+
+  const double ops = num_segments * kCombineOpsPerSegment;
+  const double io_size = CalculateInputSize(op_features, &found_unknown_shapes);
+  auto costs = PredictRooflineCost(ops, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictEncodeGroundtruth(
+    const OpInfo& op_features) const {
+  if (op_features.inputs_size() < 6) {
+    return DummyExecutionTime(op_features);
+  }
+  bool found_unknown_shapes = false;
+  // The groundtruth boxes have shape [batch, n_gt, 5].
+  const auto& gt_rboxes = op_features.inputs(0);
+  if (!gt_rboxes.shape().unknown_rank() &&
+      gt_rboxes.shape().dim_size() != 3) {
+    return DummyExecutionTime(op_features);
+  }
+  auto gt_shape =
+      MaybeGetMinimumShape(gt_rboxes.shape(), 3, &found_unknown_shapes);
+  const int64 batch = gt_shape.dim(0).size();
+  const int64 num_gt = gt_shape.dim(1).size();
+
+  std::vector<int64> map_size;
+  int64 num_positions = batch;
+  if (GetInputValues(op_features.inputs(2), &map_size) &&
+      map_size.size() == 2) {
+    num_positions *= map_size[0] * map_size[1];
+  } else {
+    found_unknown_shapes = true;
+  }
+  int num_links = kEncodeWithinLinks;
+  auto cross_links = op_features.attr().find("cross_links");
+  if (cross_links != op_features.attr().end() && cross_links->second.b()) {
+    num_links += kEncodeCrossLinks;
+  }
+
+  const double ops =
+      num_positions *
+      (num_gt * kEncodeOpsPerMatch + num_links * kEncodeOpsPerLink);
+  // Each position gets its match status and index, a status per link and
+  // the offsets, all of them 4 bytes wide.
+  const double io_size =
+      CalculateInputSize(op_features, &found_unknown_shapes) +
+      num_positions * (2 + num_links + kEncodeOffsetsDim) * sizeof(float);
+  auto costs = PredictRooflineCost(ops, io_size, op_features);
+  costs.inaccurate = found_unknown_shapes;
+  return costs;
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
@@ -34,6 +34,13 @@ class OpLevelCostEstimator {
 
   Costs PredictCosts(const OpInfo& op_features) const;
 
+  // Multiplies the predicted times of each op type listed in `scales` by the
+  // corresponding factor. The factors are typically fitted against
+  // measurements with CalibrateOpCosts() (see op_cost_calibration.h).
+  void set_op_time_scales(const std::map<string, double>& scales) {
+    op_time_scales_ = scales;
+  }
+
  protected:
   // Returns an estimate of device performance (in billions of operations
   // executed per second) and memory bandwith (in GigaBytes/second) for the
@@ -49,6 +56,13 @@ class OpLevelCostEstimator {
   Costs PredictOpCountBasedCost(double operations,
                                 const OpInfo& op_features) const;
 
+  // Roofline estimate for ops that stream their operands through memory: the
+  // loads and stores overlap with the arithmetic, so the op takes as long as
+  // the slower of the two. `io_bytes` is the total size of the tensors read
+  // and written.
+  Costs PredictRooflineCost(double operations, double io_bytes,
+                            const OpInfo& op_features) const;
+
   // This family of routines counts the number of operations to perform the
   // specified TensorFlow Op.
   struct MatMulDimensions {
@@ -87,6 +101,11 @@ class OpLevelCostEstimator {
                                             ConvolutionDimensions* conv_info,
                                             bool* found_unknown_shapes) const;
 
+  // Calculate the number of elements of a tensor, counting unknown dimensions
+  // as 1.
+  int64 CalculateTensorElementCount(const OpInfo::TensorProperties& tensor,
+                                    bool* found_unknown_shapes) const;
+
   // Calculate the total size in bytes of a single input to a TensorFlow op.
   int64 CalculateSingleInputSize(const OpInfo::TensorProperties& input,
                                  bool* found_unknown_shapes) const;
@@ -116,6 +135,18 @@ class OpLevelCostEstimator {
   Costs PredictConv2DBackPropFilter(const OpInfo& op_features) const;
   Costs PredictMatMul(const OpInfo& op_features) const;
   Costs PredictNoOp(const OpInfo& op_features) const;
+  Costs PredictCwiseOp(const OpInfo& op_features) const;
+  Costs PredictReduction(const OpInfo& op_features) const;
+  Costs PredictPooling(const OpInfo& op_features) const;
+  Costs PredictPoolingGrad(const OpInfo& op_features) const;
+  Costs PredictConcat(const OpInfo& op_features) const;
+  Costs PredictSlice(const OpInfo& op_features) const;
+  Costs PredictGather(const OpInfo& op_features) const;
+  Costs PredictTranspose(const OpInfo& op_features) const;
+  Costs PredictSoftmax(const OpInfo& op_features) const;
+  Costs PredictDecodeSegmentsLinks(const OpInfo& op_features) const;
+  Costs PredictCombineSegments(const OpInfo& op_features) const;
+  Costs PredictEncodeGroundtruth(const OpInfo& op_features) const;
 
   // Utility function for safe division. Returns 0
   // if rhs is 0 or negative.
@@ -132,9 +163,19 @@ class OpLevelCostEstimator {
       const TensorShapeProto& original_filter_shape, const OpInfo& op_features,
       bool* found_unknown_shapes);
 
+  // Dimensions of a MaxPool or AvgPool over `original_image_shape`, using
+  // the ksize, strides, padding and data_format attributes of the op. The
+  // kernel size is returned in kx and ky, and oz is the input depth.
+  static ConvolutionDimensions PoolingDimensionsFromInputs(
+      const TensorShapeProto& original_image_shape, const OpInfo& op_features,
+      bool* found_unknown_shapes);
+
  protected:
   typedef std::function<Costs(const OpInfo& op_feature)> CostImpl;
   std::map<string, CostImpl> device_cost_impl_;
+  // Number of operations per output element of each element-wise op.
+  std::map<string, int> elementwise_ops_;
+  std::map<string, double> op_time_scales_;
 };
 
 }  // end namespace grappler
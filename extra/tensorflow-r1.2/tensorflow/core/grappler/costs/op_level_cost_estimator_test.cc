@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/platform/test.h"
@@ -88,6 +90,65 @@ OpInfo DescribeConvolution(int batch, int ix, int iy, int iz1, int iz2, int kx,
   DescribeTensor4D(kx, ky, iz2, oz, &op_features);
   return op_features;
 }
+
+// Returns an OpInfo for `op` on the CPU, without inputs.
+OpInfo DescribeOp(const string& op) {
+  OpInfo op_features;
+  op_features.mutable_device()->set_type("CPU");
+  op_features.set_op(op);
+  return op_features;
+}
+
+// Adds an input of the given shape and type.
+void DescribeInput(const std::vector<int64>& dims, DataType dtype,
+                   OpInfo *op_features) {
+  auto input = op_features->add_inputs();
+  for (int64 dim : dims) {
+    input->mutable_shape()->add_dim()->set_size(dim);
+  }
+  input->set_dtype(dtype);
+}
+
+// Adds an output of the given shape and type.
+void DescribeOutput(const std::vector<int64>& dims, DataType dtype,
+                    OpInfo *op_features) {
+  auto output = op_features->add_outputs();
+  for (int64 dim : dims) {
+    output->mutable_shape()->add_dim()->set_size(dim);
+  }
+  output->set_dtype(dtype);
+}
+
+// Adds an int32 vector input whose values are known.
+void DescribeIntValues(const std::vector<int32>& values,
+                       OpInfo *op_features) {
+  Tensor tensor(DT_INT32, TensorShape({static_cast<int64>(values.size())}));
+  for (int i = 0; i < values.size(); ++i) {
+    tensor.flat<int32>()(i) = values[i];
+  }
+  auto input = op_features->add_inputs();
+  input->set_dtype(DT_INT32);
+  input->mutable_shape()->add_dim()->set_size(values.size());
+  tensor.AsProtoTensorContent(input->mutable_value());
+}
+
+// Runs at one billion operations and one billion bytes per second, so that
+// times in nanoseconds are operation and byte counts.
+class UnitDeviceCostEstimator : public OpLevelCostEstimator {
+ protected:
+  std::pair<double, double> GetDeviceInfo(
+      const DeviceProperties& device) const override {
+    return std::make_pair(1.0, 1.0);
+  }
+};
+
+// Checks the compute, memory and execution times of `costs`, in ns.
+void ExpectCosts(int64 compute, int64 memory, const Costs &costs) {
+  EXPECT_EQ(compute, costs.compute_time.count());
+  EXPECT_EQ(memory, costs.memory_time.count());
+  EXPECT_EQ(std::max(compute, memory), costs.execution_time.count());
+  EXPECT_FALSE(costs.inaccurate);
+}
 }  // namespace
 
 TEST(OpLevelCostEstimatorTest, UnknownOrPartialShape) {
@@ -110,5 +171,167 @@ TEST(OpLevelCostEstimatorTest, UnknownOrPartialShape) {
           .inaccurate);
 }
 
+TEST(OpLevelCostEstimatorTest, ElementwiseOps) {
+  UnitDeviceCostEstimator estimator;
+
+  // The scalar is broadcast: 10000 additions, reading 40004 bytes and
+  // writing 40000.
+  OpInfo add = DescribeOp("Add");
+  DescribeInput({100, 100}, DT_FLOAT, &add);
+  DescribeInput({}, DT_FLOAT, &add);
+  ExpectCosts(10000, 80004, estimator.PredictCosts(add));
+
+  // Exponentials are compute bound.
+  OpInfo exp = DescribeOp("Exp");
+  DescribeInput({100, 100}, DT_FLOAT, &exp);
+  ExpectCosts(200000, 80000, estimator.PredictCosts(exp));
+
+  // Summing three inputs takes two additions per element.
+  OpInfo add_n = DescribeOp("AddN");
+  for (int i = 0; i < 3; ++i) {
+    DescribeInput({10, 10}, DT_FLOAT, &add_n);
+  }
+  ExpectCosts(200, 1600, estimator.PredictCosts(add_n));
+
+  // A fused chain costs the sum of its ops, with a single pass over memory.
+  OpInfo fused = DescribeOp("_FusedCwise");
+  SetAttrValue(std::vector<string>({"Mul", "Exp", "RSub"}),
+               &(*fused.mutable_attr())["ops"]);
+  DescribeInput({100}, DT_FLOAT, &fused);
+  ExpectCosts(2200, 800, estimator.PredictCosts(fused));
+
+  // Comparisons write booleans: reading 80000 bytes and writing 10000.
+  OpInfo less = DescribeOp("Less");
+  DescribeInput({100, 100}, DT_FLOAT, &less);
+  DescribeInput({100, 100}, DT_FLOAT, &less);
+  DescribeOutput({100, 100}, DT_BOOL, &less);
+  ExpectCosts(10000, 90000, estimator.PredictCosts(less));
+
+  // Cast writes its DstT.
+  OpInfo cast = DescribeOp("Cast");
+  DescribeInput({100, 100}, DT_FLOAT, &cast);
+  DescribeOutput({100, 100}, DT_DOUBLE, &cast);
+  ExpectCosts(10000, 120000, estimator.PredictCosts(cast));
+}
+
+TEST(OpLevelCostEstimatorTest, Reductions) {
+  UnitDeviceCostEstimator estimator;
+
+  // Reducing dimensions 1 and 2 leaves 10 elements.
+  OpInfo sum = DescribeOp("Sum");
+  DescribeInput({10, 20, 30}, DT_FLOAT, &sum);
+  DescribeIntValues({1, -1}, &sum);
+  ExpectCosts(6000, 24040, estimator.PredictCosts(sum));
+
+  // Unknown reduction indices are taken to reduce everything.
+  OpInfo mean = DescribeOp("Mean");
+  DescribeInput({10, 20, 30}, DT_FLOAT, &mean);
+  DescribeInput({2}, DT_INT32, &mean);
+  ExpectCosts(6000, 24004, estimator.PredictCosts(mean));
+}
+
+TEST(OpLevelCostEstimatorTest, Pooling) {
+  UnitDeviceCostEstimator estimator;
+
+  // 2x2 windows with stride 2 over an 8x8 image with 4 channels.
+  OpInfo max_pool = DescribeOp("MaxPool");
+  SetAttrValue(std::vector<int>({1, 2, 2, 1}),
+               &(*max_pool.mutable_attr())["ksize"]);
+  SetAttrValue(std::vector<int>({1, 2, 2, 1}),
+               &(*max_pool.mutable_attr())["strides"]);
+  SetAttrValue("VALID", &(*max_pool.mutable_attr())["padding"]);
+  DescribeInput({1, 8, 8, 4}, DT_FLOAT, &max_pool);
+  ExpectCosts(256, 1280, estimator.PredictCosts(max_pool));
+
+  OpInfo avg_pool_grad = max_pool;
+  avg_pool_grad.set_op("AvgPoolGrad");
+  avg_pool_grad.clear_inputs();
+  DescribeIntValues({1, 8, 8, 4}, &avg_pool_grad);
+  DescribeInput({1, 4, 4, 4}, DT_FLOAT, &avg_pool_grad);
+  ExpectCosts(256, 1296, estimator.PredictCosts(avg_pool_grad));
+}
+
+TEST(OpLevelCostEstimatorTest, DataMovement) {
+  UnitDeviceCostEstimator estimator;
+
+  OpInfo concat = DescribeOp("ConcatV2");
+  DescribeInput({10, 10}, DT_FLOAT, &concat);
+  DescribeInput({10, 10}, DT_FLOAT, &concat);
+  DescribeIntValues({0}, &concat);
+  ExpectCosts(200, 1600, estimator.PredictCosts(concat));
+
+  // Rows 2 to 6, all columns.
+  OpInfo slice = DescribeOp("Slice");
+  DescribeInput({10, 10}, DT_FLOAT, &slice);
+  DescribeIntValues({2, 0}, &slice);
+  DescribeIntValues({5, -1}, &slice);
+  ExpectCosts(50, 400, estimator.PredictCosts(slice));
+
+  // Without constant sizes, the slice could be the whole input.
+  OpInfo unknown_slice = DescribeOp("Slice");
+  DescribeInput({10, 10}, DT_FLOAT, &unknown_slice);
+  DescribeInput({2}, DT_INT32, &unknown_slice);
+  DescribeInput({2}, DT_INT32, &unknown_slice);
+  EXPECT_TRUE(estimator.PredictCosts(unknown_slice).inaccurate);
+
+  // 5 rows of 8 floats.
+  OpInfo gather = DescribeOp("Gather");
+  DescribeInput({100, 8}, DT_FLOAT, &gather);
+  DescribeInput({5}, DT_INT32, &gather);
+  ExpectCosts(40, 340, estimator.PredictCosts(gather));
+
+  OpInfo softmax = DescribeOp("Softmax");
+  DescribeInput({10, 10}, DT_FLOAT, &softmax);
+  ExpectCosts(2400, 800, estimator.PredictCosts(softmax));
+}
+
+TEST(OpLevelCostEstimatorTest, SegLinkOps) {
+  UnitDeviceCostEstimator estimator;
+
+  // One layer with a 4x4 map: 16 nodes and 128 links.
+  OpInfo decode = DescribeOp("DecodeSegmentsLinks");
+  DescribeIntValues({64, 64}, &decode);
+  DescribeInput({1, 4, 4}, DT_INT32, &decode);
+  DescribeInput({1, 4, 4, 8}, DT_INT32, &decode);
+  DescribeInput({1, 4, 4, 6}, DT_FLOAT, &decode);
+  ExpectCosts(992, 968, estimator.PredictCosts(decode));
+
+  OpInfo combine = DescribeOp("CombineSegments");
+  DescribeInput({1, 10, 6}, DT_FLOAT, &combine);
+  DescribeInput({1, 10}, DT_INT32, &combine);
+  DescribeInput({1}, DT_INT32, &combine);
+  ExpectCosts(400, 284, estimator.PredictCosts(combine));
+
+  // 2 images of 3 boxes, matched against a 4x4 map.
+  OpInfo encode = DescribeOp("EncodeGroundtruth");
+  DescribeInput({2, 3, 5}, DT_FLOAT, &encode);
+  DescribeInput({2}, DT_INT32, &encode);
+  DescribeIntValues({4, 4}, &encode);
+  DescribeIntValues({64, 64}, &encode);
+  DescribeInput({2, 8, 8}, DT_INT32, &encode);
+  DescribeInput({2, 8, 8}, DT_INT32, &encode);
+  ExpectCosts(2944, 3216, estimator.PredictCosts(encode));
+
+  // Cross links add 4 links per position.
+  SetAttrValue(true, &(*encode.mutable_attr())["cross_links"]);
+  ExpectCosts(3456, 3728, estimator.PredictCosts(encode));
+
+  encode.mutable_inputs(2)->clear_value();
+  EXPECT_TRUE(estimator.PredictCosts(encode).inaccurate);
+}
+
+TEST(OpLevelCostEstimatorTest, OpTimeScales) {
+  UnitDeviceCostEstimator estimator;
+  estimator.set_op_time_scales({{"Exp", 1.5}});
+
+  OpInfo exp = DescribeOp("Exp");
+  DescribeInput({100, 100}, DT_FLOAT, &exp);
+  ExpectCosts(300000, 120000, estimator.PredictCosts(exp));
+
+  OpInfo tanh = exp;
+  tanh.set_op("Tanh");
+  ExpectCosts(250000, 80000, estimator.PredictCosts(tanh));
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
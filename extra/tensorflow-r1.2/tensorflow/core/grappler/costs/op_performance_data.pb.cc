@@ -49,11 +49,12 @@ void protobuf_AssignDesc_tensorflow_2fcore_2fgrappler_2fcosts_2fop_5fperformance
       "tensorflow/core/grappler/costs/op_performance_data.proto");
   GOOGLE_CHECK(file != NULL);
   OpInfo_descriptor_ = file->message_type(0);
-  static const int OpInfo_offsets_[4] = {
+  static const int OpInfo_offsets_[5] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OpInfo, op_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OpInfo, attr_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OpInfo, inputs_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OpInfo, device_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OpInfo, outputs_),
   };
   OpInfo_reflection_ =
     ::google::protobuf::internal::GeneratedMessageReflection::NewGeneratedMessageReflection(
@@ -224,29 +225,30 @@ void protobuf_AddDesc_tensorflow_2fcore_2fgrappler_2fcosts_2fop_5fperformance_5f
     "nsorflow/core/framework/types.proto\032*ten"
     "sorflow/core/framework/attr_value.proto\032"
     "0tensorflow/core/protobuf/device_propert"
-    "ies.proto\"\366\002\n\006OpInfo\022\n\n\002op\030\001 \001(\t\022*\n\004attr"
+    "ies.proto\"\254\003\n\006OpInfo\022\n\n\002op\030\001 \001(\t\022*\n\004attr"
     "\030\002 \003(\0132\034.tensorflow.OpInfo.AttrEntry\0223\n\006"
     "inputs\030\003 \003(\0132#.tensorflow.OpInfo.TensorP"
     "roperties\022,\n\006device\030\004 \001(\0132\034.tensorflow.D"
-    "eviceProperties\032B\n\tAttrEntry\022\013\n\003key\030\001 \001("
-    "\t\022$\n\005value\030\002 \001(\0132\025.tensorflow.AttrValue:"
-    "\0028\001\032\214\001\n\020TensorProperties\022#\n\005dtype\030\001 \001(\0162"
-    "\024.tensorflow.DataType\022+\n\005shape\030\002 \001(\0132\034.t"
-    "ensorflow.TensorShapeProto\022&\n\005value\030\003 \001("
-    "\0132\027.tensorflow.TensorProto\"\247\003\n\rOpPerform"
-    "ance\022\036\n\002op\030\001 \001(\0132\022.tensorflow.OpInfo\022\014\n\004"
-    "node\030\005 \001(\t\022\035\n\025temporary_memory_size\030\002 \001("
-    "\003\022\024\n\014compute_cost\030\003 \001(\003\022\024\n\014compute_time\030"
-    "\006 \001(\003\022\023\n\013memory_time\030\007 \001(\003\022\032\n\022compute_ef"
-    "ficiency\030\004 \001(\001\022\031\n\021memory_efficiency\030\010 \001("
-    "\001\0225\n\top_memory\030\t \001(\0132\".tensorflow.OpPerf"
-    "ormance.OpMemory\032\231\001\n\010OpMemory\022\025\n\routput_"
-    "memory\030\001 \003(\003\022\030\n\020host_temp_memory\030\002 \001(\003\022\032"
-    "\n\022device_temp_memory\030\003 \001(\003\022\036\n\026host_persi"
-    "stent_memory\030\004 \001(\003\022 \n\030device_persistent_"
-    "memory\030\005 \001(\003\"F\n\021OpPerformanceList\0221\n\016op_"
-    "performance\030\001 \003(\0132\031.tensorflow.OpPerform"
-    "anceB\003\370\001\001b\006proto3", 1177);
+    "eviceProperties\0224\n\007outputs\030\005 \003(\0132#.tenso"
+    "rflow.OpInfo.TensorProperties\032B\n\tAttrEnt"
+    "ry\022\013\n\003key\030\001 \001(\t\022$\n\005value\030\002 \001(\0132\025.tensorf"
+    "low.AttrValue:\0028\001\032\214\001\n\020TensorProperties\022#"
+    "\n\005dtype\030\001 \001(\0162\024.tensorflow.DataType\022+\n\005s"
+    "hape\030\002 \001(\0132\034.tensorflow.TensorShapeProto"
+    "\022&\n\005value\030\003 \001(\0132\027.tensorflow.TensorProto"
+    "\"\247\003\n\rOpPerformance\022\036\n\002op\030\001 \001(\0132\022.tensorf"
+    "low.OpInfo\022\014\n\004node\030\005 \001(\t\022\035\n\025temporary_me"
+    "mory_size\030\002 \001(\003\022\024\n\014compute_cost\030\003 \001(\003\022\024\n"
+    "\014compute_time\030\006 \001(\003\022\023\n\013memory_time\030\007 \001(\003"
+    "\022\032\n\022compute_efficiency\030\004 \001(\001\022\031\n\021memory_e"
+    "fficiency\030\010 \001(\001\0225\n\top_memory\030\t \001(\0132\".ten"
+    "sorflow.OpPerformance.OpMemory\032\231\001\n\010OpMem"
+    "ory\022\025\n\routput_memory\030\001 \003(\003\022\030\n\020host_temp_"
+    "memory\030\002 \001(\003\022\032\n\022device_temp_memory\030\003 \001(\003"
+    "\022\036\n\026host_persistent_memory\030\004 \001(\003\022 \n\030devi"
+    "ce_persistent_memory\030\005 \001(\003\"F\n\021OpPerforma"
+    "nceList\0221\n\016op_performance\030\001 \003(\0132\031.tensor"
+    "flow.OpPerformanceB\003\370\001\001b\006proto3", 1231);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "tensorflow/core/grappler/costs/op_performance_data.proto", &protobuf_RegisterTypes);
   ::tensorflow::protobuf_AddDesc_tensorflow_2fcore_2fframework_2ftensor_2eproto();
@@ -771,6 +773,7 @@ const int OpInfo::kOpFieldNumber;
 const int OpInfo::kAttrFieldNumber;
 const int OpInfo::kInputsFieldNumber;
 const int OpInfo::kDeviceFieldNumber;
+const int OpInfo::kOutputsFieldNumber;
 #endif  // !defined(_MSC_VER) || _MSC_VER >= 1900
 
 OpInfo::OpInfo()
@@ -783,7 +786,8 @@ OpInfo::OpInfo(::google::protobuf::Arena* arena)
   : ::google::protobuf::Message(),
   _internal_metadata_(arena),
   attr_(arena),
-  inputs_(arena) {
+  inputs_(arena),
+  outputs_(arena) {
 #ifdef GOOGLE_PROTOBUF_NO_STATIC_INITIALIZER
   protobuf_InitDefaults_tensorflow_2fcore_2fgrappler_2fcosts_2fop_5fperformance_5fdata_2eproto();
 #endif  // GOOGLE_PROTOBUF_NO_STATIC_INITIALIZER
@@ -866,6 +870,7 @@ void OpInfo::Clear() {
   device_ = NULL;
   attr_.Clear();
   inputs_.Clear();
+  outputs_.Clear();
 }
 
 bool OpInfo::MergePartialFromCodedStream(
@@ -946,6 +951,23 @@ bool OpInfo::MergePartialFromCodedStream(
         } else {
           goto handle_unusual;
         }
+        if (input->ExpectTag(42)) goto parse_outputs;
+        break;
+      }
+
+      // repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+      case 5: {
+        if (tag == 42) {
+         parse_outputs:
+          DO_(input->IncrementRecursionDepth());
+         parse_loop_outputs:
+          DO_(::google::protobuf::internal::WireFormatLite::ReadMessageNoVirtualNoRecursionDepth(
+                input, add_outputs()));
+        } else {
+          goto handle_unusual;
+        }
+        if (input->ExpectTag(42)) goto parse_loop_outputs;
+        input->UnsafeDecrementRecursionDepth();
         if (input->ExpectAtEnd()) goto success;
         break;
       }
@@ -1051,6 +1073,12 @@ void OpInfo::SerializeWithCachedSizes(
       4, *this->device_, output);
   }
 
+  // repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+  for (unsigned int i = 0, n = this->outputs_size(); i < n; i++) {
+    ::google::protobuf::internal::WireFormatLite::WriteMessageMaybeToArray(
+      5, this->outputs(i), output);
+  }
+
   // @@protoc_insertion_point(serialize_end:tensorflow.OpInfo)
 }
 
@@ -1142,6 +1170,13 @@ void OpInfo::SerializeWithCachedSizes(
         4, *this->device_, false, target);
   }
 
+  // repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+  for (unsigned int i = 0, n = this->outputs_size(); i < n; i++) {
+    target = ::google::protobuf::internal::WireFormatLite::
+      InternalWriteMessageNoVirtualToArray(
+        5, this->outputs(i), false, target);
+  }
+
   // @@protoc_insertion_point(serialize_to_array_end:tensorflow.OpInfo)
   return target;
 }
@@ -1195,6 +1230,17 @@ size_t OpInfo::ByteSizeLong() const {
     }
   }
 
+  // repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+  {
+    unsigned int count = this->outputs_size();
+    total_size += 1UL * count;
+    for (unsigned int i = 0; i < count; i++) {
+      total_size +=
+        ::google::protobuf::internal::WireFormatLite::MessageSizeNoVirtual(
+          this->outputs(i));
+    }
+  }
+
   int cached_size = ::google::protobuf::internal::ToCachedSize(total_size);
   GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
   _cached_size_ = cached_size;
@@ -1230,6 +1276,7 @@ void OpInfo::UnsafeMergeFrom(const OpInfo& from) {
   GOOGLE_DCHECK(&from != this);
   attr_.MergeFrom(from.attr_);
   inputs_.MergeFrom(from.inputs_);
+  outputs_.MergeFrom(from.outputs_);
   if (from.op().size() > 0) {
     set_op(from.op());
   }
@@ -1278,6 +1325,7 @@ void OpInfo::InternalSwap(OpInfo* other) {
   attr_.Swap(&other->attr_);
   inputs_.UnsafeArenaSwap(&other->inputs_);
   std::swap(device_, other->device_);
+  outputs_.UnsafeArenaSwap(&other->outputs_);
   _internal_metadata_.Swap(&other->_internal_metadata_);
   std::swap(_cached_size_, other->_cached_size_);
 }
@@ -1575,6 +1623,36 @@ const ::tensorflow::DeviceProperties& OpInfo::device() const {
   // @@protoc_insertion_point(field_set_allocated:tensorflow.OpInfo.device)
 }
 
+// repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+int OpInfo::outputs_size() const {
+  return outputs_.size();
+}
+void OpInfo::clear_outputs() {
+  outputs_.Clear();
+}
+const ::tensorflow::OpInfo_TensorProperties& OpInfo::outputs(int index) const {
+  // @@protoc_insertion_point(field_get:tensorflow.OpInfo.outputs)
+  return outputs_.Get(index);
+}
+::tensorflow::OpInfo_TensorProperties* OpInfo::mutable_outputs(int index) {
+  // @@protoc_insertion_point(field_mutable:tensorflow.OpInfo.outputs)
+  return outputs_.Mutable(index);
+}
+::tensorflow::OpInfo_TensorProperties* OpInfo::add_outputs() {
+  // @@protoc_insertion_point(field_add:tensorflow.OpInfo.outputs)
+  return outputs_.Add();
+}
+::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties >*
+OpInfo::mutable_outputs() {
+  // @@protoc_insertion_point(field_mutable_list:tensorflow.OpInfo.outputs)
+  return &outputs_;
+}
+const ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties >&
+OpInfo::outputs() const {
+  // @@protoc_insertion_point(field_list:tensorflow.OpInfo.outputs)
+  return outputs_;
+}
+
 inline const OpInfo* OpInfo::internal_default_instance() {
   return &OpInfo_default_instance_.get();
 }
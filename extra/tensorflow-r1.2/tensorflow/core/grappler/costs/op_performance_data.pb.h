@@ -317,6 +317,18 @@ class OpInfo : public ::google::protobuf::Message /* @@protoc_insertion_point(cl
   void unsafe_arena_set_allocated_device(
       ::tensorflow::DeviceProperties* device);
 
+  // repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+  int outputs_size() const;
+  void clear_outputs();
+  static const int kOutputsFieldNumber = 5;
+  const ::tensorflow::OpInfo_TensorProperties& outputs(int index) const;
+  ::tensorflow::OpInfo_TensorProperties* mutable_outputs(int index);
+  ::tensorflow::OpInfo_TensorProperties* add_outputs();
+  ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties >*
+      mutable_outputs();
+  const ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties >&
+      outputs() const;
+
   // @@protoc_insertion_point(class_scope:tensorflow.OpInfo)
  private:
 
@@ -336,6 +348,7 @@ class OpInfo : public ::google::protobuf::Message /* @@protoc_insertion_point(cl
       ::google::protobuf::internal::WireFormatLite::TYPE_MESSAGE,
       0 > attr_;
   ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties > inputs_;
+  ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties > outputs_;
   ::google::protobuf::internal::ArenaStringPtr op_;
   ::tensorflow::DeviceProperties* device_;
   mutable int _cached_size_;
@@ -1066,6 +1079,36 @@ inline  void OpInfo::set_allocated_device(::tensorflow::DeviceProperties* device
   // @@protoc_insertion_point(field_set_allocated:tensorflow.OpInfo.device)
 }
 
+// repeated .tensorflow.OpInfo.TensorProperties outputs = 5;
+inline int OpInfo::outputs_size() const {
+  return outputs_.size();
+}
+inline void OpInfo::clear_outputs() {
+  outputs_.Clear();
+}
+inline const ::tensorflow::OpInfo_TensorProperties& OpInfo::outputs(int index) const {
+  // @@protoc_insertion_point(field_get:tensorflow.OpInfo.outputs)
+  return outputs_.Get(index);
+}
+inline ::tensorflow::OpInfo_TensorProperties* OpInfo::mutable_outputs(int index) {
+  // @@protoc_insertion_point(field_mutable:tensorflow.OpInfo.outputs)
+  return outputs_.Mutable(index);
+}
+inline ::tensorflow::OpInfo_TensorProperties* OpInfo::add_outputs() {
+  // @@protoc_insertion_point(field_add:tensorflow.OpInfo.outputs)
+  return outputs_.Add();
+}
+inline ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties >*
+OpInfo::mutable_outputs() {
+  // @@protoc_insertion_point(field_mutable_list:tensorflow.OpInfo.outputs)
+  return &outputs_;
+}
+inline const ::google::protobuf::RepeatedPtrField< ::tensorflow::OpInfo_TensorProperties >&
+OpInfo::outputs() const {
+  // @@protoc_insertion_point(field_list:tensorflow.OpInfo.outputs)
+  return outputs_;
+}
+
 inline const OpInfo* OpInfo::internal_default_instance() {
   return &OpInfo_default_instance_.get();
 }
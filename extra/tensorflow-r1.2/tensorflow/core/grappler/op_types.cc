@@ -23,6 +23,11 @@ bool IsConcat(const NodeDef& node) {
   return op == "Concat" || op == "ConcatV2";
 }
 
+bool IsConstant(const NodeDef& node) {
+  const auto op = node.op();
+  return op == "Const";
+}
+
 bool IsDequeueOp(const NodeDef& node) {
   static const std::set<std::string> dequeue_ops = {
       "QueueDequeueManyV2", "QueueDequeueMany", "QueueDequeueV2",
@@ -51,5 +56,10 @@ bool IsMerge(const NodeDef& node) {
   return op == "Merge";
 }
 
+bool IsNextIteration(const NodeDef& node) {
+  const auto op = node.op();
+  return op == "NextIteration" || op == "RefNextIteration";
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
@@ -22,11 +22,13 @@ namespace tensorflow {
 namespace grappler {
 
 bool IsConcat(const NodeDef& node);
+bool IsConstant(const NodeDef& node);
 bool IsDequeueOp(const NodeDef& node);
 bool IsPlaceholder(const NodeDef& node);
 bool IsTranspose(const NodeDef& node);
 bool IsVariable(const NodeDef& node);
 bool IsMerge(const NodeDef& node);
+bool IsNextIteration(const NodeDef& node);
 
 }  // end namespace grappler
 }  // end namespace tensorflow
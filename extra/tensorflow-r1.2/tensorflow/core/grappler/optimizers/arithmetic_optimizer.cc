@@ -0,0 +1,602 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+DataType GetTypeAttr(const NodeDef& node, const string& name) {
+  const auto& attr = node.attr();
+  return attr.count(name) == 0 ? DT_INVALID : attr.at(name).type();
+}
+
+bool HasControlInputs(const NodeDef& node) {
+  for (const string& input : node.input()) {
+    if (!input.empty() && input[0] == '^') return true;
+  }
+  return false;
+}
+
+// Returns true if every value of type `from` can be cast to type `to` and
+// back without change.
+bool IsLosslessCast(DataType from, DataType to) {
+  switch (from) {
+    case DT_HALF:
+      return to == DT_FLOAT || to == DT_DOUBLE;
+    case DT_BFLOAT16:
+      return to == DT_FLOAT || to == DT_DOUBLE;
+    case DT_FLOAT:
+      return to == DT_DOUBLE;
+    case DT_INT8:
+      return to == DT_INT16 || to == DT_INT32 || to == DT_INT64;
+    case DT_UINT8:
+      return to == DT_INT16 || to == DT_UINT16 || to == DT_INT32 ||
+             to == DT_INT64;
+    case DT_INT16:
+    case DT_UINT16:
+      return to == DT_INT32 || to == DT_INT64;
+    case DT_INT32:
+      return to == DT_INT64;
+    default:
+      return false;
+  }
+}
+
+// Unary ops that _FusedCwise can apply.
+bool IsFusableUnaryOp(const string& op) {
+  static const std::unordered_set<string>* const kOps =
+      new std::unordered_set<string>(
+          {"Abs", "Ceil", "Exp", "Floor", "Inv", "Log", "Neg", "Reciprocal",
+           "Relu", "Relu6", "Rsqrt", "Sigmoid", "Sqrt", "Square", "Tanh"});
+  return kOps->count(op) > 0;
+}
+
+// Sets `step` to the _FusedCwise step that applies the binary op `op` with a
+// scalar operand, which comes first if `scalar_first` is set.
+bool GetFusableBinaryStep(const string& op, bool scalar_first,
+                          string* step) {
+  if (op == "Add" || op == "Mul" || op == "Maximum" || op == "Minimum") {
+    *step = op;
+  } else if (op == "Sub") {
+    *step = scalar_first ? "RSub" : "Sub";
+  } else if (op == "Div" || op == "RealDiv") {
+    *step = scalar_first ? "RDiv" : "Div";
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool IsOnCpu(const NodeDef& node) {
+  if (node.device().empty()) return true;
+  DeviceNameUtils::ParsedName parsed;
+  return DeviceNameUtils::ParseFullName(node.device(), &parsed) &&
+         (!parsed.has_type || parsed.type == "CPU");
+}
+
+// One element-wise node that can be part of a fused chain.
+struct CwiseStep {
+  string op;
+  float scalar = 0.0f;
+  string input;  // The non-constant input.
+};
+
+class Simplifier {
+ public:
+  Simplifier(const GrapplerItem& item, GraphDef* graph)
+      : graph_(graph), node_map_(graph) {
+    for (const auto& node : item.fetch) {
+      nodes_to_preserve_.insert(NodeName(node));
+    }
+    for (const auto& feed : item.feed) {
+      nodes_to_preserve_.insert(NodeName(feed.first));
+    }
+    for (const auto& node : item.init_ops) {
+      nodes_to_preserve_.insert(NodeName(node));
+    }
+  }
+
+  // Applies all simplifications until none matches, then fuses element-wise
+  // chains and removes the nodes that became unused. Returns the number of
+  // rewrites.
+  int Run();
+
+ private:
+  bool IsPreserved(const NodeDef& node) const {
+    return nodes_to_preserve_.find(node.name()) != nodes_to_preserve_.end();
+  }
+
+  bool IsRemoved(const string& name) const {
+    return removed_nodes_.find(name) != removed_nodes_.end();
+  }
+
+  // Returns the consumers of `name` that have not been removed.
+  std::vector<NodeDef*> GetConsumers(const string& name);
+
+  // Returns the node producing output 0 of `input` if it has op `op`, is not
+  // removed and has no control inputs; otherwise returns nullptr.
+  NodeDef* GetProducer(const string& input, const string& op);
+
+  // Reads the constant produced by `input`, looking through Identity nodes.
+  bool GetConstTensor(const string& input, Tensor* tensor);
+
+  // Returns true if `consumer` is the only consumer of `producer`, reads only
+  // output 0 of it, and `producer` does not have to be preserved.
+  bool HasSoleConsumer(const NodeDef& producer, const NodeDef& consumer);
+
+  // Makes the consumers of `node` read `replacement` instead and removes
+  // `node`; a preserved `node` becomes an Identity of `replacement` instead.
+  void ForwardToInput(NodeDef* node, const string& replacement,
+                      DataType type);
+
+  bool RemoveRedundantCast(NodeDef* node);
+  bool RemoveRedundantReshape(NodeDef* node);
+  bool RemoveRedundantTranspose(NodeDef* node);
+  bool HoistCommonFactor(NodeDef* node);
+
+  // Returns true if `node` can be part of a _FusedCwise chain, and sets
+  // `step` to its part of the chain.
+  bool GetCwiseStep(const NodeDef& node, CwiseStep* step);
+  // Returns the node that precedes `node` in a fusable chain, or nullptr.
+  NodeDef* GetChainPredecessor(const NodeDef& node);
+  // Fuses the chain that ends at `end`, if it is longer than one node.
+  bool FuseCwiseChain(NodeDef* end);
+
+  NodeDef* AddNode(const string& name, const string& op,
+                   const string& device);
+
+  // Removes the nodes that were rewritten away, as well as the inputs that
+  // they were the only consumers of.
+  void RemoveDeadNodes();
+
+  GraphDef* graph_;
+  NodeMap node_map_;
+  std::unordered_set<string> nodes_to_preserve_;
+  std::unordered_set<string> removed_nodes_;
+  // Nodes that may have lost their last consumer.
+  std::vector<string> maybe_unused_;
+};
+
+std::vector<NodeDef*> Simplifier::GetConsumers(const string& name) {
+  std::vector<NodeDef*> consumers;
+  for (NodeDef* consumer : node_map_.GetOutputs(name)) {
+    if (!IsRemoved(consumer->name())) consumers.push_back(consumer);
+  }
+  return consumers;
+}
+
+NodeDef* Simplifier::GetProducer(const string& input, const string& op) {
+  int position;
+  NodeDef* node = node_map_.GetNode(ParseNodeName(input, &position));
+  if (node == nullptr || position != 0 || node->op() != op ||
+      IsRemoved(node->name()) || HasControlInputs(*node)) {
+    return nullptr;
+  }
+  return node;
+}
+
+bool Simplifier::GetConstTensor(const string& input, Tensor* tensor) {
+  const NodeDef* node = node_map_.GetNode(NodeName(input));
+  while (node != nullptr && node->op() == "Identity" &&
+         node->input_size() > 0) {
+    node = node_map_.GetNode(NodeName(node->input(0)));
+  }
+  if (node == nullptr || node->op() != "Const" ||
+      node->attr().count("value") == 0) {
+    return false;
+  }
+  return tensor->FromProto(node->attr().at("value").tensor());
+}
+
+bool Simplifier::HasSoleConsumer(const NodeDef& producer,
+                                 const NodeDef& consumer) {
+  if (IsPreserved(producer)) return false;
+  const std::vector<NodeDef*> consumers = GetConsumers(producer.name());
+  if (consumers.size() != 1 || consumers[0] != &consumer) return false;
+  int num_reads = 0;
+  for (const string& input : consumer.input()) {
+    int position;
+    if (ParseNodeName(input, &position) != producer.name()) continue;
+    if (position != 0) return false;
+    ++num_reads;
+  }
+  return num_reads == 1;
+}
+
+void Simplifier::ForwardToInput(NodeDef* node, const string& replacement,
+                                DataType type) {
+  for (const string& input : node->input()) {
+    if (input != replacement) maybe_unused_.push_back(NodeName(input));
+  }
+  const string replacement_node = NodeName(replacement);
+  if (IsPreserved(*node)) {
+    node->set_op("Identity");
+    node->clear_input();
+    node->add_input(replacement);
+    node->clear_attr();
+    (*node->mutable_attr())["T"].set_type(type);
+    node_map_.AddOutput(replacement_node, node->name());
+    return;
+  }
+  for (NodeDef* consumer : GetConsumers(node->name())) {
+    for (int i = 0; i < consumer->input_size(); ++i) {
+      const string& input = consumer->input(i);
+      if (NodeName(input) != node->name()) continue;
+      consumer->set_input(i, input[0] == '^'
+                                 ? strings::StrCat("^", replacement_node)
+                                 : replacement);
+    }
+    node_map_.AddOutput(replacement_node, consumer->name());
+  }
+  removed_nodes_.insert(node->name());
+}
+
+bool Simplifier::RemoveRedundantCast(NodeDef* node) {
+  if (node->op() != "Cast" || node->input_size() != 1) return false;
+  const DataType src = GetTypeAttr(*node, "SrcT");
+  const DataType dst = GetTypeAttr(*node, "DstT");
+  if (src == dst) {
+    ForwardToInput(node, node->input(0), dst);
+    return true;
+  }
+  NodeDef* producer = GetProducer(node->input(0), "Cast");
+  if (producer == nullptr || producer->input_size() != 1 ||
+      GetTypeAttr(*producer, "SrcT") != dst ||
+      !IsLosslessCast(dst, src)) {
+    return false;
+  }
+  ForwardToInput(node, producer->input(0), dst);
+  return true;
+}
+
+bool Simplifier::RemoveRedundantReshape(NodeDef* node) {
+  if (node->op() != "Reshape" || node->input_size() < 2) return false;
+  NodeDef* producer = GetProducer(node->input(0), "Reshape");
+  if (producer == nullptr || producer->input_size() != 2) return false;
+  maybe_unused_.push_back(producer->name());
+  node->set_input(0, producer->input(0));
+  node_map_.AddOutput(NodeName(producer->input(0)), node->name());
+  return true;
+}
+
+bool Simplifier::RemoveRedundantTranspose(NodeDef* node) {
+  if (node->op() != "Transpose" || node->input_size() != 2) return false;
+  Tensor perm;
+  if (!GetConstTensor(node->input(1), &perm) || perm.dims() != 1 ||
+      (perm.dtype() != DT_INT32 && perm.dtype() != DT_INT64)) {
+    return false;
+  }
+  std::vector<int64> perm_values(perm.NumElements());
+  for (int i = 0; i < perm_values.size(); ++i) {
+    perm_values[i] = perm.dtype() == DT_INT32 ? perm.vec<int32>()(i)
+                                              : perm.vec<int64>()(i);
+  }
+  bool is_identity = true;
+  for (int i = 0; i < perm_values.size(); ++i) {
+    is_identity &= perm_values[i] == i;
+  }
+  const DataType type = GetTypeAttr(*node, "T");
+  if (is_identity) {
+    ForwardToInput(node, node->input(0), type);
+    return true;
+  }
+
+  // The output dimension i of the pair is dimension
+  // producer_perm[perm[i]] of the producer's input.
+  NodeDef* producer = GetProducer(node->input(0), "Transpose");
+  Tensor producer_perm;
+  if (producer == nullptr || producer->input_size() != 2 ||
+      !GetConstTensor(producer->input(1), &producer_perm) ||
+      producer_perm.dims() != 1 ||
+      producer_perm.NumElements() != perm_values.size() ||
+      (producer_perm.dtype() != DT_INT32 &&
+       producer_perm.dtype() != DT_INT64)) {
+    return false;
+  }
+  for (int i = 0; i < perm_values.size(); ++i) {
+    const int64 p = perm_values[i];
+    if (p < 0 || p >= perm_values.size()) return false;
+    const int64 composed = producer_perm.dtype() == DT_INT32
+                               ? producer_perm.vec<int32>()(p)
+                               : producer_perm.vec<int64>()(p);
+    if (composed != i) return false;
+  }
+  ForwardToInput(node, producer->input(0), type);
+  return true;
+}
+
+bool Simplifier::HoistCommonFactor(NodeDef* node) {
+  if (node->op() != "Add" && node->op() != "AddN") return false;
+  const DataType type = GetTypeAttr(*node, "T");
+  std::vector<NodeDef*> muls;
+  std::vector<string> control_inputs;
+  for (const string& input : node->input()) {
+    if (input[0] == '^') {
+      control_inputs.push_back(input);
+      continue;
+    }
+    NodeDef* mul = GetProducer(input, "Mul");
+    if (mul == nullptr || mul->input_size() != 2 ||
+        GetTypeAttr(*mul, "T") != type || !HasSoleConsumer(*mul, *node)) {
+      return false;
+    }
+    muls.push_back(mul);
+  }
+  if (muls.size() < 2) return false;
+
+  // Look for a factor shared by all the products.
+  string common;
+  std::vector<string> factors;
+  for (int i = 0; i < 2 && common.empty(); ++i) {
+    const string candidate = muls[0]->input(i);
+    factors.clear();
+    for (const NodeDef* mul : muls) {
+      if (mul->input(0) == candidate) {
+        factors.push_back(mul->input(1));
+      } else if (mul->input(1) == candidate) {
+        factors.push_back(mul->input(0));
+      } else {
+        break;
+      }
+    }
+    if (factors.size() == muls.size()) common = candidate;
+  }
+  if (common.empty()) return false;
+
+  // Sum the other factors with Adds rather than an AddN, since they need
+  // not have the same shape.
+  const string prefix =
+      strings::StrCat(kArithmeticOptimizer, "/", node->name(), "/sum_");
+  string sum = factors[0];
+  for (int i = 1; i < factors.size(); ++i) {
+    NodeDef* add = AddNode(strings::StrCat(prefix, i), "Add", node->device());
+    (*add->mutable_attr())["T"].set_type(type);
+    add->add_input(sum);
+    add->add_input(factors[i]);
+    node_map_.AddOutput(NodeName(sum), add->name());
+    node_map_.AddOutput(NodeName(factors[i]), add->name());
+    sum = add->name();
+  }
+  for (const NodeDef* mul : muls) {
+    removed_nodes_.insert(mul->name());
+  }
+  node->set_op("Mul");
+  node->clear_input();
+  node->clear_attr();
+  (*node->mutable_attr())["T"].set_type(type);
+  node->add_input(common);
+  node->add_input(sum);
+  for (const string& input : control_inputs) {
+    node->add_input(input);
+  }
+  node_map_.AddOutput(NodeName(common), node->name());
+  node_map_.AddOutput(NodeName(sum), node->name());
+  return true;
+}
+
+bool Simplifier::GetCwiseStep(const NodeDef& node, CwiseStep* step) {
+  if (IsRemoved(node.name()) || GetTypeAttr(node, "T") != DT_FLOAT ||
+      !IsOnCpu(node)) {
+    return false;
+  }
+  if (IsFusableUnaryOp(node.op())) {
+    if (node.input_size() < 1 || node.input(0)[0] == '^') return false;
+    step->op = node.op() == "Inv" ? "Reciprocal" : node.op();
+    step->scalar = 0.0f;
+    step->input = node.input(0);
+    return true;
+  }
+  if (node.input_size() < 2 || node.input(1)[0] == '^') return false;
+  for (int i = 1; i >= 0; --i) {
+    Tensor scalar;
+    if (!GetConstTensor(node.input(i), &scalar) || scalar.dims() != 0 ||
+        scalar.dtype() != DT_FLOAT ||
+        !GetFusableBinaryStep(node.op(), i == 0, &step->op)) {
+      continue;
+    }
+    step->scalar = scalar.scalar<float>()();
+    step->input = node.input(1 - i);
+    return true;
+  }
+  return false;
+}
+
+NodeDef* Simplifier::GetChainPredecessor(const NodeDef& node) {
+  CwiseStep step;
+  CwiseStep predecessor_step;
+  if (!GetCwiseStep(node, &step)) return nullptr;
+  int position;
+  NodeDef* predecessor =
+      node_map_.GetNode(ParseNodeName(step.input, &position));
+  if (predecessor == nullptr || position != 0 ||
+      predecessor->device() != node.device() ||
+      !GetCwiseStep(*predecessor, &predecessor_step) ||
+      !HasSoleConsumer(*predecessor, node)) {
+    return nullptr;
+  }
+  return predecessor;
+}
+
+bool Simplifier::FuseCwiseChain(NodeDef* end) {
+  CwiseStep step;
+  if (!GetCwiseStep(*end, &step)) return false;
+  // Only start from the last node of a chain.
+  const std::vector<NodeDef*> consumers = GetConsumers(end->name());
+  if (consumers.size() == 1 && GetChainPredecessor(*consumers[0]) == end) {
+    return false;
+  }
+  std::vector<NodeDef*> chain = {end};
+  for (NodeDef* node = GetChainPredecessor(*end); node != nullptr;
+       node = GetChainPredecessor(*node)) {
+    chain.push_back(node);
+  }
+  if (chain.size() < 2) return false;
+  std::reverse(chain.begin(), chain.end());
+
+  AttrValue ops;
+  AttrValue scalars;
+  string input;
+  std::vector<string> control_inputs;
+  for (NodeDef* node : chain) {
+    GetCwiseStep(*node, &step);
+    if (input.empty()) input = step.input;
+    ops.mutable_list()->add_s(step.op);
+    scalars.mutable_list()->add_f(step.scalar);
+    for (const string& node_input : node->input()) {
+      if (node_input[0] == '^') {
+        if (std::find(control_inputs.begin(), control_inputs.end(),
+                      node_input) == control_inputs.end()) {
+          control_inputs.push_back(node_input);
+        }
+      } else if (node_input != step.input) {
+        maybe_unused_.push_back(NodeName(node_input));
+      }
+    }
+    if (node != end) removed_nodes_.insert(node->name());
+  }
+
+  end->set_op("_FusedCwise");
+  end->clear_input();
+  end->clear_attr();
+  end->add_input(input);
+  for (const string& control_input : control_inputs) {
+    end->add_input(control_input);
+  }
+  (*end->mutable_attr())["T"].set_type(DT_FLOAT);
+  (*end->mutable_attr())["ops"] = ops;
+  (*end->mutable_attr())["scalars"] = scalars;
+  node_map_.AddOutput(NodeName(input), end->name());
+  return true;
+}
+
+NodeDef* Simplifier::AddNode(const string& name, const string& op,
+                             const string& device) {
+  NodeDef* node = graph_->add_node();
+  node->set_name(name);
+  node->set_op(op);
+  node->set_device(device);
+  node_map_.AddNode(name, node);
+  return node;
+}
+
+void Simplifier::RemoveDeadNodes() {
+  // Only nodes of these ops are removed when they lose their last consumer.
+  static const std::unordered_set<string>* const kRemovableOps =
+      new std::unordered_set<string>(
+          {"Const", "Identity", "Cast", "Reshape", "Transpose"});
+  std::unordered_map<string, int> num_consumers;
+  for (const NodeDef& node : graph_->node()) {
+    if (IsRemoved(node.name())) continue;
+    for (const string& input : node.input()) {
+      ++num_consumers[NodeName(input)];
+    }
+  }
+  while (!maybe_unused_.empty()) {
+    const string name = maybe_unused_.back();
+    maybe_unused_.pop_back();
+    const NodeDef* node = node_map_.GetNode(name);
+    if (node == nullptr || IsRemoved(name) || num_consumers[name] > 0 ||
+        IsPreserved(*node) || kRemovableOps->count(node->op()) == 0) {
+      continue;
+    }
+    removed_nodes_.insert(name);
+    for (const string& input : node->input()) {
+      --num_consumers[NodeName(input)];
+      maybe_unused_.push_back(NodeName(input));
+    }
+  }
+
+  GraphDef pruned;
+  for (NodeDef& node : *graph_->mutable_node()) {
+    if (IsRemoved(node.name())) continue;
+    pruned.add_node()->Swap(&node);
+  }
+  graph_->mutable_node()->Swap(pruned.mutable_node());
+}
+
+int Simplifier::Run() {
+  int num_rewrites = 0;
+  // A rewrite can expose another one downstream, e.g. a Cast feeding a
+  // Transpose pair, so iterate until nothing changes. New nodes are only
+  // appended, which keeps the node pointers held by node_map_ valid.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < graph_->node_size(); ++i) {
+      NodeDef* node = graph_->mutable_node(i);
+      if (IsRemoved(node->name()) || HasControlInputs(*node)) continue;
+      if (RemoveRedundantCast(node) || RemoveRedundantReshape(node) ||
+          RemoveRedundantTranspose(node)) {
+        ++num_rewrites;
+        changed = true;
+      }
+    }
+    for (int i = 0; i < graph_->node_size(); ++i) {
+      NodeDef* node = graph_->mutable_node(i);
+      if (!IsRemoved(node->name()) && HoistCommonFactor(node)) {
+        ++num_rewrites;
+        changed = true;
+      }
+    }
+  }
+  // Fuse last, so that the chains see the simplified graph.
+  for (int i = 0; i < graph_->node_size(); ++i) {
+    NodeDef* node = graph_->mutable_node(i);
+    if (FuseCwiseChain(node)) ++num_rewrites;
+  }
+  if (num_rewrites > 0) RemoveDeadNodes();
+  return num_rewrites;
+}
+
+}  // namespace
+
+Status ArithmeticOptimizer::Optimize(Cluster* cluster,
+                                     const GrapplerItem& item,
+                                     GraphDef* output) {
+  *output = item.graph;
+  Simplifier simplifier(item, output);
+  const int num_rewrites = simplifier.Run();
+  VLOG(1) << "Applied " << num_rewrites
+          << " arithmetic simplifications; graph size "
+          << item.graph.node_size() << " -> " << output->node_size();
+  return Status::OK();
+}
+
+void ArithmeticOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                   const GraphDef& optimize_output,
+                                   double result) {
+  // Nothing to do for ArithmeticOptimizer.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
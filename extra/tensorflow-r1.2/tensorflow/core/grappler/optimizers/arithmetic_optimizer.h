@@ -0,0 +1,56 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_ARITHMETIC_OPTIMIZER_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_ARITHMETIC_OPTIMIZER_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+const char kArithmeticOptimizer[] = "ArithmeticOptimizer";
+
+// Simplifies arithmetic in a graph:
+//  - Cast to the same type, and Cast(Cast(x)) that converts x to a wider
+//    type and back, are removed.
+//  - Reshape(Reshape(x, s1), s2) becomes Reshape(x, s2).
+//  - Transpose with the identity permutation, and pairs of Transposes whose
+//    permutations cancel out, are removed.
+//  - Common factors are hoisted out of sums: Add(Mul(x, y), Mul(x, z))
+//    becomes Mul(x, Add(y, z)), and likewise for AddN.
+//  - Chains of float element-wise ops on the CPU, unary or with a scalar
+//    constant operand, are fused into a single _FusedCwise node that
+//    evaluates them in one pass over the data.
+// Rewritten nodes keep their names, and nodes that are fetched, fed or read
+// by more than one consumer are never removed or fused away.
+class ArithmeticOptimizer : public GraphOptimizer {
+ public:
+  ArithmeticOptimizer() {}
+  ~ArithmeticOptimizer() override {}
+
+  string name() const override { return "arithmetic_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* output) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimize_output, double result) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_ARITHMETIC_OPTIMIZER_H_
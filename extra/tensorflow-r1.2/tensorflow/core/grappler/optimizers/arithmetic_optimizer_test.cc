@@ -0,0 +1,246 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class ArithmeticOptimizerTest : public ::testing::Test {
+ protected:
+  std::vector<Tensor> EvaluateNodes(const GraphDef& graph,
+                                    const std::vector<string>& fetch) {
+    SessionOptions options;
+    std::unique_ptr<tensorflow::Session> session(NewSession(options));
+    TF_CHECK_OK(session->Create(graph));
+    RunOptions run_options;
+    std::vector<Tensor> output_tensors;
+    TF_CHECK_OK(
+        session->Run(run_options, {}, fetch, fetch, &output_tensors, nullptr));
+    TF_CHECK_OK(session->Close());
+    return output_tensors;
+  }
+
+  Output RandomConst(const Scope& s, const string& name,
+                     const TensorShape& shape) {
+    Tensor t(DT_FLOAT, shape);
+    t.flat<float>().setRandom();
+    return ops::Const(s.WithOpName(name), Input::Initializer(t));
+  }
+
+  const NodeDef* FindNode(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+
+  int CountOps(const GraphDef& graph, const string& op) {
+    int count = 0;
+    for (const NodeDef& node : graph.node()) {
+      if (node.op() == op) ++count;
+    }
+    return count;
+  }
+
+  // Optimizes the graph of `s` with `fetch`, and checks that the fetched
+  // values do not change.
+  GraphDef OptimizeAndCompare(const Scope& s,
+                              const std::vector<string>& fetch) {
+    GrapplerItem item;
+    item.fetch = fetch;
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    ArithmeticOptimizer optimizer;
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+    std::vector<Tensor> expected = EvaluateNodes(item.graph, item.fetch);
+    std::vector<Tensor> actual = EvaluateNodes(output, item.fetch);
+    EXPECT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      if (expected[i].dtype() == DT_FLOAT) {
+        test::ExpectTensorNear<float>(expected[i], actual[i], 1e-5);
+      } else {
+        test::ExpectTensorEqual<int32>(expected[i], actual[i]);
+      }
+    }
+    return output;
+  }
+};
+
+TEST_F(ArithmeticOptimizerTest, RemovesRedundantCasts) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {2, 3});
+  Output same = ops::Cast(s.WithOpName("same"), x, DT_FLOAT);
+  Output out = ops::Identity(s.WithOpName("out"), same);
+  Output i = ops::Const(s.WithOpName("i"), {1, 2, 3});
+  Output wide = ops::Cast(s.WithOpName("wide"), i, DT_INT64);
+  Output narrow = ops::Cast(s.WithOpName("narrow"), wide, DT_INT32);
+  Output out_int = ops::Identity(s.WithOpName("out_int"), narrow);
+  // Casting to float and back changes large integers, so it stays.
+  Output to_float = ops::Cast(s.WithOpName("to_float"), i, DT_FLOAT);
+  Output back = ops::Cast(s.WithOpName("back"), to_float, DT_INT32);
+
+  GraphDef output = OptimizeAndCompare(s, {"out", "out_int", "back"});
+  EXPECT_EQ(2, CountOps(output, "Cast"));
+  EXPECT_EQ(nullptr, FindNode(output, "same"));
+  EXPECT_EQ(nullptr, FindNode(output, "wide"));
+  EXPECT_EQ(nullptr, FindNode(output, "narrow"));
+  EXPECT_EQ("x", FindNode(output, "out")->input(0));
+  EXPECT_EQ("i", FindNode(output, "out_int")->input(0));
+}
+
+TEST_F(ArithmeticOptimizerTest, CollapsesReshapes) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {2, 3, 4});
+  Output r1 = ops::Reshape(s.WithOpName("r1"), x, {6, 4});
+  Output r2 = ops::Reshape(s.WithOpName("r2"), r1, {4, 6});
+  Output r3 = ops::Reshape(s.WithOpName("r3"), r2, {24});
+
+  GraphDef output = OptimizeAndCompare(s, {"r3"});
+  EXPECT_EQ(1, CountOps(output, "Reshape"));
+  EXPECT_EQ("x", FindNode(output, "r3")->input(0));
+}
+
+TEST_F(ArithmeticOptimizerTest, RemovesTransposePairs) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {2, 3, 4, 5});
+  Output to_nchw = ops::Transpose(s.WithOpName("to_nchw"), x, {0, 3, 1, 2});
+  Output to_nhwc =
+      ops::Transpose(s.WithOpName("to_nhwc"), to_nchw, {0, 2, 3, 1});
+  Output out = ops::Relu(s.WithOpName("out"), to_nhwc);
+  Output other = ops::Transpose(s.WithOpName("other"), x, {0, 2, 1, 3});
+  Output not_inverse =
+      ops::Transpose(s.WithOpName("not_inverse"), other, {0, 2, 3, 1});
+
+  GraphDef output = OptimizeAndCompare(s, {"out", "not_inverse"});
+  EXPECT_EQ(2, CountOps(output, "Transpose"));
+  EXPECT_EQ(nullptr, FindNode(output, "to_nchw"));
+  EXPECT_EQ(nullptr, FindNode(output, "to_nhwc"));
+  EXPECT_EQ("x", FindNode(output, "out")->input(0));
+}
+
+TEST_F(ArithmeticOptimizerTest, KeepsFetchedNodes) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {2, 3});
+  Output t = ops::Transpose(s.WithOpName("t"), x, {0, 1});
+
+  GraphDef output = OptimizeAndCompare(s, {"t"});
+  const NodeDef* t_node = FindNode(output, "t");
+  ASSERT_NE(nullptr, t_node);
+  EXPECT_EQ("Identity", t_node->op());
+  EXPECT_EQ("x", t_node->input(0));
+}
+
+TEST_F(ArithmeticOptimizerTest, HoistsCommonFactor) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {3, 4});
+  Output y = RandomConst(s, "y", {3, 4});
+  Output z = RandomConst(s, "z", {4});
+  Output w = RandomConst(s, "w", {});
+  Output xy = ops::Mul(s.WithOpName("xy"), x, y);
+  Output zx = ops::Mul(s.WithOpName("zx"), z, x);
+  Output xw = ops::Mul(s.WithOpName("xw"), x, w);
+  Output add_n = ops::AddN(s.WithOpName("add_n"), {xy, zx, xw});
+
+  GraphDef output = OptimizeAndCompare(s, {"add_n"});
+  EXPECT_EQ(1, CountOps(output, "Mul"));
+  EXPECT_EQ(0, CountOps(output, "AddN"));
+  const NodeDef* node = FindNode(output, "add_n");
+  ASSERT_NE(nullptr, node);
+  EXPECT_EQ("Mul", node->op());
+  EXPECT_EQ("x", node->input(0));
+  EXPECT_EQ("ArithmeticOptimizer/add_n/sum_2", node->input(1));
+  const NodeDef* sum = FindNode(output, "ArithmeticOptimizer/add_n/sum_1");
+  ASSERT_NE(nullptr, sum);
+  EXPECT_EQ("y", sum->input(0));
+  EXPECT_EQ("z", sum->input(1));
+}
+
+TEST_F(ArithmeticOptimizerTest, KeepsSharedProducts) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {3, 4});
+  Output y = RandomConst(s, "y", {3, 4});
+  Output z = RandomConst(s, "z", {3, 4});
+  Output xy = ops::Mul(s.WithOpName("xy"), x, y);
+  Output xz = ops::Mul(s.WithOpName("xz"), x, z);
+  Output add = ops::Add(s.WithOpName("add"), xy, xz);
+  Output add_n = ops::AddN(s.WithOpName("add_n"), {xy, xz});
+
+  // The products are read by both sums, so neither can be rewritten.
+  GraphDef output = OptimizeAndCompare(s, {"add", "add_n"});
+  EXPECT_EQ(2, CountOps(output, "Mul"));
+  EXPECT_EQ("Add", FindNode(output, "add")->op());
+  EXPECT_EQ("AddN", FindNode(output, "add_n")->op());
+}
+
+TEST_F(ArithmeticOptimizerTest, FusesElementwiseChain) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {4, 100});
+  Output scaled = ops::Mul(s.WithOpName("scaled"), x, 0.5f);
+  Output shifted = ops::Sub(s.WithOpName("shifted"), 1.0f, scaled);
+  Output relu = ops::Relu(s.WithOpName("relu"), shifted);
+  Output tanh = ops::Tanh(s.WithOpName("tanh"), relu);
+  Output out = ops::Add(s.WithOpName("out"), tanh, x);
+
+  GraphDef output = OptimizeAndCompare(s, {"out"});
+  const NodeDef* fused = FindNode(output, "tanh");
+  ASSERT_NE(nullptr, fused);
+  EXPECT_EQ("_FusedCwise", fused->op());
+  ASSERT_EQ(1, fused->input_size());
+  EXPECT_EQ("x", fused->input(0));
+  const auto& ops = fused->attr().at("ops").list();
+  ASSERT_EQ(4, ops.s_size());
+  EXPECT_EQ("Mul", ops.s(0));
+  EXPECT_EQ("RSub", ops.s(1));
+  EXPECT_EQ("Relu", ops.s(2));
+  EXPECT_EQ("Tanh", ops.s(3));
+  EXPECT_EQ(1.0f, fused->attr().at("scalars").list().f(1));
+  EXPECT_EQ(nullptr, FindNode(output, "scaled"));
+  EXPECT_EQ(nullptr, FindNode(output, "relu"));
+  // Only x is left; the scalar constants were folded into the attributes.
+  EXPECT_EQ(1, CountOps(output, "Const"));
+}
+
+TEST_F(ArithmeticOptimizerTest, ChainsStopAtSharedOrFetchedNodes) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = RandomConst(s, "x", {100});
+  Output a = ops::Exp(s.WithOpName("a"), x);
+  Output b = ops::Neg(s.WithOpName("b"), a);
+  Output c = ops::Relu(s.WithOpName("c"), b);
+  Output d = ops::Sqrt(s.WithOpName("d"), c);
+  Output e = ops::Sigmoid(s.WithOpName("e"), b);
+  Output f = ops::Square(s.WithOpName("f"), e);
+  // a has one consumer but is fetched; b has two consumers.
+  GraphDef output = OptimizeAndCompare(s, {"a", "d", "f"});
+  EXPECT_EQ("Exp", FindNode(output, "a")->op());
+  EXPECT_EQ("Neg", FindNode(output, "b")->op());
+  EXPECT_EQ("_FusedCwise", FindNode(output, "d")->op());
+  EXPECT_EQ("b", FindNode(output, "d")->input(0));
+  EXPECT_EQ("_FusedCwise", FindNode(output, "f")->op());
+  EXPECT_EQ("b", FindNode(output, "f")->input(0));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
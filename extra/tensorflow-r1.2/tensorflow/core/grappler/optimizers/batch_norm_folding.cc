@@ -0,0 +1,484 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/batch_norm_folding.h"
+
+#include <cmath>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+bool IsFloatNhwc(const NodeDef& node) {
+  const auto& attr = node.attr();
+  if (attr.count("T") == 0 || attr.at("T").type() != DT_FLOAT) return false;
+  return attr.count("data_format") == 0 ||
+         attr.at("data_format").s() == "NHWC";
+}
+
+bool GetBoolAttr(const NodeDef& node, const string& name, bool default_value) {
+  const auto& attr = node.attr();
+  return attr.count(name) == 0 ? default_value : attr.at(name).b();
+}
+
+// The nodes of one foldable pattern. The result of the pattern is
+//   (x * weights + bias) * scale + offset
+// with x * weights computed by `weights_op`, the bias added by `bias_add` and
+// the affine transformation applied by `end` (and `mul`).
+struct Pattern {
+  NodeDef* weights_op = nullptr;  // Conv2D or MatMul.
+  NodeDef* bias_add = nullptr;    // Optional BiasAdd between weights_op and
+                                  // the affine transformation.
+  NodeDef* mul = nullptr;         // Mul feeding an Add or BiasAdd `end`.
+  NodeDef* end = nullptr;
+
+  string x;  // The input of the affine transformation.
+  // Inputs holding the parameters of the affine transformation. For a
+  // FusedBatchNorm, all four are set; otherwise mean and variance are empty
+  // and either of scale and offset may be.
+  string scale;
+  string offset;
+  string mean;
+  string variance;
+  float epsilon = 0.0f;
+};
+
+class Folder {
+ public:
+  Folder(const GrapplerItem& item, GraphDef* graph)
+      : graph_(graph), node_map_(graph) {
+    for (const auto& node : item.fetch) {
+      nodes_to_preserve_.insert(NodeName(node));
+      if (NodePosition(node) > 0) {
+        secondary_output_fetched_.insert(NodeName(node));
+      }
+    }
+    for (const auto& node : item.init_ops) {
+      nodes_to_preserve_.insert(NodeName(node));
+    }
+  }
+
+  // Folds all matching patterns in the graph and removes the nodes that
+  // become unused. Returns the number of folded patterns.
+  int Run();
+
+ private:
+  bool IsPreserved(const NodeDef& node) const {
+    return nodes_to_preserve_.find(node.name()) != nodes_to_preserve_.end();
+  }
+
+  // Returns the Const node that produces `input`, looking through Identity
+  // nodes (such as the reads of frozen variables), or nullptr.
+  const NodeDef* GetConst(const string& input);
+
+  // Reads the float constant produced by `input` into `values` as a vector of
+  // `channels` elements. Scalars are broadcast; other shapes must have
+  // `channels` elements in their last dimension, at most `max_rank`
+  // dimensions and no other non-trivial dimension.
+  bool GetChannelVector(const string& input, int64 channels, int max_rank,
+                        std::vector<float>* values);
+
+  // Returns true if `consumer` is the only consumer of `producer`, reads only
+  // output 0 of it, and `producer` does not have to be preserved.
+  bool HasSoleConsumer(const NodeDef& producer, const NodeDef& consumer);
+
+  bool MatchAffine(NodeDef* end, Pattern* pattern);
+  bool MatchWeights(Pattern* pattern);
+  bool Fold(NodeDef* end);
+
+  NodeDef* AddConst(const string& name, const string& device,
+                    const Tensor& value);
+
+  // Removes the nodes that were folded away, as well as the constants that
+  // they were the only consumers of.
+  void RemoveFoldedNodes();
+
+  GraphDef* graph_;
+  NodeMap node_map_;
+  std::unordered_set<string> nodes_to_preserve_;
+  std::unordered_set<string> secondary_output_fetched_;
+  std::unordered_set<string> folded_nodes_;
+  // Const and Identity nodes that may have lost their last consumer.
+  std::vector<string> maybe_unused_;
+};
+
+const NodeDef* Folder::GetConst(const string& input) {
+  const NodeDef* node = node_map_.GetNode(NodeName(input));
+  while (node != nullptr && node->op() == "Identity" &&
+         node->input_size() > 0) {
+    node = node_map_.GetNode(NodeName(node->input(0)));
+  }
+  if (node == nullptr || node->op() != "Const") return nullptr;
+  return node;
+}
+
+bool Folder::GetChannelVector(const string& input, int64 channels,
+                              int max_rank, std::vector<float>* values) {
+  const NodeDef* node = GetConst(input);
+  if (node == nullptr || node->attr().count("value") == 0) return false;
+  Tensor tensor;
+  if (!tensor.FromProto(node->attr().at("value").tensor()) ||
+      tensor.dtype() != DT_FLOAT || tensor.dims() > max_rank) {
+    return false;
+  }
+  const auto flat = tensor.flat<float>();
+  if (tensor.NumElements() == 1 && tensor.dims() <= 1) {
+    values->assign(channels, flat(0));
+    return true;
+  }
+  if (tensor.dims() == 0 || tensor.dim_size(tensor.dims() - 1) != channels ||
+      tensor.NumElements() != channels) {
+    return false;
+  }
+  values->assign(flat.data(), flat.data() + channels);
+  return true;
+}
+
+bool Folder::HasSoleConsumer(const NodeDef& producer,
+                             const NodeDef& consumer) {
+  if (IsPreserved(producer)) return false;
+  const std::set<NodeDef*> outputs = node_map_.GetOutputs(producer.name());
+  if (outputs.size() != 1 || *outputs.begin() != &consumer) return false;
+  int num_reads = 0;
+  for (const string& input : consumer.input()) {
+    int position;
+    if (ParseNodeName(input, &position) != producer.name()) continue;
+    if (position != 0) return false;
+    ++num_reads;
+  }
+  return num_reads == 1;
+}
+
+bool Folder::MatchAffine(NodeDef* end, Pattern* pattern) {
+  pattern->end = end;
+  if (end->op() == "FusedBatchNorm") {
+    if (end->input_size() < 5 || !IsFloatNhwc(*end) ||
+        GetBoolAttr(*end, "is_training", true) ||
+        secondary_output_fetched_.count(end->name()) > 0) {
+      return false;
+    }
+    // Only the normalized output may be used.
+    for (const NodeDef* consumer : node_map_.GetOutputs(end->name())) {
+      for (const string& input : consumer->input()) {
+        int position;
+        if (ParseNodeName(input, &position) == end->name() && position > 0) {
+          return false;
+        }
+      }
+    }
+    pattern->x = end->input(0);
+    pattern->scale = end->input(1);
+    pattern->offset = end->input(2);
+    pattern->mean = end->input(3);
+    pattern->variance = end->input(4);
+    pattern->epsilon = end->attr().count("epsilon") > 0
+                           ? end->attr().at("epsilon").f()
+                           : 0.0001f;
+    return true;
+  }
+
+  if (end->op() == "Add" || end->op() == "BiasAdd") {
+    if (end->input_size() < 2 || !IsFloatNhwc(*end)) return false;
+    // BiasAdd takes the bias as its second input; Add takes it as either.
+    const int num_candidates = end->op() == "Add" ? 2 : 1;
+    for (int i = 0; i < num_candidates; ++i) {
+      const string& offset = end->input(1 - i);
+      NodeDef* mul = node_map_.GetNode(NodeName(end->input(i)));
+      if (GetConst(offset) == nullptr || mul == nullptr ||
+          mul->op() != "Mul" || !IsFloatNhwc(*mul) ||
+          !HasSoleConsumer(*mul, *end)) {
+        continue;
+      }
+      for (int j = 0; j < 2; ++j) {
+        if (GetConst(mul->input(1 - j)) == nullptr) continue;
+        pattern->mul = mul;
+        pattern->x = mul->input(j);
+        pattern->scale = mul->input(1 - j);
+        pattern->offset = offset;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (end->op() == "Mul") {
+    if (end->input_size() < 2 || !IsFloatNhwc(*end)) return false;
+    // Leave Add(Mul(x, scale), offset) to be folded as a whole.
+    const std::set<NodeDef*> outputs = node_map_.GetOutputs(end->name());
+    Pattern add_pattern;
+    if (outputs.size() == 1 && (*outputs.begin())->op() != "Mul" &&
+        MatchAffine(*outputs.begin(), &add_pattern) &&
+        add_pattern.mul == end) {
+      return false;
+    }
+    for (int j = 0; j < 2; ++j) {
+      if (GetConst(end->input(1 - j)) == nullptr) continue;
+      pattern->x = end->input(j);
+      pattern->scale = end->input(1 - j);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Folder::MatchWeights(Pattern* pattern) {
+  NodeDef* consumer = pattern->mul != nullptr ? pattern->mul : pattern->end;
+  NodeDef* node = node_map_.GetNode(NodeName(pattern->x));
+  if (node == nullptr || !HasSoleConsumer(*node, *consumer)) return false;
+  if (node->op() == "BiasAdd") {
+    if (node->input_size() < 2 || !IsFloatNhwc(*node) ||
+        GetConst(node->input(1)) == nullptr) {
+      return false;
+    }
+    pattern->bias_add = node;
+    consumer = node;
+    node = node_map_.GetNode(NodeName(node->input(0)));
+    if (node == nullptr || !HasSoleConsumer(*node, *consumer)) return false;
+  }
+  if (node->op() != "Conv2D" && node->op() != "MatMul") return false;
+  if (node->input_size() < 2 || !IsFloatNhwc(*node) ||
+      GetConst(node->input(1)) == nullptr) {
+    return false;
+  }
+  // FusedBatchNorm only accepts 4-D inputs.
+  if (node->op() == "MatMul" && pattern->end->op() == "FusedBatchNorm") {
+    return false;
+  }
+  pattern->weights_op = node;
+  return true;
+}
+
+NodeDef* Folder::AddConst(const string& name, const string& device,
+                          const Tensor& value) {
+  NodeDef* node = graph_->add_node();
+  node->set_name(name);
+  node->set_op("Const");
+  node->set_device(device);
+  (*node->mutable_attr())["dtype"].set_type(value.dtype());
+  value.AsProtoTensorContent(
+      (*node->mutable_attr())["value"].mutable_tensor());
+  node_map_.AddNode(name, node);
+  return node;
+}
+
+bool Folder::Fold(NodeDef* end) {
+  Pattern pattern;
+  if (!MatchAffine(end, &pattern) || !MatchWeights(&pattern)) return false;
+
+  NodeDef* weights_op = pattern.weights_op;
+  Tensor weights;
+  const NodeDef* weights_const = GetConst(weights_op->input(1));
+  if (weights_const->attr().count("value") == 0 ||
+      !weights.FromProto(weights_const->attr().at("value").tensor()) ||
+      weights.dtype() != DT_FLOAT) {
+    return false;
+  }
+  const bool is_conv = weights_op->op() == "Conv2D";
+  const bool transpose_b =
+      !is_conv && GetBoolAttr(*weights_op, "transpose_b", false);
+  if (weights.dims() != (is_conv ? 4 : 2)) return false;
+  // Conv2D filters are laid out as [rows, cols, in_depth, out_depth], MatMul
+  // weights as [in_depth, out_depth] or the transpose.
+  const int64 channels = weights.dim_size(transpose_b ? 0 : weights.dims() - 1);
+  const int max_rank = is_conv ? 4 : 2;
+
+  std::vector<float> scale(channels, 1.0f);
+  std::vector<float> offset(channels, 0.0f);
+  std::vector<float> bias(channels, 0.0f);
+  if (!pattern.scale.empty() &&
+      !GetChannelVector(pattern.scale, channels, max_rank, &scale)) {
+    return false;
+  }
+  if (!pattern.offset.empty() &&
+      !GetChannelVector(pattern.offset, channels, max_rank, &offset)) {
+    return false;
+  }
+  if (pattern.bias_add != nullptr &&
+      !GetChannelVector(pattern.bias_add->input(1), channels, 1, &bias)) {
+    return false;
+  }
+  if (!pattern.mean.empty()) {
+    std::vector<float> mean;
+    std::vector<float> variance;
+    if (!GetChannelVector(pattern.mean, channels, 1, &mean) ||
+        !GetChannelVector(pattern.variance, channels, 1, &variance)) {
+      return false;
+    }
+    // y = (x - mean) * scale / sqrt(variance + epsilon) + offset.
+    for (int64 c = 0; c < channels; ++c) {
+      scale[c] /= std::sqrt(variance[c] + pattern.epsilon);
+      offset[c] -= mean[c] * scale[c];
+    }
+  }
+
+  // Everything has been checked; rewrite the graph.
+  auto w = weights.flat<float>();
+  const int64 inner = weights.NumElements() / channels;
+  for (int64 i = 0; i < w.size(); ++i) {
+    w(i) *= scale[transpose_b ? i / inner : i % channels];
+  }
+  const bool has_bias = pattern.bias_add != nullptr || !pattern.offset.empty();
+  Tensor new_bias(DT_FLOAT, TensorShape({channels}));
+  auto b = new_bias.flat<float>();
+  for (int64 c = 0; c < channels; ++c) {
+    b(c) = bias[c] * scale[c] + offset[c];
+  }
+
+  const string prefix =
+      strings::StrCat(kBatchNormFoldingConst, "/", end->name());
+  maybe_unused_.push_back(NodeName(weights_op->input(1)));
+  NodeDef* new_weights =
+      AddConst(strings::StrCat(prefix, "/weights"), weights_op->device(),
+               weights);
+  weights_op->set_input(1, new_weights->name());
+  node_map_.AddOutput(new_weights->name(), weights_op->name());
+
+  // Collect the control dependencies of the nodes that are folded away.
+  std::vector<string> control_inputs;
+  for (const NodeDef* node : {pattern.bias_add, pattern.mul, end}) {
+    if (node == nullptr) continue;
+    for (const string& input : node->input()) {
+      if (!input.empty() && input[0] == '^') {
+        control_inputs.push_back(input);
+      } else if (NodeName(input) != weights_op->name() &&
+                 (pattern.bias_add == nullptr ||
+                  NodeName(input) != pattern.bias_add->name()) &&
+                 (pattern.mul == nullptr ||
+                  NodeName(input) != pattern.mul->name())) {
+        maybe_unused_.push_back(NodeName(input));
+      }
+    }
+  }
+  for (const NodeDef* node : {pattern.bias_add, pattern.mul}) {
+    if (node == nullptr) continue;
+    folded_nodes_.insert(node->name());
+  }
+  node_map_.UpdateOutput(
+      weights_op->name(),
+      pattern.bias_add != nullptr
+          ? pattern.bias_add->name()
+          : (pattern.mul != nullptr ? pattern.mul->name() : end->name()),
+      end->name());
+
+  // The last node keeps its name, so that its consumers and fetches still
+  // find it, and becomes weights_op + bias.
+  const string device = end->device();
+  end->clear_input();
+  end->clear_attr();
+  end->add_input(weights_op->name());
+  (*end->mutable_attr())["T"].set_type(DT_FLOAT);
+  if (has_bias) {
+    NodeDef* bias_const =
+        AddConst(strings::StrCat(prefix, "/bias"), device, new_bias);
+    end->set_op("BiasAdd");
+    end->add_input(bias_const->name());
+    (*end->mutable_attr())["data_format"].set_s("NHWC");
+    node_map_.AddOutput(bias_const->name(), end->name());
+  } else {
+    end->set_op("Identity");
+  }
+  for (const string& input : control_inputs) {
+    end->add_input(input);
+  }
+  return true;
+}
+
+void Folder::RemoveFoldedNodes() {
+  std::unordered_map<string, int> num_consumers;
+  for (const NodeDef& node : graph_->node()) {
+    if (folded_nodes_.count(node.name()) > 0) continue;
+    for (const string& input : node.input()) {
+      ++num_consumers[NodeName(input)];
+    }
+  }
+  // Removing an Identity may make the Const it reads unused in turn.
+  while (!maybe_unused_.empty()) {
+    const string name = maybe_unused_.back();
+    maybe_unused_.pop_back();
+    const NodeDef* node = node_map_.GetNode(name);
+    if (node == nullptr || folded_nodes_.count(name) > 0 ||
+        num_consumers[name] > 0 || IsPreserved(*node) ||
+        (node->op() != "Const" && node->op() != "Identity")) {
+      continue;
+    }
+    folded_nodes_.insert(name);
+    for (const string& input : node->input()) {
+      --num_consumers[NodeName(input)];
+      maybe_unused_.push_back(NodeName(input));
+    }
+  }
+
+  GraphDef pruned;
+  for (NodeDef& node : *graph_->mutable_node()) {
+    if (folded_nodes_.count(node.name()) > 0) continue;
+    pruned.add_node()->Swap(&node);
+  }
+  graph_->mutable_node()->Swap(pruned.mutable_node());
+}
+
+int Folder::Run() {
+  int num_folded = 0;
+  // Folding one pattern can expose another one downstream, e.g. a Mul that
+  // follows a FusedBatchNorm, so iterate until nothing changes. New nodes are
+  // only appended, which keeps the node pointers held by node_map_ valid.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < graph_->node_size(); ++i) {
+      NodeDef* node = graph_->mutable_node(i);
+      if (folded_nodes_.count(node->name()) > 0) continue;
+      if (Fold(node)) {
+        ++num_folded;
+        changed = true;
+      }
+    }
+  }
+  if (num_folded > 0) RemoveFoldedNodes();
+  return num_folded;
+}
+
+}  // namespace
+
+Status BatchNormFolding::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                  GraphDef* output) {
+  *output = item.graph;
+  Folder folder(item, output);
+  const int num_folded = folder.Run();
+  VLOG(1) << "Folded " << num_folded << " batch normalizations; graph size "
+          << item.graph.node_size() << " -> " << output->node_size();
+  return Status::OK();
+}
+
+void BatchNormFolding::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                const GraphDef& optimize_output,
+                                double result) {
+  // Nothing to do for BatchNormFolding.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,57 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_BATCH_NORM_FOLDING_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_BATCH_NORM_FOLDING_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+const char kBatchNormFoldingConst[] = "BatchNormFolding";
+
+// Folds per-channel affine transformations with constant parameters into the
+// constant weights of the Conv2D or MatMul that feeds them, for inference
+// graphs whose variables have been frozen into constants. The folded
+// patterns are
+//
+//   FusedBatchNorm(x, scale, offset, mean, variance) with is_training=false,
+//   Add(Mul(x, scale), offset) or BiasAdd(Mul(x, scale), offset),
+//   Mul(x, scale),
+//
+// where x is Conv2D(input, weights) or MatMul(input, weights), optionally
+// followed by BiasAdd(x, bias). The weights and bias are rescaled and the
+// pattern is replaced by a single BiasAdd (or Identity) that keeps the name
+// of the last node, so fetches are unaffected. Intermediate results that are
+// fetched or consumed elsewhere block the rewrite.
+class BatchNormFolding : public GraphOptimizer {
+ public:
+  BatchNormFolding() {}
+  ~BatchNormFolding() override {}
+
+  string name() const override { return "batch_norm_folding"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* output) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimize_output, double result) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_BATCH_NORM_FOLDING_H_
@@ -0,0 +1,226 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/batch_norm_folding.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class BatchNormFoldingTest : public ::testing::Test {
+ protected:
+  std::vector<Tensor> EvaluateNodes(const GraphDef& graph,
+                                    const std::vector<string>& fetch) {
+    SessionOptions options;
+    std::unique_ptr<tensorflow::Session> session(NewSession(options));
+    TF_CHECK_OK(session->Create(graph));
+    RunOptions run_options;
+    std::vector<Tensor> output_tensors;
+    TF_CHECK_OK(
+        session->Run(run_options, {}, fetch, fetch, &output_tensors, nullptr));
+    TF_CHECK_OK(session->Close());
+    return output_tensors;
+  }
+
+  // Returns a constant with values in [low, low + 1).
+  Output RandomConst(const Scope& s, const string& name,
+                     const TensorShape& shape, float low) {
+    Tensor t(DT_FLOAT, shape);
+    t.flat<float>().setRandom();
+    t.flat<float>() = t.flat<float>() + low;
+    return ops::Const(s.WithOpName(name), Input::Initializer(t));
+  }
+
+  Output BatchNorm(const Scope& s, Input x, int channels) {
+    TensorShape shape({channels});
+    return ops::FusedBatchNorm(s.WithOpName("bn"), x,
+                               RandomConst(s, "scale", shape, 0.5f),
+                               RandomConst(s, "offset", shape, -0.5f),
+                               RandomConst(s, "mean", shape, -0.5f),
+                               RandomConst(s, "variance", shape, 0.1f),
+                               ops::FusedBatchNorm::IsTraining(false))
+        .y;
+  }
+
+  int CountOps(const GraphDef& graph, const string& op) {
+    int count = 0;
+    for (const NodeDef& node : graph.node()) {
+      if (node.op() == op) ++count;
+    }
+    return count;
+  }
+
+  // Optimizes `item` and checks that the fetched values do not change.
+  GraphDef OptimizeAndCompare(const GrapplerItem& item) {
+    BatchNormFolding optimizer;
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+    std::vector<Tensor> expected = EvaluateNodes(item.graph, item.fetch);
+    std::vector<Tensor> actual = EvaluateNodes(output, item.fetch);
+    EXPECT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      test::ExpectTensorNear<float>(expected[i], actual[i], 1e-4);
+    }
+    return output;
+  }
+};
+
+TEST_F(BatchNormFoldingTest, ConvFusedBatchNorm) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output input = RandomConst(s, "input", {2, 6, 6, 3}, -0.5f);
+  Output filter = RandomConst(s, "filter", {3, 3, 3, 4}, -0.5f);
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                            "SAME");
+  Output bn = BatchNorm(s, conv, 4);
+  Output out = ops::Identity(s.WithOpName("out"), bn);
+
+  GrapplerItem item;
+  item.fetch.push_back("out");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  GraphDef output = OptimizeAndCompare(item);
+
+  EXPECT_EQ(0, CountOps(output, "FusedBatchNorm"));
+  EXPECT_EQ(1, CountOps(output, "Conv2D"));
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "bn") {
+      EXPECT_EQ("BiasAdd", node.op());
+      ASSERT_EQ(2, node.input_size());
+      EXPECT_EQ("conv", node.input(0));
+      EXPECT_EQ("BatchNormFolding/bn/bias", node.input(1));
+    }
+    if (node.name() == "conv") {
+      EXPECT_EQ("BatchNormFolding/bn/weights", node.input(1));
+    }
+    // The batch norm parameters and the original filter are gone.
+    EXPECT_NE("filter", node.name());
+    EXPECT_NE("mean", node.name());
+    EXPECT_NE("variance", node.name());
+  }
+}
+
+TEST_F(BatchNormFoldingTest, ConvBiasAddFusedBatchNorm) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output input = RandomConst(s, "input", {1, 5, 5, 2}, -0.5f);
+  Output filter = RandomConst(s, "filter", {2, 2, 2, 3}, -0.5f);
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 2, 2, 1},
+                            "VALID");
+  Output bias = RandomConst(s, "bias", {3}, -0.5f);
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv, bias);
+  Output bn = BatchNorm(s, bias_add, 3);
+  Output out = ops::Relu(s.WithOpName("out"), bn);
+
+  GrapplerItem item;
+  item.fetch.push_back("out");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  GraphDef output = OptimizeAndCompare(item);
+
+  EXPECT_EQ(0, CountOps(output, "FusedBatchNorm"));
+  EXPECT_EQ(1, CountOps(output, "BiasAdd"));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("bias_add", node.name());
+  }
+}
+
+TEST_F(BatchNormFoldingTest, MatMulMulAdd) {
+  for (bool transpose_b : {false, true}) {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+    Output input = RandomConst(s, "input", {4, 3}, -0.5f);
+    Output weights = RandomConst(
+        s, "weights", transpose_b ? TensorShape({5, 3}) : TensorShape({3, 5}),
+        -0.5f);
+    Output matmul = ops::MatMul(s.WithOpName("matmul"), input, weights,
+                                ops::MatMul::TransposeB(transpose_b));
+    Output mul = ops::Mul(s.WithOpName("mul"),
+                          RandomConst(s, "scale", {5}, 0.5f), matmul);
+    Output add =
+        ops::Add(s.WithOpName("add"), mul, RandomConst(s, "offset", {5}, 0.0f));
+
+    GrapplerItem item;
+    item.fetch.push_back("add");
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    GraphDef output = OptimizeAndCompare(item);
+
+    EXPECT_EQ(0, CountOps(output, "Mul"));
+    EXPECT_EQ(0, CountOps(output, "Add"));
+    EXPECT_EQ(1, CountOps(output, "BiasAdd"));
+  }
+}
+
+TEST_F(BatchNormFoldingTest, ScalarMul) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output input = RandomConst(s, "input", {1, 4, 4, 2}, -0.5f);
+  Output filter = RandomConst(s, "filter", {1, 1, 2, 2}, -0.5f);
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                            "SAME");
+  Output mul = ops::Mul(s.WithOpName("mul"), conv, 3.0f);
+
+  GrapplerItem item;
+  item.fetch.push_back("mul");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  GraphDef output = OptimizeAndCompare(item);
+
+  EXPECT_EQ(0, CountOps(output, "Mul"));
+  EXPECT_EQ(1, CountOps(output, "Identity"));
+}
+
+TEST_F(BatchNormFoldingTest, KeepsFetchedIntermediateResults) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output input = RandomConst(s, "input", {1, 4, 4, 2}, -0.5f);
+  Output filter = RandomConst(s, "filter", {3, 3, 2, 2}, -0.5f);
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                            "SAME");
+  Output bn = BatchNorm(s, conv, 2);
+
+  GrapplerItem item;
+  item.fetch = {"bn", "conv"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  GraphDef output = OptimizeAndCompare(item);
+  EXPECT_EQ(1, CountOps(output, "FusedBatchNorm"));
+}
+
+TEST_F(BatchNormFoldingTest, KeepsTrainingBatchNorm) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output input = RandomConst(s, "input", {1, 4, 4, 2}, -0.5f);
+  Output filter = RandomConst(s, "filter", {3, 3, 2, 2}, -0.5f);
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                            "SAME");
+  Output empty = ops::Const(s.WithOpName("empty"),
+                            Input::Initializer(Tensor(DT_FLOAT, {0})));
+  Output bn = ops::FusedBatchNorm(s.WithOpName("bn"), conv,
+                                  RandomConst(s, "scale", {2}, 0.5f),
+                                  RandomConst(s, "offset", {2}, 0.0f), empty,
+                                  empty)
+                  .y;
+
+  GrapplerItem item;
+  item.fetch.push_back("bn");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  BatchNormFolding optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(1, CountOps(output, "FusedBatchNorm"));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
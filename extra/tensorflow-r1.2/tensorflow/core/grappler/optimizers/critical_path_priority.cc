@@ -0,0 +1,65 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/critical_path_priority.h"
+
+#include <unordered_map>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/static_schedule.h"
+
+namespace tensorflow {
+namespace grappler {
+
+Status CriticalPathPriority::Optimize(Cluster* cluster,
+                                      const GrapplerItem& item,
+                                      GraphDef* output) {
+  *output = item.graph;
+  if (cluster == nullptr) {
+    // The static schedule needs the devices to predict execution times.
+    VLOG(1) << "No cluster to estimate critical paths on";
+    return Status::OK();
+  }
+
+  std::unordered_map<const NodeDef*, Costs::NanoSeconds> path_lengths;
+  TF_RETURN_IF_ERROR(
+      EstimateCriticalPathLengths(item, cluster, &path_lengths));
+
+  int annotated = 0;
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    auto it = path_lengths.find(&item.graph.node(i));
+    if (it == path_lengths.end()) {
+      continue;
+    }
+    (*output->mutable_node(i)->mutable_attr())[kCriticalPathAttr].set_i(
+        it->second.count());
+    ++annotated;
+  }
+  VLOG(1) << "Annotated " << annotated << " of " << output->node_size()
+          << " nodes with their critical path length";
+  return Status::OK();
+}
+
+void CriticalPathPriority::Feedback(Cluster* cluster, const GrapplerItem& item,
+                                    const GraphDef& optimize_output,
+                                    double result) {
+  // Nothing to do for CriticalPathPriority.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
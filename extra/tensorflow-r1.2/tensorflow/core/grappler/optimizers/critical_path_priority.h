@@ -0,0 +1,48 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_GRAPPLER_OPTIMIZERS_CRITICAL_PATH_PRIORITY_H_
+#define TENSORFLOW_GRAPPLER_OPTIMIZERS_CRITICAL_PATH_PRIORITY_H_
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Annotates every node, in kCriticalPathAttr (see node_def_util.h), with the
+// length of the longest chain of predicted execution times from the start of
+// the node to the end of the graph (see EstimateCriticalPathLengths). When
+// the annotations are present, the executor starts the ready nodes with the
+// longest critical paths first, so that long chains are not delayed behind
+// short branches on busy CPUs. The graph itself is left unchanged.
+class CriticalPathPriority : public GraphOptimizer {
+ public:
+  CriticalPathPriority() {}
+  ~CriticalPathPriority() override {}
+
+  string name() const override { return "critical_path_priority"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* output) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimize_output, double result) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_GRAPPLER_OPTIMIZERS_CRITICAL_PATH_PRIORITY_H_
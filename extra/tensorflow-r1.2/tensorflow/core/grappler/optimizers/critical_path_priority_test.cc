@@ -0,0 +1,98 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/critical_path_priority.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class CriticalPathPriorityTest : public ::testing::Test {
+ public:
+  static VirtualCluster CreateVirtualCluster() {
+    DeviceProperties cpu_device;
+    cpu_device.set_type("CPU");
+    cpu_device.set_frequency(1000);
+    cpu_device.set_num_cores(4);
+    cpu_device.set_bandwidth(32);
+    std::unordered_map<string, DeviceProperties> devices;
+    devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
+    return VirtualCluster(devices);
+  }
+};
+
+TEST_F(CriticalPathPriorityTest, AnnotatesNodes) {
+  // A long chain of exponentials next to a single short branch.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 0.0f, {100, 100});
+  Output b = ops::Exp(s.WithOpName("b"), a);
+  Output c = ops::Exp(s.WithOpName("c"), b);
+  Output d = ops::Exp(s.WithOpName("d"), c);
+  Output e = ops::Identity(s.WithOpName("e"), a);
+  Output f = ops::AddN(s.WithOpName("f"), {d, e});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  VirtualCluster cluster(CreateVirtualCluster());
+  CriticalPathPriority optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+
+  ASSERT_EQ(item.graph.node_size(), output.node_size());
+  std::unordered_map<string, int64> path_lengths;
+  for (int i = 0; i < output.node_size(); ++i) {
+    const NodeDef& node = output.node(i);
+    EXPECT_EQ(item.graph.node(i).name(), node.name());
+    EXPECT_EQ(item.graph.node(i).input_size(), node.input_size());
+    ASSERT_EQ(1, node.attr().count(kCriticalPathAttr)) << node.name();
+    path_lengths[node.name()] = node.attr().at(kCriticalPathAttr).i();
+  }
+
+  EXPECT_GT(path_lengths["a"], path_lengths["b"]);
+  EXPECT_GT(path_lengths["b"], path_lengths["c"]);
+  EXPECT_GT(path_lengths["c"], path_lengths["d"]);
+  EXPECT_GT(path_lengths["d"], path_lengths["f"]);
+  EXPECT_GT(path_lengths["e"], path_lengths["f"]);
+  // The chain is a better pick than the branch once a is done.
+  EXPECT_GT(path_lengths["b"], path_lengths["e"]);
+  EXPECT_GT(path_lengths["f"], 0);
+}
+
+TEST_F(CriticalPathPriorityTest, NoCluster) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 0.0f, {10, 10});
+  Output b = ops::Exp(s.WithOpName("b"), a);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  CriticalPathPriority optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_EQ(0, node.attr().count(kCriticalPathAttr));
+  }
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
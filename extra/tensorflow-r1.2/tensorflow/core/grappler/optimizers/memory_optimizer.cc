@@ -15,16 +15,25 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/graph_memory.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
 #include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
 #include "tensorflow/core/grappler/optimizers/graph_rewriter.h"
 #include "tensorflow/core/grappler/optimizers/static_schedule.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/platform/mem.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -34,8 +43,10 @@ const char* kRecomputedNodePrefix = "Recomputed";
 string RecomputedOrOriginalNodeName(
     const std::unordered_set<string>& recomputed_node_names,
     const string& original_node_name) {
-  if (recomputed_node_names.find(original_node_name) ==
-      recomputed_node_names.end()) {
+  // Control dependencies are left on the original nodes.
+  if (original_node_name[0] == '^' ||
+      recomputed_node_names.find(NodeName(original_node_name)) ==
+          recomputed_node_names.end()) {
     return original_node_name;
   } else {
     return AddPrefixToNodeName(original_node_name, kRecomputedNodePrefix);
@@ -201,10 +212,8 @@ static const NodeDef* FindSwapTrigger(
   return nullptr;
 }
 
-Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
-                                 GraphDef* optimized_graph) {
-  *optimized_graph = item.graph;
-
+static Status SwappingPass(Cluster* cluster, const GrapplerItem& item,
+                           GraphDef* optimized_graph) {
   // Figure out what needs to be swapped;
   std::unordered_map<NodeDef*, SwapInfo> nodes_to_swap;
   for (auto& node : *optimized_graph->mutable_node()) {
@@ -281,6 +290,410 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
   return Status::OK();
 }
 
+// Returns the position of every node in a topological order of the graph. The
+// nodes that are part of a cycle are left out.
+static std::unordered_map<const NodeDef*, int> TopologicalOrder(
+    const GraphDef& graph) {
+  std::unordered_map<string, const NodeDef*> name_map;
+  for (const NodeDef& node : graph.node()) {
+    name_map[node.name()] = &node;
+  }
+  std::unordered_map<const NodeDef*, std::vector<const NodeDef*>> fanouts;
+  std::unordered_map<const NodeDef*, int> pending_inputs;
+  for (const NodeDef& node : graph.node()) {
+    for (const string& input : node.input()) {
+      auto it = name_map.find(NodeName(input));
+      if (it != name_map.end()) {
+        fanouts[it->second].push_back(&node);
+        pending_inputs[&node]++;
+      }
+    }
+  }
+
+  std::deque<const NodeDef*> ready_nodes;
+  for (const NodeDef& node : graph.node()) {
+    if (pending_inputs[&node] == 0) {
+      ready_nodes.push_back(&node);
+    }
+  }
+  std::unordered_map<const NodeDef*, int> order;
+  while (!ready_nodes.empty()) {
+    const NodeDef* node = ready_nodes.front();
+    ready_nodes.pop_front();
+    const int position = order.size();
+    order[node] = position;
+    for (const NodeDef* fanout : fanouts[node]) {
+      if (--pending_inputs[fanout] == 0) {
+        ready_nodes.push_back(fanout);
+      }
+    }
+  }
+  return order;
+}
+
+// Returns the size in bytes of output `port` of node `name`, or 0 if unknown.
+static int64 OutputSize(const GraphProperties& properties, const string& name,
+                        int port) {
+  const std::vector<OpInfo::TensorProperties> outputs =
+      properties.GetOutputProperties(name);
+  if (port < 0 || port >= outputs.size()) {
+    return 0;
+  }
+  return EstimateSize(outputs[port]);
+}
+
+// True iff the node was generated by tf.gradients().
+static bool IsGradientNode(const NodeDef& node) {
+  const string& name = node.name();
+  return name.compare(0, 10, "gradients/") == 0 ||
+         name.find("/gradients/") != string::npos;
+}
+
+// Stateless ops whose outputs are cheap to recompute from their inputs. They
+// tend to produce activations as large as their inputs.
+static bool IsCheapToRecompute(const NodeDef& node) {
+  static const std::unordered_set<string> cheap_ops = {
+      "Add", "AddN", "BiasAdd", "Cast", "Exp", "Fill", "Mul", "Neg", "RealDiv",
+      "Relu", "Relu6", "Reshape", "Rsqrt", "Sigmoid", "Sqrt", "Square", "Sub",
+      "Tanh", "Tile", "Transpose"};
+  return cheap_ops.count(node.op()) > 0;
+}
+
+// Recomputes, right before the gradients need them, the activations that
+// cheap forward ops would otherwise keep alive for the whole backward pass.
+// The candidates are picked by decreasing savings until the worst case
+// memory usage estimated by GraphMemory fits in the memory of the devices.
+static void RecomputationPass(Cluster* cluster, const GrapplerItem& item,
+                              GraphProperties* properties,
+                              GraphDef* optimized_graph) {
+  NodeMap node_map(optimized_graph);
+  std::unordered_map<const NodeDef*, int> topo_order =
+      TopologicalOrder(*optimized_graph);
+
+  std::unordered_set<string> fetch_nodes;
+  for (const string& fetch : item.fetch) {
+    fetch_nodes.insert(NodeName(fetch));
+  }
+
+  // Candidates are cheap forward nodes with outputs consumed by gradients.
+  std::unordered_set<const NodeDef*> candidates;
+  for (const NodeDef& node : optimized_graph->node()) {
+    if (IsGradientNode(node) || !IsCheapToRecompute(node) ||
+        fetch_nodes.count(node.name()) > 0) {
+      continue;
+    }
+    for (const NodeDef* fanout : node_map.GetOutputs(node.name())) {
+      if (IsGradientNode(*fanout)) {
+        candidates.insert(&node);
+        break;
+      }
+    }
+  }
+
+  // Group the candidates that feed each other, since they are recomputed
+  // together.
+  struct Recomputation {
+    std::vector<const NodeDef*> nodes;
+    std::vector<NodeDef*> targets;
+    const NodeDef* trigger = nullptr;
+    int64 savings = 0;
+  };
+  std::vector<Recomputation> recomputations;
+  std::unordered_set<const NodeDef*> grouped;
+  for (const NodeDef& node : optimized_graph->node()) {
+    if (candidates.count(&node) == 0 || grouped.count(&node) > 0) {
+      continue;
+    }
+    Recomputation recomputation;
+    std::deque<const NodeDef*> queue = {&node};
+    grouped.insert(&node);
+    while (!queue.empty()) {
+      const NodeDef* current = queue.front();
+      queue.pop_front();
+      recomputation.nodes.push_back(current);
+      std::vector<const NodeDef*> neighbors;
+      for (const string& input : current->input()) {
+        if (input[0] != '^') {
+          neighbors.push_back(node_map.GetNode(input));
+        }
+      }
+      for (const NodeDef* fanout : node_map.GetOutputs(current->name())) {
+        neighbors.push_back(fanout);
+      }
+      for (const NodeDef* neighbor : neighbors) {
+        if (neighbor != nullptr && candidates.count(neighbor) > 0 &&
+            grouped.insert(neighbor).second) {
+          queue.push_back(neighbor);
+        }
+      }
+    }
+
+    std::unordered_set<const NodeDef*> nodes(recomputation.nodes.begin(),
+                                             recomputation.nodes.end());
+    // The tensors kept alive for the gradients are freed after the forward
+    // pass...
+    std::set<std::pair<string, int>> saved_outputs;
+    std::set<NodeDef*> targets;
+    for (const NodeDef* group_node : recomputation.nodes) {
+      for (NodeDef* fanout : node_map.GetOutputs(group_node->name())) {
+        if (!IsGradientNode(*fanout)) {
+          continue;
+        }
+        for (const string& input : fanout->input()) {
+          int port;
+          if (input[0] != '^' &&
+              ParseNodeName(input, &port) == group_node->name()) {
+            saved_outputs.insert(std::make_pair(group_node->name(), port));
+            targets.insert(fanout);
+          }
+        }
+      }
+    }
+    for (const auto& output : saved_outputs) {
+      recomputation.savings +=
+          OutputSize(*properties, output.first, output.second);
+    }
+    // ... but the inputs of the recomputed nodes now have to be kept alive
+    // instead, unless the gradients need them anyway.
+    std::set<std::pair<string, int>> extra_inputs;
+    for (const NodeDef* group_node : recomputation.nodes) {
+      for (const string& input : group_node->input()) {
+        int port;
+        const string input_name = ParseNodeName(input, &port);
+        const NodeDef* input_node = node_map.GetNode(input_name);
+        if (input[0] == '^' || input_node == nullptr ||
+            nodes.count(input_node) > 0) {
+          continue;
+        }
+        bool needed_by_gradients = false;
+        for (const NodeDef* fanout : node_map.GetOutputs(input_name)) {
+          needed_by_gradients |= IsGradientNode(*fanout);
+        }
+        if (!needed_by_gradients) {
+          extra_inputs.insert(std::make_pair(input_name, port));
+        }
+      }
+    }
+    for (const auto& input : extra_inputs) {
+      recomputation.savings -=
+          OutputSize(*properties, input.first, input.second);
+    }
+    if (recomputation.savings <= 0 || targets.empty()) {
+      continue;
+    }
+
+    // Trigger the recomputation on the last input of the targets that comes
+    // before all of them in the topological order, so that it cannot depend
+    // on their outputs.
+    int first_target = std::numeric_limits<int>::max();
+    for (NodeDef* target : targets) {
+      recomputation.targets.push_back(target);
+      first_target = std::min(first_target, topo_order[target]);
+    }
+    int trigger_position = -1;
+    for (const NodeDef* target : recomputation.targets) {
+      for (const string& input : target->input()) {
+        const NodeDef* input_node = node_map.GetNode(NodeName(input));
+        if (input_node == nullptr || !IsGradientNode(*input_node)) {
+          continue;
+        }
+        auto position = topo_order.find(input_node);
+        if (position != topo_order.end() && position->second < first_target &&
+            position->second > trigger_position) {
+          trigger_position = position->second;
+          recomputation.trigger = input_node;
+        }
+      }
+    }
+    if (recomputation.trigger != nullptr) {
+      recomputations.push_back(std::move(recomputation));
+    }
+  }
+  if (recomputations.empty()) {
+    return;
+  }
+
+  // Stop once the graph fits in the smallest device, if its memory is known.
+  // CPU devices don't report their memory size, so the RAM that is available
+  // to the process is used instead.
+  int64 memory_budget = 0;
+  if (cluster != nullptr) {
+    for (const auto& device : cluster->GetDevices()) {
+      int64 memory_size = device.second.memory_size();
+      if (memory_size <= 0 && device.second.type() == "CPU") {
+        memory_size = port::AvailableRam();
+        if (memory_size == kint64max) {
+          memory_size = 0;
+        }
+      }
+      if (memory_size > 0 &&
+          (memory_budget == 0 || memory_size < memory_budget)) {
+        memory_budget = memory_size;
+      }
+    }
+  }
+  GraphMemory memory(item);
+  int64 memory_usage = -1;
+  if (memory.InferFromGraphProperties(properties).ok()) {
+    memory_usage = memory.GetWorstCaseMemoryUsage();
+  }
+
+  std::sort(recomputations.begin(), recomputations.end(),
+            [](const Recomputation& a, const Recomputation& b) {
+              return a.savings > b.savings;
+            });
+  for (const Recomputation& recomputation : recomputations) {
+    if (memory_budget > 0 && memory_usage >= 0 &&
+        memory_usage <= memory_budget) {
+      break;
+    }
+    VLOG(1) << "Recomputing " << recomputation.nodes.size()
+            << " nodes starting at " << recomputation.nodes[0]->name()
+            << " to save " << recomputation.savings << " bytes";
+    RecomputeSubgraph(recomputation.nodes, recomputation.trigger->name(),
+                      recomputation.targets, optimized_graph);
+    memory_usage -= recomputation.savings;
+  }
+}
+
+// The inputs that the kernel of a node overwrites with its output when it
+// holds the only reference to their buffer, through
+// OpKernelContext::forward_input_or_allocate_output().
+static std::vector<int> ForwardableInputs(const NodeDef& node) {
+  static const std::unordered_set<string> unary_ops = {
+      "Abs", "BiasAdd", "Ceil", "Cos", "Exp", "Expm1", "Floor", "Inv", "Log",
+      "Log1p", "LogSoftmax", "Neg", "Reciprocal", "Rint", "Round", "Rsqrt",
+      "Sigmoid", "Sign", "Sin", "Softmax", "Sqrt", "Square", "Tan", "Tanh",
+      "_FusedCwise"};
+  static const std::unordered_set<string> binary_ops = {
+      "InvGrad", "ReciprocalGrad", "RsqrtGrad", "SigmoidGrad", "SqrtGrad",
+      "TanhGrad"};
+  if (unary_ops.count(node.op()) > 0) {
+    return {0};
+  }
+  if (binary_ops.count(node.op()) > 0) {
+    return {0, 1};
+  }
+  return {};
+}
+
+// Lets elementwise ops reuse the buffer of one of their inputs. A kernel can
+// only forward an input whose buffer it holds the only reference to, so the
+// other consumers of the input are made to run first through control
+// dependencies. This is only done when all of them come before the
+// elementwise op in the topological order, so that no cycle can be created.
+static void InPlacePass(const GrapplerItem& item,
+                        const GraphProperties& properties,
+                        GraphDef* optimized_graph) {
+  // Don't bother serializing the consumers of small tensors.
+  const int64 kMinInPlaceBytes = 64 * 1024;
+
+  NodeMap node_map(optimized_graph);
+  std::unordered_map<const NodeDef*, int> topo_order =
+      TopologicalOrder(*optimized_graph);
+  std::unordered_set<string> fetch_nodes;
+  for (const string& fetch : item.fetch) {
+    fetch_nodes.insert(NodeName(fetch));
+  }
+
+  for (int i = 0; i < optimized_graph->node_size(); ++i) {
+    NodeDef* node = optimized_graph->mutable_node(i);
+    const int64 output_size = OutputSize(properties, node->name(), 0);
+    if (output_size < kMinInPlaceBytes || topo_order.count(node) == 0) {
+      continue;
+    }
+    for (int input_index : ForwardableInputs(*node)) {
+      if (input_index >= node->input_size() ||
+          node->input(input_index)[0] == '^') {
+        break;
+      }
+      int port;
+      const string input_name = ParseNodeName(node->input(input_index), &port);
+      const NodeDef* input_node = node_map.GetNode(input_name);
+      // Constants and variables hold on to their own buffers, and the
+      // fetched tensors are referenced by the session.
+      if (input_node == nullptr || IsConstant(*input_node) ||
+          IsVariable(*input_node) || IsPlaceholder(*input_node) ||
+          fetch_nodes.count(input_name) > 0 ||
+          OutputSize(properties, input_name, port) != output_size) {
+        continue;
+      }
+
+      std::vector<const NodeDef*> other_consumers;
+      bool can_forward = true;
+      for (const NodeDef* fanout : node_map.GetOutputs(input_name)) {
+        if (fanout == node) {
+          continue;
+        }
+        bool consumes_input = false;
+        for (const string& fanout_input : fanout->input()) {
+          int fanout_port;
+          consumes_input |=
+              fanout_input[0] != '^' &&
+              ParseNodeName(fanout_input, &fanout_port) == input_name &&
+              fanout_port == port;
+        }
+        if (!consumes_input) {
+          continue;
+        }
+        auto position = topo_order.find(fanout);
+        if (position == topo_order.end() ||
+            position->second >= topo_order[node] ||
+            fanout->device() != node->device()) {
+          can_forward = false;
+          break;
+        }
+        other_consumers.push_back(fanout);
+      }
+      if (!can_forward) {
+        continue;
+      }
+
+      std::sort(other_consumers.begin(), other_consumers.end(),
+                [&topo_order](const NodeDef* a, const NodeDef* b) {
+                  return topo_order[a] < topo_order[b];
+                });
+      for (const NodeDef* consumer : other_consumers) {
+        const string control_input = strings::StrCat("^", consumer->name());
+        if (std::find(node->input().begin(), node->input().end(),
+                      control_input) == node->input().end()) {
+          *node->add_input() = control_input;
+          node_map.AddOutput(consumer->name(), node->name());
+        }
+      }
+      if (!other_consumers.empty()) {
+        VLOG(1) << "Running " << node->name() << " after the other "
+                << other_consumers.size() << " consumers of "
+                << node->input(input_index) << " to reuse its buffer";
+      }
+      break;
+    }
+  }
+}
+
+Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                 GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+
+  TF_RETURN_IF_ERROR(SwappingPass(cluster, item, optimized_graph));
+
+  if (optimization_level_ != RewriterConfig::HEURISTICS) {
+    return Status::OK();
+  }
+  for (const NodeDef& node : optimized_graph->node()) {
+    if (IsNextIteration(node)) {
+      // The control dependencies added below can't cross frames.
+      VLOG(1) << "Not optimizing the memory usage of a graph with loops";
+      return Status::OK();
+    }
+  }
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically());
+  RecomputationPass(cluster, item, &properties, optimized_graph);
+  InPlacePass(item, properties, optimized_graph);
+  return Status::OK();
+}
+
 void MemoryOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
                                const GraphDef& optimized_graph, double result) {
   // Nothing to do for MemoryOptimizer.
@@ -19,14 +19,19 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
 
 namespace tensorflow {
 namespace grappler {
 
-// Swap tensors in and out of device memory.
+// Swap tensors in and out of device memory. With the HEURISTICS optimization
+// level, also recompute cheap activations for the gradients and let
+// elementwise ops reuse the buffers of their inputs, to reduce the peak memory
+// usage of training graphs.
 class MemoryOptimizer : public GraphOptimizer {
  public:
-  MemoryOptimizer() {}
+  explicit MemoryOptimizer(RewriterConfig::MemOptType optimization_level)
+      : optimization_level_(optimization_level) {}
   ~MemoryOptimizer() override {}
 
   string name() const override { return "memory_optimizer"; };
@@ -36,6 +41,9 @@ class MemoryOptimizer : public GraphOptimizer {
 
   void Feedback(Cluster* cluster, const GrapplerItem& item,
                 const GraphDef& pruned_graph, double result) override;
+
+ private:
+  RewriterConfig::MemOptType optimization_level_;
 };
 
 // Helper function to recompute a sub-graph (recomputed_source_nodes) on a
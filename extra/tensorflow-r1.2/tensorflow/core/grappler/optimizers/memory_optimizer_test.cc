@@ -117,12 +117,15 @@ TEST_F(RecomputeSubgraphTest, MultiNode) {
 
 class MemoryOptimizerTest : public ::testing::Test {
  public:
-  static VirtualCluster CreateVirtualCluster() {
+  static VirtualCluster CreateVirtualCluster(int64 memory_size = 0) {
     DeviceProperties cpu_device;
     cpu_device.set_type("CPU");
     cpu_device.set_frequency(1000);
     cpu_device.set_num_cores(4);
     cpu_device.set_bandwidth(32);
+    if (memory_size > 0) {
+      cpu_device.set_memory_size(memory_size);
+    }
     std::unordered_map<string, DeviceProperties> devices;
     devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
     return VirtualCluster(devices);
@@ -150,7 +153,7 @@ TEST_F(MemoryOptimizerTest, SimpleSwapping) {
 
   VirtualCluster cluster(CreateVirtualCluster());
 
-  MemoryOptimizer optimizer;
+  MemoryOptimizer optimizer(RewriterConfig::MANUAL);
   GraphDef output;
   Status status = optimizer.Optimize(&cluster, item, &output);
   TF_EXPECT_OK(status);
@@ -174,6 +177,150 @@ TEST_F(MemoryOptimizerTest, SimpleSwapping) {
   EXPECT_EQ("^c", swap_in.input(1));
 }
 
+TEST_F(MemoryOptimizerTest, RecomputeCheapActivations) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Const(s.WithOpName("a"), 1.f, {64, 64});
+  Output b = ops::Relu(s.WithOpName("b"), a);
+  Output c = ops::Tanh(s.WithOpName("c"), b);
+  Output grad = ops::Const(s.WithOpName("gradients/Fill"), 1.f, {64, 64});
+  Output c_grad = ops::Mul(s.WithOpName("gradients/c_grad"), c, grad);
+  Output b_grad = ops::Mul(s.WithOpName("gradients/b_grad"), c_grad, b);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/b_grad"};
+
+  // The activations don't fit in a 16KB device.
+  VirtualCluster cluster(CreateVirtualCluster(16 * 1024));
+
+  MemoryOptimizer optimizer(RewriterConfig::HEURISTICS);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+
+  // b and c are recomputed from a for the gradients, which frees two
+  // activations for the price of keeping a alive.
+  EXPECT_EQ(8, output.node_size());
+  NodeMap node_map(&output);
+  const NodeDef* recomputed_b = node_map.GetNode("Recomputed/b");
+  ASSERT_NE(nullptr, recomputed_b);
+  EXPECT_EQ(2, recomputed_b->input_size());
+  EXPECT_EQ("a", recomputed_b->input(0));
+  EXPECT_EQ("^gradients/Fill", recomputed_b->input(1));
+  const NodeDef* recomputed_c = node_map.GetNode("Recomputed/c");
+  ASSERT_NE(nullptr, recomputed_c);
+  EXPECT_EQ(2, recomputed_c->input_size());
+  EXPECT_EQ("Recomputed/b", recomputed_c->input(0));
+  EXPECT_EQ("^gradients/Fill", recomputed_c->input(1));
+
+  EXPECT_EQ("Recomputed/c", node_map.GetNode("gradients/c_grad")->input(0));
+  EXPECT_EQ("Recomputed/b", node_map.GetNode("gradients/b_grad")->input(1));
+  // The forward pass is unchanged.
+  EXPECT_EQ("b", node_map.GetNode("c")->input(0));
+}
+
+TEST_F(MemoryOptimizerTest, NoRecomputationWhenTheGraphFits) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Const(s.WithOpName("a"), 1.f, {64, 64});
+  Output b = ops::Relu(s.WithOpName("b"), a);
+  Output c = ops::Tanh(s.WithOpName("c"), b);
+  Output grad = ops::Const(s.WithOpName("gradients/Fill"), 1.f, {64, 64});
+  Output c_grad = ops::Mul(s.WithOpName("gradients/c_grad"), c, grad);
+  Output b_grad = ops::Mul(s.WithOpName("gradients/b_grad"), c_grad, b);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/b_grad"};
+
+  VirtualCluster cluster(CreateVirtualCluster(1LL << 30));
+
+  MemoryOptimizer optimizer(RewriterConfig::HEURISTICS);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+}
+
+TEST_F(MemoryOptimizerTest, CpuMemoryDefaultsToAvailableRam) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Const(s.WithOpName("a"), 1.f, {64, 64});
+  Output b = ops::Relu(s.WithOpName("b"), a);
+  Output c = ops::Tanh(s.WithOpName("c"), b);
+  Output grad = ops::Const(s.WithOpName("gradients/Fill"), 1.f, {64, 64});
+  Output c_grad = ops::Mul(s.WithOpName("gradients/c_grad"), c, grad);
+  Output b_grad = ops::Mul(s.WithOpName("gradients/b_grad"), c_grad, b);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/b_grad"};
+
+  // The CPU device doesn't set its memory size, and the graph fits in the
+  // available RAM.
+  VirtualCluster cluster(CreateVirtualCluster());
+
+  MemoryOptimizer optimizer(RewriterConfig::HEURISTICS);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+}
+
+TEST_F(MemoryOptimizerTest, ReuseInputBuffers) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Const(s.WithOpName("a"), 1.f, {256, 256});
+  Output b = ops::Relu(s.WithOpName("b"), a);
+  Output n = ops::Neg(s.WithOpName("n"), b);
+  Output m = ops::MatMul(s.WithOpName("m"), b, b);
+  Output e = ops::Exp(s.WithOpName("e"), b);
+  Output out = ops::AddN(s.WithOpName("out"), {n, m, e});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"out"};
+
+  VirtualCluster cluster(CreateVirtualCluster());
+
+  MemoryOptimizer optimizer(RewriterConfig::HEURISTICS);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  NodeMap node_map(&output);
+  // e runs last among the consumers of b, and can overwrite it.
+  const NodeDef* new_e = node_map.GetNode("e");
+  ASSERT_EQ(3, new_e->input_size());
+  EXPECT_EQ("b", new_e->input(0));
+  EXPECT_EQ("^n", new_e->input(1));
+  EXPECT_EQ("^m", new_e->input(2));
+  // Making n wait for e would create a cycle.
+  EXPECT_EQ(1, node_map.GetNode("n")->input_size());
+}
+
+TEST_F(MemoryOptimizerTest, ManualModeIgnoresHeuristics) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Const(s.WithOpName("a"), 1.f, {256, 256});
+  Output b = ops::Relu(s.WithOpName("b"), a);
+  Output n = ops::Neg(s.WithOpName("n"), b);
+  Output e = ops::Exp(s.WithOpName("e"), b);
+  Output out = ops::AddN(s.WithOpName("out"), {n, e});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"out"};
+
+  VirtualCluster cluster(CreateVirtualCluster());
+
+  MemoryOptimizer optimizer(RewriterConfig::MANUAL);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(&cluster, item, &output));
+  ASSERT_EQ(item.graph.node_size(), output.node_size());
+  for (int i = 0; i < output.node_size(); ++i) {
+    EXPECT_EQ(item.graph.node(i).DebugString(), output.node(i).DebugString());
+  }
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
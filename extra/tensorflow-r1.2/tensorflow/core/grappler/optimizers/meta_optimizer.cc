@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
 #include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/grappler/optimizers/arithmetic_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/auto_parallel.h"
+#include "tensorflow/core/grappler/optimizers/batch_norm_folding.h"
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
+#include "tensorflow/core/grappler/optimizers/critical_path_priority.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
@@ -37,16 +40,28 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::NewOptimizer(
   if (optimizer == "constfold") {
     graph_optimizer.reset(new ConstantFolding());
   }
+  if (optimizer == "batchnorm") {
+    graph_optimizer.reset(new BatchNormFolding());
+  }
   if (optimizer == "layout") {
     graph_optimizer.reset(new LayoutOptimizer());
   }
+  if (optimizer == "arithmetic") {
+    graph_optimizer.reset(new ArithmeticOptimizer());
+  }
   if (optimizer == "memory") {
-    graph_optimizer.reset(new MemoryOptimizer());
+    graph_optimizer.reset(new MemoryOptimizer(
+        cfg_.memory_optimization() == RewriterConfig::HEURISTICS
+            ? RewriterConfig::HEURISTICS
+            : RewriterConfig::MANUAL));
   }
   if (optimizer == "autoparallel") {
     graph_optimizer.reset(
         new AutoParallel(cfg_.auto_parallel().num_replicas()));
   }
+  if (optimizer == "criticalpath") {
+    graph_optimizer.reset(new CriticalPathPriority());
+  }
   return graph_optimizer;
 }
 
@@ -61,21 +76,37 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       optimizers.push_back(
           std::unique_ptr<GraphOptimizer>(new ConstantFolding()));
     }
+    if (cfg_.fold_batch_norms()) {
+      optimizers.push_back(
+          std::unique_ptr<GraphOptimizer>(new BatchNormFolding()));
+    }
     if (cfg_.optimize_tensor_layout()) {
       optimizers.push_back(
           std::unique_ptr<GraphOptimizer>(new LayoutOptimizer()));
     }
-    if (cfg_.memory_optimization() > 0) {
+    // After the layout optimizer, whose transposes may cancel out, and after
+    // batch norm folding, whose patterns would otherwise be fused.
+    if (cfg_.arithmetic_optimization()) {
       optimizers.push_back(
-          std::unique_ptr<GraphOptimizer>(new MemoryOptimizer()));
+          std::unique_ptr<GraphOptimizer>(new ArithmeticOptimizer()));
+    }
+    if (cfg_.memory_optimization() > 0) {
+      optimizers.push_back(std::unique_ptr<GraphOptimizer>(
+          new MemoryOptimizer(cfg_.memory_optimization())));
     }
     if (cfg_.auto_parallel().enable()) {
       optimizers.push_back(std::unique_ptr<GraphOptimizer>(
           new AutoParallel(cfg_.auto_parallel().num_replicas())));
     }
+    // Last, so that the annotations describe the final graph.
+    if (cfg_.critical_path_priority()) {
+      optimizers.push_back(
+          std::unique_ptr<GraphOptimizer>(new CriticalPathPriority()));
+    }
   } else {
-    std::set<string> available_optimizers = {"pruning", "constfold", "layout",
-                                             "memory", "autoparallel"};
+    std::set<string> available_optimizers = {
+        "pruning",    "constfold",    "batchnorm",   "layout", "memory",
+        "arithmetic", "autoparallel", "criticalpath"};
     for (const auto& optimizer : cfg_.optimizers()) {
       if (available_optimizers.find(optimizer) != available_optimizers.end()) {
         optimizers.push_back(NewOptimizer(optimizer));
@@ -114,7 +145,9 @@ void MetaOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
 
 bool MetaOptimizerEnabled(const RewriterConfig& cfg) {
   return cfg.optimize_tensor_layout() || cfg.constant_folding() ||
-         cfg.auto_parallel().enable() || !cfg.optimizers().empty();
+         cfg.fold_batch_norms() || cfg.arithmetic_optimization() ||
+         cfg.memory_optimization() > 0 || cfg.auto_parallel().enable() ||
+         cfg.critical_path_priority() || !cfg.optimizers().empty();
 }
 
 Status RunMetaOptimizer(const GrapplerItem& item, const RewriterConfig& cfg,
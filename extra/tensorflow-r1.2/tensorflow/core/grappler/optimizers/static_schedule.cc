@@ -119,5 +119,68 @@ Status EstimateEarliestExecutionTimes(
   return Status::OK();
 }
 
+Status EstimateCriticalPathLengths(
+    const GrapplerItem& item, const Cluster* cluster,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>* path_lengths) {
+  std::unordered_map<string, const NodeDef*> name_map;
+  for (const NodeDef& node : item.graph.node()) {
+    name_map[node.name()] = &node;
+  }
+
+  // Walk the graph backwards from the nodes without fanouts. The edges out of
+  // NextIteration nodes close the loops, and are ignored.
+  std::unordered_map<const NodeDef*, std::vector<const NodeDef*>> fanins;
+  std::unordered_map<const NodeDef*, int> pending_fanouts;
+  for (const NodeDef& node : item.graph.node()) {
+    for (const string& input : node.input()) {
+      auto it = name_map.find(NodeName(input));
+      if (it == name_map.end()) {
+        return errors::InvalidArgument(
+            strings::StrCat("Unknown input node ", input));
+      }
+      const NodeDef* fanin = it->second;
+      if (IsNextIteration(*fanin)) {
+        continue;
+      }
+      fanins[&node].push_back(fanin);
+      pending_fanouts[fanin]++;
+    }
+  }
+  name_map.clear();
+
+  std::deque<const NodeDef*> ready_nodes;
+  for (const NodeDef& node : item.graph.node()) {
+    if (pending_fanouts[&node] == 0) {
+      ready_nodes.push_back(&node);
+    }
+  }
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically());
+  OpLevelCostEstimator estimator;
+  VirtualPlacer placer(cluster);
+
+  while (!ready_nodes.empty()) {
+    const NodeDef* node = ready_nodes.front();
+    ready_nodes.pop_front();
+
+    // (*path_lengths)[node] holds the longest path among the fanouts.
+    Costs::NanoSeconds path_length =
+        PredictExecutionTime(properties, estimator, placer, *node) +
+        (*path_lengths)[node];
+    (*path_lengths)[node] = path_length;
+
+    for (const NodeDef* fanin : fanins[node]) {
+      Costs::NanoSeconds& fanin_length = (*path_lengths)[fanin];
+      fanin_length = std::max(fanin_length, path_length);
+      if (--pending_fanouts[fanin] == 0) {
+        ready_nodes.push_back(fanin);
+      }
+    }
+  }
+
+  return Status::OK();
+}
+
 }  // end namespace grappler
 }  // end namespace tensorflow
@@ -35,6 +35,15 @@ Status EstimateEarliestExecutionTimes(
     const GrapplerItem& item, const Cluster* cluster,
     std::unordered_map<const NodeDef*, Costs::NanoSeconds>* execution_times);
 
+// Compute, for each node in the graph, the length of the longest chain of
+// predicted execution times from the start of the node to the end of the
+// graph. Nodes with longer critical paths should be started first to shorten
+// the overall execution. The edges out of NextIteration nodes, which close
+// the loops, are ignored, so each loop body is only counted once.
+Status EstimateCriticalPathLengths(
+    const GrapplerItem& item, const Cluster* cluster,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>* path_lengths);
+
 }  // namespace grappler
 }  // end namespace tensorflow
 
@@ -66,15 +66,15 @@ TEST_F(StaticScheduleTest, BasicGraph) {
     } else if (time.first->name() == "x") {
       EXPECT_EQ(Costs::NanoSeconds(250001), time.second);
     } else if (time.first->name() == "AddN") {
-      EXPECT_EQ(Costs::NanoSeconds(1500001), time.second);
-    } else if (time.first->name() == "AddN_1") {
       EXPECT_EQ(Costs::NanoSeconds(2750001), time.second);
+    } else if (time.first->name() == "AddN_1") {
+      EXPECT_EQ(Costs::NanoSeconds(5250001), time.second);
     } else if (time.first->name() == "AddN_2") {
-      EXPECT_EQ(Costs::NanoSeconds(4000001), time.second);
+      EXPECT_EQ(Costs::NanoSeconds(7750001), time.second);
     } else if (time.first->name() == "AddN_3") {
-      EXPECT_EQ(Costs::NanoSeconds(5250001), time.second);
+      EXPECT_EQ(Costs::NanoSeconds(10250001), time.second);
     } else if (time.first->name() == "y") {
-      EXPECT_EQ(Costs::NanoSeconds(6500001), time.second);
+      EXPECT_EQ(Costs::NanoSeconds(12750001), time.second);
     }
   }
 }
@@ -110,13 +110,51 @@ TEST_F(StaticScheduleTest, BasicGraphWithCtrlDependencies) {
     if (time.first->name() == "a") {
       EXPECT_EQ(Costs::NanoSeconds(1), time.second);
     } else if (time.first->name() == "b") {
-      EXPECT_EQ(Costs::NanoSeconds(12500001), time.second);
+      EXPECT_EQ(Costs::NanoSeconds(25000001), time.second);
     } else if (time.first->name() == "c") {
-      EXPECT_EQ(Costs::NanoSeconds(12500002), time.second);
+      EXPECT_EQ(Costs::NanoSeconds(25000002), time.second);
     } else if (time.first->name() == "d") {
-      EXPECT_EQ(Costs::NanoSeconds(12500003), time.second);
-    } else if (time.first->name() == "e") {
       EXPECT_EQ(Costs::NanoSeconds(25000003), time.second);
+    } else if (time.first->name() == "e") {
+      EXPECT_EQ(Costs::NanoSeconds(50000003), time.second);
+    }
+  }
+}
+
+TEST_F(StaticScheduleTest, CriticalPathLengths) {
+  // Build a simple graph with a control dependency.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  Output a = ops::Const(s.WithOpName("a"), 0.0f, {10, 10});
+  Output b = ops::AddN(s.WithOpName("b"), {a});
+  Output c = ops::Identity(s.WithOpName("c"), b);
+  Output d = ops::Identity(s.WithOpName("d"), c);
+  Output e = ops::AddN(s.WithOpName("e"), {d});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  *item.graph.mutable_node(4)->add_input() = "^c";
+
+  VirtualCluster cluster(CreateVirtualCluster());
+
+  std::unordered_map<const NodeDef*, Costs::NanoSeconds> path_lengths;
+  Status status = EstimateCriticalPathLengths(item, &cluster, &path_lengths);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(item.graph.node_size(), path_lengths.size());
+
+  // The critical path of the root spans the whole schedule.
+  for (auto length : path_lengths) {
+    if (length.first->name() == "a") {
+      EXPECT_EQ(Costs::NanoSeconds(50000003), length.second);
+    } else if (length.first->name() == "b") {
+      EXPECT_EQ(Costs::NanoSeconds(50000002), length.second);
+    } else if (length.first->name() == "c") {
+      EXPECT_EQ(Costs::NanoSeconds(25000002), length.second);
+    } else if (length.first->name() == "d") {
+      EXPECT_EQ(Costs::NanoSeconds(25000001), length.second);
+    } else if (length.first->name() == "e") {
+      EXPECT_EQ(Costs::NanoSeconds(25000000), length.second);
     }
   }
 }
@@ -14,24 +14,117 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/captured_function.h"
 
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/lookup_interface.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/queue_interface.h"
 #include "tensorflow/core/framework/reader_interface.h"
 #include "tensorflow/core/framework/resource_handle.pb_text.h"
 #include "tensorflow/core/kernels/dataset.h"
 #include "tensorflow/core/kernels/variable_ops.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/public/session_options.h"
 
 
 namespace tensorflow {
 
+namespace {
+
+// Captured inputs of at most this size are folded into the function body.
+const int64 kMaxSpecializedInputBytes = 64 << 10;
+
+// Functions with at most this many nodes (including the source and sink
+// nodes) are run in the calling thread, because the cost of handing each of
+// their nodes to the runner would dominate their execution.
+const int kMaxInlineRunNodes = 32;
+
+bool IsSpecializable(const OpDef::ArgDef& arg, const Tensor& captured_input) {
+  return arg.number_attr().empty() && arg.type_list_attr().empty() &&
+         !arg.is_ref() && captured_input.dtype() != DT_RESOURCE &&
+         captured_input.TotalBytes() <= kMaxSpecializedInputBytes;
+}
+
+// Rewrites the references of `input` to a function argument that is in
+// `folded_args` into references of the Const node that replaces it.
+void RewriteFoldedArg(
+    const std::unordered_map<string, string>& folded_args, string* input) {
+  const bool is_control = !input->empty() && (*input)[0] == '^';
+  StringPiece name(*input);
+  if (is_control) name.remove_prefix(1);
+  name = name.substr(0, name.find(':'));
+  auto iter = folded_args.find(name.ToString());
+  if (iter == folded_args.end()) return;
+  *input = is_control ? strings::StrCat("^", iter->second)
+                      : strings::StrCat(iter->second, ":output:0");
+}
+
+}  // namespace
+
+bool SpecializeCapturedFunction(const FunctionDef& fdef,
+                                std::vector<Tensor>* captured_inputs,
+                                FunctionDef* specialized) {
+  const int num_args = fdef.signature().input_arg_size();
+  const int first_captured =
+      num_args - static_cast<int>(captured_inputs->size());
+  if (first_captured < 0) return false;
+
+  std::unordered_set<string> names;
+  for (const OpDef::ArgDef& arg : fdef.signature().input_arg()) {
+    names.insert(arg.name());
+  }
+  for (const NodeDef& node : fdef.node_def()) {
+    names.insert(node.name());
+  }
+
+  *specialized = fdef;
+  specialized->mutable_signature()->clear_input_arg();
+  std::unordered_map<string, string> folded_args;
+  std::vector<Tensor> remaining_inputs;
+  for (int i = 0; i < num_args; ++i) {
+    const OpDef::ArgDef& arg = fdef.signature().input_arg(i);
+    if (i < first_captured ||
+        !IsSpecializable(arg, (*captured_inputs)[i - first_captured])) {
+      *specialized->mutable_signature()->add_input_arg() = arg;
+      if (i >= first_captured) {
+        remaining_inputs.push_back((*captured_inputs)[i - first_captured]);
+      }
+      continue;
+    }
+    const Tensor& value = (*captured_inputs)[i - first_captured];
+    string const_name = strings::StrCat(arg.name(), "_captured");
+    while (!names.insert(const_name).second) {
+      const_name.append("_");
+    }
+    NodeDef* node = specialized->add_node_def();
+    node->set_name(const_name);
+    node->set_op("Const");
+    AddNodeAttr("dtype", value.dtype(), node);
+    AddNodeAttr("value", value, node);
+    folded_args[arg.name()] = const_name;
+  }
+  if (folded_args.empty()) return false;
+
+  for (NodeDef& node : *specialized->mutable_node_def()) {
+    for (string& input : *node.mutable_input()) {
+      RewriteFoldedArg(folded_args, &input);
+    }
+  }
+  for (auto& ret : *specialized->mutable_ret()) {
+    RewriteFoldedArg(folded_args, &ret.second);
+  }
+  *captured_inputs = std::move(remaining_inputs);
+  return true;
+}
+
 /* static */
 Status CapturedFunction::Create(
     OpKernelContext* ctx, const NameAttrList* func, int graph_def_version,
@@ -85,17 +178,38 @@ Status CapturedFunction::Create(
   std::unique_ptr<FunctionLibraryDefinition> flib_def(
       new FunctionLibraryDefinition(
           *ctx->function_library()->GetFunctionLibraryDefinition()));
+  // Specialize the function on the values of its captured inputs, in the
+  // private copy of the library.
+  string func_name = func->name();
+  const FunctionDef* fdef = flib_def->Find(func_name);
+  FunctionDef specialized;
+  if (fdef != nullptr &&
+      SpecializeCapturedFunction(*fdef, &captured_inputs, &specialized)) {
+    func_name = strings::StrCat(func->name(), "_specialized");
+    while (flib_def->Find(func_name) != nullptr) {
+      func_name.append("_");
+    }
+    specialized.mutable_signature()->set_name(func_name);
+    TF_RETURN_IF_ERROR(flib_def->AddFunctionDef(specialized));
+  }
+
+  // TODO(mrry): OptimizerOptions?
+  OptimizerOptions optimizer_options;
+  // Each dataset creates its own runtime, so share the optimized function
+  // graphs between them.
+  optimizer_options.set_cache_function_graphs(true);
   std::unique_ptr<FunctionLibraryRuntime> lib(NewFunctionLibraryRuntime(
       nullptr /* device_mgr */, ctx->env(), device.get(), graph_def_version,
-      flib_def.get(), {} /* TODO(mrry): OptimizerOptions? */));
+      flib_def.get(), optimizer_options));
 
   FunctionLibraryRuntime::Handle f_handle;
-  TF_RETURN_IF_ERROR(lib->Instantiate(func->name(),
-                                      func->attr(), &f_handle));
+  TF_RETURN_IF_ERROR(lib->Instantiate(func_name, func->attr(), &f_handle));
+  const bool run_inline =
+      lib->GetFunctionBody(f_handle)->graph->num_nodes() <= kMaxInlineRunNodes;
 
   out_function->reset(new CapturedFunction(
       std::move(device), std::move(flib_def), std::move(lib), f_handle,
-      std::move(captured_inputs)));
+      std::move(captured_inputs), run_inline));
   return Status::OK();
 }
 
@@ -116,9 +230,13 @@ Status CapturedFunction::Run(FunctionLibraryRuntime::Options f_opts,
   // will be required to plumb it through the `IteratorContext`.
   CancellationManager c_mgr;
   f_opts.cancellation_manager = &c_mgr;
-  // TODO(mrry): Implement a synchronous version of
-  // FunctionLibraryRuntime::Run() that avoids a context switch for small
-  // functions.
+  // Small functions are run in this thread, which avoids a context switch
+  // per node.
+  std::function<void(std::function<void()>)> inline_runner =
+      [](std::function<void()> fn) { fn(); };
+  if (run_inline_) {
+    f_opts.runner = &inline_runner;
+  }
   if (captured_inputs_.empty()) {
     lib_->Run(f_opts, f_handle_, args, rets, done_callback);
   } else {
@@ -139,11 +257,12 @@ CapturedFunction::CapturedFunction(
     std::unique_ptr<FunctionLibraryDefinition> flib_def,
     std::unique_ptr<FunctionLibraryRuntime> lib,
     FunctionLibraryRuntime::Handle f_handle,
-    std::vector<Tensor> captured_inputs)
+    std::vector<Tensor> captured_inputs, bool run_inline)
     : device_(std::move(device)),
       flib_def_(std::move(flib_def)),
       lib_(std::move(lib)),
       f_handle_(f_handle),
-      captured_inputs_(std::move(captured_inputs)) {}
+      captured_inputs_(std::move(captured_inputs)),
+      run_inline_(run_inline) {}
 
 }  // namespace tensorflow
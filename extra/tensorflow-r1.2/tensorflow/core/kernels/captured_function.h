@@ -48,6 +48,11 @@ class ResourceMgr;
 // in each of the session implementations) to make it possible to close
 // down a ParallelMapDataset::Iterator when its session is closed.
 //
+// The small, non-resource `captured_inputs` are folded into a specialized
+// copy of the function as constants, so that they are constant folded with
+// the rest of the function body, and small functions are run in the calling
+// thread.
+//
 // TODO(mrry): Clean this up. Investigate whether it would be possible to
 // reuse the session's FunctionLibraryRuntime(s) or Device(s).
 class CapturedFunction {
@@ -71,17 +76,30 @@ class CapturedFunction {
                    std::unique_ptr<FunctionLibraryDefinition> flib_def,
                    std::unique_ptr<FunctionLibraryRuntime> lib,
                    FunctionLibraryRuntime::Handle f_handle,
-                   std::vector<Tensor> captured_inputs);
+                   std::vector<Tensor> captured_inputs, bool run_inline);
 
   const std::unique_ptr<Device> device_;
   const std::unique_ptr<FunctionLibraryDefinition> flib_def_;
   const std::unique_ptr<FunctionLibraryRuntime> lib_;
   const FunctionLibraryRuntime::Handle f_handle_;
   const std::vector<Tensor> captured_inputs_;
+  // If true, the function is run in the thread that calls `Run()`.
+  const bool run_inline_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(CapturedFunction);
 };
 
+// Sets `*specialized` to a copy of `fdef` in which the small, non-resource
+// `captured_inputs`, which are the last arguments of `fdef`, are replaced
+// by Const nodes. The folded inputs are removed from the signature of
+// `*specialized` and from `*captured_inputs`. Returns false if no input
+// could be folded.
+//
+// Exposed for testing.
+bool SpecializeCapturedFunction(const FunctionDef& fdef,
+                                std::vector<Tensor>* captured_inputs,
+                                FunctionDef* specialized);
+
 }  // namespace tensorflow
 
 #endif  // THIRD_PARTY_TENSORFLOW_CORE_KERNELS_KERNELS_CAPTURED_FUNCTION_H_
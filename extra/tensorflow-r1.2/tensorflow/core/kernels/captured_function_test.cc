@@ -0,0 +1,147 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/captured_function.h"
+
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+typedef FunctionDefHelper FDH;
+
+// Returns the node named `name` in `fdef`, or nullptr.
+const NodeDef* FindNode(const FunctionDef& fdef, const string& name) {
+  for (const NodeDef& node : fdef.node_def()) {
+    if (node.name() == name) return &node;
+  }
+  return nullptr;
+}
+
+std::vector<string> Inputs(const NodeDef& node) {
+  return std::vector<string>(node.input().begin(), node.input().end());
+}
+
+std::vector<string> ArgNames(const FunctionDef& fdef) {
+  std::vector<string> names;
+  for (const OpDef::ArgDef& arg : fdef.signature().input_arg()) {
+    names.push_back(arg.name());
+  }
+  return names;
+}
+
+void ExpectFoldedConst(const FunctionDef& fdef, const string& name,
+                       const Tensor& expected) {
+  const NodeDef* node = FindNode(fdef, name);
+  ASSERT_NE(nullptr, node);
+  EXPECT_EQ("Const", node->op());
+  Tensor value;
+  TF_ASSERT_OK(GetNodeAttr(*node, "value", &value));
+  test::ExpectTensorEqual<float>(expected, value);
+}
+
+// A captured input larger than the inputs that are folded.
+Tensor LargeInput() {
+  return test::AsTensor<float>(std::vector<float>(32 << 10, 1.0f));
+}
+
+TEST(SpecializeCapturedFunctionTest, FoldsOnlySmallCapturedInputs) {
+  // y = (x + a) * big, where `a` and `big` are captured.
+  const FunctionDef fdef = FDH::Create(
+      "F", {"x: float", "a: float", "big: float"}, {"y: float"}, {},
+      {{{"sum"}, "Add", {"x", "a"}, {{"T", DT_FLOAT}}},
+       {{"prod"}, "Mul", {"sum:z:0", "big"}, {{"T", DT_FLOAT}}}},
+      {{"y", "prod:z:0"}});
+  const Tensor a = test::AsScalar<float>(2.0f);
+  const Tensor big = LargeInput();
+  std::vector<Tensor> captured_inputs = {a, big};
+
+  FunctionDef specialized;
+  ASSERT_TRUE(
+      SpecializeCapturedFunction(fdef, &captured_inputs, &specialized));
+
+  EXPECT_EQ(std::vector<string>({"x", "big"}), ArgNames(specialized));
+  ASSERT_EQ(1, captured_inputs.size());
+  EXPECT_TRUE(captured_inputs[0].SharesBufferWith(big));
+  ExpectFoldedConst(specialized, "a_captured", a);
+  EXPECT_EQ(std::vector<string>({"x", "a_captured:output:0"}),
+            Inputs(*FindNode(specialized, "sum")));
+  EXPECT_EQ(std::vector<string>({"sum:z:0", "big"}),
+            Inputs(*FindNode(specialized, "prod")));
+  EXPECT_EQ("prod:z:0", specialized.ret().at("y"));
+}
+
+TEST(SpecializeCapturedFunctionTest, RewritesControlInputs) {
+  // y = x, run after `a` is available; `a` is captured.
+  const FunctionDef fdef =
+      FDH::Create("F", {"x: float", "a: float"}, {"y: float"}, {},
+                  {{{"id"}, "Identity", {"x"}, {{"T", DT_FLOAT}}, {"a"}}},
+                  {{"y", "id:output:0"}});
+  const Tensor a = test::AsScalar<float>(2.0f);
+  std::vector<Tensor> captured_inputs = {a};
+
+  FunctionDef specialized;
+  ASSERT_TRUE(
+      SpecializeCapturedFunction(fdef, &captured_inputs, &specialized));
+
+  EXPECT_EQ(std::vector<string>({"x"}), ArgNames(specialized));
+  EXPECT_TRUE(captured_inputs.empty());
+  ExpectFoldedConst(specialized, "a_captured", a);
+  EXPECT_EQ(std::vector<string>({"x", "^a_captured"}),
+            Inputs(*FindNode(specialized, "id")));
+}
+
+TEST(SpecializeCapturedFunctionTest, RewritesReturnedArgs) {
+  // y = x + a, z = a, where `a` is captured. The body already has a node
+  // with the name the Const would be given.
+  const FunctionDef fdef = FDH::Create(
+      "F", {"x: float", "a: float"}, {"y: float", "z: float"}, {},
+      {{{"a_captured"}, "Add", {"x", "a"}, {{"T", DT_FLOAT}}}},
+      {{"y", "a_captured:z:0"}, {"z", "a"}});
+  const Tensor a = test::AsScalar<float>(2.0f);
+  std::vector<Tensor> captured_inputs = {a};
+
+  FunctionDef specialized;
+  ASSERT_TRUE(
+      SpecializeCapturedFunction(fdef, &captured_inputs, &specialized));
+
+  ExpectFoldedConst(specialized, "a_captured_", a);
+  EXPECT_EQ(std::vector<string>({"x", "a_captured_:output:0"}),
+            Inputs(*FindNode(specialized, "a_captured")));
+  EXPECT_EQ("a_captured:z:0", specialized.ret().at("y"));
+  EXPECT_EQ("a_captured_:output:0", specialized.ret().at("z"));
+}
+
+TEST(SpecializeCapturedFunctionTest, NothingToFold) {
+  const FunctionDef fdef = FDH::Create(
+      "F", {"x: float", "big: float"}, {"y: float"}, {},
+      {{{"prod"}, "Mul", {"x", "big"}, {{"T", DT_FLOAT}}}},
+      {{"y", "prod:z:0"}});
+  const Tensor big = LargeInput();
+  std::vector<Tensor> captured_inputs = {big};
+
+  FunctionDef specialized;
+  EXPECT_FALSE(
+      SpecializeCapturedFunction(fdef, &captured_inputs, &specialized));
+  ASSERT_EQ(1, captured_inputs.size());
+  EXPECT_TRUE(captured_inputs[0].SharesBufferWith(big));
+}
+
+}  // namespace
+}  // namespace tensorflow
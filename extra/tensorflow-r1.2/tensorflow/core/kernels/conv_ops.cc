@@ -30,8 +30,10 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/conv_2d.h"
+#include "tensorflow/core/kernels/conv_ops_autotune_cpu.h"
 #include "tensorflow/core/kernels/deep_conv2d.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/kernels/packed_weights_cache.h"
 #ifdef TENSORFLOW_USE_LIBXSMM
 #include "tensorflow/core/kernels/xsmm_conv2d.h"
 #endif
@@ -39,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/util/padding.h"
@@ -157,7 +160,20 @@ class LaunchDeepConvOp<CPUDevice, float> {
                           in_depth, out_depth, out_rows, out_cols)) {
       return false;
     }
+    Launch(ctx, input, filter, batch, input_rows, input_cols, in_depth,
+           filter_rows, filter_cols, pad_rows, pad_cols, out_rows, out_cols,
+           out_depth, output);
+    return true;
+  }
 
+  // Runs DeepConv2D without checking whether it is enabled or cheaper than
+  // the direct convolution.
+  // REQUIRES: NHWC data format and DeepConv2DSupportsShape().
+  static void Launch(OpKernelContext* ctx, const Tensor& input,
+                     const Tensor& filter, int batch, int input_rows,
+                     int input_cols, int in_depth, int filter_rows,
+                     int filter_cols, int pad_rows, int pad_cols, int out_rows,
+                     int out_cols, int out_depth, Tensor* output) {
     Conv2DArgs args;
     args.batch = batch;
     args.in_rows = input_rows;
@@ -177,7 +193,6 @@ class LaunchDeepConvOp<CPUDevice, float> {
 
     functor::DeepConv2D<CPUDevice, float>()(ctx, args, input_ptr, filter_ptr,
                                             output_ptr);
-    return true;
   }
 };
 
@@ -250,6 +265,185 @@ class LaunchXsmmConvOp<CPUDevice, float> {
 };
 #endif
 
+template <typename Device, typename T>
+class LaunchPackedConvOp {
+ public:
+  static bool Run(OpKernelContext* ctx, PackedWeightsCache* cache,
+                  const Tensor& input, const Tensor& filter, int batch,
+                  int input_rows, int input_cols, int filter_rows,
+                  int filter_cols, int out_rows, int out_cols, int stride_rows,
+                  int stride_cols, Padding padding, Tensor* output,
+                  TensorFormat data_format) {
+    return false;
+  }
+};
+
+// Runs convolutions that reduce to a matrix multiplication with only a few
+// rows (see LaunchGeneric) with the cached packed form of a constant filter.
+template <>
+class LaunchPackedConvOp<CPUDevice, float> {
+ public:
+  static bool Run(OpKernelContext* ctx, PackedWeightsCache* cache,
+                  const Tensor& input, const Tensor& filter, int batch,
+                  int input_rows, int input_cols, int filter_rows,
+                  int filter_cols, int out_rows, int out_cols, int stride_rows,
+                  int stride_cols, Padding padding, Tensor* output,
+                  TensorFormat data_format) {
+    if (cache == nullptr || data_format != FORMAT_NHWC) return false;
+    const bool is_1x1 = filter_rows == 1 && filter_cols == 1 &&
+                        stride_rows == 1 && stride_cols == 1;
+    const bool is_full = filter_rows == input_rows &&
+                         filter_cols == input_cols && padding == VALID;
+    const int64 rows = static_cast<int64>(batch) * out_rows * out_cols;
+    if ((!is_1x1 && !is_full) || rows > PackedWeights::kMaxRows) {
+      return false;
+    }
+    // The filter is laid out as [filter_rows, filter_cols, in_depth,
+    // out_depth], i.e. as a [depth, out_depth] matrix.
+    const int64 depth = filter.NumElements() / filter.dim_size(3);
+    Tensor weights;
+    CHECK(weights.CopyFrom(filter, TensorShape({depth, filter.dim_size(3)})));
+    std::shared_ptr<const PackedWeights> packed = cache->Get(weights, false);
+    packed->Multiply(*ctx->device()->tensorflow_cpu_worker_threads(),
+                     input.flat<float>().data(), rows,
+                     output->flat<float>().data());
+    return true;
+  }
+};
+
+template <typename Device, typename T>
+class LaunchAutotunedConvOp {
+ public:
+  static bool Run(OpKernelContext* ctx, const Tensor& input,
+                  const Tensor& filter, int batch, int input_rows,
+                  int input_cols, int in_depth, int filter_rows,
+                  int filter_cols, int pad_rows, int pad_cols, int out_rows,
+                  int out_cols, int out_depth, int stride_rows, int stride_cols,
+                  Padding padding, Tensor* output, TensorFormat data_format) {
+    return false;
+  }
+};
+
+// When CpuConvAutotuneEnabled(), times every applicable CPU algorithm the
+// first time a convolution shape is seen, and runs the fastest one from then
+// on.  Results are shared through CpuConvAutotuneMap::Global().
+template <>
+class LaunchAutotunedConvOp<CPUDevice, float> {
+ public:
+  static bool Run(OpKernelContext* ctx, const Tensor& input,
+                  const Tensor& filter, int batch, int input_rows,
+                  int input_cols, int in_depth, int filter_rows,
+                  int filter_cols, int pad_rows, int pad_cols, int out_rows,
+                  int out_cols, int out_depth, int stride_rows, int stride_cols,
+                  Padding padding, Tensor* output, TensorFormat data_format) {
+    if (data_format != FORMAT_NHWC || !CpuConvAutotuneEnabled()) {
+      return false;
+    }
+    const CpuConvParameters params = {
+        batch,
+        input_rows,
+        input_cols,
+        in_depth,
+        filter_rows,
+        filter_cols,
+        out_depth,
+        stride_rows,
+        stride_cols,
+        padding,
+        ctx->device()->tensorflow_cpu_worker_threads()->num_threads};
+    auto launch = [&](CpuConvAlgorithm algorithm) {
+      return LaunchAlgorithm(algorithm, ctx, input, filter, batch, input_rows,
+                             input_cols, in_depth, filter_rows, filter_cols,
+                             pad_rows, pad_cols, out_rows, out_cols, out_depth,
+                             stride_rows, stride_cols, padding, output);
+    };
+
+    CpuConvAutotuneMap* autotune_map = CpuConvAutotuneMap::Global();
+    CpuConvAlgorithm algorithm;
+    if (autotune_map->Find(params, &algorithm) && launch(algorithm)) {
+      return true;
+    }
+
+    // Each candidate runs once untimed, which also tells whether it supports
+    // this convolution, and then kNumTimedRuns times.
+    static constexpr int kNumTimedRuns = 2;
+    const CpuConvAlgorithm candidates[] = {
+        CpuConvAlgorithm::kEigen, CpuConvAlgorithm::kDeepConv2D,
+#ifdef TENSORFLOW_USE_LIBXSMM
+        CpuConvAlgorithm::kXsmm,
+#endif
+    };
+    Env* env = Env::Default();
+    bool found = false;
+    CpuConvAlgorithm best = CpuConvAlgorithm::kEigen;
+    CpuConvAlgorithm last = CpuConvAlgorithm::kEigen;
+    uint64 best_micros = 0;
+    for (CpuConvAlgorithm candidate : candidates) {
+      if (!launch(candidate)) continue;
+      const uint64 start_micros = env->NowMicros();
+      for (int i = 0; i < kNumTimedRuns; ++i) {
+        launch(candidate);
+      }
+      const uint64 micros = (env->NowMicros() - start_micros) / kNumTimedRuns;
+      if (!ctx->status().ok()) return true;
+      VLOG(2) << "Conv2D autotune: " << CpuConvAlgorithmName(candidate)
+              << " takes " << micros << "us for " << params.ToString();
+      if (!found || micros < best_micros) {
+        found = true;
+        best = candidate;
+        best_micros = micros;
+      }
+      last = candidate;
+    }
+    if (!found) return false;
+    autotune_map->Insert(params, best);
+    // The output holds the result of the last candidate, which may differ
+    // slightly from that of the one chosen.
+    if (best != last) launch(best);
+    return true;
+  }
+
+ private:
+  // Runs `algorithm` and returns true, or returns false if it does not
+  // support this convolution.
+  static bool LaunchAlgorithm(CpuConvAlgorithm algorithm, OpKernelContext* ctx,
+                              const Tensor& input, const Tensor& filter,
+                              int batch, int input_rows, int input_cols,
+                              int in_depth, int filter_rows, int filter_cols,
+                              int pad_rows, int pad_cols, int out_rows,
+                              int out_cols, int out_depth, int stride_rows,
+                              int stride_cols, Padding padding,
+                              Tensor* output) {
+    switch (algorithm) {
+      case CpuConvAlgorithm::kEigen:
+        LaunchGeneric<CPUDevice, float>::launch(
+            ctx, input, filter, stride_rows, stride_cols,
+            BrainPadding2EigenPadding(padding), output, FORMAT_NHWC);
+        return true;
+      case CpuConvAlgorithm::kDeepConv2D:
+        if (!DeepConv2DSupportsShape(stride_rows, stride_cols, filter_rows,
+                                     filter_cols)) {
+          return false;
+        }
+        LaunchDeepConvOp<CPUDevice, float>::Launch(
+            ctx, input, filter, batch, input_rows, input_cols, in_depth,
+            filter_rows, filter_cols, pad_rows, pad_cols, out_rows, out_cols,
+            out_depth, output);
+        return true;
+      case CpuConvAlgorithm::kXsmm:
+#ifdef TENSORFLOW_USE_LIBXSMM
+        return LaunchXsmmConvOp<CPUDevice, float>::Run(
+            ctx, input, filter, batch, input_rows, input_cols, in_depth,
+            filter_rows, filter_cols, pad_rows, pad_cols, out_rows, out_cols,
+            out_depth, stride_rows, stride_cols, output, FORMAT_NHWC);
+#else
+        return false;
+#endif
+    }
+    return false;
+  }
+};
+
 template <typename Device, typename T>
 class Conv2DOp : public BinaryOp<T> {
  public:
@@ -262,6 +456,9 @@ class Conv2DOp : public BinaryOp<T> {
     OP_REQUIRES_OK(context, context->GetAttr("use_cudnn_on_gpu", &use_cudnn_));
     use_cudnn_ &= CanUseCudnn();
     cudnn_use_autotune_ = CudnnUseAutotune();
+    if (HasConstantWeights(context)) {
+      packed_filter_.reset(new PackedWeightsCache);
+    }
     OP_REQUIRES(context, strides_.size() == 4,
                 errors::InvalidArgument("Sliding window strides field must "
                                         "specify 4 dimensions"));
@@ -371,6 +568,21 @@ class Conv2DOp : public BinaryOp<T> {
       return;
     }
 
+    if (LaunchPackedConvOp<Device, T>::Run(
+            context, packed_filter_.get(), input, filter, batch, input_rows,
+            input_cols, filter_rows, filter_cols, out_rows, out_cols,
+            stride_rows, stride_cols, padding_, output, data_format_)) {
+      return;
+    }
+
+    if (LaunchAutotunedConvOp<Device, T>::Run(
+            context, input, filter, batch, input_rows, input_cols, in_depth,
+            filter_rows, filter_cols, pad_rows, pad_cols, out_rows, out_cols,
+            out_depth, stride_rows, stride_cols, padding_, output,
+            data_format_)) {
+      return;
+    }
+
 #ifdef TENSORFLOW_USE_LIBXSMM
     if (LaunchXsmmConvOp<Device, T>::Run(
             context, input, filter, batch, input_rows, input_cols, in_depth,
@@ -399,6 +611,8 @@ class Conv2DOp : public BinaryOp<T> {
   TensorFormat data_format_;
   LaunchConv2DOp<Device, T> launcher_;
   bool cudnn_use_autotune_;
+  // Set if the filter is constant, see kConstantWeightsAttr.
+  std::unique_ptr<PackedWeightsCache> packed_filter_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(Conv2DOp);
 };
@@ -0,0 +1,190 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/conv_ops_autotune_cpu.h"
+
+#include <stdlib.h>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The number of integers in one line of the autotune file: the parameters,
+// in declaration order, followed by the algorithm.
+constexpr int kNumFieldsPerLine = 12;
+
+std::vector<int> ParametersToFields(const CpuConvParameters& params) {
+  return {params.batch,       params.in_rows,     params.in_cols,
+          params.in_depth,    params.filter_rows, params.filter_cols,
+          params.out_depth,   params.stride_rows, params.stride_cols,
+          params.padding,     params.num_threads};
+}
+
+}  // namespace
+
+const char* CpuConvAlgorithmName(CpuConvAlgorithm algorithm) {
+  switch (algorithm) {
+    case CpuConvAlgorithm::kEigen:
+      return "eigen";
+    case CpuConvAlgorithm::kDeepConv2D:
+      return "deep_conv2d";
+    case CpuConvAlgorithm::kXsmm:
+      return "xsmm";
+  }
+  return "unknown";
+}
+
+bool CpuConvParameters::operator==(const CpuConvParameters& other) const {
+  return ParametersToFields(*this) == ParametersToFields(other);
+}
+
+uint64 CpuConvParameters::hash() const {
+  uint64 hash = 0;
+  for (int field : ParametersToFields(*this)) {
+    hash = Hash64Combine(hash, field);
+  }
+  return hash;
+}
+
+string CpuConvParameters::ToString() const {
+  return strings::StrCat(
+      "input: [", batch, ", ", in_rows, ", ", in_cols, ", ", in_depth,
+      "], filter: [", filter_rows, ", ", filter_cols, ", ", in_depth, ", ",
+      out_depth, "], strides: [", stride_rows, ", ", stride_cols,
+      "], padding: ", padding == VALID ? "VALID" : "SAME",
+      ", threads: ", num_threads);
+}
+
+bool CpuConvAutotuneEnabled() {
+  static bool enabled = [] {
+    bool value = false;
+    Status status = ReadBoolFromEnvVar("TF_CPU_CONV_AUTOTUNE", false, &value);
+    if (!status.ok()) {
+      LOG(ERROR) << status.error_message();
+    }
+    return value;
+  }();
+  return enabled;
+}
+
+CpuConvAutotuneMap* CpuConvAutotuneMap::Global() {
+  static CpuConvAutotuneMap* instance = [] {
+    const char* filename = getenv("TF_CPU_CONV_AUTOTUNE_FILE");
+    return new CpuConvAutotuneMap(filename == nullptr ? "" : filename);
+  }();
+  return instance;
+}
+
+CpuConvAutotuneMap::CpuConvAutotuneMap(const string& filename)
+    : filename_(filename) {
+  if (filename_.empty()) return;
+  mutex_lock l(mu_);
+  LoadLocked();
+  Status status = Env::Default()->NewAppendableFile(filename_, &file_);
+  if (!status.ok()) {
+    LOG(WARNING) << "Conv2D autotune results will not be saved to "
+                 << filename_ << ": " << status;
+  }
+}
+
+void CpuConvAutotuneMap::LoadLocked() {
+  Env* env = Env::Default();
+  if (!env->FileExists(filename_).ok()) return;
+  string contents;
+  Status status = ReadFileToString(env, filename_, &contents);
+  if (!status.ok()) {
+    LOG(WARNING) << "Could not read Conv2D autotune results from " << filename_
+                 << ": " << status;
+    return;
+  }
+  for (StringPiece line : str_util::Split(contents, '\n')) {
+    if (line.empty()) continue;
+    std::vector<int32> fields;
+    if (!str_util::SplitAndParseAsInts(line, ' ', &fields) ||
+        fields.size() != kNumFieldsPerLine || fields[9] < VALID ||
+        fields[9] > SAME || fields[11] < 0 ||
+        fields[11] > static_cast<int>(CpuConvAlgorithm::kXsmm)) {
+      LOG(WARNING) << "Ignoring malformed line in " << filename_ << ": "
+                   << line;
+      continue;
+    }
+    CpuConvParameters params = {fields[0], fields[1], fields[2], fields[3],
+                                fields[4], fields[5], fields[6], fields[7],
+                                fields[8], static_cast<Padding>(fields[9]),
+                                fields[10]};
+    // Later lines win, so that a file can be updated by appending.
+    map_[params] = static_cast<CpuConvAlgorithm>(fields[11]);
+  }
+  VLOG(1) << "Loaded " << map_.size() << " Conv2D autotune results from "
+          << filename_;
+}
+
+bool CpuConvAutotuneMap::Find(const CpuConvParameters& params,
+                              CpuConvAlgorithm* algorithm) {
+  mutex_lock l(mu_);
+  auto it = map_.find(params);
+  if (it == map_.end()) {
+    ++num_misses_;
+    return false;
+  }
+  ++num_hits_;
+  *algorithm = it->second;
+  return true;
+}
+
+void CpuConvAutotuneMap::Insert(const CpuConvParameters& params,
+                                CpuConvAlgorithm algorithm) {
+  mutex_lock l(mu_);
+  VLOG(1) << "Conv2D autotune selects " << CpuConvAlgorithmName(algorithm)
+          << " for " << params.ToString();
+  map_[params] = algorithm;
+  if (file_ == nullptr) return;
+  string line = str_util::Join(ParametersToFields(params), " ");
+  strings::StrAppend(&line, " ", static_cast<int>(algorithm), "\n");
+  Status status = file_->Append(line);
+  if (status.ok()) status = file_->Flush();
+  if (!status.ok()) {
+    LOG(WARNING) << "Could not save Conv2D autotune result to " << filename_
+                 << ": " << status;
+    file_.reset();
+  }
+}
+
+int64 CpuConvAutotuneMap::size() const {
+  mutex_lock l(mu_);
+  return map_.size();
+}
+
+int64 CpuConvAutotuneMap::num_hits() const {
+  mutex_lock l(mu_);
+  return num_hits_;
+}
+
+int64 CpuConvAutotuneMap::num_misses() const {
+  mutex_lock l(mu_);
+  return num_misses_;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,124 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_CONV_OPS_AUTOTUNE_CPU_H_
+#define TENSORFLOW_CORE_KERNELS_CONV_OPS_AUTOTUNE_CPU_H_
+
+#include <memory>
+#include <unordered_map>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/padding.h"
+
+namespace tensorflow {
+
+// The CPU implementations of Conv2D that the autotuner chooses between.
+// The values are written to the autotune file, so do not renumber them.
+enum class CpuConvAlgorithm {
+  // Eigen's SpatialConvolution, or a plain matrix multiplication for 1x1 and
+  // full-size filters (LaunchGeneric in conv_ops.cc).
+  kEigen = 0,
+  // The Winograd-based DeepConv2D (deep_conv2d.h).
+  kDeepConv2D = 1,
+  // libxsmm's direct convolution (xsmm_conv2d.h).
+  kXsmm = 2,
+};
+
+// Returns a short name for `algorithm`, e.g. "eigen".
+const char* CpuConvAlgorithmName(CpuConvAlgorithm algorithm);
+
+// Everything about a Conv2D invocation that may change which algorithm is
+// fastest.
+struct CpuConvParameters {
+  int batch;
+  int in_rows;
+  int in_cols;
+  int in_depth;
+  int filter_rows;
+  int filter_cols;
+  int out_depth;
+  int stride_rows;
+  int stride_cols;
+  Padding padding;
+  int num_threads;
+
+  bool operator==(const CpuConvParameters& other) const;
+  uint64 hash() const;
+  string ToString() const;
+};
+
+// Returns true if CPU convolutions should be autotuned, which is enabled by
+// setting the environment variable TF_CPU_CONV_AUTOTUNE to 1. It is off by
+// default since the candidate algorithms do not produce bitwise identical
+// results.
+bool CpuConvAutotuneEnabled();
+
+// Process-wide table from convolution parameters to the fastest algorithm
+// measured for them.  If a file name is given, the table is loaded from it on
+// construction and every new result is appended to it, so that later
+// processes skip the measurements.  Thread-safe.
+class CpuConvAutotuneMap {
+ public:
+  // Returns the table shared by all Conv2D kernels.  It is persisted to the
+  // file named by the environment variable TF_CPU_CONV_AUTOTUNE_FILE, if set.
+  static CpuConvAutotuneMap* Global();
+
+  // `filename` may be empty, in which case results are kept in memory only.
+  explicit CpuConvAutotuneMap(const string& filename);
+
+  // Returns true and sets *algorithm if `params` has been tuned.
+  bool Find(const CpuConvParameters& params, CpuConvAlgorithm* algorithm);
+
+  // Records `algorithm` as the fastest one for `params`.
+  void Insert(const CpuConvParameters& params, CpuConvAlgorithm algorithm);
+
+  // Number of tuned parameter sets.
+  int64 size() const;
+
+  // Number of Find() calls that did and did not find a result.
+  int64 num_hits() const;
+  int64 num_misses() const;
+
+ private:
+  struct Hasher {
+    size_t operator()(const CpuConvParameters& params) const {
+      return params.hash();
+    }
+  };
+
+  // Reads the entries in filename_ into map_.  A missing file is not an
+  // error; malformed lines are skipped.
+  void LoadLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const string filename_;
+  mutable mutex mu_;
+  std::unordered_map<CpuConvParameters, CpuConvAlgorithm, Hasher> map_
+      GUARDED_BY(mu_);
+  std::unique_ptr<WritableFile> file_ GUARDED_BY(mu_);
+  int64 num_hits_ GUARDED_BY(mu_) = 0;
+  int64 num_misses_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(CpuConvAutotuneMap);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_CONV_OPS_AUTOTUNE_CPU_H_
@@ -0,0 +1,111 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/conv_ops_autotune_cpu.h"
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+CpuConvParameters MakeParameters(int in_depth, Padding padding) {
+  return {32, 35, 35, in_depth, 3, 3, 96, 1, 1, padding, 8};
+}
+
+TEST(CpuConvAutotuneMapTest, InMemory) {
+  CpuConvAutotuneMap map("");
+  CpuConvAlgorithm algorithm;
+  EXPECT_FALSE(map.Find(MakeParameters(64, SAME), &algorithm));
+
+  map.Insert(MakeParameters(64, SAME), CpuConvAlgorithm::kDeepConv2D);
+  map.Insert(MakeParameters(64, VALID), CpuConvAlgorithm::kEigen);
+  EXPECT_EQ(2, map.size());
+  ASSERT_TRUE(map.Find(MakeParameters(64, SAME), &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kDeepConv2D, algorithm);
+  ASSERT_TRUE(map.Find(MakeParameters(64, VALID), &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kEigen, algorithm);
+  EXPECT_FALSE(map.Find(MakeParameters(32, SAME), &algorithm));
+
+  // Re-tuning replaces the previous result.
+  map.Insert(MakeParameters(64, SAME), CpuConvAlgorithm::kEigen);
+  ASSERT_TRUE(map.Find(MakeParameters(64, SAME), &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kEigen, algorithm);
+  EXPECT_EQ(2, map.size());
+
+  EXPECT_EQ(3, map.num_hits());
+  EXPECT_EQ(2, map.num_misses());
+}
+
+TEST(CpuConvAutotuneMapTest, Persistence) {
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "conv_autotune_persistence");
+  Env::Default()->DeleteFile(filename).IgnoreError();
+  {
+    CpuConvAutotuneMap map(filename);
+    EXPECT_EQ(0, map.size());
+    map.Insert(MakeParameters(64, SAME), CpuConvAlgorithm::kDeepConv2D);
+    map.Insert(MakeParameters(192, VALID), CpuConvAlgorithm::kEigen);
+  }
+  {
+    CpuConvAutotuneMap map(filename);
+    EXPECT_EQ(2, map.size());
+    CpuConvAlgorithm algorithm;
+    ASSERT_TRUE(map.Find(MakeParameters(64, SAME), &algorithm));
+    EXPECT_EQ(CpuConvAlgorithm::kDeepConv2D, algorithm);
+    ASSERT_TRUE(map.Find(MakeParameters(192, VALID), &algorithm));
+    EXPECT_EQ(CpuConvAlgorithm::kEigen, algorithm);
+    // New results are appended and override earlier ones on the next load.
+    map.Insert(MakeParameters(64, SAME), CpuConvAlgorithm::kEigen);
+  }
+  CpuConvAutotuneMap map(filename);
+  EXPECT_EQ(2, map.size());
+  CpuConvAlgorithm algorithm;
+  ASSERT_TRUE(map.Find(MakeParameters(64, SAME), &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kEigen, algorithm);
+}
+
+TEST(CpuConvAutotuneMapTest, IgnoresMalformedLines) {
+  const string filename =
+      io::JoinPath(testing::TmpDir(), "conv_autotune_malformed");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename,
+                                 strings::StrCat("garbage\n",
+                                                 "1 2 3\n",
+                                                 // Unknown algorithm.
+                                                 "32 35 35 64 3 3 96 1 1 2 8 "
+                                                 "7\n",
+                                                 "32 35 35 64 3 3 96 1 1 2 8 "
+                                                 "1\n")));
+  CpuConvAutotuneMap map(filename);
+  EXPECT_EQ(1, map.size());
+  CpuConvAlgorithm algorithm;
+  ASSERT_TRUE(map.Find(MakeParameters(64, SAME), &algorithm));
+  EXPECT_EQ(CpuConvAlgorithm::kDeepConv2D, algorithm);
+}
+
+TEST(CpuConvAutotuneMapTest, ParametersToString) {
+  EXPECT_EQ(
+      "input: [32, 35, 35, 64], filter: [3, 3, 64, 96], strides: [1, 1], "
+      "padding: SAME, threads: 8",
+      MakeParameters(64, SAME).ToString());
+  EXPECT_STREQ("deep_conv2d",
+               CpuConvAlgorithmName(CpuConvAlgorithm::kDeepConv2D));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -37,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/util/mirror_pad_mode.h"
 #include "tensorflow/core/util/padding.h"
 #include "tensorflow/core/util/tensor_format.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -886,4 +887,233 @@ TF_CALL_float(REGISTER_FUSED);
 
 TF_CALL_float(REGISTER_PAD_ONLY_FUSED);
 
+namespace {
+
+// Activations that _FusedConv2DBiasActivation can apply after the bias.
+enum class FusedActivation { kNone, kRelu, kRelu6 };
+
+// Adds bias to each of the `rows` rows of `output`, which have `depth`
+// values each, and applies the activation in place.
+template <FusedActivation Activation>
+void BiasActivate(const float* bias, int64 rows, int64 depth, float* output) {
+  for (int64 row = 0; row < rows; ++row) {
+    float* values = output + row * depth;
+    for (int64 d = 0; d < depth; ++d) {
+      float value = values[d] + bias[d];
+      if (Activation != FusedActivation::kNone) {
+        value = std::max(value, 0.0f);
+      }
+      if (Activation == FusedActivation::kRelu6) {
+        value = std::min(value, 6.0f);
+      }
+      values[d] = value;
+    }
+  }
+}
+
+// Fills `patches` with the im2col rows for output pixels [begin, end) of an
+// NHWC convolution: one row per pixel, holding the filter_rows x filter_cols
+// x in_depth input window in filter order, with zeros for the padding.
+void Im2ColRows(const float* input, int64 in_rows, int64 in_cols,
+                int64 in_depth, int64 filter_rows, int64 filter_cols,
+                int64 stride_rows, int64 stride_cols, int64 pad_rows,
+                int64 pad_cols, int64 out_rows, int64 out_cols, int64 begin,
+                int64 end, float* patches) {
+  const int64 copy_bytes = in_depth * sizeof(float);
+  for (int64 pixel = begin; pixel < end; ++pixel) {
+    const int64 batch = pixel / (out_rows * out_cols);
+    const int64 out_y = (pixel / out_cols) % out_rows;
+    const int64 out_x = pixel % out_cols;
+    const float* input_batch = input + batch * in_rows * in_cols * in_depth;
+    for (int64 filter_y = 0; filter_y < filter_rows; ++filter_y) {
+      const int64 in_y = out_y * stride_rows - pad_rows + filter_y;
+      for (int64 filter_x = 0; filter_x < filter_cols; ++filter_x) {
+        const int64 in_x = out_x * stride_cols - pad_cols + filter_x;
+        if (in_y >= 0 && in_y < in_rows && in_x >= 0 && in_x < in_cols) {
+          memcpy(patches, input_batch + (in_y * in_cols + in_x) * in_depth,
+                 copy_bytes);
+        } else {
+          memset(patches, 0, copy_bytes);
+        }
+        patches += in_depth;
+      }
+    }
+  }
+}
+
+// Computes a float NHWC convolution followed by a bias add and an activation,
+// one tile of output pixels at a time. Each tile's patches are gathered into
+// a small im2col buffer and multiplied by the filter, and the bias and
+// activation are applied while the tile's output is still in cache. Tiles
+// are spread over the CPU worker threads, each with its own buffer, so unlike
+// FusedResizeAndPadConvFunctor there is no shared scratch buffer to lock.
+class FusedConv2DBiasActivationOp : public OpKernel {
+ public:
+  explicit FusedConv2DBiasActivationOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window strides field must "
+                                        "specify 4 dimensions"));
+    const int64 stride_n = GetTensorDim(strides_, FORMAT_NHWC, 'N');
+    const int64 stride_c = GetTensorDim(strides_, FORMAT_NHWC, 'C');
+    OP_REQUIRES(
+        context, stride_n == 1 && stride_c == 1,
+        errors::InvalidArgument("Current implementation does not yet support "
+                                "strides in the batch and depth dimensions."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    string activation;
+    OP_REQUIRES_OK(context, context->GetAttr("activation", &activation));
+    if (activation == "Relu") {
+      activation_ = FusedActivation::kRelu;
+    } else if (activation == "Relu6") {
+      activation_ = FusedActivation::kRelu6;
+    } else {
+      activation_ = FusedActivation::kNone;
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    // [ batch, in_rows, in_cols, in_depth ]
+    const Tensor& input = context->input(0);
+    // [ filter_rows, filter_cols, in_depth, out_depth ]
+    const Tensor& filter = context->input(1);
+    // [ out_depth ]
+    const Tensor& bias = context->input(2);
+
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(bias.shape()),
+                errors::InvalidArgument("bias must be 1-dimensional: ",
+                                        bias.shape().DebugString()));
+    const int64 in_depth = input.dim_size(3);
+    OP_REQUIRES(
+        context, in_depth == filter.dim_size(2),
+        errors::InvalidArgument("input and filter must have the same depth: ",
+                                in_depth, " vs ", filter.dim_size(2)));
+    const int64 out_depth = filter.dim_size(3);
+    OP_REQUIRES(
+        context, bias.dim_size(0) == out_depth,
+        errors::InvalidArgument("bias must have the same size as the last "
+                                "dimension of filter: ",
+                                bias.dim_size(0), " vs ", out_depth));
+
+    const int64 batch = input.dim_size(0);
+    const int64 in_rows = input.dim_size(1);
+    const int64 in_cols = input.dim_size(2);
+    const int64 filter_rows = filter.dim_size(0);
+    const int64 filter_cols = filter.dim_size(1);
+    const int stride_rows = GetTensorDim(strides_, FORMAT_NHWC, 'H');
+    const int stride_cols = GetTensorDim(strides_, FORMAT_NHWC, 'W');
+
+    int64 out_rows = 0, out_cols = 0, pad_rows = 0, pad_cols = 0;
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(in_rows, filter_rows, stride_rows,
+                                         padding_, &out_rows, &pad_rows));
+    OP_REQUIRES_OK(context,
+                   GetWindowedOutputSize(in_cols, filter_cols, stride_cols,
+                                         padding_, &out_cols, &pad_cols));
+    TensorShape out_shape =
+        ShapeFromFormat(FORMAT_NHWC, batch, out_rows, out_cols, out_depth);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, out_shape, &output));
+    if (out_shape.num_elements() == 0) {
+      return;
+    }
+    if (filter.NumElements() == 0) {
+      // An empty reduction: only the bias and activation remain.
+      output->flat<float>().setZero();
+      ApplyBiasActivation(bias.flat<float>().data(),
+                          out_shape.num_elements() / out_depth, out_depth,
+                          output->flat<float>().data());
+      return;
+    }
+
+    // A 1x1 convolution with unit strides reads each input pixel as its own
+    // patch, so it needs no im2col buffer.
+    const bool direct_patches = filter_rows == 1 && filter_cols == 1 &&
+                                stride_rows == 1 && stride_cols == 1;
+    const int64 patch_size = filter_rows * filter_cols * in_depth;
+    const int64 num_pixels = batch * out_rows * out_cols;
+    const int64 row_bytes = std::max(patch_size, out_depth) * sizeof(float);
+    const int64 pixels_per_tile =
+        std::max<int64>(1, std::min(num_pixels, kTileBytes / row_bytes));
+    const int64 num_tiles =
+        (num_pixels + pixels_per_tile - 1) / pixels_per_tile;
+
+    const float* input_data = input.flat<float>().data();
+    const float* filter_data = filter.flat<float>().data();
+    const float* bias_data = bias.flat<float>().data();
+    float* output_data = output->flat<float>().data();
+    TTypes<float>::ConstMatrix filter_matrix(filter_data, patch_size,
+                                             out_depth);
+    Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1> dim_pair;
+    dim_pair[0] = Eigen::IndexPair<Eigen::DenseIndex>(1, 0);
+
+    auto compute_tiles = [&](int64 begin_tile, int64 end_tile) {
+      std::vector<float> im2col_buffer(
+          direct_patches ? 0 : pixels_per_tile * patch_size);
+      for (int64 tile = begin_tile; tile < end_tile; ++tile) {
+        const int64 begin = tile * pixels_per_tile;
+        const int64 end = std::min(begin + pixels_per_tile, num_pixels);
+        const float* patches = input_data + begin * in_depth;
+        if (!direct_patches) {
+          Im2ColRows(input_data, in_rows, in_cols, in_depth, filter_rows,
+                     filter_cols, stride_rows, stride_cols, pad_rows,
+                     pad_cols, out_rows, out_cols, begin, end,
+                     im2col_buffer.data());
+          patches = im2col_buffer.data();
+        }
+        float* tile_output = output_data + begin * out_depth;
+        TTypes<float>::ConstMatrix patch_matrix(patches, end - begin,
+                                                patch_size);
+        TTypes<float>::Matrix output_matrix(tile_output, end - begin,
+                                            out_depth);
+        output_matrix = patch_matrix.contract(filter_matrix, dim_pair);
+        ApplyBiasActivation(bias_data, end - begin, out_depth, tile_output);
+      }
+    };
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_tiles,
+          pixels_per_tile * patch_size * out_depth, compute_tiles);
+  }
+
+ private:
+  // Upper bound on the size of a tile's im2col buffer and of its output, so
+  // that both stay in the per-core caches.
+  static constexpr int64 kTileBytes = 256 * 1024;
+
+  void ApplyBiasActivation(const float* bias, int64 rows, int64 depth,
+                           float* output) const {
+    switch (activation_) {
+      case FusedActivation::kNone:
+        BiasActivate<FusedActivation::kNone>(bias, rows, depth, output);
+        break;
+      case FusedActivation::kRelu:
+        BiasActivate<FusedActivation::kRelu>(bias, rows, depth, output);
+        break;
+      case FusedActivation::kRelu6:
+        BiasActivate<FusedActivation::kRelu6>(bias, rows, depth, output);
+        break;
+    }
+  }
+
+  std::vector<int32> strides_;
+  Padding padding_;
+  FusedActivation activation_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedConv2DBiasActivationOp);
+};
+
+}  // namespace
+
+REGISTER_KERNEL_BUILDER(Name("_FusedConv2DBiasActivation")
+                            .Device(DEVICE_CPU)
+                            .TypeConstraint<float>("T"),
+                        FusedConv2DBiasActivationOp);
+
 }  // namespace tensorflow
@@ -101,6 +101,12 @@ bool CanUseDeepConv2D(int stride_rows, int stride_cols, int filter_rows,
                       int filter_cols, int in_depth, int out_depth,
                       int out_rows, int out_cols);
 
+// Returns true if DeepConv2D implements convolutions with the given strides
+// and filter size, regardless of cost or whether the feature is enabled.
+// Used by the CPU convolution autotuner to pick candidates.
+bool DeepConv2DSupportsShape(int stride_rows, int stride_cols, int filter_rows,
+                             int filter_cols);
+
 namespace functor {
 
 // Calls DeepConv2D implementation (see deep_conv2d.cc for details).
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <algorithm>
 #include <deque>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/framework/tensor.h"
@@ -34,19 +36,161 @@ namespace tensorflow {
 FIFOQueue::FIFOQueue(int capacity, const DataTypeVector& component_dtypes,
                      const std::vector<TensorShape>& component_shapes,
                      const string& name)
-    : TypedQueue(capacity, component_dtypes, component_shapes, name) {}
+    : TypedQueue(capacity, component_dtypes, component_shapes, name),
+      fast_path_closed_(false),
+      fast_ops_in_flight_(0),
+      ring_bytes_(0) {
+  if (capacity_ > 0 && capacity_ <= kMaxRingCapacity) {
+    ring_.reset(new MpmcRingBuffer<Element>(capacity_));
+  }
+}
+
+/* static */
+int64 FIFOQueue::ElementBytes(const Element& element) {
+  int64 bytes = 0;
+  for (const PersistentTensor& component : element) {
+    bytes += component.AllocatedBytes();
+  }
+  return bytes;
+}
+
+bool FIFOQueue::PushToRing(Element* element) {
+  const int64 bytes = ElementBytes(*element);
+  ring_bytes_.fetch_add(bytes);
+  if (!ring_->TryPush(element)) {
+    ring_bytes_.fetch_sub(bytes);
+    return false;
+  }
+  return true;
+}
+
+int64 FIFOQueue::SizeLocked() const {
+  if (ring_ == nullptr) {
+    return queues_[0].size();
+  }
+  return restored_.size() + ring_->size();
+}
+
+bool FIFOQueue::EnqueueLocked(Element* element) {
+  if (ring_ != nullptr) {
+    return PushToRing(element);
+  }
+  if (queues_[0].size() >= static_cast<size_t>(capacity_)) {
+    return false;
+  }
+  for (int i = 0; i < num_components(); ++i) {
+    queues_[i].push_back(std::move((*element)[i]));
+  }
+  return true;
+}
 
-void FIFOQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
-  DCHECK_GT(queues_[0].size(), size_t{0});
+bool FIFOQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
+  Element element;
+  if (!restored_.empty()) {
+    element = std::move(restored_.front());
+    restored_.pop_front();
+  } else if (ring_ != nullptr) {
+    if (!ring_->TryPop(&element)) return false;
+  } else {
+    if (queues_[0].empty()) return false;
+    (*tuple).reserve(num_components());
+    for (int i = 0; i < num_components(); ++i) {
+      (*tuple).push_back(*queues_[i][0].AccessTensor(ctx));
+      queues_[i].pop_front();
+    }
+    return true;
+  }
+  ring_bytes_.fetch_sub(ElementBytes(element));
   (*tuple).reserve(num_components());
   for (int i = 0; i < num_components(); ++i) {
-    (*tuple).push_back(*queues_[i][0].AccessTensor(ctx));
-    queues_[i].pop_front();
+    (*tuple).push_back(*element[i].AccessTensor(ctx));
+  }
+  return true;
+}
+
+void FIFOQueue::RestoreLocked(Element* element) {
+  if (ring_ != nullptr) {
+    ring_bytes_.fetch_add(ElementBytes(*element));
+    restored_.push_front(std::move(*element));
+    return;
+  }
+  for (int i = 0; i < num_components(); ++i) {
+    queues_[i].push_front(std::move((*element)[i]));
   }
 }
 
+bool FIFOQueue::TryEnqueueFast(const Tuple& tuple) {
+  // Let blocked operations go first, so that the fast path does not
+  // overtake them.
+  if (ring_ == nullptr || has_pending_attempts_.load()) return false;
+  bool enqueued = false;
+  fast_ops_in_flight_.fetch_add(1);
+  if (!fast_path_closed_.load()) {
+    Element element;
+    element.reserve(num_components());
+    for (int i = 0; i < num_components(); ++i) {
+      element.push_back(PersistentTensor(tuple[i]));
+    }
+    enqueued = PushToRing(&element);
+  }
+  fast_ops_in_flight_.fetch_sub(1);
+  if (enqueued) {
+    // A dequeue may have blocked on the empty queue since the check above.
+    // The fence pairs with the one in FlushUnlocked(): either that dequeue
+    // sees the new element, or we see its attempt and flush it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_pending_attempts_.load()) FlushUnlocked();
+  }
+  return enqueued;
+}
+
+bool FIFOQueue::TryDequeueFast(OpKernelContext* ctx, Tuple* tuple) {
+  if (ring_ == nullptr || has_pending_attempts_.load()) return false;
+  Element element;
+  bool dequeued = false;
+  fast_ops_in_flight_.fetch_add(1);
+  if (!fast_path_closed_.load()) {
+    dequeued = ring_->TryPop(&element);
+  }
+  fast_ops_in_flight_.fetch_sub(1);
+  if (!dequeued) return false;
+  ring_bytes_.fetch_sub(ElementBytes(element));
+  tuple->reserve(num_components());
+  for (int i = 0; i < num_components(); ++i) {
+    tuple->push_back(*element[i].AccessTensor(ctx));
+  }
+  // Likewise, an enqueue may have blocked on the full queue.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (has_pending_attempts_.load()) FlushUnlocked();
+  return true;
+}
+
+void FIFOQueue::Close(OpKernelContext* ctx, bool cancel_pending_enqueues,
+                      DoneCallback callback) {
+  // Once closed_ may be set, every operation must observe it, so retire the
+  // fast path first.
+  fast_path_closed_.store(true);
+  while (fast_ops_in_flight_.load() > 0) {
+    std::this_thread::yield();
+  }
+  QueueBase::Close(ctx, cancel_pending_enqueues, callback);
+}
+
+int64 FIFOQueue::MemoryUsed() const {
+  if (ring_ == nullptr) {
+    return TypedQueue::MemoryUsed();
+  }
+  // Elements in the ring cannot be inspected without dequeuing them, so
+  // their bytes are counted as they come and go.
+  return ring_bytes_.load();
+}
+
 void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                            DoneCallback callback) {
+  if (TryEnqueueFast(tuple)) {
+    callback();
+    return;
+  }
   CancellationManager* cm = ctx->cancellation_manager();
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
@@ -63,14 +207,15 @@ void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                   errors::Cancelled("FIFOQueue '", name_, "' is closed."));
               return kComplete;
             }
-            if (queues_[0].size() < static_cast<size_t>(capacity_)) {
-              for (int i = 0; i < num_components(); ++i) {
-                queues_[i].push_back(PersistentTensor(tuple[i]));
-              }
-              return kComplete;
-            } else {
+            if (SizeLocked() >= capacity_) {
               return kNoProgress;
             }
+            Element element;
+            element.reserve(num_components());
+            for (int i = 0; i < num_components(); ++i) {
+              element.push_back(PersistentTensor(tuple[i]));
+            }
+            return EnqueueLocked(&element) ? kComplete : kNoProgress;
           });
     }
   }
@@ -122,17 +267,17 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
               return kComplete;
             }
             RunResult result = kNoProgress;
-            while (queues_[0].size() < static_cast<size_t>(capacity_)) {
-              result = kProgress;
+            while (SizeLocked() < capacity_) {
               const int64 index =
                   tuple[0].dim_size(0) - attempt->elements_requested;
+              Element element(num_components());
               for (int i = 0; i < num_components(); ++i) {
-                PersistentTensor element;
                 attempt->context->SetStatus(GetElementComponentFromBatch(
-                    tuple, index, i, attempt->context, &element));
+                    tuple, index, i, attempt->context, &element[i]));
                 if (!attempt->context->status().ok()) return kComplete;
-                queues_[i].push_back(element);
               }
+              if (!EnqueueLocked(&element)) break;
+              result = kProgress;
               --attempt->elements_requested;
               if (attempt->elements_requested == 0) {
                 return kComplete;
@@ -151,6 +296,11 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
 }
 
 void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
+  Tuple fast_tuple;
+  if (TryDequeueFast(ctx, &fast_tuple)) {
+    callback(fast_tuple);
+    return;
+  }
   CancellationManager* cm = ctx->cancellation_manager();
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
@@ -163,22 +313,19 @@ void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
       dequeue_attempts_.emplace_back(
           1, [callback]() { callback(Tuple()); }, ctx, cm, token,
           [callback, this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-            const int64 queue_size = queues_[0].size();
-            if (closed_ && queue_size == 0) {
+            Tuple tuple;
+            if (DequeueLocked(attempt->context, &tuple)) {
+              attempt->done_callback = [callback, tuple]() { callback(tuple); };
+              return kComplete;
+            }
+            if (closed_) {
               attempt->context->SetStatus(errors::OutOfRange(
                   "FIFOQueue '", name_, "' is closed and has ",
                   "insufficient elements (requested ", 1, ", current size ",
-                  queue_size, ")"));
+                  0, ")"));
               return kComplete;
             }
-            if (queue_size > 0) {
-              Tuple tuple;
-              DequeueLocked(attempt->context, &tuple);
-              attempt->done_callback = [callback, tuple]() { callback(tuple); };
-              return kComplete;
-            } else {
-              return kNoProgress;
-            }
+            return kNoProgress;
           });
     }
   }
@@ -255,36 +402,24 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
           num_elements, [callback]() { callback(Tuple()); }, ctx, cm, token,
           [callback, allow_small_batch, this](Attempt* attempt)
               EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-                int64 queue_size = queues_[0].size();
+                int64 queue_size = SizeLocked();
 
                 if (closed_ && queue_size < attempt->elements_requested) {
                   // If we don't have enough for a full dequeue, we have
-                  // to reset the attempt tuple.
-                  if (!attempt->tuple.empty()) {
-                    // Restore already-dequeued elements to the front of the
-                    // queue.
-                    for (int64 i = attempt->tuple[0].dim_size(0) -
-                                   attempt->elements_requested - 1;
-                         i >= 0; --i) {
-                      for (int j = 0; j < num_components(); ++j) {
-                        PersistentTensor element;
-                        Status s = GetElementComponentFromBatch(
-                            attempt->tuple, i, j, attempt->context, &element);
-                        if (!s.ok()) {
-                          attempt->context->SetStatus(
-                              errors::DataLoss("Failed to restore element from "
-                                               "partially-dequeued batch "
-                                               "to FIFOQueue: ",
-                                               s.error_message()));
-                        }
-                        queues_[j].push_front(element);
-                      }
+                  // to reset the attempt tuples: restore already-dequeued
+                  // elements to the front of the queue.
+                  for (int64 i = attempt->tuples.size() - 1; i >= 0; --i) {
+                    Element element;
+                    element.reserve(num_components());
+                    for (const Tensor& component : attempt->tuples[i]) {
+                      element.emplace_back(component);
                     }
+                    RestoreLocked(&element);
                   }
-                  if (allow_small_batch && queues_[0].size() > 0) {
+                  attempt->tuples.clear();
+                  if (allow_small_batch && SizeLocked() > 0) {
                     // Request all remaining elements in the queue.
-                    queue_size = queues_[0].size();
-                    attempt->tuple.clear();
+                    queue_size = SizeLocked();
                     attempt->elements_requested = queue_size;
                   } else {
                     if (allow_small_batch) {
@@ -306,38 +441,28 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
 
                 RunResult result = kNoProgress;
                 for (; queue_size > 0; --queue_size) {
-                  if (attempt->tuple.empty()) {
-                    // Only allocate tuple when we have something to dequeue
-                    // so we don't use excessive memory when there are many
-                    // blocked dequeue attempts waiting.
-                    attempt->tuple.reserve(num_components());
-                    for (int i = 0; i < num_components(); ++i) {
-                      const TensorShape shape =
-                          ManyOutShape(i, attempt->elements_requested);
-                      Tensor element;
-                      attempt->context->SetStatus(
-                          attempt->context->allocate_temp(component_dtypes_[i],
-                                                          shape, &element));
-                      if (!attempt->context->status().ok()) return kComplete;
-                      attempt->tuple.emplace_back(element);
-                    }
-                  }
-                  result = kProgress;
+                  // Only take references to the dequeued elements here; the
+                  // batch is allocated and filled once mu_ is released, so
+                  // that large batches do not hold up other producers and
+                  // consumers.
                   Tuple tuple;
-                  DequeueLocked(attempt->context, &tuple);
-                  const int64 index = attempt->tuple[0].dim_size(0) -
-                                      attempt->elements_requested;
-                  for (int i = 0; i < num_components(); ++i) {
-                    attempt->context->SetStatus(CopyElementToSlice(
-                        tuple[i], &attempt->tuple[i], index));
-                    if (!attempt->context->status().ok()) return kComplete;
-                  }
-                  tuple.clear();
+                  if (!DequeueLocked(attempt->context, &tuple)) break;
+                  result = kProgress;
+                  attempt->tuples.push_back(std::move(tuple));
                   --attempt->elements_requested;
                   if (attempt->elements_requested == 0) {
-                    tuple = attempt->tuple;
-                    attempt->done_callback = [callback, tuple]() {
-                      callback(tuple);
+                    std::vector<Tuple> tuples;
+                    tuples.swap(attempt->tuples);
+                    OpKernelContext* ctx = attempt->context;
+                    attempt->done_callback = [this, ctx, callback, tuples]() {
+                      Tuple batch;
+                      Status s = CopyTuplesToBatch(ctx, tuples, &batch);
+                      if (!s.ok()) {
+                        ctx->SetStatus(s);
+                        callback(Tuple());
+                        return;
+                      }
+                      callback(batch);
                     };
                     return kComplete;
                   }
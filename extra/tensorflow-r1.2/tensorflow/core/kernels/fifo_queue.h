@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_KERNELS_FIFO_QUEUE_H_
 #define TENSORFLOW_KERNELS_FIFO_QUEUE_H_
 
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
@@ -27,9 +29,17 @@ limitations under the License.
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/mpmc_ring_buffer.h"
 
 namespace tensorflow {
 
+// A FIFOQueue whose capacity is bounded by kMaxRingCapacity keeps its
+// elements in a lock-free ring buffer. Enqueue and Dequeue of a single
+// element then complete without taking mu_, as long as the queue is neither
+// full nor empty and no other operation is blocked; otherwise they fall back
+// to the attempt lists of QueueBase, which also serve all other operations.
+// Unbounded queues keep their elements in queues_ and always use the attempt
+// lists.
 class FIFOQueue : public TypedQueue<std::deque<PersistentTensor> > {
  public:
   FIFOQueue(int32 capacity, const DataTypeVector& component_dtypes,
@@ -46,26 +56,78 @@ class FIFOQueue : public TypedQueue<std::deque<PersistentTensor> > {
   void TryDequeueMany(int num_elements, OpKernelContext* ctx,
                       bool allow_small_batch,
                       CallbackWithTuple callback) override;
+  void Close(OpKernelContext* ctx, bool cancel_pending_enqueues,
+             DoneCallback callback) override;
   Status MatchesNodeDef(const NodeDef& node_def) override;
 
   int32 size() override {
     mutex_lock lock(mu_);
-    return queues_[0].size();
+    return SizeLocked();
   }
 
+  int64 MemoryUsed() const override;
+
  protected:
   ~FIFOQueue() override {}
 
-  // Helper for dequeuing a single element from queues_.
-  void DequeueLocked(OpKernelContext* ctx, Tuple* tuple)
+  // A queue element: one PersistentTensor per component.
+  typedef std::vector<PersistentTensor> Element;
+
+  // Helpers for accessing the elements, wherever they are stored. Until the
+  // queue is closed, fast-path operations may change the ring buffer at any
+  // time, so SizeLocked() is only a hint and EnqueueLocked() and
+  // DequeueLocked() may fail even when it suggests otherwise.
+  int64 SizeLocked() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Appends *element and returns true, or returns false if the queue is
+  // full.
+  bool EnqueueLocked(Element* element) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Helper for dequeuing a single element. Returns false if the queue is
+  // empty.
+  bool DequeueLocked(OpKernelContext* ctx, Tuple* tuple)
       EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Returns *element to the front of a closed queue.
+  void RestoreLocked(Element* element) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   static Status GetElementComponentFromBatch(const Tuple& tuple, int64 index,
                                              int component,
                                              OpKernelContext* ctx,
                                              PersistentTensor* out_element);
 
  private:
+  // Largest capacity for which the ring buffer, which is allocated up front,
+  // is used.
+  static const int32 kMaxRingCapacity = 1 << 16;
+
+  // Lock-free Enqueue and Dequeue of a single element. Return false if the
+  // operation must go through the attempt lists instead.
+  bool TryEnqueueFast(const Tuple& tuple);
+  bool TryDequeueFast(OpKernelContext* ctx, Tuple* tuple);
+
+  // Pushes *element onto ring_ and accounts for its bytes. Returns false if
+  // the ring is full.
+  bool PushToRing(Element* element);
+
+  // Returns the bytes allocated by the components of element.
+  static int64 ElementBytes(const Element& element);
+
+  // Non-null if capacity_ <= kMaxRingCapacity.
+  std::unique_ptr<MpmcRingBuffer<Element>> ring_;
+  // Elements put back by a DequeueMany on a closed queue. They precede the
+  // elements in ring_.
+  std::deque<Element> restored_ GUARDED_BY(mu_);
+  // Set by Close(), which then waits until fast_ops_in_flight_ is zero.
+  // From then on every operation goes through the attempt lists, which
+  // observe closed_.
+  std::atomic<bool> fast_path_closed_;
+  std::atomic<int32> fast_ops_in_flight_;
+  // Bytes allocated by the elements in ring_ and restored_, for
+  // MemoryUsed(). Added before an element is pushed, so that it never
+  // becomes negative.
+  std::atomic<int64> ring_bytes_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(FIFOQueue);
 };
 
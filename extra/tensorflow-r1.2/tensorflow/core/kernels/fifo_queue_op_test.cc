@@ -0,0 +1,110 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Contention benchmark: each step runs `num_pairs` QueueEnqueueV2 and
+// `num_pairs` QueueDequeueV2 ops against one FIFOQueueV2 concurrently, so
+// producers and consumers race on the queue from all inter-op threads. A
+// `capacity` of -1 makes the queue unbounded, which disables the lock-free
+// path.
+static void BM_FIFOQueueContention(int iters, int num_pairs, int capacity) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* queue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("queue"), "FIFOQueueV2")
+                  .Attr("component_types", {DT_FLOAT})
+                  .Attr("capacity", capacity)
+                  .Finalize(g, &queue));
+  Node* value = test::graph::Constant(g, test::AsScalar<float>(1.0f));
+  for (int i = 0; i < num_pairs; ++i) {
+    Node* enqueue;
+    TF_CHECK_OK(NodeBuilder(g->NewName("enqueue"), "QueueEnqueueV2")
+                    .Input(queue)
+                    .Input({NodeBuilder::NodeOut(value)})
+                    .Finalize(g, &enqueue));
+    Node* dequeue;
+    TF_CHECK_OK(NodeBuilder(g->NewName("dequeue"), "QueueDequeueV2")
+                    .Input(queue)
+                    .Attr("component_types", {DT_FLOAT})
+                    .Finalize(g, &dequeue));
+  }
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_pairs);
+  testing::UseRealTime();
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+BENCHMARK(BM_FIFOQueueContention)
+    ->ArgPair(1, 100)
+    ->ArgPair(16, 100)
+    ->ArgPair(256, 100)
+    ->ArgPair(256, 1000)
+    ->ArgPair(1, -1)
+    ->ArgPair(16, -1)
+    ->ArgPair(256, -1);
+
+// Batching benchmark: each step enqueues `batch_size` elements of
+// `element_size` floats with QueueEnqueueManyV2 and takes them out again with
+// a single QueueDequeueManyV2, so the time is dominated by assembling the
+// dequeued batch.
+static void BM_FIFOQueueDequeueMany(int iters, int batch_size,
+                                    int element_size) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* queue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("queue"), "FIFOQueueV2")
+                  .Attr("component_types", {DT_FLOAT})
+                  .Attr("shapes", {TensorShape({element_size})})
+                  .Attr("capacity", batch_size)
+                  .Finalize(g, &queue));
+  Tensor values(DT_FLOAT, TensorShape({batch_size, element_size}));
+  values.flat<float>().setRandom();
+  Node* enqueue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("enqueue"), "QueueEnqueueManyV2")
+                  .Input(queue)
+                  .Input({NodeBuilder::NodeOut(
+                      test::graph::Constant(g, values))})
+                  .Finalize(g, &enqueue));
+  Node* dequeue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("dequeue"), "QueueDequeueManyV2")
+                  .Input(queue)
+                  .Input(test::graph::Constant(g, test::AsScalar(batch_size)))
+                  .Attr("component_types", {DT_FLOAT})
+                  .Finalize(g, &dequeue));
+  testing::BytesProcessed(static_cast<int64>(iters) * batch_size *
+                          element_size * sizeof(float));
+  testing::UseRealTime();
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+BENCHMARK(BM_FIFOQueueDequeueMany)
+    ->ArgPair(32, 1024)
+    ->ArgPair(32, 150528)
+    ->ArgPair(256, 1024);
+
+}  // namespace
+}  // namespace tensorflow
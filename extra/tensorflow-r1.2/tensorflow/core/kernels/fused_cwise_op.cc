@@ -0,0 +1,250 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Number of floats per block; 16KB of them stay in L1.
+const int64 kBlockSize = 4096;
+
+}  // namespace
+
+// Evaluates the chain block by block: each block of the output is written
+// from the input by the first operation, and then updated in place by the
+// others while it is still in L1, so the tensor is read and written once
+// however long the chain is.
+class FusedCwiseOp : public OpKernel {
+ public:
+  explicit FusedCwiseOp(OpKernelConstruction* context) : OpKernel(context) {
+    std::vector<string> ops;
+    std::vector<float> scalars;
+    OP_REQUIRES_OK(context, context->GetAttr("ops", &ops));
+    OP_REQUIRES_OK(context, context->GetAttr("scalars", &scalars));
+    OP_REQUIRES(context, ops.size() == scalars.size(),
+                errors::InvalidArgument("ops and scalars must have the same "
+                                        "length, got ",
+                                        ops.size(), " and ", scalars.size()));
+    cost_per_element_ = 0;
+    for (int i = 0; i < ops.size(); ++i) {
+      Step step;
+      OP_REQUIRES(context, ParseKind(ops[i], &step.kind, &step.cost),
+                  errors::InvalidArgument("Unsupported element-wise op ",
+                                          ops[i]));
+      step.scalar = scalars[i];
+      steps_.push_back(step);
+      cost_per_element_ += step.cost;
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& input = context->input(0);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
+                                {0}, 0, input.shape(), &output));
+    const int64 size = input.NumElements();
+    if (size == 0) return;
+    const float* in = input.flat<float>().data();
+    float* out = output->flat<float>().data();
+    auto work = [this, in, out](int64 begin, int64 end) {
+      for (int64 start = begin; start < end; start += kBlockSize) {
+        const int64 n = std::min<int64>(kBlockSize, end - start);
+        Array block(out + start, n);
+        Apply(steps_[0], ConstArray(in + start, n), &block);
+        for (int i = 1; i < steps_.size(); ++i) {
+          Apply(steps_[i], block, &block);
+        }
+      }
+    };
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, size,
+          cost_per_element_, work);
+  }
+
+ private:
+  typedef Eigen::Map<Eigen::ArrayXf> Array;
+  typedef Eigen::Map<const Eigen::ArrayXf> ConstArray;
+
+  enum Kind {
+    kAbs,
+    kCeil,
+    kExp,
+    kFloor,
+    kLog,
+    kNeg,
+    kReciprocal,
+    kRelu,
+    kRelu6,
+    kRsqrt,
+    kSigmoid,
+    kSqrt,
+    kSquare,
+    kTanh,
+    kAdd,
+    kSub,
+    kRSub,
+    kMul,
+    kDiv,
+    kRDiv,
+    kMaximum,
+    kMinimum,
+  };
+
+  struct Step {
+    Kind kind;
+    float scalar;
+    int cost;
+  };
+
+  static bool ParseKind(const string& op, Kind* kind, int* cost) {
+    static const struct {
+      const char* name;
+      Kind kind;
+      int cost;
+    } kKinds[] = {
+        {"Abs", kAbs, 1},
+        {"Ceil", kCeil, 1},
+        {"Exp", kExp, 20},
+        {"Floor", kFloor, 1},
+        {"Log", kLog, 20},
+        {"Neg", kNeg, 1},
+        {"Reciprocal", kReciprocal, 5},
+        {"Inv", kReciprocal, 5},
+        {"Relu", kRelu, 1},
+        {"Relu6", kRelu6, 2},
+        {"Rsqrt", kRsqrt, 10},
+        {"Sigmoid", kSigmoid, 25},
+        {"Sqrt", kSqrt, 5},
+        {"Square", kSquare, 1},
+        {"Tanh", kTanh, 25},
+        {"Add", kAdd, 1},
+        {"Sub", kSub, 1},
+        {"RSub", kRSub, 1},
+        {"Mul", kMul, 1},
+        {"Div", kDiv, 5},
+        {"RealDiv", kDiv, 5},
+        {"RDiv", kRDiv, 5},
+        {"Maximum", kMaximum, 1},
+        {"Minimum", kMinimum, 1},
+    };
+    for (const auto& entry : kKinds) {
+      if (op == entry.name) {
+        *kind = entry.kind;
+        *cost = entry.cost;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Sets `out` to the result of `step` on `in`, which may be `out` itself.
+  template <typename In>
+  static void Apply(const Step& step, const In& in, Array* out) {
+    const float c = step.scalar;
+    switch (step.kind) {
+      case kAbs:
+        *out = in.abs();
+        break;
+      case kCeil:
+        *out = in.ceil();
+        break;
+      case kExp:
+        *out = in.exp();
+        break;
+      case kFloor:
+        *out = in.floor();
+        break;
+      case kLog:
+        *out = in.log();
+        break;
+      case kNeg:
+        *out = -in;
+        break;
+      case kReciprocal:
+        *out = in.inverse();
+        break;
+      case kRelu:
+        *out = in.max(0.0f);
+        break;
+      case kRelu6:
+        *out = in.max(0.0f).min(6.0f);
+        break;
+      case kRsqrt:
+        *out = in.sqrt().inverse();
+        break;
+      case kSigmoid:
+        *out = ((-in).exp() + 1.0f).inverse();
+        break;
+      case kSqrt:
+        *out = in.sqrt();
+        break;
+      case kSquare:
+        *out = in.square();
+        break;
+      case kTanh:
+        *out = in.tanh();
+        break;
+      case kAdd:
+        *out = in + c;
+        break;
+      case kSub:
+        *out = in - c;
+        break;
+      case kRSub:
+        *out = c - in;
+        break;
+      case kMul:
+        *out = in * c;
+        break;
+      case kDiv:
+        *out = in / c;
+        break;
+      case kRDiv:
+        *out = c * in.inverse();
+        break;
+      case kMaximum:
+        *out = in.max(c);
+        break;
+      case kMinimum:
+        *out = in.min(c);
+        break;
+    }
+  }
+
+  std::vector<Step> steps_;
+  int cost_per_element_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedCwiseOp);
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("_FusedCwise").Device(DEVICE_CPU).TypeConstraint<float>("T"),
+    FusedCwiseOp);
+
+}  // namespace tensorflow
@@ -0,0 +1,147 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedCwiseOpTest : public OpsTestBase {
+ protected:
+  Status MakeOp(const std::vector<string>& ops,
+                const std::vector<float>& scalars) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("fused", "_FusedCwise")
+                           .Input(FakeInput(DT_FLOAT))
+                           .Attr("ops", ops)
+                           .Attr("scalars", scalars)
+                           .Finalize(node_def()));
+    return InitOp();
+  }
+
+  // Runs the op on `size` values in [-3, 3) and compares each output with
+  // `expected` applied to the input.
+  void ExpectMatches(int64 size, const std::function<float(float)>& expected) {
+    std::vector<float> input(size);
+    for (int64 i = 0; i < size; ++i) {
+      input[i] = -3.0f + 6.0f * (i % 1000) / 1000.0f;
+    }
+    AddInputFromArray<float>(TensorShape({size}), input);
+    TF_ASSERT_OK(RunOpKernel());
+    auto output = GetOutput(0)->flat<float>();
+    ASSERT_EQ(size, output.size());
+    for (int64 i = 0; i < size; ++i) {
+      const float want = expected(input[i]);
+      EXPECT_NEAR(want, output(i), 1e-5 * std::max(1.0f, std::abs(want)))
+          << "at " << input[i];
+    }
+  }
+};
+
+TEST_F(FusedCwiseOpTest, ScalarOperands) {
+  TF_ASSERT_OK(MakeOp({"Mul", "Add", "RSub", "Div", "RDiv", "Maximum",
+                       "Minimum", "Sub"},
+                      {2.0f, 0.5f, 1.0f, 4.0f, 3.0f, -2.0f, 5.0f, 0.25f}));
+  ExpectMatches(5000, [](float x) {
+    x = 3.0f / ((1.0f - (x * 2.0f + 0.5f)) / 4.0f);
+    return std::min(std::max(x, -2.0f), 5.0f) - 0.25f;
+  });
+}
+
+TEST_F(FusedCwiseOpTest, UnaryOps) {
+  TF_ASSERT_OK(MakeOp({"Tanh", "Square", "Sqrt", "Neg", "Exp", "Reciprocal",
+                       "Log", "Abs", "Rsqrt", "Sigmoid"},
+                      {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}));
+  ExpectMatches(3000, [](float x) {
+    x = std::log(1.0f / std::exp(-std::sqrt(std::tanh(x) * std::tanh(x))));
+    x = 1.0f / std::sqrt(std::abs(x));
+    return 1.0f / (1.0f + std::exp(-x));
+  });
+}
+
+TEST_F(FusedCwiseOpTest, Activations) {
+  TF_ASSERT_OK(MakeOp({"Mul", "Relu6", "Sub", "Relu", "Floor", "Ceil"},
+                      {3.0f, 0, 2.5f, 0, 0, 0}));
+  ExpectMatches(100000, [](float x) {
+    x = std::min(std::max(x * 3.0f, 0.0f), 6.0f) - 2.5f;
+    return std::ceil(std::floor(std::max(x, 0.0f)));
+  });
+}
+
+TEST_F(FusedCwiseOpTest, UnsupportedOp) {
+  Status s = MakeOp({"Relu", "Softplus"}, {0, 0});
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("Softplus")) << s;
+}
+
+TEST_F(FusedCwiseOpTest, MismatchedScalars) {
+  Status s = MakeOp({"Relu", "Add"}, {0});
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("same length")) << s;
+}
+
+// y = Tanh(Relu(x * 0.5 + 1) - 2), either as separate ops or fused.
+static Graph* CwiseChain(int64 size, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, TensorShape({size}));
+  input.flat<float>().setRandom();
+  Node* x = test::graph::Constant(g, input);
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedCwise")
+                    .Input(x)
+                    .Attr("ops", {"Mul", "Add", "Relu", "Sub", "Tanh"})
+                    .Attr("scalars", {0.5f, 1.0f, 0.0f, 2.0f, 0.0f})
+                    .Finalize(g, nullptr));
+    return g;
+  }
+  auto scalar = [g](float value) {
+    Tensor t(DT_FLOAT, TensorShape({}));
+    t.scalar<float>()() = value;
+    return test::graph::Constant(g, t);
+  };
+  x = test::graph::Binary(g, "Mul", x, scalar(0.5f));
+  x = test::graph::Binary(g, "Add", x, scalar(1.0f));
+  x = test::graph::Unary(g, "Relu", x);
+  x = test::graph::Binary(g, "Sub", x, scalar(2.0f));
+  test::graph::Unary(g, "Tanh", x);
+  return g;
+}
+
+static void BM_CwiseChain(int iters, int size, int fused) {
+  testing::ItemsProcessed(static_cast<int64>(iters) * size);
+  testing::UseRealTime();
+  test::Benchmark("cpu", CwiseChain(size, fused)).Run(iters);
+}
+
+BENCHMARK(BM_CwiseChain)
+    ->ArgPair(1 << 16, 0)
+    ->ArgPair(1 << 16, 1)
+    ->ArgPair(1 << 22, 0)
+    ->ArgPair(1 << 22, 1);
+
+}  // namespace
+}  // namespace tensorflow
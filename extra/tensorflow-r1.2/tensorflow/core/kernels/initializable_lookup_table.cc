@@ -29,7 +29,7 @@ Status InitializableLookupTable::Find(OpKernelContext* ctx, const Tensor& keys,
   // Do not let the use migrate before the check;  table is used without
   // a lock by the readers.
   std::atomic_thread_fence(std::memory_order_acquire);
-  return DoFind(keys, values, default_value);
+  return DoFind(ctx, keys, values, default_value);
 }
 
 Status InitializableLookupTable::Initialize(InitTableIterator& iter) {
@@ -52,6 +52,7 @@ Status InitializableLookupTable::Initialize(InitTableIterator& iter) {
   if (!errors::IsOutOfRange(iter.status())) {
     return iter.status();
   }
+  TF_RETURN_IF_ERROR(DoFinalize());
 
   // Prevent compiler/memory reordering of is_initialized and
   // the initialization itself.
@@ -133,9 +133,15 @@ class InitializableLookupTable : public LookupInterface {
   // underlying data structure.
   virtual Status DoInsert(const Tensor& keys, const Tensor& values) = 0;
 
+  // Called once all elements have been inserted, before the table is marked
+  // as initialized and becomes visible to concurrent readers. Implementations
+  // may use it to build read-optimized structures.
+  virtual Status DoFinalize() { return Status::OK(); }
+
   // Performs the batch find operation on the underlying data structure.
-  virtual Status DoFind(const Tensor& keys, Tensor* values,
-                        const Tensor& default_value) = 0;
+  // `ctx` may be used to parallelize large lookups; it may be null.
+  virtual Status DoFind(OpKernelContext* ctx, const Tensor& keys,
+                        Tensor* values, const Tensor& default_value) = 0;
 
   mutex mu_;
   bool is_initialized_ = false;
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <array>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -25,6 +26,8 @@ limitations under the License.
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/util/memmapped_lookup_table.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -34,6 +37,10 @@ namespace lookup {
 // required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// Keys are partitioned by hash over kNumShards independently locked
+// unordered_maps, so concurrent lookups and inserts of different keys rarely
+// contend. Each batch is grouped by shard first, so every shard lock is taken
+// at most once per call.
 //
 // Sample use case:
 //
@@ -49,8 +56,12 @@ class MutableHashTableOfScalars final : public LookupInterface {
   MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
 
   size_t size() const override {
-    mutex_lock l(mu_);
-    return table_.size();
+    size_t size = 0;
+    for (const TableShard& shard : shards_) {
+      mutex_lock l(shard.mu);
+      size += shard.table.size();
+    }
+    return size;
   }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
@@ -59,13 +70,20 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
-    mutex_lock l(mu_);
-    for (int64 i = 0; i < key_values.size(); ++i) {
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
-          default_val);
+    std::vector<int64> positions;
+    ShardOffsets shard_begin;
+    GroupByShard(key_values, &positions, &shard_begin);
+    for (int s = 0; s < kNumShards; ++s) {
+      if (shard_begin[s] == shard_begin[s + 1]) continue;
+      const TableShard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64 p = shard_begin[s]; p < shard_begin[s + 1]; ++p) {
+        const int64 i = positions[p];
+        value_values(i) = gtl::FindWithDefault(
+            shard.table, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
+            default_val);
+      }
     }
-
     return Status::OK();
   }
 
@@ -73,14 +91,25 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
+    std::vector<int64> positions;
+    ShardOffsets shard_begin;
+    GroupByShard(key_values, &positions, &shard_begin);
     if (clear) {
-      table_.clear();
+      // Replace the contents atomically with respect to concurrent readers.
+      LockAllShards();
+      for (int s = 0; s < kNumShards; ++s) {
+        shards_[s].table.clear();
+        InsertLocked(key_values, value_values, positions, shard_begin[s],
+                     shard_begin[s + 1], &shards_[s]);
+      }
+      UnlockAllShards();
+      return Status::OK();
     }
-    for (int64 i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_,
-                          SubtleMustCopyUnlessStringOrFloat(key_values(i)),
-                          SubtleMustCopyUnlessStringOrFloat(value_values(i)));
+    for (int s = 0; s < kNumShards; ++s) {
+      if (shard_begin[s] == shard_begin[s + 1]) continue;
+      mutex_lock l(shards_[s].mu);
+      InsertLocked(key_values, value_values, positions, shard_begin[s],
+                   shard_begin[s + 1], &shards_[s]);
     }
     return Status::OK();
   }
@@ -96,24 +125,32 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    mutex_lock l(mu_);
-    int64 size = table_.size();
+    LockAllShards();
+    int64 size = 0;
+    for (const TableShard& shard : shards_) {
+      size += shard.table.size();
+    }
 
     Tensor* keys;
     Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("values", TensorShape({size}), &values));
-
-    auto keys_data = keys->flat<K>();
-    auto values_data = values->flat<V>();
-    int64 i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
+    Status s = ctx->allocate_output("keys", TensorShape({size}), &keys);
+    if (s.ok()) {
+      s = ctx->allocate_output("values", TensorShape({size}), &values);
     }
-    return Status::OK();
+    if (s.ok()) {
+      auto keys_data = keys->flat<K>();
+      auto values_data = values->flat<V>();
+      int64 i = 0;
+      for (const TableShard& shard : shards_) {
+        for (auto it = shard.table.begin(); it != shard.table.end();
+             ++it, ++i) {
+          keys_data(i) = it->first;
+          values_data(i) = it->second;
+        }
+      }
+    }
+    UnlockAllShards();
+    return s;
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -125,9 +162,67 @@ class MutableHashTableOfScalars final : public LookupInterface {
   TensorShape value_shape() const override { return TensorShape(); }
 
  private:
-  // TODO(andreasst): consider using a read/write lock or a concurrent map
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ GUARDED_BY(mu_);
+  static constexpr int kNumShards = 16;
+  static constexpr int kShardShift = 60;  // 64 - log2(kNumShards)
+
+  typedef std::array<int64, kNumShards + 1> ShardOffsets;
+
+  struct TableShard {
+    mutable mutex mu;
+    std::unordered_map<K, V> table GUARDED_BY(mu);
+  };
+
+  // Computes in `positions` the indices of `keys` ordered by owning shard, so
+  // that shard s owns positions [shard_begin[s], shard_begin[s + 1]).
+  static void GroupByShard(typename TTypes<K>::ConstFlat keys,
+                           std::vector<int64>* positions,
+                           ShardOffsets* shard_begin) {
+    const int64 num_keys = keys.size();
+    std::vector<uint8> shard_ids(num_keys);
+    shard_begin->fill(0);
+    for (int64 i = 0; i < num_keys; ++i) {
+      shard_ids[i] =
+          HashTableFingerprint(SubtleMustCopyUnlessStringOrFloat(keys(i))) >>
+          kShardShift;
+      ++(*shard_begin)[shard_ids[i] + 1];
+    }
+    for (int s = 0; s < kNumShards; ++s) {
+      (*shard_begin)[s + 1] += (*shard_begin)[s];
+    }
+    ShardOffsets next = *shard_begin;
+    positions->resize(num_keys);
+    for (int64 i = 0; i < num_keys; ++i) {
+      (*positions)[next[shard_ids[i]]++] = i;
+    }
+  }
+
+  static void InsertLocked(typename TTypes<K>::ConstFlat key_values,
+                           typename TTypes<V>::ConstFlat value_values,
+                           const std::vector<int64>& positions, int64 begin,
+                           int64 end, TableShard* shard)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->mu) {
+    for (int64 p = begin; p < end; ++p) {
+      const int64 i = positions[p];
+      gtl::InsertOrUpdate(&shard->table,
+                          SubtleMustCopyUnlessStringOrFloat(key_values(i)),
+                          SubtleMustCopyUnlessStringOrFloat(value_values(i)));
+    }
+  }
+
+  // Shards are always locked in index order to avoid deadlocks.
+  void LockAllShards() const NO_THREAD_SAFETY_ANALYSIS {
+    for (const TableShard& shard : shards_) {
+      shard.mu.lock();
+    }
+  }
+
+  void UnlockAllShards() const NO_THREAD_SAFETY_ANALYSIS {
+    for (const TableShard& shard : shards_) {
+      shard.mu.unlock();
+    }
+  }
+
+  TableShard shards_[kNumShards];
 };
 
 // Lookup table that wraps an unordered_map. Behaves identical to
@@ -612,6 +707,103 @@ class MutableDenseHashTable final : public LookupInterface {
   uint64 empty_key_hash_;
 };
 
+// Immutable lookup table read from a file written by
+// MemmappedLookupTableBuilder (see build_memmapped_lookup_table in
+// contrib/util). The file is memory-mapped rather than parsed, so the table
+// is ready as soon as it is opened and its pages are shared with every other
+// process that maps the same file. Lookups take no locks.
+template <class K, class V>
+class MemmappedHashTable final : public LookupInterface {
+ public:
+  MemmappedHashTable(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "filename", &filename_));
+    OP_REQUIRES_OK(ctx,
+                   MemmappedLookupTable::Open(ctx->env(), filename_, &table_));
+    OP_REQUIRES(
+        ctx,
+        table_->key_dtype() == key_dtype() &&
+            table_->value_dtype() == value_dtype(),
+        errors::InvalidArgument(
+            "Table file ", filename_, " maps ",
+            DataTypeString(table_->key_dtype()), " to ",
+            DataTypeString(table_->value_dtype()), ", but the op expects ",
+            DataTypeString(key_dtype()), " to ",
+            DataTypeString(value_dtype())));
+  }
+
+  size_t size() const override { return table_->size(); }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const V default_val = default_value.flat<V>()(0);
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+
+    auto find_range = [this, &key_values, &value_values, &default_val](
+                          int64 begin, int64 end) {
+      for (int64 i = begin; i < end; ++i) {
+        const int64 slot = table_->FindSlot(key_values(i));
+        if (slot < 0) {
+          value_values(i) = default_val;
+        } else {
+          GetValue(slot, &value_values(i));
+        }
+      }
+    };
+    if (ctx == nullptr || ctx->device() == nullptr) {
+      find_range(0, key_values.size());
+      return Status::OK();
+    }
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers,
+          key_values.size(), kFindCostPerKey, find_range);
+    return Status::OK();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    return errors::Unimplemented("Memmapped table ", filename_,
+                                 " is immutable");
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    return errors::Unimplemented("Memmapped table ", filename_,
+                                 " is immutable");
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    return errors::Unimplemented(
+        "Export is not supported for memmapped table ", filename_);
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const override { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  // The mapped pages are owned by the OS page cache, not the process heap.
+  int64 MemoryUsed() const override { return sizeof(*this); }
+
+ private:
+  void GetValue(int64 slot, int64* value) const {
+    *value = table_->Int64Value(slot);
+  }
+
+  void GetValue(int64 slot, string* value) const {
+    *value = table_->StringValue(slot).ToString();
+  }
+
+  // Rough cost, in cycles, of hashing a key and probing the mapped table.
+  static constexpr int64 kFindCostPerKey = 200;
+
+  string filename_;
+  std::unique_ptr<MemmappedLookupTable> table_;
+};
+
 }  // namespace lookup
 
 // Table lookup op. Perform the lookup operation on the given table.
@@ -870,4 +1062,21 @@ REGISTER_KERNEL(int64, bool);
 
 #undef REGISTER_KERNEL
 
+// Register the MemmappedHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                                \
+  REGISTER_KERNEL_BUILDER(                                                     \
+      Name("MemmappedHashTable")                                               \
+          .Device(DEVICE_CPU)                                                  \
+          .TypeConstraint<key_dtype>("key_dtype")                              \
+          .TypeConstraint<value_dtype>("value_dtype"),                         \
+      LookupTableOp<lookup::MemmappedHashTable<key_dtype, value_dtype>,        \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(string, int64);
+REGISTER_KERNEL(int64, string);
+REGISTER_KERNEL(int64, int64);
+REGISTER_KERNEL(string, string);
+
+#undef REGISTER_KERNEL
+
 }  // namespace tensorflow
@@ -26,8 +26,11 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/presized_cuckoo_map.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -141,6 +144,22 @@ inline const double SubtleMustCopyUnlessStringOrFloat(const double value) {
   return value;
 }
 
+// Returns a 64-bit fingerprint of `key` whose bits are spread across the
+// whole range, as required by PresizedCuckooMap. For integral keys this is the
+// MurmurHash3 finalizer, which is a bijection, so distinct keys never collide.
+template <typename T>
+inline uint64 HashTableFingerprint(const T& key) {
+  uint64 h = static_cast<uint64>(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint64 HashTableFingerprint(const string& key) { return Hash64(key); }
+
 // Lookup table that wraps an unordered_map, where the key and value data type
 // is specified.
 //
@@ -148,6 +167,11 @@ inline const double SubtleMustCopyUnlessStringOrFloat(const double value) {
 //
 // For look up, the table is required to be initialized (allocated
 // and populated). Once the table is marked as initialized it becomes read-only.
+// At that point the entries are moved into a flat array indexed by a
+// PresizedCuckooMap of key fingerprints, so that each lookup touches at most
+// two cache-line sized buckets and one entry. The index is immutable, so
+// concurrent lookups need no locking and large lookups are sharded across the
+// device's worker threads.
 //
 // Sample use case:
 //
@@ -172,6 +196,9 @@ class HashTable : public InitializableLookupTable {
       return 0;
     }
     std::atomic_thread_fence(std::memory_order_acquire);
+    if (index_) {
+      return entries_.size();
+    }
     return table_ ? table_->size() : 0;
   }
 
@@ -211,22 +238,61 @@ class HashTable : public InitializableLookupTable {
     return Status::OK();
   }
 
-  Status DoFind(const Tensor& key, Tensor* value,
+  Status DoFinalize() override {
+    if (!table_ || table_->size() > static_cast<size_t>(kint32max)) {
+      return Status::OK();
+    }
+    std::unique_ptr<PresizedCuckooMap<int32>> index(
+        new PresizedCuckooMap<int32>(table_->size()));
+    std::vector<std::pair<K, V>> entries;
+    entries.reserve(table_->size());
+    for (const auto& entry : *table_) {
+      // Fingerprint collisions between distinct string keys are rare but
+      // possible; keep serving from the unordered_map if one occurs.
+      if (!index->InsertUnique(HashTableFingerprint(entry.first),
+                               entries.size())) {
+        return Status::OK();
+      }
+      entries.push_back(entry);
+    }
+    entries_.swap(entries);
+    index_ = std::move(index);
+    table_.reset();
+    return Status::OK();
+  }
+
+  Status DoFind(OpKernelContext* ctx, const Tensor& key, Tensor* value,
                 const Tensor& default_value) override {
     const V default_val = default_value.flat<V>()(0);
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
-    for (int64 i = 0; i < key_values.size(); ++i) {
-      value_values(i) = gtl::FindWithDefault(
-          *table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
-          default_val);
+    auto find_range = [this, &key_values, &value_values, &default_val](
+                          int64 begin, int64 end) {
+      if (index_) {
+        FindInIndex(key_values, begin, end, default_val, &value_values);
+        return;
+      }
+      for (int64 i = begin; i < end; ++i) {
+        value_values(i) = gtl::FindWithDefault(
+            *table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
+            default_val);
+      }
+    };
+    if (ctx == nullptr || ctx->device() == nullptr) {
+      find_range(0, key_values.size());
+      return Status::OK();
     }
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers,
+          key_values.size(), kFindCostPerKey, find_range);
     return Status::OK();
   }
 
   int64 MemoryUsed() const override {
-    if (table_) {
+    if (index_) {
+      return index_->MemoryUsed() + entries_.size() * sizeof(entries_[0]);
+    } else if (table_) {
       const int64 num_elements = table_->size();
       return num_elements * (sizeof(K) + sizeof(V));
     } else {
@@ -235,7 +301,48 @@ class HashTable : public InitializableLookupTable {
   }
 
  private:
+  // Looks up keys [begin, end) in the index, in groups of kFindBatchSize:
+  // the fingerprints of a group are computed and their buckets prefetched
+  // before any of them is probed, so the cache misses overlap.
+  void FindInIndex(typename TTypes<K>::ConstFlat key_values, int64 begin,
+                   int64 end, const V& default_val,
+                   typename TTypes<V>::Flat* value_values) const {
+    uint64 fingerprints[kFindBatchSize];
+    for (int64 batch_begin = begin; batch_begin < end;
+         batch_begin += kFindBatchSize) {
+      const int64 batch_size = end - batch_begin < kFindBatchSize
+                                   ? end - batch_begin
+                                   : kFindBatchSize;
+      for (int64 j = 0; j < batch_size; ++j) {
+        fingerprints[j] = HashTableFingerprint(
+            SubtleMustCopyUnlessStringOrFloat(key_values(batch_begin + j)));
+        index_->PrefetchKey(fingerprints[j]);
+      }
+      for (int64 j = 0; j < batch_size; ++j) {
+        int32 position;
+        if (index_->Find(fingerprints[j], &position) &&
+            entries_[position].first ==
+                SubtleMustCopyUnlessStringOrFloat(
+                    key_values(batch_begin + j))) {
+          (*value_values)(batch_begin + j) = entries_[position].second;
+        } else {
+          (*value_values)(batch_begin + j) = default_val;
+        }
+      }
+    }
+  }
+
+  static constexpr int64 kFindBatchSize = 16;
+  // Rough cost, in cycles, of hashing a key and probing the index.
+  static constexpr int64 kFindCostPerKey = 100;
+
+  // Holds the entries while the table is being populated, and afterwards if
+  // no index could be built.
   std::unique_ptr<std::unordered_map<K, V>> table_;
+  // Read-only index built by DoFinalize(), mapping key fingerprints to
+  // positions in entries_.
+  std::unique_ptr<PresizedCuckooMap<int32>> index_;
+  std::vector<std::pair<K, V>> entries_;
 };
 
 }  // namespace lookup
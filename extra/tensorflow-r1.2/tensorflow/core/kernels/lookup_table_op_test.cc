@@ -0,0 +1,229 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/lookup_table_op.h"
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+// Yields a single batch of keys and values.
+class SingleBatchIterator : public InitializableLookupTable::InitTableIterator {
+ public:
+  SingleBatchIterator(const Tensor& keys, const Tensor& values)
+      : keys_(keys), values_(values) {}
+
+  void Next() override { valid_ = false; }
+
+  bool Valid() const override { return valid_; }
+
+  const Tensor& keys() const override { return keys_; }
+
+  const Tensor& values() const override { return values_; }
+
+  Status status() const override {
+    return valid_ ? Status::OK() : errors::OutOfRange("No more data.");
+  }
+
+  int64 total_size() const override { return keys_.NumElements(); }
+
+ private:
+  const Tensor keys_;
+  const Tensor values_;
+  bool valid_ = true;
+};
+
+// Returns an initialized table; the caller owns a reference.
+template <typename K, typename V>
+HashTable<K, V>* MakeTable(const Tensor& keys, const Tensor& values) {
+  HashTable<K, V>* table = new HashTable<K, V>(nullptr, nullptr);
+  SingleBatchIterator iter(keys, values);
+  TF_CHECK_OK(table->Initialize(iter));
+  return table;
+}
+
+TEST(HashTableTest, FindInt64) {
+  const int64 kNumEntries = 1000;
+  Tensor keys(DT_INT64, TensorShape({kNumEntries}));
+  Tensor values(DT_INT64, TensorShape({kNumEntries}));
+  for (int64 i = 0; i < kNumEntries; ++i) {
+    keys.flat<int64>()(i) = i * 7;
+    values.flat<int64>()(i) = i;
+  }
+  auto* table = MakeTable<int64, int64>(keys, values);
+  core::ScopedUnref unref(table);
+  EXPECT_EQ(kNumEntries, table->size());
+
+  Tensor query(DT_INT64, TensorShape({2 * kNumEntries}));
+  for (int64 i = 0; i < 2 * kNumEntries; ++i) {
+    query.flat<int64>()(i) = i * 7 + (i >= kNumEntries ? 1 : 0);
+  }
+  Tensor result(DT_INT64, query.shape());
+  TF_ASSERT_OK(table->Find(nullptr, query, &result,
+                           test::AsScalar<int64>(-1)));
+  for (int64 i = 0; i < kNumEntries; ++i) {
+    EXPECT_EQ(i, result.flat<int64>()(i));
+    EXPECT_EQ(-1, result.flat<int64>()(kNumEntries + i));
+  }
+}
+
+TEST(HashTableTest, FindString) {
+  Tensor keys = test::AsTensor<string>({"brain", "salad", "surgery"});
+  Tensor values = test::AsTensor<int64>({0, 1, 2});
+  auto* table = MakeTable<string, int64>(keys, values);
+  core::ScopedUnref unref(table);
+  EXPECT_EQ(3, table->size());
+
+  Tensor query = test::AsTensor<string>({"salad", "tank", "surgery", ""});
+  Tensor result(DT_INT64, query.shape());
+  TF_ASSERT_OK(table->Find(nullptr, query, &result,
+                           test::AsScalar<int64>(-1)));
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({1, -1, 2, -1}),
+                                 result);
+}
+
+TEST(HashTableTest, FindBeforeInitializeFails) {
+  auto* table = new HashTable<int64, int64>(nullptr, nullptr);
+  core::ScopedUnref unref(table);
+  Tensor query = test::AsTensor<int64>({1});
+  Tensor result(DT_INT64, query.shape());
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      table->Find(nullptr, query, &result, test::AsScalar<int64>(-1))));
+}
+
+TEST(HashTableTest, EmptyTable) {
+  Tensor keys(DT_INT64, TensorShape({0}));
+  Tensor values(DT_INT64, TensorShape({0}));
+  auto* table = MakeTable<int64, int64>(keys, values);
+  core::ScopedUnref unref(table);
+  EXPECT_EQ(0, table->size());
+  Tensor query = test::AsTensor<int64>({0, 1});
+  Tensor result(DT_INT64, query.shape());
+  TF_ASSERT_OK(table->Find(nullptr, query, &result,
+                           test::AsScalar<int64>(-1)));
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({-1, -1}), result);
+}
+
+// Benchmarks of LookupTableFindV2 against each table implementation. The
+// init graph creates and populates a shared table with `num_entries` keys;
+// the timed graph looks up `batch_size` keys, half of which are missing.
+
+template <typename K>
+Tensor BenchmarkKeys(int64 num_keys, int64 stride) {
+  Tensor keys(DataTypeToEnum<K>::v(), TensorShape({num_keys}));
+  for (int64 i = 0; i < num_keys; ++i) {
+    keys.flat<K>()(i) = (i * stride) % (2 * num_keys);
+  }
+  return keys;
+}
+
+template <>
+Tensor BenchmarkKeys<string>(int64 num_keys, int64 stride) {
+  Tensor keys(DT_STRING, TensorShape({num_keys}));
+  for (int64 i = 0; i < num_keys; ++i) {
+    keys.flat<string>()(i) =
+        strings::StrCat("token_", (i * stride) % (2 * num_keys));
+  }
+  return keys;
+}
+
+Node* TableNode(Graph* g, const string& op, DataType key_dtype,
+                DataType value_dtype) {
+  Node* ret;
+  NodeBuilder builder(g->NewName("table"), op);
+  builder.Attr("shared_name", "bench_table")
+      .Attr("key_dtype", key_dtype)
+      .Attr("value_dtype", value_dtype);
+  if (op == "MutableDenseHashTableV2") {
+    builder.Input(test::graph::Constant(g, test::AsScalar<int64>(-1)))
+        .Attr("initial_num_buckets", 1 << 22);
+  }
+  TF_CHECK_OK(builder.Finalize(g, &ret));
+  return ret;
+}
+
+template <typename K, typename V>
+void BM_TableFind(int iters, const string& op, int num_entries,
+                  int batch_size) {
+  testing::StopTiming();
+  const DataType key_dtype = DataTypeToEnum<K>::v();
+  const DataType value_dtype = DataTypeToEnum<V>::v();
+
+  Graph* init = new Graph(OpRegistry::Global());
+  {
+    Node* table = TableNode(init, op, key_dtype, value_dtype);
+    Tensor keys = BenchmarkKeys<K>(num_entries, 2);
+    Tensor values(value_dtype, TensorShape({num_entries}));
+    values.flat<V>().setConstant(1);
+    Node* populate;
+    TF_CHECK_OK(
+        NodeBuilder(init->NewName("populate"), op == "HashTableV2"
+                                                   ? "InitializeTableV2"
+                                                   : "LookupTableInsertV2")
+            .Input(table)
+            .Input(test::graph::Constant(init, keys))
+            .Input(test::graph::Constant(init, values))
+            .Finalize(init, &populate));
+  }
+
+  Graph* g = new Graph(OpRegistry::Global());
+  {
+    Node* table = TableNode(g, op, key_dtype, value_dtype);
+    Node* find;
+    TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                    .Input(table)
+                    .Input(test::graph::Constant(
+                        g, BenchmarkKeys<K>(batch_size, 997)))
+                    .Input(test::graph::Constant(g, test::AsScalar<V>(0)))
+                    .Finalize(g, &find));
+  }
+
+  testing::ItemsProcessed(static_cast<int64>(iters) * batch_size);
+  testing::StartTiming();
+  test::Benchmark("cpu", g, nullptr, init).Run(iters);
+}
+
+#define BM_TABLE_FIND(NAME, K, V, OP)                                  \
+  static void BM_##NAME(int iters, int num_entries, int batch_size) { \
+    BM_TableFind<K, V>(iters, OP, num_entries, batch_size);            \
+  }                                                                    \
+  BENCHMARK(BM_##NAME)                                                 \
+      ->ArgPair(1 << 10, 1 << 10)                                      \
+      ->ArgPair(1 << 20, 1 << 10)                                      \
+      ->ArgPair(1 << 20, 1 << 16);
+
+BM_TABLE_FIND(HashTableFindString, string, int64, "HashTableV2");
+BM_TABLE_FIND(MutableHashTableFindString, string, int64,
+              "MutableHashTableV2");
+BM_TABLE_FIND(HashTableFindInt64, int64, int64, "HashTableV2");
+BM_TABLE_FIND(MutableDenseHashTableFindInt64, int64, int64,
+              "MutableDenseHashTableV2");
+
+#undef BM_TABLE_FIND
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
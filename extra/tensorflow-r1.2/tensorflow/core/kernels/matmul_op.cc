@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/fill_functor.h"
+#include "tensorflow/core/kernels/packed_weights_cache.h"
 
 #if GOOGLE_CUDA
 #include "cuda/include/cuda.h"
@@ -148,6 +149,35 @@ struct LaunchMatMulCPU : LaunchMatMulBase<CPUDevice, T> {};
 template <typename T, bool USE_CUBLAS>
 struct LaunchMatMul<CPUDevice, T, USE_CUBLAS> : public LaunchMatMulCPU<T> {};
 
+// Multiplies by the packed form of constant weights, which is cached across
+// steps, when the left-hand side has only a few rows. Returns false if the
+// product should be computed by LaunchMatMul instead.
+template <typename Device, typename T>
+struct LaunchPackedMatMul {
+  static bool launch(OpKernelContext* ctx, PackedWeightsCache* cache,
+                     const Tensor& a, const Tensor& b, bool transpose_a,
+                     bool transpose_b, Tensor* out) {
+    return false;
+  }
+};
+
+template <>
+struct LaunchPackedMatMul<CPUDevice, float> {
+  static bool launch(OpKernelContext* ctx, PackedWeightsCache* cache,
+                     const Tensor& a, const Tensor& b, bool transpose_a,
+                     bool transpose_b, Tensor* out) {
+    if (transpose_a || out->dim_size(0) > PackedWeights::kMaxRows ||
+        out->dim_size(1) == 1) {
+      return false;
+    }
+    std::shared_ptr<const PackedWeights> packed = cache->Get(b, transpose_b);
+    packed->Multiply(*ctx->device()->tensorflow_cpu_worker_threads(),
+                     a.flat<float>().data(), a.dim_size(0),
+                     out->flat<float>().data());
+    return true;
+  }
+};
+
 #ifdef TENSORFLOW_USE_SYCL
 template <typename T>
 struct LaunchMatMulSYCL : LaunchMatMulBase<SYCLDevice, T> {};
@@ -260,6 +290,9 @@ class MatMulOp : public OpKernel {
   explicit MatMulOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("transpose_a", &transpose_a_));
     OP_REQUIRES_OK(ctx, ctx->GetAttr("transpose_b", &transpose_b_));
+    if (HasConstantWeights(ctx)) {
+      packed_weights_.reset(new PackedWeightsCache);
+    }
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -302,12 +335,21 @@ class MatMulOp : public OpKernel {
       return;
     }
 
+    if (packed_weights_ != nullptr &&
+        LaunchPackedMatMul<Device, T>::launch(ctx, packed_weights_.get(), a, b,
+                                              transpose_a_, transpose_b_,
+                                              out)) {
+      return;
+    }
+
     LaunchMatMul<Device, T, USE_CUBLAS>::launch(ctx, this, a, b, dim_pair, out);
   }
 
  private:
   bool transpose_a_;
   bool transpose_b_;
+  // Set if the weights (input 1) are constant, see kConstantWeightsAttr.
+  std::unique_ptr<PackedWeightsCache> packed_weights_;
 };
 
 namespace functor {
@@ -0,0 +1,101 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/packed_weights_cache.h"
+
+#include <algorithm>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+bool HasConstantWeights(OpKernelConstruction* context) {
+  bool constant_weights = false;
+  if (!GetNodeAttr(context->def(), kConstantWeightsAttr, &constant_weights)
+           .ok()) {
+    return false;
+  }
+  return constant_weights;
+}
+
+constexpr int PackedWeights::kPanelCols;
+constexpr int64 PackedWeights::kMaxRows;
+
+PackedWeights::PackedWeights(const Tensor& weights, bool transposed)
+    : depth_(weights.dim_size(transposed ? 1 : 0)),
+      cols_(weights.dim_size(transposed ? 0 : 1)) {
+  CHECK_EQ(weights.dtype(), DT_FLOAT);
+  const int64 num_panels = (cols_ + kPanelCols - 1) / kPanelCols;
+  panels_.assign(num_panels * depth_ * kPanelCols, 0.0f);
+  const float* src = weights.flat<float>().data();
+  for (int64 p = 0; p < num_panels; ++p) {
+    const int64 width = std::min<int64>(kPanelCols, cols_ - p * kPanelCols);
+    float* panel = panels_.data() + p * depth_ * kPanelCols;
+    for (int64 k = 0; k < depth_; ++k) {
+      for (int64 j = 0; j < width; ++j) {
+        const int64 col = p * kPanelCols + j;
+        panel[k * kPanelCols + j] =
+            transposed ? src[col * depth_ + k] : src[k * cols_ + col];
+      }
+    }
+  }
+}
+
+void PackedWeights::Multiply(const DeviceBase::CpuWorkerThreads& workers,
+                             const float* lhs, int64 rows, float* out) const {
+  typedef Eigen::Array<float, kPanelCols, 1> Panel;
+  const int64 num_panels = (cols_ + kPanelCols - 1) / kPanelCols;
+  auto work = [this, lhs, rows, out](int64 begin, int64 end) {
+    for (int64 p = begin; p < end; ++p) {
+      const float* panel = panels_.data() + p * depth_ * kPanelCols;
+      const int64 col = p * kPanelCols;
+      const int64 width = std::min<int64>(kPanelCols, cols_ - col);
+      for (int64 r = 0; r < rows; ++r) {
+        const float* a = lhs + r * depth_;
+        Panel sum = Panel::Zero();
+        for (int64 k = 0; k < depth_; ++k) {
+          sum += a[k] * Eigen::Map<const Panel>(panel + k * kPanelCols);
+        }
+        std::copy_n(sum.data(), width, out + r * cols_ + col);
+      }
+    }
+  };
+  Shard(workers.num_threads, workers.workers, num_panels,
+        rows * depth_ * kPanelCols, work);
+}
+
+std::shared_ptr<const PackedWeights> PackedWeightsCache::Get(
+    const Tensor& weights, bool transposed) {
+  mutex_lock l(mu_);
+  if (packed_ == nullptr || !source_.SharesBufferWith(weights) ||
+      !source_.shape().IsSameSize(weights.shape()) ||
+      transposed_ != transposed) {
+    packed_.reset(new PackedWeights(weights, transposed));
+    source_ = weights;
+    transposed_ = transposed;
+    ++num_packs_;
+  }
+  return packed_;
+}
+
+int64 PackedWeightsCache::num_packs() const {
+  mutex_lock l(mu_);
+  return num_packs_;
+}
+
+}  // namespace tensorflow
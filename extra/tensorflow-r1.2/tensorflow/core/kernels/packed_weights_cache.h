@@ -0,0 +1,104 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_PACKED_WEIGHTS_CACHE_H_
+#define TENSORFLOW_KERNELS_PACKED_WEIGHTS_CACHE_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Returns the value of kConstantWeightsAttr (see node_def_util.h) on the
+// kernel's node, or false if it is not set. The attribute is set by
+// MarkConstantWeightsPass (common_runtime/mark_constant_weights.cc).
+bool HasConstantWeights(OpKernelConstruction* context);
+
+// The right-hand side of a float matrix product out = lhs * weights, repacked
+// into panels of kPanelCols columns that are contiguous along the depth
+// dimension. Eigen's contraction repacks its right-hand side into a similar
+// layout on every call; for a handful of lhs rows that packing costs as much
+// as the product itself, so kernels with constant weights pack them once and
+// multiply with Multiply() instead.
+class PackedWeights {
+ public:
+  static constexpr int kPanelCols = 8;
+
+  // Products with at most this many lhs rows should use Multiply(); larger
+  // ones amortize Eigen's packing and benefit from its cache blocking.
+  static constexpr int64 kMaxRows = 16;
+
+  // `weights` is a float [depth, cols] matrix, or [cols, depth] if
+  // `transposed`.
+  PackedWeights(const Tensor& weights, bool transposed);
+
+  int64 depth() const { return depth_; }
+  int64 cols() const { return cols_; }
+
+  // Computes out = lhs * weights, where lhs is a row-major [rows, depth]
+  // matrix and out a row-major [rows, cols] matrix. The panels are sharded
+  // over `workers`.
+  void Multiply(const DeviceBase::CpuWorkerThreads& workers, const float* lhs,
+                int64 rows, float* out) const;
+
+ private:
+  const int64 depth_;
+  const int64 cols_;
+  // panels_[(p * depth_ + k) * kPanelCols + j] is weights[k, p * kPanelCols +
+  // j], zero-padded past the last column.
+  std::vector<float> panels_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PackedWeights);
+};
+
+// Caches the packed form of the weights of one kernel across Compute() calls.
+// The cache is keyed by the identity of the weights buffer, and holds a
+// reference to that buffer so that the address cannot be reused by another
+// tensor; weights that arrive in a different buffer are repacked. It does not
+// notice writes into the cached buffer, so it must only be used for weights
+// that are never mutated, see kConstantWeightsAttr. Thread-safe.
+class PackedWeightsCache {
+ public:
+  PackedWeightsCache() {}
+
+  // Returns the packed form of `weights`, a float matrix laid out as for
+  // PackedWeights.
+  std::shared_ptr<const PackedWeights> Get(const Tensor& weights,
+                                           bool transposed);
+
+  // Number of times Get() had to pack the weights.
+  int64 num_packs() const;
+
+ private:
+  mutable mutex mu_;
+  Tensor source_ GUARDED_BY(mu_);
+  bool transposed_ GUARDED_BY(mu_) = false;
+  std::shared_ptr<const PackedWeights> packed_ GUARDED_BY(mu_);
+  int64 num_packs_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PackedWeightsCache);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_PACKED_WEIGHTS_CACHE_H_
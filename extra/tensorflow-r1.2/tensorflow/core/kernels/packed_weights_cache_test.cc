@@ -0,0 +1,122 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/packed_weights_cache.h"
+
+#include <memory>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor RandomMatrix(int64 rows, int64 cols) {
+  Tensor t(DT_FLOAT, TensorShape({rows, cols}));
+  t.flat<float>().setRandom();
+  return t;
+}
+
+// Computes lhs * weights (or lhs * weights^T) the straightforward way.
+Tensor ReferenceProduct(const Tensor& lhs, const Tensor& weights,
+                        bool transposed) {
+  const int64 rows = lhs.dim_size(0);
+  const int64 depth = lhs.dim_size(1);
+  const int64 cols = weights.dim_size(transposed ? 0 : 1);
+  Tensor out(DT_FLOAT, TensorShape({rows, cols}));
+  auto a = lhs.matrix<float>();
+  auto w = weights.matrix<float>();
+  auto o = out.matrix<float>();
+  for (int64 r = 0; r < rows; ++r) {
+    for (int64 c = 0; c < cols; ++c) {
+      float sum = 0;
+      for (int64 k = 0; k < depth; ++k) {
+        sum += a(r, k) * (transposed ? w(c, k) : w(k, c));
+      }
+      o(r, c) = sum;
+    }
+  }
+  return out;
+}
+
+class PackedWeightsTest : public ::testing::Test {
+ protected:
+  PackedWeightsTest()
+      : pool_(new thread::ThreadPool(Env::Default(), "test", 4)) {
+    workers_.num_threads = 4;
+    workers_.workers = pool_.get();
+  }
+
+  void ExpectMatchesReference(int64 rows, int64 depth, int64 cols,
+                              bool transposed) {
+    Tensor lhs = RandomMatrix(rows, depth);
+    Tensor weights = transposed ? RandomMatrix(cols, depth)
+                                : RandomMatrix(depth, cols);
+    PackedWeights packed(weights, transposed);
+    EXPECT_EQ(depth, packed.depth());
+    EXPECT_EQ(cols, packed.cols());
+    Tensor out(DT_FLOAT, TensorShape({rows, cols}));
+    packed.Multiply(workers_, lhs.flat<float>().data(), rows,
+                    out.flat<float>().data());
+    test::ExpectTensorNear<float>(ReferenceProduct(lhs, weights, transposed),
+                                  out, 1e-4);
+  }
+
+  std::unique_ptr<thread::ThreadPool> pool_;
+  DeviceBase::CpuWorkerThreads workers_;
+};
+
+TEST_F(PackedWeightsTest, MatchesReference) {
+  for (bool transposed : {false, true}) {
+    ExpectMatchesReference(1, 64, 32, transposed);
+    // Columns that do not fill the last panel.
+    ExpectMatchesReference(3, 17, 13, transposed);
+    ExpectMatchesReference(16, 100, 5, transposed);
+    ExpectMatchesReference(2, 1, 9, transposed);
+  }
+}
+
+TEST(PackedWeightsCacheTest, PacksOncePerBuffer) {
+  PackedWeightsCache cache;
+  Tensor weights = RandomMatrix(8, 16);
+  auto first = cache.Get(weights, false);
+  auto second = cache.Get(weights, false);
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(1, cache.num_packs());
+
+  // A tensor that shares the buffer hits the cache.
+  Tensor alias;
+  ASSERT_TRUE(alias.CopyFrom(weights, weights.shape()));
+  EXPECT_EQ(first.get(), cache.Get(alias, false).get());
+  EXPECT_EQ(1, cache.num_packs());
+
+  // Equal contents in another buffer, or another layout, are repacked.
+  Tensor copy = tensor::DeepCopy(weights);
+  EXPECT_NE(first.get(), cache.Get(copy, false).get());
+  EXPECT_EQ(2, cache.num_packs());
+  auto transposed = cache.Get(copy, true);
+  EXPECT_EQ(16, transposed->depth());
+  EXPECT_EQ(8, transposed->cols());
+  EXPECT_EQ(3, cache.num_packs());
+
+  // Entries handed out earlier stay valid.
+  EXPECT_EQ(8, first->depth());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include <deque>
 #include <vector>
 
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -28,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -64,6 +66,79 @@ Status PaddingFIFOQueue::GetElementComponent(
   return Status::OK();
 }
 
+Status PaddingFIFOQueue::CopyTuplesToPaddedBatch(
+    OpKernelContext* ctx, const std::vector<Tuple>& tuples, Tuple* batch) {
+  batch->clear();
+  batch->reserve(num_components());
+  std::vector<bool> dynamic_shape;
+  const int64 batch_size = tuples.size();
+  int64 element_bytes = 1;
+
+  for (int i = 0; i < num_components(); ++i) {
+    const PartialTensorShape partial_shape =
+        PartialTensorShape({batch_size}).Concatenate(partial_shapes_[i]);
+    TensorShape shape({batch_size});
+
+    for (int j = 0; j < partial_shape.dims() - 1; ++j) {
+      if (partial_shape.dim_size(j + 1) > -1) {
+        shape.AddDim(partial_shape.dim_size(j + 1));
+      } else {
+        // Expand sizes to match.
+        int64 max_val = 0;
+        for (const Tuple& t : tuples) {
+          max_val = std::max(max_val, t[i].shape().dim_size(j));
+        }
+        shape.AddDim(max_val);
+      }
+    }
+
+    Tensor element;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_temp(component_dtypes_[i], shape, &element));
+
+    bool has_dynamic_shape = !partial_shape.IsFullyDefined();
+    if (has_dynamic_shape) {
+      // Set all values to zero because not all values
+      // will get written over.
+      TF_RETURN_IF_ERROR(SetElementZero(&element));
+    }
+
+    dynamic_shape.push_back(has_dynamic_shape);
+    if (batch_size > 0) {
+      element_bytes += element.TotalBytes() / batch_size;
+    }
+
+    // TODO(ebrevdo): should this be a persistent tensor?
+    batch->emplace_back(element);
+  }
+
+  mutex status_mu;
+  Status status;
+  auto copy_range = [&tuples, &dynamic_shape, batch, &status_mu, &status,
+                     this](int64 begin, int64 end) {
+    for (int64 index = begin; index < end; ++index) {
+      for (int i = 0; i < num_components(); ++i) {
+        Status s;
+        if (dynamic_shape[i]) {
+          // Slightly slower copy operation
+          s = CopyElementToLargerSlice(tuples[index][i], &(*batch)[i], index);
+        } else {
+          s = CopyElementToSlice(tuples[index][i], &(*batch)[i], index);
+        }
+        if (!s.ok()) {
+          mutex_lock l(status_mu);
+          status.Update(s);
+          return;
+        }
+      }
+    }
+  };
+  auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
+        element_bytes, copy_range);
+  return status;
+}
+
 void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                                       bool allow_small_batch,
                                       CallbackWithTuple callback) {
@@ -97,17 +172,18 @@ void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
           num_elements, [callback]() { callback(Tuple()); }, ctx, cm, token,
           [callback, allow_small_batch,
            this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-            int32 queue_size = queues_[0].size();
+            int32 queue_size = SizeLocked();
             if (closed_ && queue_size < attempt->elements_requested) {
               // If we don't have enough for a full dequeue, we have
               // to reset the attempt tuple.
               if (!attempt->tuples.empty()) {
                 // Restore already-dequeued elements to the front of the queue.
                 for (int64 i = attempt->tuples.size() - 1; i >= 0; --i) {
+                  Element element(num_components());
                   for (int j = 0; j < num_components(); ++j) {
-                    PersistentTensor element;
                     Status s = GetElementComponent(attempt->tuples[i], j,
-                                                   attempt->context, &element);
+                                                   attempt->context,
+                                                   &element[j]);
                     if (!s.ok()) {
                       attempt->context->SetStatus(
                           errors::DataLoss("Failed to restore element from "
@@ -115,13 +191,13 @@ void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                                            "to PaddingFIFOQueue: ",
                                            s.error_message()));
                     }
-                    queues_[j].push_front(element);
                   }
+                  RestoreLocked(&element);
                 }
               }
-              if (allow_small_batch && queues_[0].size() > 0) {
+              if (allow_small_batch && SizeLocked() > 0) {
                 // Request all remaining elements in the queue.
-                queue_size = queues_[0].size();
+                queue_size = SizeLocked();
                 attempt->tuples.clear();
                 attempt->elements_requested = queue_size;
               } else {
@@ -144,77 +220,28 @@ void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
 
             RunResult result = kNoProgress;
             for (; queue_size > 0; --queue_size) {
-              result = kProgress;
               Tuple tuple;
-              DequeueLocked(attempt->context, &tuple);
+              if (!DequeueLocked(attempt->context, &tuple)) break;
+              result = kProgress;
               attempt->tuples.push_back(tuple);
               tuple.clear();
               --attempt->elements_requested;
 
               if (attempt->elements_requested == 0) {
-                // Finished.  Allocate attempt->tuple and
-                // copy from attempt->tuples to attempt->tuple.
-                attempt->tuple.reserve(num_components());
-                const std::vector<Tuple>& tuples = attempt->tuples;
-
-                std::vector<bool> dynamic_shape;
-                const int64 batch_size = tuples.size();
-
-                for (int i = 0; i < num_components(); ++i) {
-                  const PartialTensorShape partial_shape =
-                      PartialTensorShape({batch_size})
-                          .Concatenate(partial_shapes_[i]);
-                  TensorShape shape({batch_size});
-
-                  for (int j = 0; j < partial_shape.dims() - 1; ++j) {
-                    if (partial_shape.dim_size(j + 1) > -1) {
-                      shape.AddDim(partial_shape.dim_size(j + 1));
-                    } else {
-                      // Expand sizes to match.
-                      int64 max_val = 0;
-                      for (const Tuple& t : tuples) {
-                        max_val = std::max(max_val, t[i].shape().dim_size(j));
-                      }
-                      shape.AddDim(max_val);
-                    }
+                // Finished.  The padded batch is allocated and filled by
+                // done_callback, outside mu_.
+                std::vector<Tuple> tuples;
+                tuples.swap(attempt->tuples);
+                OpKernelContext* ctx = attempt->context;
+                attempt->done_callback = [this, ctx, callback, tuples]() {
+                  Tuple batch;
+                  Status s = CopyTuplesToPaddedBatch(ctx, tuples, &batch);
+                  if (!s.ok()) {
+                    ctx->SetStatus(s);
+                    callback(Tuple());
+                    return;
                   }
-
-                  Tensor element;
-                  attempt->context->SetStatus(attempt->context->allocate_temp(
-                      component_dtypes_[i], shape, &element));
-                  if (!attempt->context->status().ok()) return kComplete;
-
-                  bool has_dynamic_shape = !partial_shape.IsFullyDefined();
-                  if (has_dynamic_shape) {
-                    // Set all values to zero because not all values
-                    // will get written over.
-                    attempt->context->SetStatus(SetElementZero(&element));
-                    if (!attempt->context->status().ok()) return kComplete;
-                  }
-
-                  dynamic_shape.push_back(has_dynamic_shape);
-
-                  // TODO(ebrevdo): should this be a persistent tensor?
-                  attempt->tuple.emplace_back(element);
-                }
-
-                for (size_t index = 0; index < tuples.size(); ++index) {
-                  for (int i = 0; i < num_components(); ++i) {
-                    if (dynamic_shape[i]) {
-                      // Slightly slower copy operation
-                      attempt->context->SetStatus(CopyElementToLargerSlice(
-                          tuples[index][i], &attempt->tuple[i], index));
-                    } else {
-                      attempt->context->SetStatus(CopyElementToSlice(
-                          tuples[index][i], &attempt->tuple[i], index));
-                    }
-                    if (!attempt->context->status().ok()) return kComplete;
-                  }
-                }
-                tuple = attempt->tuple;
-                attempt->tuples.clear();
-                attempt->done_callback = [callback, tuple]() {
-                  callback(tuple);
+                  callback(batch);
                 };
                 return kComplete;
               }
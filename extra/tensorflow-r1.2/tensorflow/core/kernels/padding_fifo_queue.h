@@ -81,6 +81,12 @@ class PaddingFIFOQueue : public FIFOQueue {
   static Status IsSameSizeExceptZerosInFirst(const TensorShape& first,
                                              const TensorShape& second);
 
+  // Like CopyTuplesToBatch(), but pads every component with unknown
+  // dimensions to the largest size in tuples.  Called without mu_.
+  Status CopyTuplesToPaddedBatch(OpKernelContext* ctx,
+                                 const std::vector<Tuple>& tuples,
+                                 Tuple* batch);
+
   TF_DISALLOW_COPY_AND_ASSIGN(PaddingFIFOQueue);
 };
 
@@ -24,10 +24,15 @@ limitations under the License.
 // optimized. They should be implementable using fixed point representations
 // to avoid a dependency on floating-point hardware.
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #define GEMMLOWP_ALLOW_SLOW_SCALAR_FALLBACK
 #include "public/gemmlowp.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 
 namespace tensorflow {
@@ -116,6 +121,85 @@ void QuantizationRangeForMultiplication(float min_a, float max_a, float min_b,
   *max_c = c_float_for_one_quant_level * c_highest;
 }
 
+// Quantization parameters for weights whose range is given per output
+// channel, so that channels with small weights keep their precision. A GEMM
+// against such weights is run with a weights offset of zero; Apply() then
+// subtracts each channel's offset and rescales every channel to the
+// quantization level of the widest one, whose range (min, max) determines the
+// range of the whole result.
+template <class T>
+struct PerChannelQuantization {
+  // Reads the weights ranges from `min_range` and `max_range`, which must
+  // both hold `channels` elements.
+  Status Init(const Tensor& min_range, const Tensor& max_range,
+              int64 channels) {
+    if (min_range.NumElements() != channels ||
+        max_range.NumElements() != channels) {
+      return errors::InvalidArgument(
+          "Per-channel weights ranges must have one element per output "
+          "channel (",
+          channels, "), got ", min_range.NumElements(), " and ",
+          max_range.NumElements());
+    }
+    auto mins = min_range.flat<float>();
+    auto maxs = max_range.flat<float>();
+    offsets.resize(channels);
+    scales.resize(channels);
+    float widest_level = 0.0f;
+    for (int64 c = 0; c < channels; ++c) {
+      if (!(maxs(c) > mins(c))) {
+        return errors::InvalidArgument("max_filter must be larger than "
+                                       "min_filter for channel ",
+                                       c);
+      }
+      offsets[c] = FloatToQuantizedUnclamped<T>(0.0f, mins(c), maxs(c));
+      scales[c] = FloatForOneQuantizedLevel<T>(mins(c), maxs(c));
+      if (scales[c] > widest_level) {
+        widest_level = scales[c];
+        min = mins(c);
+        max = maxs(c);
+      }
+    }
+    for (float& scale : scales) {
+      scale /= widest_level;
+    }
+    return Status::OK();
+  }
+
+  // Returns the result for `channel` given the value `raw` computed with a
+  // weights offset of zero, where `row_sum` is the sum of the corresponding
+  // left-hand side row with the left-hand side's offset applied.
+  int32 Adjust(int64 channel, int32 raw, int64 row_sum) const {
+    const double value = (raw - offsets[channel] * row_sum) *
+                         static_cast<double>(scales[channel]);
+    return static_cast<int32>(std::max<double>(
+        std::min<double>(std::round(value), std::numeric_limits<int32>::max()),
+        std::numeric_limits<int32>::lowest()));
+  }
+
+  // Adjusts `rows` rows of `ldc` int32 results, with one column per channel,
+  // as Adjust() does. If row_sums is null, the channel offsets have already
+  // been applied and only the rescaling is done.
+  void Apply(const int32* row_sums, int64 rows, int64 ldc,
+             int32* output) const {
+    const int64 channels = offsets.size();
+    for (int64 r = 0; r < rows; ++r) {
+      int32* row = output + r * ldc;
+      const int64 row_sum = row_sums == nullptr ? 0 : row_sums[r];
+      for (int64 c = 0; c < channels; ++c) {
+        row[c] = Adjust(c, row[c], row_sum);
+      }
+    }
+  }
+
+  std::vector<int32> offsets;
+  // The quantization level of each channel relative to the widest channel.
+  std::vector<float> scales;
+  // The range of the widest channel.
+  float min = 0.0f;
+  float max = 0.0f;
+};
+
 // input_array is an eigen Tensor.  q2f is a QuantizedToFloatStruct.
 // This evaluates to an eigen tensor expression, to be used like:
 // auto tensor = DEQUANTIZE_WITH_EIGEN(input_tensor, q2f);
@@ -16,6 +16,7 @@ limitations under the License.
 // Implements quantized eight-bit versions of the convolution operations.
 
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #define EIGEN_USE_THREADS
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/reference_gemm.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/util/padding.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -48,6 +50,8 @@ namespace tensorflow {
 // input_data = [input_batches, input_height, input_width, input_depth]
 // filter_data = [filter_height, filter_width, input_depth, filter_count]
 // output_data = [input_batches, output_height, output_width, filter_count]
+// If per_channel is not null, it holds the filter offset and scale of each
+// output channel, and filter_offset is ignored.
 template <class T1, class T2, class T3>
 class ReferenceConvFunctor {
  public:
@@ -57,7 +61,8 @@ class ReferenceConvFunctor {
                   int filter_height, int filter_width, int filter_count,
                   int filter_offset, int stride, Padding padding,
                   T3* output_data, int output_height, int output_width,
-                  int output_shift, int output_offset, int output_mult) {
+                  int output_shift, int output_offset, int output_mult,
+                  const PerChannelQuantization<T2>* per_channel) {
     // Set up some constants we need for the output down-shifting and
     // saturation.
     const int32 highest = static_cast<int32>(Eigen::NumTraits<T3>::highest());
@@ -107,6 +112,9 @@ class ReferenceConvFunctor {
         for (int out_x = 0; out_x < output_width; ++out_x) {
           // Each filter kernel produces one output channel.
           for (int out_channel = 0; out_channel < filter_count; ++out_channel) {
+            const int32 channel_filter_offset =
+                per_channel == nullptr ? filter_offset
+                                       : per_channel->offsets[out_channel];
             // We're going to calculate a single output value, which means we
             // need to multiply a three dimensional kernel of weights against
             // the current location within the input image.
@@ -159,11 +167,15 @@ class ReferenceConvFunctor {
                                   (in_channel * filter_count) + out_channel];
                   // Another promotion to 32 bit, as above.
                   const int32 filter_value =
-                      static_cast<int32>(filter_source_value) - filter_offset;
+                      static_cast<int32>(filter_source_value) -
+                      channel_filter_offset;
                   total += (input_value * filter_value);
                 }
               }
             }
+            if (per_channel != nullptr) {
+              total = per_channel->Adjust(out_channel, total, 0);
+            }
             // Here we're applying scale factors to compress the 32 bit
             // accumulated total to a potentially lower bit depth.
             const int32_t output =
@@ -191,6 +203,12 @@ class ReferenceConvFunctor {
 // experimentation.
 const size_t kMaxChunkSize = (1 * 1024 * 1024);
 
+// When several threads are available, the patches are instead split into
+// roughly one chunk per thread, each packed and multiplied on its own thread,
+// but chunks are not made smaller than this so that each GEMM still amortizes
+// its setup cost.
+const int64 kMinPatchesPerChunk = 64;
+
 // Implements convolution as a two stage process, first packing the patches of
 // the input image into columns (im2col) and then running GEMM to produce the
 // final result.
@@ -203,7 +221,8 @@ class Im2ColConvFunctor {
                   int filter_height, int filter_width, int filter_count,
                   int filter_offset, int stride, Padding padding,
                   T3* output_data, int output_height, int output_width,
-                  int output_shift, int output_offset, int output_mult) {
+                  int output_shift, int output_offset, int output_mult,
+                  const PerChannelQuantization<T2>* per_channel) {
     if (input_offset < 0) {
       // Only log the first few occurrences of this warning.
       static int warning_count = 0;
@@ -223,7 +242,7 @@ class Im2ColConvFunctor {
                    input_width, input_depth, input_offset, filter_data,
                    filter_height, filter_width, filter_count, filter_offset,
                    stride, padding, output_data, output_height, output_width,
-                   output_shift, output_offset, output_mult);
+                   output_shift, output_offset, output_mult, per_channel);
       return;
     }
 
@@ -255,42 +274,13 @@ class Im2ColConvFunctor {
     // by the width, then the height. This is the standard memory order in the
     // image world if it helps to visualize it.
     const int filter_value_count = filter_width * filter_height * input_depth;
-    const int64 patches_per_chunk =
-        kMaxChunkSize / (filter_value_count * sizeof(T1));
-    const int64 chunk_value_count =
-        (kMaxChunkSize + (sizeof(T1) - 1)) / sizeof(T1);
-    // TODO(petewarden) - Memory allocation can be very slow on Android. Can we
-    // optimize this by keeping the scratch buffer around?
-    // Because memory allocation is very expensive on mobile platforms, try to
-    // allocate a persistent buffer that will be kept around between calls. We
-    // use TensorFlow's resource management to ensure that the memory will be
-    // released when the session is over.
-    Im2ColBufferResource<T1, chunk_value_count>* im2col_buffer_resource;
-    std::function<Status(Im2ColBufferResource<T1, chunk_value_count>**)>
-        creator = [](Im2ColBufferResource<T1, chunk_value_count>** resource) {
-          *resource = new Im2ColBufferResource<T1, chunk_value_count>();
-          return Status::OK();
-        };
-    OP_REQUIRES_OK(
-        context,
-        context->resource_manager()->LookupOrCreate(
-            "Conv2d", "im2col_buffer", &im2col_buffer_resource, creator));
-    // This means that multiple ops can't be run simultaneously on different
-    // threads, because we have a single shared resource. The platforms this is
-    // aimed at have intra-op parallelism as their focus though, so it shouldn't
-    // be an issue.
-    mutex_lock lock_buffer(im2col_buffer_resource->mu);
-    core::ScopedUnref unref_buffer(im2col_buffer_resource);
-    T1* im2col_buffer = im2col_buffer_resource->data;
-
     const int64 patch_count = (input_batches * output_height * output_width);
-    const int64 chunk_count =
-        (patch_count + (patches_per_chunk - 1)) / patches_per_chunk;
 
-    for (int64 chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
-      const int64 patch_index_start = chunk_index * patches_per_chunk;
-      const int64 patch_index_end =
-          std::min(patch_index_start + patches_per_chunk, patch_count);
+    // Packs patches [patch_index_start, patch_index_end) into im2col_buffer.
+    // If row_sums is not null, it also stores the sum of each packed patch,
+    // with the input offset applied, for the per-channel filter correction.
+    auto pack_chunk = [&](int64 patch_index_start, int64 patch_index_end,
+                          T1* im2col_buffer, int32* row_sums) {
       for (int64 patch_index = patch_index_start; patch_index < patch_index_end;
            ++patch_index) {
         const int64 batch = patch_index / (output_height * output_width);
@@ -300,7 +290,7 @@ class Im2ColConvFunctor {
             input_data + (batch * input_height * input_width * input_depth);
         const int in_y_origin = (out_y * stride) - filter_top_offset;
         const int in_x_origin = (out_x * stride) - filter_left_offset;
-        const int patch_index_within_chunk = patch_index % patches_per_chunk;
+        const int64 patch_index_within_chunk = patch_index - patch_index_start;
         T1* im2col_patch_start =
             im2col_buffer + (patch_index_within_chunk * filter_value_count);
         for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
@@ -362,44 +352,58 @@ class Im2ColConvFunctor {
             }
           }
         }
+        if (row_sums != nullptr) {
+          // The padding holds input_offset, so it doesn't contribute.
+          int32 row_sum = 0;
+          for (int i = 0; i < filter_value_count; ++i) {
+            row_sum += static_cast<int32>(im2col_patch_start[i]) - input_offset;
+          }
+          row_sums[patch_index_within_chunk] = row_sum;
+        }
       }
-      // Now we've assembled a set of image patches into a matrix, apply a
-      // GEMM matrix multiply of the patches as rows, times the filter
-      // weights in columns, to get partial results in the output matrix.
-      const int how_many_patches = patch_index_end - patch_index_start;
-      const bool transpose_a = false;
-      const bool transpose_b = false;
-      const bool transpose_c = false;
-      const int m = how_many_patches;
-      const int n = filter_count;
-      const int k = filter_value_count;
-      const int lda = filter_value_count;
-      const int ldb = filter_count;
-      const int ldc = filter_count;
+    };
+
+    // All of the transpose_* variables are currently compile-time consts, so
+    // we could just hard-code these values too, but that would break if
+    // anybody changed those values in the future (e.g. to match the ability of
+    // MatMul to specify them as attributes). We're using a verbose approach of
+    // deriving the order values from the transpose variables to be able to
+    // catch any changes like that.
+    const bool transpose_a = false;
+    const bool transpose_b = false;
+    const bool transpose_c = false;
+    const int n = filter_count;
+    const int k = filter_value_count;
+    const int lda = filter_value_count;
+    const int ldb = filter_count;
+    const int ldc = filter_count;
+
+    // The gemmlowp optimized library only works for a particular set of data
+    // types, so check if we meet those requirements and fall back to a slower
+    // reference implementation if not.
+    const bool use_gemmlowp =
+        std::is_same<T1, quint8>() && std::is_same<T2, quint8>() &&
+        std::is_same<T3, qint32>() && (output_offset == 0) &&
+        (output_mult == 1) && (output_shift == 0);
+    const bool use_meta = use_gemmlowp && meta::IsSupportedAndEnabled() &&
+                          (transpose_c == false);
+
+    // Multiplies packed patches [patch_index_start, patch_index_end) by the
+    // filter into the matching rows of the output, with gemmlowp running on
+    // the threads of gemm_context.
+    auto multiply_chunk = [&](const T1* im2col_buffer, int64 patch_index_start,
+                              int64 patch_index_end, const int32* row_sums,
+                              TensorflowGemmContext* gemm_context) {
+      const int m = patch_index_end - patch_index_start;
       T3* chunk_output_data = output_data + (patch_index_start * filter_count);
-
-      if (meta::IsSupportedAndEnabled() && std::is_same<T1, quint8>() &&
-          std::is_same<T2, quint8>() && std::is_same<T3, qint32>() &&
-          (output_offset == 0) && (output_mult == 1) && (output_shift == 0) &&
-          (transpose_c == false)) {
+      if (use_meta) {
         meta::QuantizedGemm(context, transpose_a, transpose_b, im2col_buffer,
                             filter_data, chunk_output_data, m, n, k,
                             -input_offset, -filter_offset, lda, ldb, ldc);
-      } else if (std::is_same<T1, quint8>() && std::is_same<T2, quint8>() &&
-                 std::is_same<T3, qint32>() && (output_offset == 0) &&
-                 (output_mult == 1) && (output_shift == 0)) {
-        // The gemmlowp optimized library only works for a particular set of
-        // data types, so check if we meet those requirements and fall back to a
-        // slower reference implementation if not.
+      } else if (use_gemmlowp) {
         const uint8* im2col_data_as_uint8 = &(im2col_buffer->value);
         const uint8* filter_data_as_uint8 = &(filter_data->value);
         int32* output_data_as_int32 = &(chunk_output_data->value);
-        // All of the transpose_* variables are currently compile-time consts,
-        // so we could just hard-code these values too, but that would break if
-        // anybody changed those values in the future (e.g. to match the ability
-        // of MatMul to specify them as attributes). We're using a verbose
-        // approach of deriving the order values from the transpose variables to
-        // be able to catch any changes like that.
         static const gemmlowp::MapOrder ResultOrder =
             !transpose_c ? gemmlowp::MapOrder::RowMajor
                          : gemmlowp::MapOrder::ColMajor;
@@ -416,14 +420,9 @@ class Im2ColConvFunctor {
         gemmlowp::MatrixMap<std::int32_t, ResultOrder> result(
             output_data_as_int32, m, n, ldc);
         const std::tuple<> empty_pipeline = {};
-
-        auto& worker_threads =
-            *(context->device()->tensorflow_cpu_worker_threads());
-        TensorflowGemmContext context(worker_threads.num_threads,
-                                      worker_threads.workers);
         gemmlowp::GemmWithOutputPipeline<std::uint8_t, std::int32_t,
                                          gemmlowp::DefaultL8R8BitDepthParams>(
-            &context, lhs, rhs, &result, -input_offset, -filter_offset,
+            gemm_context, lhs, rhs, &result, -input_offset, -filter_offset,
             empty_pipeline);
         // Since gemmlowp uses assembly to write to the output, msan won't
         // detect the output buffer as written to, so we mark it manually.
@@ -435,6 +434,98 @@ class Im2ColConvFunctor {
             input_offset, lda, filter_data, filter_offset, ldb,
             chunk_output_data, output_shift, output_offset, output_mult, ldc);
       }
+      // The filter offsets differ per output channel, so the GEMM ran with a
+      // filter offset of zero and each channel is corrected here, while the
+      // chunk is still in cache.
+      if (per_channel != nullptr) {
+        per_channel->Apply(row_sums, m, ldc, &(chunk_output_data->value));
+      }
+    };
+
+    auto& worker_threads =
+        *(context->device()->tensorflow_cpu_worker_threads());
+    int64 patches_per_chunk = kMaxChunkSize / (filter_value_count * sizeof(T1));
+    // meta::QuantizedGemm shards its work over the worker threads itself, so
+    // only plain gemmlowp GEMMs are run from inside a shard.
+    const bool parallel_chunks =
+        use_gemmlowp && !use_meta && worker_threads.num_threads > 1;
+    if (parallel_chunks) {
+      const int64 patches_per_thread =
+          (patch_count + worker_threads.num_threads - 1) /
+          worker_threads.num_threads;
+      patches_per_chunk =
+          std::max<int64>(1, std::min(patches_per_chunk,
+                                      std::max(patches_per_thread,
+                                               kMinPatchesPerChunk)));
+    }
+    const int64 chunk_count =
+        (patch_count + (patches_per_chunk - 1)) / patches_per_chunk;
+
+    if (parallel_chunks && chunk_count > 1) {
+      // Each shard packs and multiplies its own chunks with a single-threaded
+      // GEMM, in a buffer of its own, so that packing is parallelized too and
+      // no shard waits for the shared buffer below.
+      auto shard = [&](int64 chunk_start, int64 chunk_limit) {
+        std::unique_ptr<T1[]> im2col_buffer(
+            new T1[patches_per_chunk * filter_value_count]);
+        std::vector<int32> row_sums(per_channel ? patches_per_chunk : 0);
+        TensorflowGemmContext gemm_context(1, worker_threads.workers);
+        for (int64 chunk_index = chunk_start; chunk_index < chunk_limit;
+             ++chunk_index) {
+          const int64 patch_index_start = chunk_index * patches_per_chunk;
+          const int64 patch_index_end =
+              std::min(patch_index_start + patches_per_chunk, patch_count);
+          pack_chunk(patch_index_start, patch_index_end, im2col_buffer.get(),
+                     per_channel ? row_sums.data() : nullptr);
+          multiply_chunk(im2col_buffer.get(), patch_index_start,
+                         patch_index_end, row_sums.data(), &gemm_context);
+        }
+      };
+      Shard(worker_threads.num_threads, worker_threads.workers, chunk_count,
+            patches_per_chunk * filter_value_count * filter_count, shard);
+      return;
+    }
+
+    const int64 chunk_value_count =
+        (kMaxChunkSize + (sizeof(T1) - 1)) / sizeof(T1);
+    // TODO(petewarden) - Memory allocation can be very slow on Android. Can we
+    // optimize this by keeping the scratch buffer around?
+    // Because memory allocation is very expensive on mobile platforms, try to
+    // allocate a persistent buffer that will be kept around between calls. We
+    // use TensorFlow's resource management to ensure that the memory will be
+    // released when the session is over.
+    Im2ColBufferResource<T1, chunk_value_count>* im2col_buffer_resource;
+    std::function<Status(Im2ColBufferResource<T1, chunk_value_count>**)>
+        creator = [](Im2ColBufferResource<T1, chunk_value_count>** resource) {
+          *resource = new Im2ColBufferResource<T1, chunk_value_count>();
+          return Status::OK();
+        };
+    OP_REQUIRES_OK(
+        context,
+        context->resource_manager()->LookupOrCreate(
+            "Conv2d", "im2col_buffer", &im2col_buffer_resource, creator));
+    // This means that multiple ops can't be run simultaneously on different
+    // threads, because we have a single shared resource. The platforms this is
+    // aimed at have intra-op parallelism as their focus though, so it shouldn't
+    // be an issue.
+    mutex_lock lock_buffer(im2col_buffer_resource->mu);
+    core::ScopedUnref unref_buffer(im2col_buffer_resource);
+    T1* im2col_buffer = im2col_buffer_resource->data;
+
+    std::vector<int32> row_sums(per_channel ? patches_per_chunk : 0);
+    TensorflowGemmContext gemm_context(worker_threads.num_threads,
+                                       worker_threads.workers);
+    for (int64 chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+      const int64 patch_index_start = chunk_index * patches_per_chunk;
+      const int64 patch_index_end =
+          std::min(patch_index_start + patches_per_chunk, patch_count);
+      pack_chunk(patch_index_start, patch_index_end, im2col_buffer,
+                 per_channel ? row_sums.data() : nullptr);
+      // Now we've assembled a set of image patches into a matrix, apply a
+      // GEMM matrix multiply of the patches as rows, times the filter
+      // weights in columns, to get partial results in the output matrix.
+      multiply_chunk(im2col_buffer, patch_index_start, patch_index_end,
+                     row_sums.data(), &gemm_context);
     }
   }
 };
@@ -479,12 +570,10 @@ class QuantizedConv2DOp : public OpKernel {
 
     const float min_input = context->input(2).flat<float>()(0);
     const float max_input = context->input(3).flat<float>()(0);
-    const float min_filter = context->input(4).flat<float>()(0);
-    const float max_filter = context->input(5).flat<float>()(0);
+    const Tensor& min_filter_tensor = context->input(4);
+    const Tensor& max_filter_tensor = context->input(5);
     const int32 offset_input =
         FloatToQuantizedUnclamped<T1>(0.0f, min_input, max_input);
-    const int32 offset_filter =
-        FloatToQuantizedUnclamped<T2>(0.0f, min_filter, max_filter);
     const int32 offset_output = 0;
     const int32 mult_output = 1;
     const int32 shift_output = 0;
@@ -500,6 +589,35 @@ class QuantizedConv2DOp : public OpKernel {
     // The last dimension for filter is out_depth.
     const int64 out_depth = filter.dim_size(3);
 
+    // The filter range is either a single range for the whole filter, or one
+    // range per output channel.
+    float min_filter;
+    float max_filter;
+    int32 offset_filter;
+    PerChannelQuantization<T2> per_channel;
+    const bool is_per_channel = min_filter_tensor.NumElements() > 1 ||
+                                max_filter_tensor.NumElements() > 1;
+    if (is_per_channel) {
+      OP_REQUIRES_OK(context, per_channel.Init(min_filter_tensor,
+                                               max_filter_tensor, out_depth));
+      min_filter = per_channel.min;
+      max_filter = per_channel.max;
+      offset_filter = 0;
+    } else {
+      OP_REQUIRES(context,
+                  min_filter_tensor.NumElements() == 1 &&
+                      max_filter_tensor.NumElements() == 1,
+                  errors::InvalidArgument(
+                      "min_filter and max_filter must hold one value, or one "
+                      "per output channel; got ",
+                      min_filter_tensor.NumElements(), " and ",
+                      max_filter_tensor.NumElements()));
+      min_filter = min_filter_tensor.flat<float>()(0);
+      max_filter = max_filter_tensor.flat<float>()(0);
+      offset_filter =
+          FloatToQuantizedUnclamped<T2>(0.0f, min_filter, max_filter);
+    }
+
     // The second dimension for input is rows/height.
     // The first dimension for filter is rows/height.
     const int64 input_rows = input.dim_size(1);
@@ -543,7 +661,8 @@ class QuantizedConv2DOp : public OpKernel {
                  input_cols, in_depth, offset_input, filter.flat<T2>().data(),
                  filter_rows, filter_cols, out_depth, offset_filter, stride,
                  padding_, output->flat<T3>().data(), out_rows, out_cols,
-                 shift_output, offset_output, mult_output);
+                 shift_output, offset_output, mult_output,
+                 is_per_channel ? &per_channel : nullptr);
 
     float min_output_value;
     float max_output_value;
@@ -13,11 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cmath>
 #include <functional>
 #include <memory>
 #include <vector>
 
 #include "tensorflow/core/kernels/quantization_utils.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -27,15 +29,22 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
 class QuantizedConv2DTest : public OpsTestBase {
  protected:
+  void RunAgainstFloatReference(int batch, int height, int width, int depth,
+                                int filter_size, int filter_count,
+                                bool per_channel);
 };
 
 TEST_F(QuantizedConv2DTest, Small) {
@@ -173,6 +182,29 @@ TEST_F(QuantizedConv2DTest, Small32Bit) {
   test::ExpectTensorEqual<qint32>(expected, *GetOutput(0));
 }
 
+// Empty filter ranges are neither a single range nor one range per channel.
+TEST_F(QuantizedConv2DTest, EmptyFilterRanges) {
+  TF_ASSERT_OK(NodeDefBuilder("quantized_conv_op", "QuantizedConv2D")
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("out_type", DataTypeToEnum<qint32>::v())
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<quint8>(TensorShape({1, 2, 2, 1}), {10, 20, 30, 40});
+  AddInputFromArray<quint8>(TensorShape({1, 1, 1, 1}), {10});
+  AddInputFromArray<float>(TensorShape({1}), {0});
+  AddInputFromArray<float>(TensorShape({1}), {255.0f});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  EXPECT_EQ(::tensorflow::error::INVALID_ARGUMENT, RunOpKernel().code());
+}
+
 TEST_F(QuantizedConv2DTest, OddPadding) {
   const int stride = 2;
   TF_ASSERT_OK(NodeDefBuilder("quantized_conv_op", "QuantizedConv2D")
@@ -321,4 +353,226 @@ TEST_F(QuantizedConv2DTest, SmallWithNoZero) {
   test::ExpectTensorNear<float>(expected_float, output_float, 1.0);
 }
 
+// Runs a SAME-padded, unit-stride QuantizedConv2D on generated data, with
+// either a single filter range or one range per output channel, and checks
+// each output against a float convolution of the unquantized data, within a
+// bound derived from the quantization levels of its inputs.
+void QuantizedConv2DTest::RunAgainstFloatReference(int batch, int height,
+                                                   int width, int depth,
+                                                   int filter_size,
+                                                   int filter_count,
+                                                   bool per_channel) {
+  TF_ASSERT_OK(NodeDefBuilder("quantized_conv_op", "QuantizedConv2D")
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("out_type", DataTypeToEnum<qint32>::v())
+                   .Attr("strides", {1, 1, 1, 1})
+                   .Attr("padding", "SAME")
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  const float image_min = 0.0f;
+  const float image_max = 8.0f;
+  Tensor image_float(DT_FLOAT, {batch, height, width, depth});
+  auto image_flat = image_float.flat<float>();
+  for (int i = 0; i < image_flat.size(); ++i) {
+    image_flat(i) = (i * 7) % 9;
+  }
+  Tensor image_quantized =
+      FloatTensorToQuantized<quint8>(image_float, image_min, image_max);
+
+  // Even output channels have weights a hundred times smaller than odd ones,
+  // as is common after batch normalization has been folded into a filter.
+  Tensor filter_float(DT_FLOAT,
+                      {filter_size, filter_size, depth, filter_count});
+  auto filter_flat = filter_float.flat<float>();
+  for (int i = 0; i < filter_flat.size(); ++i) {
+    const int channel = i % filter_count;
+    filter_flat(i) = (((i * 5) % 11) - 5) * ((channel % 2) ? 1.0f : 0.01f);
+  }
+  std::vector<float> filter_mins(filter_count);
+  std::vector<float> filter_maxes(filter_count);
+  for (int c = 0; c < filter_count; ++c) {
+    const float range = per_channel ? ((c % 2) ? 5.0f : 0.05f) : 5.0f;
+    filter_mins[c] = -range;
+    filter_maxes[c] = range;
+  }
+  Tensor filter_quantized(DT_QUINT8, filter_float.shape());
+  auto filter_quantized_flat = filter_quantized.flat<quint8>();
+  for (int i = 0; i < filter_flat.size(); ++i) {
+    const int channel = i % filter_count;
+    filter_quantized_flat(i) = FloatToQuantized<quint8>(
+        filter_flat(i), filter_mins[channel], filter_maxes[channel]);
+  }
+
+  AddInputFromArray<quint8>(image_quantized.shape(),
+                            image_quantized.flat<quint8>());
+  AddInputFromArray<quint8>(filter_quantized.shape(),
+                            filter_quantized.flat<quint8>());
+  AddInputFromArray<float>(TensorShape({1}), {image_min});
+  AddInputFromArray<float>(TensorShape({1}), {image_max});
+  if (per_channel) {
+    AddInputFromArray<float>(TensorShape({filter_count}), filter_mins);
+    AddInputFromArray<float>(TensorShape({filter_count}), filter_maxes);
+  } else {
+    AddInputFromArray<float>(TensorShape({1}), {filter_mins[0]});
+    AddInputFromArray<float>(TensorShape({1}), {filter_maxes[0]});
+  }
+  TF_ASSERT_OK(RunOpKernel());
+
+  // The outputs are scaled directly by the output's quantization level, since
+  // going through the 32-bit range loses the precision this test checks for.
+  auto output = GetOutput(0)->tensor<qint32, 4>();
+  const double output_level = FloatForOneQuantizedLevel<qint32>(
+      GetOutput(1)->flat<float>()(0), GetOutput(2)->flat<float>()(0));
+  auto image = image_float.tensor<float, 4>();
+  auto filter = filter_float.tensor<float, 4>();
+  const float image_level = (image_max - image_min) / 255.0f;
+  const int pad = (filter_size - 1) / 2;
+  for (int b = 0; b < batch; ++b) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        for (int c = 0; c < filter_count; ++c) {
+          const float filter_level =
+              (filter_maxes[c] - filter_mins[c]) / 255.0f;
+          float expected = 0.0f;
+          // Rescaling to the widest filter range rounds to its level.
+          float bound = image_level * 10.0f / 255.0f;
+          for (int fy = 0; fy < filter_size; ++fy) {
+            for (int fx = 0; fx < filter_size; ++fx) {
+              const int in_y = y + fy - pad;
+              const int in_x = x + fx - pad;
+              if (in_y < 0 || in_y >= height || in_x < 0 || in_x >= width) {
+                continue;
+              }
+              for (int d = 0; d < depth; ++d) {
+                const float in = image(b, in_y, in_x, d);
+                const float w = filter(fy, fx, d, c);
+                expected += in * w;
+                bound += (std::abs(w) * image_level +
+                          std::abs(in) * filter_level) / 2.0f +
+                         image_level * filter_level / 4.0f;
+              }
+            }
+          }
+          EXPECT_NEAR(expected, output(b, y, x, c).value * output_level, bound)
+              << "at " << b << ", " << y << ", " << x << ", " << c;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(QuantizedConv2DTest, PerChannelFilter) {
+  RunAgainstFloatReference(1, 3, 4, 2, 3, 2, true /* per_channel */);
+}
+
+// Large enough for the patches to be split into several chunks, which are
+// processed in parallel when more than one thread is available.
+TEST_F(QuantizedConv2DTest, ManyChunks) {
+  RunAgainstFloatReference(2, 16, 16, 8, 3, 4, false /* per_channel */);
+}
+
+TEST_F(QuantizedConv2DTest, ManyChunksPerChannelFilter) {
+  RunAgainstFloatReference(2, 16, 16, 8, 3, 4, true /* per_channel */);
+}
+
+// Convolution shapes taken from the Inception v3 network, as
+// {image size, input depth, filter size, filter count}.
+const int kInceptionConvShapes[][4] = {
+    {147, 32, 3, 64}, {73, 64, 1, 80}, {35, 192, 1, 64},
+    {35, 64, 3, 96},  {17, 768, 1, 192}, {8, 1280, 3, 384},
+};
+
+// Runs a SAME-padded, unit-stride convolution of one image with the shape
+// at `shape_index` in kInceptionConvShapes, either quantized, with a single or
+// a per-channel filter range, or in float, so that the two can be compared.
+static void Conv2DHelper(int iters, int shape_index, bool quantized,
+                         bool per_channel) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  const int* shape = kInceptionConvShapes[shape_index];
+  const int image_size = shape[0];
+  const int depth = shape[1];
+  const int filter_size = shape[2];
+  const int filter_count = shape[3];
+  const DataType dt = quantized ? DT_QUINT8 : DT_FLOAT;
+  Tensor image(dt, {1, image_size, image_size, depth});
+  Tensor filter(dt, {filter_size, filter_size, depth, filter_count});
+  if (quantized) {
+    image.flat<quint8>().setRandom();
+    filter.flat<quint8>().setRandom();
+  } else {
+    image.flat<float>().setRandom();
+    filter.flat<float>().setRandom();
+  }
+
+  Node* node;
+  if (quantized) {
+    const int range_size = per_channel ? filter_count : 1;
+    Tensor filter_mins(DT_FLOAT, {range_size});
+    filter_mins.flat<float>().setConstant(-1.0f);
+    Tensor filter_maxes(DT_FLOAT, {range_size});
+    filter_maxes.flat<float>().setConstant(1.0f);
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "QuantizedConv2D")
+                    .Input(test::graph::Constant(g, image))
+                    .Input(test::graph::Constant(g, filter))
+                    .Input(test::graph::Constant(g, test::AsScalar(0.0f)))
+                    .Input(test::graph::Constant(g, test::AsScalar(1.0f)))
+                    .Input(test::graph::Constant(g, filter_mins))
+                    .Input(test::graph::Constant(g, filter_maxes))
+                    .Attr("out_type", DT_QINT32)
+                    .Attr("strides", {1, 1, 1, 1})
+                    .Attr("padding", "SAME")
+                    .Finalize(g, &node));
+  } else {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Conv2D")
+                    .Input(test::graph::Constant(g, image))
+                    .Input(test::graph::Constant(g, filter))
+                    .Attr("T", DT_FLOAT)
+                    .Attr("strides", {1, 1, 1, 1})
+                    .Attr("padding", "SAME")
+                    .Finalize(g, &node));
+  }
+
+  testing::ItemsProcessed(static_cast<int64>(iters) * image_size * image_size *
+                          filter_size * filter_size * depth * filter_count *
+                          2);
+  testing::SetLabel(strings::StrCat(image_size, "x", image_size, "x", depth,
+                                    " * ", filter_size, "x", filter_size, "x",
+                                    filter_count));
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+  testing::UseRealTime();
+}
+
+static void BM_Conv2DFloat(int iters, int shape_index) {
+  Conv2DHelper(iters, shape_index, false /* quantized */,
+               false /* per_channel */);
+}
+
+static void BM_QuantizedConv2D(int iters, int shape_index) {
+  Conv2DHelper(iters, shape_index, true /* quantized */,
+               false /* per_channel */);
+}
+
+static void BM_QuantizedConv2DPerChannel(int iters, int shape_index) {
+  Conv2DHelper(iters, shape_index, true /* quantized */,
+               true /* per_channel */);
+}
+
+BENCHMARK(BM_Conv2DFloat)->Arg(0)->Arg(1)->Arg(2)->Arg(3)->Arg(4)->Arg(5);
+BENCHMARK(BM_QuantizedConv2D)->Arg(0)->Arg(1)->Arg(2)->Arg(3)->Arg(4)->Arg(5);
+BENCHMARK(BM_QuantizedConv2DPerChannel)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(3)
+    ->Arg(4)
+    ->Arg(5);
+
 }  // namespace tensorflow
@@ -15,6 +15,8 @@ limitations under the License.
 
 // Implements a quantized eight-bit version of the matmul operation.
 
+#include <vector>
+
 #define EIGEN_USE_THREADS
 
 #define GEMMLOWP_ALLOW_SLOW_SCALAR_FALLBACK
@@ -77,18 +79,15 @@ class QuantizedMatMulOp : public OpKernel {
     const Tensor& b = context->input(1);
     const float min_a = context->input(2).flat<float>()(0);
     const float max_a = context->input(3).flat<float>()(0);
-    const float min_b = context->input(4).flat<float>()(0);
-    const float max_b = context->input(5).flat<float>()(0);
+    const Tensor& min_b_tensor = context->input(4);
+    const Tensor& max_b_tensor = context->input(5);
 
     // Make sure that we have valid quantization ranges for the input buffers.
     // If the difference between the min and max is negative or zero, it makes
     // it hard to do meaningful intermediate operations on the values.
     OP_REQUIRES(context, (max_a > min_a),
                 errors::InvalidArgument("max_a must be larger than min_a."));
-    OP_REQUIRES(context, (max_b > min_b),
-                errors::InvalidArgument("max_b must be larger than min_b."));
     const int32 offset_a = FloatToQuantizedUnclamped<T1>(0.0f, min_a, max_a);
-    const int32 offset_b = FloatToQuantizedUnclamped<T2>(0.0f, min_b, max_b);
     const int32 offset_c = 0;
     const int32 mult_c = 1;
     const int32 shift_c = 0;
@@ -132,6 +131,36 @@ class QuantizedMatMulOp : public OpKernel {
     const size_t ldb = b.dim_size(1);
     const size_t ldc = n;
 
+    // The range of b is either a single range for the whole matrix, or one
+    // range per column of the result.
+    float min_b;
+    float max_b;
+    int32 offset_b;
+    PerChannelQuantization<T2> per_channel;
+    const bool is_per_channel =
+        min_b_tensor.NumElements() > 1 || max_b_tensor.NumElements() > 1;
+    if (is_per_channel) {
+      OP_REQUIRES_OK(context, per_channel.Init(min_b_tensor, max_b_tensor, n));
+      min_b = per_channel.min;
+      max_b = per_channel.max;
+      // The per-column offsets are applied after the multiplication.
+      offset_b = 0;
+    } else {
+      OP_REQUIRES(context,
+                  min_b_tensor.NumElements() == 1 &&
+                      max_b_tensor.NumElements() == 1,
+                  errors::InvalidArgument(
+                      "min_b and max_b must hold one value, or one per "
+                      "column of the output; got ",
+                      min_b_tensor.NumElements(), " and ",
+                      max_b_tensor.NumElements()));
+      min_b = min_b_tensor.flat<float>()(0);
+      max_b = max_b_tensor.flat<float>()(0);
+      OP_REQUIRES(context, (max_b > min_b),
+                  errors::InvalidArgument("max_b must be larger than min_b."));
+      offset_b = FloatToQuantizedUnclamped<T2>(0.0f, min_b, max_b);
+    }
+
     if (meta::IsSupportedAndEnabled() && std::is_same<T1, quint8>() &&
         std::is_same<T2, quint8>() && std::is_same<Toutput, qint32>() &&
         (offset_c == 0) && (mult_c == 1) && (shift_c == 0) &&
@@ -173,6 +202,22 @@ class QuantizedMatMulOp : public OpKernel {
           lda, b_data, offset_b, ldb, c_data, shift_c, offset_c, mult_c, ldc);
     }
 
+    if (is_per_channel) {
+      // Sum each row of a, with its offset applied, to correct every column
+      // of the result for the offset of its range.
+      std::vector<int32> row_sums(m, 0);
+      for (size_t i = 0; i < m; ++i) {
+        int32 row_sum = 0;
+        for (size_t l = 0; l < k; ++l) {
+          const T1 value = transpose_a_ ? a_data[l * lda + i]
+                                        : a_data[i * lda + l];
+          row_sum += static_cast<int32>(value) - offset_a;
+        }
+        row_sums[i] = row_sum;
+      }
+      per_channel.Apply(row_sums.data(), m, ldc, &(c_data->value));
+    }
+
     float min_c_value;
     float max_c_value;
     QuantizationRangeForMultiplication<T1, T2, Toutput>(
@@ -81,6 +81,95 @@ TEST_F(QuantizedMatMulTest, Small_NoParams) {
   test::ExpectTensorEqual<qint32>(expected, *GetOutput(0));
 }
 
+// Multiplies by a matrix whose columns each have their own quantization range,
+// with a transposed `a` to check that the row sums follow the transpose.
+TEST_F(QuantizedMatMulTest, Small_PerColumnRanges) {
+  TF_ASSERT_OK(NodeDefBuilder("quantized_mat_mul_op", "QuantizedMatMul")
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("Toutput", DataTypeToEnum<qint32>::v())
+                   .Attr("transpose_a", true)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  // A matrix, after being transposed, is:
+  // |  1 |  2 |  3 |
+  // |  4 |  5 |  6 |
+  AddInputFromArray<quint8>(TensorShape({3, 2}), {1, 4, 2, 5, 3, 6});
+  // The quantized B matrix is:
+  // |  1 | 130 |
+  // |  2 | 126 |
+  // |  3 | 132 |
+  // The first column's range is [0, 255], so it represents 1, 2 and 3. The
+  // second column's range is [-64, 63.5], with zero at 128 and 0.5 per level,
+  // so it represents 1, -1 and 2.
+  AddInputFromArray<quint8>(TensorShape({3, 2}), {1, 130, 2, 126, 3, 132});
+  AddInputFromArray<float>(TensorShape({1}), {0});
+  AddInputFromArray<float>(TensorShape({1}), {255.0f});
+  AddInputFromArray<float>(TensorShape({2}), {0, -64.0f});
+  AddInputFromArray<float>(TensorShape({2}), {255.0f, 63.5f});
+
+  TF_ASSERT_OK(RunOpKernel());
+  // The first column has the widest range, so the output has one unit per
+  // level:
+  // (1 * 1) + (2 * 2) + (3 * 3) = 14
+  // (1 * 1) + (2 * -1) + (3 * 2) = 5
+  // (4 * 1) + (5 * 2) + (6 * 3) = 32
+  // (4 * 1) + (5 * -1) + (6 * 2) = 11
+  Tensor expected(allocator(), DT_QINT32, TensorShape({2, 2}));
+  test::FillValues<qint32>(&expected, {14, 5, 32, 11});
+  test::ExpectTensorEqual<qint32>(expected, *GetOutput(0));
+  EXPECT_NEAR(1.0f,
+              FloatForOneQuantizedLevel<qint32>(GetOutput(1)->flat<float>()(0),
+                                                GetOutput(2)->flat<float>()(0)),
+              1e-6);
+}
+
+// Per-column ranges must have one element per column of the output.
+TEST_F(QuantizedMatMulTest, Small_PerColumnRangesBadShape) {
+  TF_ASSERT_OK(NodeDefBuilder("quantized_mat_mul_op", "QuantizedMatMul")
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("Toutput", DataTypeToEnum<qint32>::v())
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<quint8>(TensorShape({1, 1}), {1});
+  AddInputFromArray<quint8>(TensorShape({1, 3}), {1, 2, 3});
+  AddInputFromArray<float>(TensorShape({1}), {0});
+  AddInputFromArray<float>(TensorShape({1}), {255.0f});
+  AddInputFromArray<float>(TensorShape({2}), {0, 0});
+  AddInputFromArray<float>(TensorShape({2}), {255.0f, 255.0f});
+  EXPECT_EQ(::tensorflow::error::INVALID_ARGUMENT, RunOpKernel().code());
+}
+
+// Empty ranges are neither a single range nor one range per column.
+TEST_F(QuantizedMatMulTest, Small_EmptyRanges) {
+  TF_ASSERT_OK(NodeDefBuilder("quantized_mat_mul_op", "QuantizedMatMul")
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_QUINT8))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Attr("Toutput", DataTypeToEnum<qint32>::v())
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddInputFromArray<quint8>(TensorShape({1, 1}), {1});
+  AddInputFromArray<quint8>(TensorShape({1, 3}), {1, 2, 3});
+  AddInputFromArray<float>(TensorShape({1}), {0});
+  AddInputFromArray<float>(TensorShape({1}), {255.0f});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  AddInputFromArray<float>(TensorShape({0}), {});
+  EXPECT_EQ(::tensorflow::error::INVALID_ARGUMENT, RunOpKernel().code());
+}
+
 // This test multiplies two 1x1 8bit matrices, and compares the
 // results with hand-calculated expectations.
 TEST_F(QuantizedMatMulTest, VerySmall_WithParams) {
@@ -15,11 +15,14 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/queue_base.h"
 
+#include <algorithm>
 #include <vector>
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -73,7 +76,8 @@ QueueBase::QueueBase(int32 capacity, const DataTypeVector& component_dtypes,
       component_dtypes_(component_dtypes),
       component_shapes_(component_shapes),
       name_(name),
-      closed_(false) {}
+      closed_(false),
+      has_pending_attempts_(false) {}
 
 QueueBase::~QueueBase() {}
 
@@ -202,6 +206,45 @@ Status QueueBase::ValidateManyTuple(const Tuple& tuple) {
   return Status::OK();
 }
 
+Status QueueBase::CopyTuplesToBatch(OpKernelContext* ctx,
+                                    const std::vector<Tuple>& tuples,
+                                    Tuple* batch) {
+  const int64 batch_size = tuples.size();
+  batch->clear();
+  batch->reserve(num_components());
+  int64 element_bytes = 1;
+  for (int i = 0; i < num_components(); ++i) {
+    Tensor component;
+    TF_RETURN_IF_ERROR(ctx->allocate_temp(
+        component_dtypes_[i], ManyOutShape(i, batch_size), &component));
+    batch->push_back(component);
+    if (batch_size > 0) {
+      element_bytes += tuples[0][i].TotalBytes();
+    }
+  }
+  if (batch_size == 0) return Status::OK();
+
+  mutex status_mu;
+  Status status;
+  auto copy_range = [&tuples, batch, &status_mu, &status, this](int64 begin,
+                                                                 int64 end) {
+    for (int64 index = begin; index < end; ++index) {
+      for (int i = 0; i < num_components(); ++i) {
+        Status s = CopyElementToSlice(tuples[index][i], &(*batch)[i], index);
+        if (!s.ok()) {
+          mutex_lock l(status_mu);
+          status.Update(s);
+          return;
+        }
+      }
+    }
+  };
+  auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
+        element_bytes, copy_range);
+  return status;
+}
+
 void QueueBase::Cancel(Action action, CancellationManager* cancellation_manager,
                        CancellationToken token) {
   DoneCallback callback = nullptr;
@@ -331,6 +374,8 @@ bool QueueBase::TryAttemptLocked(Action action,
 void QueueBase::FlushUnlocked() {
   std::vector<CleanUp> clean_up;
   Ref();
+  has_pending_attempts_.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
   {
     mutex_lock lock(mu_);
     bool changed;
@@ -338,6 +383,8 @@ void QueueBase::FlushUnlocked() {
       changed = TryAttemptLocked(kEnqueue, &clean_up);
       changed = TryAttemptLocked(kDequeue, &clean_up) || changed;
     } while (changed);
+    has_pending_attempts_.store(!enqueue_attempts_.empty() ||
+                                !dequeue_attempts_.empty());
   }
   Unref();
   for (const auto& to_clean : clean_up) {
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_QUEUE_BASE_H_
 #define TENSORFLOW_CORE_KERNELS_QUEUE_BASE_H_
 
+#include <atomic>
 #include <deque>
 #include <vector>
 
@@ -115,6 +116,14 @@ class QueueBase : public QueueInterface {
     return shape;
   }
 
+  // Allocates one tensor per component with shape
+  // ManyOutShape(i, tuples.size()) and copies tuples[j][i] into its j^th
+  // slice. Does not need mu_: dequeue-many implementations take the elements
+  // under the lock and call this once it is released, and the copies are
+  // sharded across the CPU worker threads of `ctx`.
+  Status CopyTuplesToBatch(OpKernelContext* ctx,
+                           const std::vector<Tuple>& tuples, Tuple* batch);
+
   void Cancel(Action action, CancellationManager* cancellation_manager,
               CancellationToken token);
 
@@ -174,6 +183,14 @@ class QueueBase : public QueueInterface {
   std::deque<Attempt> enqueue_attempts_ GUARDED_BY(mu_);
   std::deque<Attempt> dequeue_attempts_ GUARDED_BY(mu_);
 
+  // True while enqueue_attempts_ or dequeue_attempts_ may be non-empty.
+  // Readable without mu_, so that implementations can take a lock-free fast
+  // path only when no operation is blocked. FlushUnlocked() sets it, with a
+  // full fence, before running any attempt, so an operation that completes
+  // without mu_ and then sees it false cannot have been missed by an
+  // attempt.
+  std::atomic<bool> has_pending_attempts_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(QueueBase);
 };
 
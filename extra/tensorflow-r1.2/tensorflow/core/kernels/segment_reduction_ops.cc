@@ -30,7 +30,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -100,86 +102,93 @@ class SegmentReductionOp : public OpKernel {
                 errors::InvalidArgument("segment ids must be >= 0"));
     auto output_flat = output->flat_outer_dims<T>();
 
-#if !defined(EIGEN_HAS_INDEX_LIST)
-    Eigen::DSizes<Eigen::DenseIndex, 1> dims_to_reduce;
-    dims_to_reduce[0] = 0;
-#else
-    Eigen::IndexList<Eigen::type2index<0>> dims_to_reduce;
-#endif
-    Index start = 0, end = 1;
-
-    Index uninitialized_index = 0;  // Index from which the output is not set.
-    Index out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    // TODO(agarwal): if this loop becomes a bottleneck, consider sharding it
-    // across threads.
-    Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
-    while (end <= num_indices) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      Index next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
-        }
+    // The segments are found sequentially, checking that the ids increase,
+    // and then reduced in parallel. Each segment also fills the gap in the
+    // output before it.
+    std::vector<int64> segment_starts;
+    std::vector<Index> out_indices;
+    for (int64 i = 0; i < num_indices; ++i) {
+      const Index out_index = internal::SubtleMustCopy(segment_vec(i));
+      if (!out_indices.empty()) {
+        if (out_index == out_indices.back()) continue;
         // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
+        OP_REQUIRES(context, out_indices.back() < out_index,
                     errors::InvalidArgument("segment ids are not increasing"));
       }
-
-      // Process segment [start, end)
-      const T* in_slice_ptr = &input_flat(start, 0);
-      typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
-                               Eigen::Unaligned>
-          OutT;
-
       OP_REQUIRES(
           context, FastBoundsCheck(out_index, output_rows),
           errors::InvalidArgument(
               "Segment id ", out_index, " out of range [0, ", output_rows,
               "), possibly because 'segment_ids' input is not sorted."));
+      segment_starts.push_back(i);
+      out_indices.push_back(out_index);
+    }
+    segment_starts.push_back(num_indices);
+    const int64 num_segments = out_indices.size();
 
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(T(default_value));
-      }
+    auto reduce_segments = [&input_flat, &output_flat, &segment_starts,
+                            &out_indices, num_col](int64 begin, int64 end) {
+#if !defined(EIGEN_HAS_INDEX_LIST)
+      Eigen::DSizes<Eigen::DenseIndex, 1> dims_to_reduce;
+      dims_to_reduce[0] = 0;
+#else
+      Eigen::IndexList<Eigen::type2index<0>> dims_to_reduce;
+#endif
+      Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
+      for (int64 segment = begin; segment < end; ++segment) {
+        const int64 start = segment_starts[segment];
+        const int64 num_rows = segment_starts[segment + 1] - start;
+        const Index out_index = out_indices[segment];
+        // Index from which the output is not set.
+        const Index uninitialized_index =
+            segment == 0 ? 0 : out_indices[segment - 1] + 1;
+
+        // If there is a gap between two indices, we need to set that gap to
+        // the default value.
+        if (out_index > uninitialized_index) {
+          Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+              out_index - uninitialized_index, num_col);
+          Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+              gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
+          gap_slice.setConstant(T(default_value));
+        }
 
-      T* out_slice_ptr = &output_flat(out_index, 0);
-      OutT out_slice(out_slice_ptr, out_slice_shape);
-      // We don't use out_slice.device(context->eigen_device<Device>)
-      // because these pieces of work are likely to be very small and
-      // the context switching overhead dwarfs any benefit we get from
-      // using another thread to do this work.
-      if (start == end - 1) {
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, out_slice_shape);
-        out_slice = in_slice;
-      } else {
-        Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(end - start,
-                                                           num_col);
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 2, Eigen::RowMajor>,
+        const T* in_slice_ptr = &input_flat(start, 0);
+        typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
                                  Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, in_slice_shape);
-
-        out_slice = in_slice.reduce(dims_to_reduce, Reducer());
+            OutT;
+        T* out_slice_ptr = &output_flat(out_index, 0);
+        OutT out_slice(out_slice_ptr, out_slice_shape);
+        // We don't use out_slice.device(context->eigen_device<Device>)
+        // because these pieces of work are likely to be very small and
+        // the context switching overhead dwarfs any benefit we get from
+        // using another thread to do this work.
+        if (num_rows == 1) {
+          typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
+                                   Eigen::Unaligned>
+              InT;
+          InT in_slice(in_slice_ptr, out_slice_shape);
+          out_slice = in_slice;
+        } else {
+          Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(num_rows,
+                                                             num_col);
+          typedef Eigen::TensorMap<
+              Eigen::Tensor<const T, 2, Eigen::RowMajor>, Eigen::Unaligned>
+              InT;
+          InT in_slice(in_slice_ptr, in_slice_shape);
+
+          out_slice = in_slice.reduce(dims_to_reduce, Reducer());
+        }
       }
-      if (end >= num_indices) break;
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-    }
+    };
+    // Segments are assumed to be of similar sizes, each reading its input
+    // rows and writing one output row plus its share of the gaps.
+    const int64 cost_per_segment =
+        (num_indices + output_rows) / num_segments * num_col;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          cost_per_segment, reduce_segments);
   }
 };
 
@@ -229,6 +238,41 @@ REGISTER_COMPLEX_CPU_KERNELS_ALL(complex128);
 
 namespace functor {
 
+// Checks that `segment_ids` are in [0, output_rows), then calls
+// update(output_row, input_row) for each input row in parallel. Each shard
+// owns a range of output rows: it scans all the ids and handles the input
+// rows that map into its range. Every output row is therefore updated by a
+// single thread in input order, which keeps results identical to a
+// sequential loop and needs no per-thread copy of an output that can be as
+// large as an embedding table. `cost_per_row` is the cost of one update.
+template <typename Index, typename Update>
+void ShardUnsortedSegments(OpKernelContext* ctx, const Index output_rows,
+                           const TensorShape& segment_ids_shape,
+                           typename TTypes<Index>::ConstFlat segment_ids,
+                           int64 cost_per_row, Update update) {
+  const int64 N = segment_ids.dimension(0);
+  for (int64 i = 0; i < N; ++i) {
+    Index j = internal::SubtleMustCopy(segment_ids(i));
+    OP_REQUIRES(ctx, FastBoundsCheck(j, output_rows),
+                errors::InvalidArgument(
+                    "segment_ids", SliceDebugString(segment_ids_shape, i),
+                    " = ", j, " is out of range [0, ", output_rows, ")"));
+  }
+  auto work = [&segment_ids, &update, N](int64 begin, int64 end) {
+    for (int64 i = 0; i < N; ++i) {
+      // The range check also guards against ids changed since validation.
+      const Index j = internal::SubtleMustCopy(segment_ids(i));
+      if (j >= begin && j < end) update(j, i);
+    }
+  };
+  // Every shard reads all the ids in addition to its share of the updates.
+  const int64 cost_per_output_row =
+      output_rows > 0 ? (N * cost_per_row) / output_rows + 1 : 1;
+  auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, output_rows,
+        cost_per_output_row, work);
+}
+
 // UnsortedSegmentSumFunctor implementation for CPUDevice.
 // todo: Remove duplicate code in UnsortedSegmentSumFunctor and UnsortedSegmentMaxFunctor.
 template <typename T, typename Index>
@@ -245,14 +289,11 @@ struct UnsortedSegmentSumFunctor<CPUDevice, T, Index>
     }
     const int64 N = segment_ids.dimension(0);
     auto data_flat = typename TTypes<T, 2>::ConstTensor(data, N, data_size / N);
-    for (int64 i = 0; i < N; ++i) {
-      Index j = internal::SubtleMustCopy(segment_ids(i));
-      OP_REQUIRES(ctx, FastBoundsCheck(j, output_rows),
-                  errors::InvalidArgument(
-                      "segment_ids", SliceDebugString(segment_ids_shape, i),
-                      " = ", j, " is out of range [0, ", output_rows, ")"));
-      output.template chip<0>(j) += data_flat.template chip<0>(i);
-    }
+    ShardUnsortedSegments<Index>(
+        ctx, output_rows, segment_ids_shape, segment_ids, data_size / N,
+        [&output, &data_flat](Index j, int64 i) {
+          output.template chip<0>(j) += data_flat.template chip<0>(i);
+        });
   }
 };
 // UnsortedSegmentMaxFunctor implementation for CPUDevice.
@@ -270,15 +311,12 @@ struct UnsortedSegmentMaxFunctor<CPUDevice, T, Index>
     }
     const int64 N = segment_ids.dimension(0);
     auto data_flat = typename TTypes<T, 2>::ConstTensor(data, N, data_size / N);
-    for (int64 i = 0; i < N; ++i) {
-      Index j = internal::SubtleMustCopy(segment_ids(i));
-      OP_REQUIRES(ctx, FastBoundsCheck(j, output_rows),
-                  errors::InvalidArgument(
-                      "segment_ids", SliceDebugString(segment_ids_shape, i),
-                      " = ", j, " is out of range [0, ", output_rows, ")"));
-      output.template chip<0>(j) =
-          data_flat.template chip<0>(i).cwiseMax(output.template chip<0>(j));
-    }
+    ShardUnsortedSegments<Index>(
+        ctx, output_rows, segment_ids_shape, segment_ids, data_size / N,
+        [&output, &data_flat](Index j, int64 i) {
+          output.template chip<0>(j) = data_flat.template chip<0>(i).cwiseMax(
+              output.template chip<0>(j));
+        });
   }
 };
 }  // namespace functor
@@ -468,58 +506,75 @@ class SparseSegmentReductionOpBase : public OpKernel {
                 errors::InvalidArgument("segment ids must be >= 0"));
     auto output_flat = output->flat_outer_dims<T>();
 
-    int64 start = 0, end = 1;
-    // Index from which the output is not initialized.
-    OutputRow uninitialized_index = 0;
-    OutputRow out_index = internal::SubtleMustCopy(segment_vec(start));
-
-    while (true) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      OutputRow next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
-        }
+    // As in SegmentReductionOp, the segments are found sequentially and
+    // reduced in parallel, each one filling the gap in the output before it.
+    std::vector<int64> segment_starts;
+    std::vector<OutputRow> out_indices;
+    for (int64 i = 0; i < num_indices; ++i) {
+      const OutputRow out_index = internal::SubtleMustCopy(segment_vec(i));
+      if (!out_indices.empty()) {
+        if (out_index == out_indices.back()) continue;
         // We have a new segment here.  Verify that the segment ids are growing.
-        OP_REQUIRES(context, out_index < next_index,
+        OP_REQUIRES(context, out_indices.back() < out_index,
                     errors::InvalidArgument("segment ids are not increasing"));
       }
-
       OP_REQUIRES(
           context, FastBoundsCheck(out_index, output_rows),
           errors::InvalidArgument(
               "Segment id ", out_index, " out of range [0, ", output_rows,
               "), possibly because 'segment_ids' input is not sorted."));
+      segment_starts.push_back(i);
+      out_indices.push_back(out_index);
+    }
+    segment_starts.push_back(num_indices);
+    const int64 num_segments = out_indices.size();
+
+    // The position of the first out-of-range index found by any shard.
+    mutex mu;
+    int64 bad_position = num_indices;
+    auto reduce_segments = [this, &input_flat, &indices_vec, &output_flat,
+                            &segment_starts, &out_indices, num_col, &mu,
+                            &bad_position](int64 begin, int64 end) {
+      for (int64 segment = begin; segment < end; ++segment) {
+        const int64 start = segment_starts[segment];
+        const OutputRow out_index = out_indices[segment];
+        // Index from which the output is not initialized.
+        const OutputRow uninitialized_index =
+            segment == 0 ? 0 : out_indices[segment - 1] + 1;
+
+        // If there is a gap between two indices, we need to set that gap to
+        // the default value.
+        if (out_index > uninitialized_index) {
+          Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
+              out_index - uninitialized_index, num_col);
+          Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+              gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
+          gap_slice.setConstant(default_value_);
+        }
 
-      // If there is a gap between two indices, we need to set that gap to the
-      // default value.
-      if (out_index > uninitialized_index) {
-        Eigen::DSizes<Eigen::DenseIndex, 2> gap_slice_shape(
-            out_index - uninitialized_index, num_col);
-        Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor>, Eigen::Unaligned>
-            gap_slice(&output_flat(uninitialized_index, 0), gap_slice_shape);
-        gap_slice.setConstant(default_value_);
+        auto out = output_flat.template chip<0>(out_index);
+        const int64 bad_offset =
+            Reduce(input_flat, indices_vec, start,
+                   segment_starts[segment + 1] - start, out);
+        if (bad_offset >= 0) {
+          mutex_lock l(mu);
+          bad_position = std::min(bad_position, start + bad_offset);
+        }
       }
-
-      auto out = output_flat.template chip<0>(out_index);
-      const int bad_offset =
-          Reduce(input_flat, indices_vec, start, end - start, out);
-      OP_REQUIRES(context, bad_offset < 0,
-                  errors::InvalidArgument(
-                      "Bad: indices[", start + bad_offset, "] == ",
-                      indices_vec(start + bad_offset), " out of range [0, ",
-                      input_flat.dimension(0), ")"));
-
-      if (end >= num_indices) break;
-      start = end;
-      ++end;
-      uninitialized_index = out_index + 1;
-      out_index = next_index;
-    }
+    };
+    // Segments are assumed to be of similar sizes, each gathering its input
+    // rows and writing one output row plus its share of the gaps.
+    const int64 cost_per_segment =
+        (num_indices + output_rows) / num_segments * num_col;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          cost_per_segment, reduce_segments);
+    OP_REQUIRES(context, bad_position == num_indices,
+                errors::InvalidArgument(
+                    "Bad: indices[", bad_position, "] == ",
+                    indices_vec(bad_position), " out of range [0, ",
+                    input_flat.dimension(0), ")"));
   }
 
  private:
@@ -780,24 +835,31 @@ class SparseSegmentGradOpBase : public OpKernel {
       }
     }
 
-    auto output_flat = output->flat_outer_dims<T>();
-    output_flat.setZero();
-    std::vector<bool> is_modified(M, false);
-
     for (int64 i = 0; i < N; ++i) {
       const Index output_idx = internal::SubtleMustCopy(indices_vec(i));
       OP_REQUIRES(context, FastBoundsCheck(output_idx, M),
                   errors::InvalidArgument("Index ", output_idx,
                                           " out of range [0, ", M, ")."));
+    }
 
-      const SegmentId idx = internal::SubtleMustCopy(segment_vec(i));
-      OP_REQUIRES(
-          context, FastBoundsCheck(idx, num_segments),
-          errors::InvalidArgument("Segment id ", idx, " out of range [0, ",
-                                  num_segments, ")."));
-
-      const T scale = static_cast<T>(scaling[idx]);
-      if (is_modified[output_idx]) {
+    // Each shard owns a range of output rows, which it zeroes and then
+    // accumulates into, scanning all the indices for the ones in its range.
+    // Every output row is updated by a single thread in input order.
+    auto output_flat = output->flat_outer_dims<T>();
+    auto work = [&input_flat, &indices_vec, &segment_vec, &scaling,
+                 &output_flat, N, num_segments](int64 begin, int64 end) {
+      for (int64 row = begin; row < end; ++row) {
+        output_flat.template chip<0>(row).setZero();
+      }
+      for (int64 i = 0; i < N; ++i) {
+        // The indices were checked above; checking them again guards
+        // against inputs changed since.
+        const Index output_idx = internal::SubtleMustCopy(indices_vec(i));
+        if (output_idx < begin || output_idx >= end) continue;
+        const SegmentId idx = internal::SubtleMustCopy(segment_vec(i));
+        if (!FastBoundsCheck(idx, num_segments)) continue;
+
+        const T scale = static_cast<T>(scaling[idx]);
         if (scale == 1.0) {
           output_flat.template chip<0>(output_idx) +=
               input_flat.template chip<0>(idx);
@@ -805,17 +867,12 @@ class SparseSegmentGradOpBase : public OpKernel {
           output_flat.template chip<0>(output_idx) +=
               input_flat.template chip<0>(idx) * scale;
         }
-      } else {
-        if (scale == 1.0) {
-          output_flat.template chip<0>(output_idx) =
-              input_flat.template chip<0>(idx);
-        } else {
-          output_flat.template chip<0>(output_idx) =
-              input_flat.template chip<0>(idx) * scale;
-        }
       }
-      is_modified[output_idx] = true;
-    }
+    };
+    const int64 num_col = input_flat.dimension(1);
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, M,
+          (N * num_col) / M + num_col, work);
   }
 
  private:
@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cmath>
 #include <functional>
 #include <vector>
 
@@ -32,6 +33,8 @@ limitations under the License.
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
@@ -39,6 +42,164 @@ limitations under the License.
 
 namespace tensorflow {
 
+// The reductions below are large enough to be split across threads; each
+// is compared with a sequential computation of the same result.
+class SegmentReductionOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(const string& op, int num_inputs) {
+    NodeDefBuilder builder("myop", op);
+    builder.Input(FakeInput(DT_FLOAT));
+    for (int i = 1; i < num_inputs; ++i) builder.Input(FakeInput(DT_INT32));
+    TF_ASSERT_OK(builder.Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  static std::vector<float> Values(int64 size) {
+    std::vector<float> values(size);
+    for (int64 i = 0; i < size; ++i) values[i] = (i % 97) * 0.5f;
+    return values;
+  }
+};
+
+TEST_F(SegmentReductionOpTest, SegmentSumManySegmentsWithGaps) {
+  MakeOp("SegmentSum", 2);
+  const int64 kRows = 3000, kCols = 5;
+  const std::vector<float> data = Values(kRows * kCols);
+  std::vector<int32> ids(kRows);
+  // Segments of 1 to 3 rows, with every fourth id skipped.
+  for (int64 i = 0; i < kRows; ++i) ids[i] = (i / 2) + (i / 2) / 3;
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), data);
+  AddInputFromArray<int32>(TensorShape({kRows}), ids);
+  TF_ASSERT_OK(RunOpKernel());
+
+  const int64 num_segments = ids.back() + 1;
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({num_segments, kCols}));
+  test::FillFn<float>(&expected, [](int) { return 0.0f; });
+  auto expected_matrix = expected.matrix<float>();
+  for (int64 i = 0; i < kRows; ++i) {
+    for (int64 c = 0; c < kCols; ++c) {
+      expected_matrix(ids[i], c) += data[i * kCols + c];
+    }
+  }
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(SegmentReductionOpTest, SegmentSumNotIncreasing) {
+  MakeOp("SegmentSum", 2);
+  AddInputFromArray<float>(TensorShape({4, 1}), {1, 2, 3, 4});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 1, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("not increasing")) << s;
+}
+
+TEST_F(SegmentReductionOpTest, UnsortedSegmentSumMatchesSequential) {
+  MakeOp("UnsortedSegmentSum", 3);
+  const int64 kRows = 5000, kCols = 8, kSegments = 700;
+  const std::vector<float> data = Values(kRows * kCols);
+  std::vector<int32> ids(kRows);
+  for (int64 i = 0; i < kRows; ++i) ids[i] = (i * 7919) % kSegments;
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), data);
+  AddInputFromArray<int32>(TensorShape({kRows}), ids);
+  AddInputFromArray<int32>(TensorShape({}), {kSegments});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({kSegments, kCols}));
+  test::FillFn<float>(&expected, [](int) { return 0.0f; });
+  auto expected_matrix = expected.matrix<float>();
+  for (int64 i = 0; i < kRows; ++i) {
+    for (int64 c = 0; c < kCols; ++c) {
+      expected_matrix(ids[i], c) += data[i * kCols + c];
+    }
+  }
+  // Each output row is accumulated in input order, as above.
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(SegmentReductionOpTest, UnsortedSegmentSumOutOfRange) {
+  MakeOp("UnsortedSegmentSum", 3);
+  AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+  AddInputFromArray<int32>(TensorShape({3}), {0, 5, 1});
+  AddInputFromArray<int32>(TensorShape({}), {2});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("out of range")) << s;
+}
+
+TEST_F(SegmentReductionOpTest, SparseSegmentMeanManySegments) {
+  MakeOp("SparseSegmentMean", 3);
+  const int64 kRows = 400, kCols = 3, kIndices = 4000;
+  const std::vector<float> data = Values(kRows * kCols);
+  std::vector<int32> indices(kIndices);
+  std::vector<int32> ids(kIndices);
+  for (int64 i = 0; i < kIndices; ++i) {
+    indices[i] = (i * 31) % kRows;
+    // Segments alternate between six rows and a single row.
+    ids[i] = (i / 7) * 2 + (i % 7 == 6);
+  }
+  AddInputFromArray<float>(TensorShape({kRows, kCols}), data);
+  AddInputFromArray<int32>(TensorShape({kIndices}), indices);
+  AddInputFromArray<int32>(TensorShape({kIndices}), ids);
+  TF_ASSERT_OK(RunOpKernel());
+
+  const int64 num_segments = ids.back() + 1;
+  std::vector<double> sums(num_segments * kCols, 0.0);
+  std::vector<int> counts(num_segments, 0);
+  for (int64 i = 0; i < kIndices; ++i) {
+    ++counts[ids[i]];
+    for (int64 c = 0; c < kCols; ++c) {
+      sums[ids[i] * kCols + c] += data[indices[i] * kCols + c];
+    }
+  }
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({num_segments, kCols}));
+  test::FillFn<float>(&expected, [&sums, &counts](int i) {
+    const int count = counts[i / kCols];
+    return count == 0 ? 0.0f : static_cast<float>(sums[i] / count);
+  });
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+}
+
+TEST_F(SegmentReductionOpTest, SparseSegmentSumBadIndex) {
+  MakeOp("SparseSegmentSum", 3);
+  AddInputFromArray<float>(TensorShape({2, 1}), {1, 2});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 1, 7});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 2, 3});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(StringPiece(s.ToString()).contains("indices[3] == 7")) << s;
+}
+
+TEST_F(SegmentReductionOpTest, SparseSegmentSqrtNGradMatchesSequential) {
+  TF_ASSERT_OK(NodeDefBuilder("myop", "SparseSegmentSqrtNGrad")
+                   .Input(FakeInput(DT_FLOAT))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  const int64 kSegments = 300, kCols = 4, kIndices = 3000, kOutputRows = 500;
+  const std::vector<float> grad = Values(kSegments * kCols);
+  std::vector<int32> indices(kIndices);
+  std::vector<int32> ids(kIndices);
+  for (int64 i = 0; i < kIndices; ++i) {
+    indices[i] = (i * 13) % kOutputRows;
+    ids[i] = i / 10;
+  }
+  AddInputFromArray<float>(TensorShape({kSegments, kCols}), grad);
+  AddInputFromArray<int32>(TensorShape({kIndices}), indices);
+  AddInputFromArray<int32>(TensorShape({kIndices}), ids);
+  AddInputFromArray<int32>(TensorShape({}), {kOutputRows});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({kOutputRows, kCols}));
+  test::FillFn<float>(&expected, [](int) { return 0.0f; });
+  auto expected_matrix = expected.matrix<float>();
+  const float scale = static_cast<float>(1.0 / sqrt(10.0));
+  for (int64 i = 0; i < kIndices; ++i) {
+    for (int64 c = 0; c < kCols; ++c) {
+      expected_matrix(indices[i], c) += grad[ids[i] * kCols + c] * scale;
+    }
+  }
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+}
+
 template <typename Index>
 static void BM_SegmentReduction(int iters, const string& reduction,
                                 Index num_rows, Index num_cols,
@@ -114,6 +275,37 @@ BM_Reduce_Arg(64, 32, 2);
 BM_Reduce_Arg(4096, 32, 2);
 BM_Reduce_Arg(4096, 128, 2);
 
+// Aggregates the gradient rows of an embedding lookup into a table of
+// `num_segments` rows.
+static void BM_UnsortedSegmentSum(int iters, int num_rows, int num_segments) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  const int kNumCols = 64;
+  Tensor data(DT_FLOAT, TensorShape({num_rows, kNumCols}));
+  data.flat<float>().setRandom();
+  Tensor segment_ids(DT_INT32, TensorShape({num_rows}));
+  test::FillFn<int32>(&segment_ids, [num_segments](int i) -> int32 {
+    return (static_cast<int64>(i) * 7919) % num_segments;
+  });
+  Tensor num_segments_t(DT_INT32, TensorShape({}));
+  num_segments_t.scalar<int32>()() = num_segments;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "UnsortedSegmentSum")
+                  .Input(test::graph::Constant(g, data))
+                  .Input(test::graph::Constant(g, segment_ids))
+                  .Input(test::graph::Constant(g, num_segments_t))
+                  .Finalize(g, nullptr));
+  testing::UseRealTime();
+  testing::BytesProcessed(static_cast<int64>(iters) * num_rows * kNumCols *
+                          sizeof(float));
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+BENCHMARK(BM_UnsortedSegmentSum)
+    ->ArgPair(4096, 1000)
+    ->ArgPair(65536, 1000)
+    ->ArgPair(65536, 100000);
+
 static void SparseSegmentMeanGradHelper(int iters, float uniqueness, int size) {
   testing::StopTiming();
   Graph* g = new Graph(OpRegistry::Global());
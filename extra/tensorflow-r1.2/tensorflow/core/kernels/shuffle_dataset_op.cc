@@ -16,6 +16,11 @@ limitations under the License.
 
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
@@ -162,6 +167,365 @@ class ShuffleDatasetOp : public OpKernel {
 REGISTER_KERNEL_BUILDER(Name("ShuffleDataset").Device(DEVICE_CPU),
                         ShuffleDatasetOp);
 
+// Returns a uniformly distributed index in [0, n) drawn from `generator`.
+//
+// Uses rejection sampling on a 64-bit value assembled from two Philox
+// samples, so that the distribution is unbiased even when `n` is large
+// relative to the range of a single sample.
+template <class Generator>
+int64 UniformIndex(Generator* generator, int64 n) {
+  DCHECK_GT(n, 0);
+  const uint64 range = static_cast<uint64>(n);
+  const uint64 limit = kuint64max - (kuint64max % range);
+  uint64 sample;
+  do {
+    sample = (static_cast<uint64>((*generator)()) << 32) | (*generator)();
+  } while (sample >= limit);
+  return static_cast<int64>(sample % range);
+}
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+class SpillingShuffleDatasetOp : public OpKernel {
+ public:
+  explicit SpillingShuffleDatasetOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    DatasetBase* input;
+    OP_REQUIRES_OK(ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &input));
+    core::ScopedUnref unref_input(input);
+
+    int64 buffer_size;
+    OP_REQUIRES_OK(ctx, ParseScalar<int64>(ctx, "buffer_size", &buffer_size));
+    OP_REQUIRES(
+        ctx, buffer_size > 0,
+        errors::InvalidArgument("buffer_size must be greater than zero."));
+
+    int64 max_buffer_bytes;
+    OP_REQUIRES_OK(
+        ctx, ParseScalar<int64>(ctx, "max_buffer_bytes", &max_buffer_bytes));
+    OP_REQUIRES(ctx, max_buffer_bytes > 0,
+                errors::InvalidArgument(
+                    "max_buffer_bytes must be greater than zero."));
+
+    string spill_directory;
+    OP_REQUIRES_OK(
+        ctx, ParseScalar<string>(ctx, "spill_directory", &spill_directory));
+
+    int64 seed;
+    OP_REQUIRES_OK(ctx, ParseScalar<int64>(ctx, "seed", &seed));
+
+    int64 seed2;
+    OP_REQUIRES_OK(ctx, ParseScalar<int64>(ctx, "seed2", &seed2));
+
+    DatasetBase* dataset =
+        new Dataset(input, buffer_size, max_buffer_bytes,
+                    std::move(spill_directory), seed, seed2);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
+    ResourceHandle handle = MakeResourceHandle<DatasetBase>(
+        ctx, ctx->step_container()->name(), name());
+    OP_REQUIRES_OK(ctx, CreateResource(ctx, handle, dataset));
+    output->flat<ResourceHandle>()(0) = handle;
+  }
+
+ private:
+  template <typename T>
+  static Status ParseScalar(OpKernelContext* ctx, StringPiece name, T* out) {
+    const Tensor* t;
+    TF_RETURN_IF_ERROR(ctx->input(name, &t));
+    if (!TensorShapeUtils::IsScalar(t->shape())) {
+      return errors::InvalidArgument(name, " must be a scalar");
+    }
+    *out = t->scalar<T>()();
+    return Status::OK();
+  }
+
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(const DatasetBase* input, int64 buffer_size,
+            int64 max_buffer_bytes, string spill_directory, int64 seed,
+            int64 seed2)
+        : input_(input),
+          buffer_size_(buffer_size),
+          max_buffer_bytes_(max_buffer_bytes),
+          spill_directory_(std::move(spill_directory)),
+          seed_(seed),
+          seed2_(seed2) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIterator() const override {
+      return std::unique_ptr<IteratorBase>(new Iterator(this));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() override {
+      return strings::StrCat("SpillingShuffleDatasetOp(", buffer_size_, ", ",
+                             max_buffer_bytes_, ", ", spill_directory_, ", ",
+                             seed_, ", ", seed2_, ")::Dataset");
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Dataset* dataset)
+          : DatasetIterator<Dataset>(dataset),
+            input_impl_(dataset->input_->MakeIterator()),
+            generator_(&parent_generator_) {
+        int64 seed = dataset->seed_;
+        int64 seed2 = dataset->seed2_;
+        if (seed == 0 && seed2 == 0) {
+          // If both seeds are unspecified, use completely random seeds.
+          seed = random::New64();
+          seed2 = random::New64();
+        }
+        parent_generator_ = random::PhiloxRandom(seed, seed2);
+        spill_prefix_ =
+            strings::StrCat("shuffle_spill_", strings::Hex(random::New64()));
+      }
+
+      ~Iterator() override {
+        mutex_lock l(mu_);
+        for (auto& file : spill_files_) {
+          if (file != nullptr) {
+            DeleteSpillFile(file.get()).IgnoreError();
+          }
+        }
+      }
+
+      Status GetNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
+                     bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        // Fill the buffer up to `buffer_size` elements. Elements that would
+        // push the resident set past `max_buffer_bytes` are spilled to disk
+        // when a spill directory is configured; otherwise the byte budget
+        // caps the number of buffered elements instead. At least one
+        // element is always admitted so that oversized elements still flow.
+        while (!end_of_input_sequence_ &&
+               buffer_.size() < dataset()->buffer_size_) {
+          if (dataset()->spill_directory_.empty() && !buffer_.empty() &&
+              resident_bytes_ >= dataset()->max_buffer_bytes_) {
+            break;
+          }
+          std::vector<Tensor> input_element;
+          TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &input_element,
+                                                  &end_of_input_sequence_));
+          if (!end_of_input_sequence_) {
+            TF_RETURN_IF_ERROR(AddToBuffer(std::move(input_element)));
+          }
+        }
+
+        if (buffer_.empty()) {
+          DCHECK(end_of_input_sequence_);
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+
+        // Choose an element to produce uniformly at random, and swap the
+        // last entry into its place. Entries are small handles (tensors or
+        // spill locations), so no element data is moved.
+        const int64 index = UniformIndex(&generator_, buffer_.size());
+        BufferEntry& entry = buffer_[index];
+        if (entry.spill_file < 0) {
+          resident_bytes_ -= entry.bytes;
+          *out_tensors = std::move(entry.tensors);
+        } else {
+          TF_RETURN_IF_ERROR(ReadSpilledElement(entry, out_tensors));
+        }
+        std::swap(buffer_[index], buffer_.back());
+        buffer_.pop_back();
+        *end_of_sequence = false;
+        return Status::OK();
+      }
+
+     private:
+      // A buffered element, either resident in memory or spilled as
+      // consecutive records (one serialized TensorProto per component)
+      // starting at `offset` in spill file `spill_file`.
+      struct BufferEntry {
+        std::vector<Tensor> tensors;
+        int64 bytes = 0;
+        int64 spill_file = -1;
+        uint64 offset = 0;
+      };
+
+      struct SpillFile {
+        string filename;
+        // `writer` and `reader` borrow `writable_file` and `readable_file`
+        // respectively, so they are declared after them.
+        std::unique_ptr<WritableFile> writable_file;
+        std::unique_ptr<io::RecordWriter> writer;
+        std::unique_ptr<RandomAccessFile> readable_file;
+        std::unique_ptr<io::RecordReader> reader;
+        uint64 size = 0;
+        int64 num_records = 0;
+        int64 num_live = 0;
+        bool dirty = false;
+      };
+
+      Status AddToBuffer(std::vector<Tensor> element)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        int64 bytes = 0;
+        for (const Tensor& t : element) {
+          bytes += t.TotalBytes();
+        }
+        BufferEntry entry;
+        if (dataset()->spill_directory_.empty() || buffer_.empty() ||
+            resident_bytes_ + bytes <= dataset()->max_buffer_bytes_) {
+          entry.tensors = std::move(element);
+          entry.bytes = bytes;
+          resident_bytes_ += bytes;
+        } else {
+          TF_RETURN_IF_ERROR(SpillElement(element, &entry));
+        }
+        buffer_.push_back(std::move(entry));
+        return Status::OK();
+      }
+
+      Status SpillElement(const std::vector<Tensor>& element,
+                          BufferEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        // Start a new spill file once the active one holds a full buffer's
+        // worth of elements, so that fully consumed files can be deleted
+        // and disk usage stays proportional to the buffer size.
+        if (spill_files_.empty() || spill_files_.back() == nullptr ||
+            spill_files_.back()->num_records >= dataset()->buffer_size_) {
+          TF_RETURN_IF_ERROR(SealActiveSpillFile());
+          std::unique_ptr<SpillFile> file(new SpillFile);
+          file->filename =
+              io::JoinPath(dataset()->spill_directory_,
+                           strings::StrCat(spill_prefix_, "_",
+                                           spill_files_.size(), ".tfrecord"));
+          TF_RETURN_IF_ERROR(Env::Default()->NewWritableFile(
+              file->filename, &file->writable_file));
+          file->writer.reset(new io::RecordWriter(file->writable_file.get()));
+          spill_files_.push_back(std::move(file));
+        }
+        SpillFile* file = spill_files_.back().get();
+        entry->spill_file = spill_files_.size() - 1;
+        entry->offset = file->size;
+        string record;
+        for (const Tensor& t : element) {
+          TensorProto proto;
+          t.AsProtoTensorContent(&proto);
+          record.clear();
+          if (!proto.SerializeToString(&record)) {
+            return errors::Internal("Failed to serialize tensor for spilling");
+          }
+          TF_RETURN_IF_ERROR(file->writer->WriteRecord(record));
+          file->size += kRecordOverheadBytes + record.size();
+        }
+        ++file->num_records;
+        ++file->num_live;
+        file->dirty = true;
+        return Status::OK();
+      }
+
+      Status ReadSpilledElement(const BufferEntry& entry,
+                                std::vector<Tensor>* out_tensors)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        SpillFile* file = spill_files_[entry.spill_file].get();
+        if (file->dirty) {
+          TF_RETURN_IF_ERROR(file->writer->Flush());
+          TF_RETURN_IF_ERROR(file->writable_file->Flush());
+          file->dirty = false;
+        }
+        if (file->reader == nullptr) {
+          TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(
+              file->filename, &file->readable_file));
+          file->reader.reset(new io::RecordReader(file->readable_file.get()));
+        }
+        const DataTypeVector& dtypes = dataset()->output_dtypes();
+        out_tensors->clear();
+        out_tensors->reserve(dtypes.size());
+        uint64 offset = entry.offset;
+        string record;
+        for (size_t i = 0; i < dtypes.size(); ++i) {
+          TF_RETURN_IF_ERROR(file->reader->ReadRecord(&offset, &record));
+          TensorProto proto;
+          Tensor t;
+          if (!proto.ParseFromString(record) || !t.FromProto(proto)) {
+            return errors::DataLoss("Corrupt shuffle spill record in ",
+                                    file->filename, " at offset ",
+                                    entry.offset);
+          }
+          out_tensors->push_back(std::move(t));
+        }
+        // Delete the file as soon as its last element has been produced,
+        // even if it is still the active file; the next spilled element then
+        // starts a fresh one.
+        if (--file->num_live == 0) {
+          TF_RETURN_IF_ERROR(DeleteSpillFile(file));
+          spill_files_[entry.spill_file].reset();
+        }
+        return Status::OK();
+      }
+
+      // Closes the file currently receiving spilled elements, deleting it
+      // if every element it holds has already been produced.
+      Status SealActiveSpillFile() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (spill_files_.empty() || spill_files_.back() == nullptr) {
+          return Status::OK();
+        }
+        SpillFile* file = spill_files_.back().get();
+        file->writer.reset();
+        TF_RETURN_IF_ERROR(file->writable_file->Close());
+        file->writable_file.reset();
+        file->dirty = false;
+        if (file->num_live == 0) {
+          TF_RETURN_IF_ERROR(DeleteSpillFile(file));
+          spill_files_.back().reset();
+        }
+        return Status::OK();
+      }
+
+      static Status DeleteSpillFile(SpillFile* file) {
+        file->reader.reset();
+        file->readable_file.reset();
+        file->writer.reset();
+        file->writable_file.reset();
+        return Env::Default()->DeleteFile(file->filename);
+      }
+
+      // Every record is framed by a 12-byte header (length and its CRC)
+      // and a 4-byte data CRC; see lib/io/record_writer.cc.
+      static constexpr uint64 kRecordOverheadBytes = 16;
+
+      mutex mu_;
+      std::vector<BufferEntry> buffer_ GUARDED_BY(mu_);
+      int64 resident_bytes_ GUARDED_BY(mu_) = 0;
+      std::vector<std::unique_ptr<SpillFile>> spill_files_ GUARDED_BY(mu_);
+      string spill_prefix_;
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+      bool end_of_input_sequence_ GUARDED_BY(mu_) = false;
+      random::PhiloxRandom parent_generator_ GUARDED_BY(mu_);
+      random::SingleSampleAdapter<random::PhiloxRandom> generator_
+          GUARDED_BY(mu_);
+    };
+
+    const DatasetBase* const input_;
+    const int64 buffer_size_;
+    const int64 max_buffer_bytes_;
+    const string spill_directory_;
+    const int64 seed_;
+    const int64 seed2_;
+  };
+};
+
+REGISTER_KERNEL_BUILDER(Name("SpillingShuffleDataset").Device(DEVICE_CPU),
+                        SpillingShuffleDatasetOp);
+
 }  // namespace
 
 }  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/kernels/softmax_op.h"
+#include "tensorflow/core/kernels/softmax_op_cpu.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -32,8 +33,8 @@ typedef Eigen::GpuDevice GPUDevice;
 typedef Eigen::SyclDevice SYCLDevice;
 #endif // TENSORFLOW_USE_SYCL
 
-// Partial specialization for a CPUDevice, that uses the Eigen implementation
-// from SoftmaxEigenImpl.
+// Partial specialization for a CPUDevice, that uses the row-wise
+// implementation from SoftmaxCpuImpl.
 namespace functor {
 template <typename Device, typename T>
 struct SoftmaxFunctorBase {
@@ -43,7 +44,12 @@ struct SoftmaxFunctorBase {
   }
 };
 template <typename T>
-struct SoftmaxFunctor<CPUDevice, T> : SoftmaxFunctorBase<CPUDevice, T> {};
+struct SoftmaxFunctor<CPUDevice, T> {
+  void operator()(const CPUDevice& d, typename TTypes<T>::ConstMatrix logits,
+                  typename TTypes<T>::Matrix softmax, const bool log) {
+    SoftmaxCpuImpl<T>::Compute(d, logits, softmax, log);
+  }
+};
 
 #ifdef TENSORFLOW_USE_SYCL
 template <typename T>
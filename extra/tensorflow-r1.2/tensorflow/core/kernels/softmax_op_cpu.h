@@ -0,0 +1,173 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_KERNELS_SOFTMAX_OP_CPU_H_
+#define TENSORFLOW_KERNELS_SOFTMAX_OP_CPU_H_
+// Row-wise softmax kernels for the CPU, shared by SoftmaxOp and
+// SoftmaxXentWithLogitsOp.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace functor {
+
+// The Eigen implementations in softmax_op_functor.h and xent_op.h reduce and
+// broadcast over the whole batch in separate expressions, reading the logits
+// four or five times. Here each row is handled by a single thread in two
+// passes:
+//  - The max and the sum of exp(logits - max) are found together with online
+//    normalization: the row is read in blocks small enough to stay in L1,
+//    and the running sum is rescaled whenever a block raises the max.
+//  - The outputs are written from the logits, the max and the sum.
+// Both passes evaluate exp() on whole blocks with Eigen's vectorized
+// implementation. Half values are computed in float.
+template <typename T>
+struct SoftmaxCpuImpl {
+  typedef typename std::conditional<std::is_same<T, double>::value, double,
+                                    float>::type Accum;
+
+  static void Compute(const Eigen::ThreadPoolDevice& d,
+                      typename TTypes<T>::ConstMatrix logits,
+                      typename TTypes<T>::Matrix softmax, const bool log) {
+    const int64 num_classes = logits.dimension(1);
+    auto work = [&logits, &softmax, num_classes, log](int64 begin,
+                                                      int64 end) {
+      Accum buffer[kBlockSize];
+      for (int64 r = begin; r < end; ++r) {
+        const T* row = &logits(r, 0);
+        T* out = &softmax(r, 0);
+        Accum max, sum;
+        Normalizer(row, num_classes, buffer, &max, &sum);
+        const Accum log_sum = std::log(sum);
+        const Accum inverse_sum = Accum(1) / sum;
+        for (int64 start = 0; start < num_classes; start += kBlockSize) {
+          const int64 size = std::min<int64>(kBlockSize, num_classes - start);
+          ConstArrayMap shifted = Load(row + start, size, buffer);
+          if (log) {
+            Store((shifted - max) - log_sum, out + start, size);
+          } else {
+            Store((shifted - max).exp() * inverse_sum, out + start, size);
+          }
+        }
+      }
+    };
+    d.parallelFor(logits.dimension(0), RowCost(num_classes), work);
+  }
+
+  // Computes the loss and backprop of SoftmaxCrossEntropyWithLogits.
+  // `backprop` may share its buffer with `logits`.
+  static void ComputeXent(const Eigen::ThreadPoolDevice& d,
+                          typename TTypes<T>::ConstMatrix logits,
+                          typename TTypes<T>::ConstMatrix labels,
+                          typename TTypes<T>::Vec loss,
+                          typename TTypes<T>::Matrix backprop) {
+    const int64 num_classes = logits.dimension(1);
+    auto work = [&logits, &labels, &loss, &backprop, num_classes](
+                    int64 begin, int64 end) {
+      Accum buffer[kBlockSize];
+      for (int64 r = begin; r < end; ++r) {
+        const T* row = &logits(r, 0);
+        Accum max, sum;
+        Normalizer(row, num_classes, buffer, &max, &sum);
+        const Accum log_sum = std::log(sum);
+        Accum row_loss = 0;
+        for (int64 start = 0; start < num_classes; start += kBlockSize) {
+          const int64 size = std::min<int64>(kBlockSize, num_classes - start);
+          // The block is copied to `buffer` before backprop is written, so
+          // aliasing the logits is safe.
+          ConstArrayMap shifted = Load(row + start, size, buffer);
+          const auto row_labels =
+              Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>(
+                  &labels(r, start), size)
+                  .template cast<Accum>();
+          // Classes with a zero label add nothing to the loss, even when
+          // their logit is -inf.
+          row_loss += (row_labels == Accum(0))
+                          .select(Accum(0),
+                                  row_labels * (log_sum - (shifted - max)))
+                          .sum();
+          Store((shifted - max).exp() / sum - row_labels, &backprop(r, start),
+                size);
+        }
+        loss(r) = static_cast<T>(row_loss);
+      }
+    };
+    d.parallelFor(logits.dimension(0), RowCost(num_classes), work);
+  }
+
+ private:
+  typedef Eigen::Map<const Eigen::Array<Accum, Eigen::Dynamic, 1>>
+      ConstArrayMap;
+
+  // Number of values per block; a block of doubles fits in 2KB.
+  static const int kBlockSize = 256;
+
+  // Converts `size` values from `in` into `buffer` and returns a view of it.
+  static ConstArrayMap Load(const T* in, int64 size, Accum* buffer) {
+    Eigen::Map<Eigen::Array<Accum, Eigen::Dynamic, 1>>(buffer, size) =
+        Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>(in, size)
+            .template cast<Accum>();
+    return ConstArrayMap(buffer, size);
+  }
+
+  template <typename Expr>
+  static void Store(const Expr& expr, T* out, int64 size) {
+    Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>(out, size) =
+        expr.template cast<T>();
+  }
+
+  // Sets `max` to the largest of the `size` values of `row`, and `sum` to the
+  // sum of their exp(value - max), reading the row once.
+  static void Normalizer(const T* row, int64 size, Accum* buffer, Accum* max,
+                         Accum* sum) {
+    *max = -std::numeric_limits<Accum>::infinity();
+    *sum = 0;
+    for (int64 start = 0; start < size; start += kBlockSize) {
+      ConstArrayMap block =
+          Load(row + start, std::min<int64>(kBlockSize, size - start), buffer);
+      const Accum block_max = block.maxCoeff();
+      // A block of -inf values, e.g. masked logits, adds nothing to the sum,
+      // and shifting it by a max that is still -inf would give NaN.
+      if (block_max == -std::numeric_limits<Accum>::infinity()) continue;
+      if (block_max > *max) {
+        *sum *= std::exp(*max - block_max);
+        *max = block_max;
+      }
+      *sum += (block - *max).exp().sum();
+    }
+  }
+
+  // Each value is read twice and written once, with two exponentials and a
+  // few arithmetic operations.
+  static Eigen::TensorOpCost RowCost(int64 num_classes) {
+    return Eigen::TensorOpCost(2 * num_classes * sizeof(T),
+                               num_classes * sizeof(T), 40 * num_classes);
+  }
+};
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_KERNELS_SOFTMAX_OP_CPU_H_
@@ -0,0 +1,195 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/softmax_op_cpu.h"
+
+#include <cmath>
+#include <limits>
+
+#include "tensorflow/core/common_runtime/eigen_thread_pool.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/softmax_op_functor.h"
+#include "tensorflow/core/kernels/xent_op.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+class SoftmaxCpuImplTest : public ::testing::Test {
+ protected:
+  SoftmaxCpuImplTest()
+      : pool_(Env::Default(), "test", 4),
+        wrapper_(&pool_),
+        device_(&wrapper_, 4 /* num_threads */) {}
+
+  // Logits that grow along each row, so that later blocks raise the max.
+  static Tensor MakeLogits(int64 rows, int64 cols) {
+    Tensor logits(DT_FLOAT, TensorShape({rows, cols}));
+    logits.flat<float>().setRandom();
+    auto matrix = logits.matrix<float>();
+    for (int64 r = 0; r < rows; ++r) {
+      for (int64 c = 0; c < cols; ++c) {
+        matrix(r, c) = 10.0f * matrix(r, c) + 0.05f * c;
+      }
+    }
+    return logits;
+  }
+
+  void ExpectSoftmaxMatchesEigen(int64 rows, int64 cols, bool log) {
+    const Tensor logits = MakeLogits(rows, cols);
+    Tensor expected(DT_FLOAT, logits.shape());
+    functor::SoftmaxEigenImpl<CPUDevice, float>::Compute(
+        device_, logits.matrix<float>(), expected.matrix<float>(), log);
+    Tensor actual(DT_FLOAT, logits.shape());
+    functor::SoftmaxCpuImpl<float>::Compute(device_, logits.matrix<float>(),
+                                            actual.matrix<float>(), log);
+    test::ExpectTensorNear<float>(expected, actual, 1e-5);
+  }
+
+  void ExpectXentMatchesEigen(int64 rows, int64 cols) {
+    const Tensor logits = MakeLogits(rows, cols);
+    Tensor labels(DT_FLOAT, logits.shape());
+    labels.flat<float>().setRandom();
+    const Tensor& labels_in = labels;
+    Tensor scratch(DT_FLOAT, TensorShape({rows, 1}));
+    Tensor expected_loss(DT_FLOAT, TensorShape({rows}));
+    Tensor expected_backprop(DT_FLOAT, logits.shape());
+    functor::XentEigenImpl<CPUDevice, float>::Compute(
+        device_, logits.matrix<float>(), labels_in.matrix<float>(),
+        scratch.matrix<float>(), expected_loss.vec<float>(),
+        expected_backprop.matrix<float>());
+
+    // The op may write the backprop over the logits.
+    Tensor backprop = tensor::DeepCopy(logits);
+    const Tensor& backprop_logits = backprop;
+    Tensor loss(DT_FLOAT, TensorShape({rows}));
+    functor::SoftmaxCpuImpl<float>::ComputeXent(
+        device_, backprop_logits.matrix<float>(), labels_in.matrix<float>(),
+        loss.vec<float>(), backprop.matrix<float>());
+    test::ExpectTensorNear<float>(expected_backprop, backprop, 1e-5);
+    auto expected_values = expected_loss.vec<float>();
+    auto values = loss.vec<float>();
+    for (int64 r = 0; r < rows; ++r) {
+      EXPECT_NEAR(expected_values(r), values(r),
+                  1e-5 * std::abs(expected_values(r)));
+    }
+  }
+
+  thread::ThreadPool pool_;
+  EigenThreadPoolWrapper wrapper_;
+  CPUDevice device_;
+};
+
+TEST_F(SoftmaxCpuImplTest, Softmax) {
+  for (int64 cols : {1, 7, 256, 1000, 3001}) {
+    ExpectSoftmaxMatchesEigen(37, cols, false);
+  }
+}
+
+TEST_F(SoftmaxCpuImplTest, LogSoftmax) {
+  for (int64 cols : {1, 7, 256, 1000, 3001}) {
+    ExpectSoftmaxMatchesEigen(37, cols, true);
+  }
+}
+
+TEST_F(SoftmaxCpuImplTest, Xent) {
+  for (int64 cols : {1, 7, 256, 1000, 3001}) {
+    ExpectXentMatchesEigen(37, cols);
+  }
+}
+
+// Masked logits are -inf. Here the whole first block of each row is masked.
+TEST_F(SoftmaxCpuImplTest, LeadingMaskedBlock) {
+  const int64 rows = 3, cols = 300, masked = 256;
+  Tensor logits(DT_FLOAT, TensorShape({rows, cols}));
+  Tensor labels(DT_FLOAT, TensorShape({rows, cols}));
+  auto logit_values = logits.matrix<float>();
+  auto label_values = labels.matrix<float>();
+  for (int64 r = 0; r < rows; ++r) {
+    for (int64 c = 0; c < cols; ++c) {
+      logit_values(r, c) =
+          c < masked ? -std::numeric_limits<float>::infinity() : 1.0f;
+      label_values(r, c) = c == cols - 1 ? 1.0f : 0.0f;
+    }
+  }
+  const Tensor& logits_in = logits;
+  const Tensor& labels_in = labels;
+  const float p = 1.0f / (cols - masked);
+
+  Tensor softmax(DT_FLOAT, logits.shape());
+  functor::SoftmaxCpuImpl<float>::Compute(device_, logits_in.matrix<float>(),
+                                          softmax.matrix<float>(), false);
+  Tensor log_softmax(DT_FLOAT, logits.shape());
+  functor::SoftmaxCpuImpl<float>::Compute(device_, logits_in.matrix<float>(),
+                                          log_softmax.matrix<float>(), true);
+  Tensor loss(DT_FLOAT, TensorShape({rows}));
+  Tensor backprop(DT_FLOAT, logits.shape());
+  functor::SoftmaxCpuImpl<float>::ComputeXent(
+      device_, logits_in.matrix<float>(), labels_in.matrix<float>(),
+      loss.vec<float>(), backprop.matrix<float>());
+
+  for (int64 r = 0; r < rows; ++r) {
+    for (int64 c = 0; c < cols; ++c) {
+      const float expected = c < masked ? 0.0f : p;
+      EXPECT_NEAR(expected, softmax.matrix<float>()(r, c), 1e-6);
+      if (c < masked) {
+        EXPECT_EQ(-std::numeric_limits<float>::infinity(),
+                  log_softmax.matrix<float>()(r, c));
+      } else {
+        EXPECT_NEAR(std::log(p), log_softmax.matrix<float>()(r, c), 1e-5);
+      }
+      EXPECT_NEAR(expected - label_values(r, c),
+                  backprop.matrix<float>()(r, c), 1e-6);
+    }
+    EXPECT_NEAR(-std::log(p), loss.vec<float>()(r), 1e-5);
+  }
+}
+
+static Graph* Softmax(const string& op, int batch_size, int num_classes) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor logits(DT_FLOAT, TensorShape({batch_size, num_classes}));
+  logits.flat<float>().setRandom();
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), op)
+                  .Input(test::graph::Constant(g, logits))
+                  .Finalize(g, nullptr));
+  return g;
+}
+
+#define BM_SoftmaxDev(OP, BATCH, CLASS, DEVICE)                          \
+  static void BM_##OP##_##BATCH##_##CLASS##_##DEVICE(int iters) {        \
+    testing::ItemsProcessed(static_cast<int64>(iters) * BATCH * CLASS);  \
+    test::Benchmark(#DEVICE, Softmax(#OP, BATCH, CLASS)).Run(iters);     \
+  }                                                                      \
+  BENCHMARK(BM_##OP##_##BATCH##_##CLASS##_##DEVICE);
+
+BM_SoftmaxDev(Softmax, 32, 1008, cpu);
+BM_SoftmaxDev(Softmax, 256, 1008, cpu);
+BM_SoftmaxDev(Softmax, 256, 100000, cpu);
+BM_SoftmaxDev(LogSoftmax, 32, 1008, cpu);
+BM_SoftmaxDev(LogSoftmax, 256, 100000, cpu);
+
+}  // namespace
+}  // namespace tensorflow
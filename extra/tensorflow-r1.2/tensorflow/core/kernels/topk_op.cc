@@ -17,13 +17,18 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <memory>
 #include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/gtl/top_n.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -76,31 +81,78 @@ class TopK : public OpKernel {
 
     auto values = values_out->flat_inner_dims<T>();
     auto indices = indices_out->flat_inner_dims<int32>();
-    gtl::TopN<std::pair<T, int32>> filter(k);
-    for (int r = 0; r < num_rows; r++) {
-      for (int32 c = 0; c < num_cols; ++c) {
-        // The second element is the negated index, so that lower-index elements
-        // are considered larger than higher-index elements in case of ties.
-        filter.push(std::make_pair(input(r, c), -c));
+    const bool sorted = sorted_;
+    auto shard = [&input, &values, &indices, num_cols, k, sorted](
+                     int64 start_row, int64 limit_row) {
+      gtl::TopN<std::pair<T, int32>> filter(k);
+      for (int64 r = start_row; r < limit_row; ++r) {
+        SelectRow(&input(r, 0), num_cols, &filter);
+        int32 i = 0;
+        if (sorted && k > 1) {
+          std::unique_ptr<std::vector<std::pair<T, int32>>> top_k(
+              filter.Extract());
+          for (auto top_k_it = top_k->begin(); top_k_it != top_k->end();
+               ++top_k_it, ++i) {
+            values(r, i) = top_k_it->first;
+            indices(r, i) = -top_k_it->second;
+          }
+        } else {
+          for (auto top_k_it = filter.unsorted_begin();
+               top_k_it != filter.unsorted_end(); ++top_k_it, ++i) {
+            values(r, i) = top_k_it->first;
+            indices(r, i) = -top_k_it->second;
+          }
+        }
+        filter.Reset();
       }
+    };
+    // Most values of a row are rejected by the threshold test below, so a row
+    // costs a few cycles per column plus the heap updates for its top k.
+    const int64 cost_per_row =
+        3 * num_cols + 20 * k * Log2Ceiling(std::max(k, 2));
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_rows,
+          cost_per_row, shard);
+  }
 
-      int32 i = 0;
-      if (sorted_ && k > 1) {
-        std::unique_ptr<std::vector<std::pair<T, int32>>> top_k(
-            filter.Extract());
-        for (auto top_k_it = top_k->begin(); top_k_it != top_k->end();
-             ++top_k_it, ++i) {
-          values(r, i) = top_k_it->first;
-          indices(r, i) = -top_k_it->second;
-        }
-      } else {
-        for (auto top_k_it = filter.unsorted_begin();
-             top_k_it != filter.unsorted_end(); ++top_k_it, ++i) {
-          values(r, i) = top_k_it->first;
-          indices(r, i) = -top_k_it->second;
+ private:
+  // Values are tested against the current k-th largest value of the row in
+  // blocks of this many, so that blocks with no candidates are skipped with a
+  // branch-free loop the compiler can vectorize.
+  static const int kFilterBlockSize = 16;
+
+  // Pushes the k largest values of `row` into the empty `filter`. Once the
+  // filter is full, a value that is not greater than its smallest element
+  // would be rejected by TopN anyway: ties are broken in favour of the lower
+  // index, and every value still to come has a higher index than the ones
+  // already kept. Such values are skipped without touching the heap. The
+  // test is written as !(v <= threshold) so that NaNs still reach TopN.
+  static void SelectRow(const T* row, int32 num_cols,
+                        gtl::TopN<std::pair<T, int32>>* filter) {
+    const size_t k = filter->limit();
+    int32 c = 0;
+    for (; c < num_cols && filter->size() < k; ++c) {
+      // The second element is the negated index, so that lower-index elements
+      // are considered larger than higher-index elements in case of ties.
+      filter->push(std::make_pair(row[c], -c));
+    }
+    if (c == num_cols) return;
+    T threshold = filter->peek_bottom().first;
+    while (c < num_cols) {
+      const int32 block_end = std::min(c + kFilterBlockSize, num_cols);
+      bool any_candidate = false;
+      for (int32 i = c; i < block_end; ++i) {
+        any_candidate |= !(row[i] <= threshold);
+      }
+      if (any_candidate) {
+        for (int32 i = c; i < block_end; ++i) {
+          if (!(row[i] <= threshold)) {
+            filter->push(std::make_pair(row[i], -i));
+            threshold = filter->peek_bottom().first;
+          }
         }
       }
-      filter.Reset();
+      c = block_end;
     }
   }
 
@@ -0,0 +1,178 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class TopKOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(bool sorted) {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "TopKV2")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Attr("sorted", sorted)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // Runs the op on `input` and checks it against a stable sort of each row.
+  void ExpectMatchesSort(const Tensor& input, int k) {
+    const int64 num_rows = input.dim_size(0);
+    const int64 num_cols = input.dim_size(1);
+    auto input_flat = input.flat<float>();
+    AddInputFromArray<float>(
+        input.shape(),
+        gtl::ArraySlice<float>(input_flat.data(), input_flat.size()));
+    AddInputFromArray<int32>(TensorShape({}), {k});
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected_values(DT_FLOAT, TensorShape({num_rows, k}));
+    Tensor expected_indices(DT_INT32, TensorShape({num_rows, k}));
+    auto in = input.matrix<float>();
+    std::vector<int32> order(num_cols);
+    for (int64 r = 0; r < num_rows; ++r) {
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+                       [&in, r](int32 a, int32 b) {
+                         return in(r, a) > in(r, b);
+                       });
+      for (int i = 0; i < k; ++i) {
+        expected_values.matrix<float>()(r, i) = in(r, order[i]);
+        expected_indices.matrix<int32>()(r, i) = order[i];
+      }
+    }
+    test::ExpectTensorEqual<float>(expected_values, *GetOutput(0));
+    test::ExpectTensorEqual<int32>(expected_indices, *GetOutput(1));
+  }
+};
+
+Tensor RandomMatrix(int64 rows, int64 cols, int num_distinct) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor t(DT_FLOAT, TensorShape({rows, cols}));
+  auto flat = t.flat<float>();
+  for (int64 i = 0; i < flat.size(); ++i) {
+    flat(i) = rnd.Uniform(num_distinct);
+  }
+  return t;
+}
+
+TEST_F(TopKOpTest, Simple) {
+  MakeOp(true);
+  AddInputFromArray<float>(TensorShape({2, 5}),
+                           {1, 5, 3, 5, 2, -1, -4, -2, -3, -5});
+  AddInputFromArray<int32>(TensorShape({}), {3});
+  TF_ASSERT_OK(RunOpKernel());
+  Tensor expected_values(allocator(), DT_FLOAT, TensorShape({2, 3}));
+  test::FillValues<float>(&expected_values, {5, 5, 3, -1, -2, -3});
+  test::ExpectTensorEqual<float>(expected_values, *GetOutput(0));
+  // Ties go to the lower index.
+  Tensor expected_indices(allocator(), DT_INT32, TensorShape({2, 3}));
+  test::FillValues<int32>(&expected_indices, {1, 3, 2, 0, 2, 3});
+  test::ExpectTensorEqual<int32>(expected_indices, *GetOutput(1));
+}
+
+TEST_F(TopKOpTest, ManyRowsWithTies) {
+  MakeOp(true);
+  // Few distinct values, so that many columns equal the k-th largest value.
+  ExpectMatchesSort(RandomMatrix(300, 1000, 50), 20);
+}
+
+TEST_F(TopKOpTest, ManyRowsDistinct) {
+  MakeOp(true);
+  ExpectMatchesSort(RandomMatrix(64, 5000, 1 << 30), 100);
+}
+
+TEST_F(TopKOpTest, KIsOne) {
+  MakeOp(true);
+  ExpectMatchesSort(RandomMatrix(17, 333, 10), 1);
+}
+
+TEST_F(TopKOpTest, KIsNumCols) {
+  MakeOp(true);
+  ExpectMatchesSort(RandomMatrix(8, 40, 5), 40);
+}
+
+TEST_F(TopKOpTest, Unsorted) {
+  MakeOp(false);
+  const Tensor random = RandomMatrix(1, 40, 1000);
+  AddInputFromArray<float>(
+      TensorShape({1, 40}),
+      gtl::ArraySlice<float>(random.flat<float>().data(), 40));
+  AddInputFromArray<int32>(TensorShape({}), {5});
+  TF_ASSERT_OK(RunOpKernel());
+  auto input = random.flat<float>();
+  std::vector<float> expected(input.data(), input.data() + 40);
+  std::sort(expected.begin(), expected.end(), std::greater<float>());
+  std::vector<float> values(GetOutput(0)->flat<float>().data(),
+                            GetOutput(0)->flat<float>().data() + 5);
+  std::sort(values.begin(), values.end(), std::greater<float>());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(expected[i], values[i]);
+    EXPECT_EQ(GetOutput(0)->flat<float>()(i),
+              input(GetOutput(1)->flat<int32>()(i)));
+  }
+}
+
+static Graph* TopK(int rows, int cols, int k) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_FLOAT, TensorShape({rows, cols}));
+  input.flat<float>().setRandom();
+  Tensor k_tensor(DT_INT32, TensorShape({}));
+  k_tensor.scalar<int32>()() = k;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "TopKV2")
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, k_tensor))
+                  .Attr("sorted", true)
+                  .Finalize(g, nullptr));
+  return g;
+}
+
+#define BM_TopKDev(ROWS, COLS, K, DEVICE)                                  \
+  static void BM_TopK##_##ROWS##_##COLS##_##K##_##DEVICE(int iters) {      \
+    testing::ItemsProcessed(static_cast<int64>(iters) * ROWS * COLS);      \
+    testing::UseRealTime();                                                \
+    test::Benchmark(#DEVICE, TopK(ROWS, COLS, K)).Run(iters);              \
+  }                                                                        \
+  BENCHMARK(BM_TopK##_##ROWS##_##COLS##_##K##_##DEVICE);
+
+BM_TopKDev(1, 100000, 1, cpu);
+BM_TopKDev(1, 100000, 100, cpu);
+BM_TopKDev(32, 10000, 5, cpu);
+BM_TopKDev(32, 10000, 100, cpu);
+BM_TopKDev(256, 100000, 1, cpu);
+BM_TopKDev(256, 100000, 5, cpu);
+BM_TopKDev(256, 100000, 100, cpu);
+BM_TopKDev(256, 100000, 1000, cpu);
+BM_TopKDev(256, 1000000, 10, cpu);
+
+}  // namespace
+}  // namespace tensorflow
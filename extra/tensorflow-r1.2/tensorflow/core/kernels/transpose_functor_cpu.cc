@@ -17,73 +17,169 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/transpose_functor.h"
 
+#include <algorithm>
+
 namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
 namespace internal {
 
-template <typename Device, typename T>
-void TransposeSimple(const Device& d, const Tensor& in,
-                     const gtl::ArraySlice<int32> perm, Tensor* out) {
-  const int ndims = in.dims();
-  gtl::InlinedVector<int64, 8> in_strides(ndims);
-  ComputeStride(in.shape(), in_strides.data());
-  gtl::InlinedVector<int64, 8> out_strides(ndims);
-  ComputeStride(out->shape(), out_strides.data());
-  const int64 nelem = in.NumElements();
-  const T* p = reinterpret_cast<const T*>(in.tensor_data().data());
-  T* q = reinterpret_cast<T*>(const_cast<char*>((out->tensor_data().data())));
-
-  // TODO(zhifengc): Shard by range.
-  // TODO(zhifengc): Avoids the division.
-  for (int64 o_idx = 0; o_idx < nelem; ++o_idx) {
-    int64 i_idx = 0;
-    int64 t = o_idx;
-    for (int i = 0; i < ndims; ++i) {
-      i_idx += (t / out_strides[i]) * in_strides[perm[i]];
-      t = t % out_strides[i];
+// Side of the square tiles that are moved between the input's innermost
+// dimension and the output's. A tile of 32x32 eight-byte values is 8KB, so
+// the tile being read and the one being written stay in L1.
+const int64 kTransposeTileSize = 32;
+
+// Side of the blocks that tiles are split into. The loops over a full block
+// have constant bounds, so the compiler unrolls them completely.
+const int64 kTransposeBlockSize = 8;
+
+// Sets out[c * out_stride + r] = in[r * in_stride + c] for all r < rows and
+// c < cols.
+template <typename T>
+void TransposeTile(const T* in, int64 in_stride, int64 rows, int64 cols,
+                   T* out, int64 out_stride) {
+  int64 r = 0;
+  for (; r + kTransposeBlockSize <= rows; r += kTransposeBlockSize) {
+    int64 c = 0;
+    for (; c + kTransposeBlockSize <= cols; c += kTransposeBlockSize) {
+      const T* block_in = in + r * in_stride + c;
+      T* block_out = out + c * out_stride + r;
+      for (int64 i = 0; i < kTransposeBlockSize; ++i) {
+        for (int64 j = 0; j < kTransposeBlockSize; ++j) {
+          block_out[j * out_stride + i] = block_in[i * in_stride + j];
+        }
+      }
+    }
+    for (; c < cols; ++c) {
+      for (int64 i = r; i < r + kTransposeBlockSize; ++i) {
+        out[c * out_stride + i] = in[i * in_stride + c];
+      }
+    }
+  }
+  for (; r < rows; ++r) {
+    for (int64 c = 0; c < cols; ++c) {
+      out[c * out_stride + r] = in[r * in_stride + c];
     }
-    q[o_idx] = p[i_idx];
   }
 }
 
-template <typename Device, typename T, int NDIMS>
-void TransposeUsingEigen(const Device& d, const Tensor& in,
-                         const gtl::ArraySlice<int32> perm, Tensor* out) {
-  Eigen::array<int, NDIMS> p;
-  for (int i = 0; i < NDIMS; ++i) p[i] = perm[i];
-  auto x = typename TTypes<T, NDIMS>::ConstTensor(
-      reinterpret_cast<const T*>(in.tensor_data().data()),
-      in.shape().AsEigenDSizes<NDIMS>());
-  auto y = typename TTypes<T, NDIMS>::Tensor(
-      reinterpret_cast<T*>(const_cast<char*>(out->tensor_data().data())),
-      out->shape().AsEigenDSizes<NDIMS>());
-  y.device(d) = x.shuffle(p);
+// Transposes the tensor `in` of shape `dims`, whose adjacent dimensions that
+// stay adjacent have been combined, so that output dimension i is input
+// dimension perm[i].
+//
+// If the innermost dimension stays in place, its rows are copied whole.
+// Otherwise the input's innermost dimension and the one that becomes the
+// output's innermost are transposed in square tiles, so that both reads and
+// writes are sequential within a tile; all other dimensions index the
+// tiles. Rows of tiles are distributed over the device's threads.
+template <typename T>
+void TransposeBlocked(const CPUDevice& d, const T* in,
+                      const TransposeDimsVec& dims,
+                      const TransposePermsVec& perm, T* out) {
+  const int ndims = dims.size();
+  TransposeDimsVec in_strides(ndims);
+  TransposeDimsVec out_dims(ndims);
+  TransposeDimsVec out_strides(ndims);
+  int64 stride = 1;
+  for (int i = ndims - 1; i >= 0; --i) {
+    in_strides[i] = stride;
+    stride *= dims[i];
+  }
+  const int64 nelem = stride;
+  stride = 1;
+  for (int i = ndims - 1; i >= 0; --i) {
+    out_dims[i] = dims[perm[i]];
+    out_strides[i] = stride;
+    stride *= out_dims[i];
+  }
+
+  if (perm[ndims - 1] == ndims - 1) {
+    const int64 row_size = dims[ndims - 1];
+    auto work = [in, out, row_size, ndims, &perm, &out_dims, &in_strides](
+                    int64 begin, int64 end) {
+      for (int64 row = begin; row < end; ++row) {
+        int64 in_offset = 0;
+        int64 t = row;
+        for (int i = ndims - 2; i >= 0; --i) {
+          in_offset += (t % out_dims[i]) * in_strides[perm[i]];
+          t /= out_dims[i];
+        }
+        std::copy(in + in_offset, in + in_offset + row_size,
+                  out + row * row_size);
+      }
+    };
+    d.parallelFor(nelem / row_size,
+                  Eigen::TensorOpCost(row_size * sizeof(T),
+                                      row_size * sizeof(T), 2 * ndims),
+                  work);
+    return;
+  }
+
+  // Input dimension `tile_row_dim` becomes the output's innermost, and the
+  // input's innermost dimension becomes output dimension `tile_col_pos`.
+  const int tile_row_dim = perm[ndims - 1];
+  int tile_col_pos = 0;
+  while (perm[tile_col_pos] != ndims - 1) ++tile_col_pos;
+  const int64 rows = dims[tile_row_dim];
+  const int64 cols = dims[ndims - 1];
+  const int64 in_stride = in_strides[tile_row_dim];
+  const int64 out_stride = out_strides[tile_col_pos];
+  const int64 row_tiles = (rows + kTransposeTileSize - 1) / kTransposeTileSize;
+  const int64 num_outer = nelem / (rows * cols);
+
+  auto work = [in, out, ndims, tile_col_pos, rows, cols, in_stride,
+               out_stride, row_tiles, &perm, &out_dims, &in_strides,
+               &out_strides](int64 begin, int64 end) {
+    for (int64 unit = begin; unit < end; ++unit) {
+      // Offsets of the tiles' origins from the outer dimensions.
+      int64 in_offset = 0;
+      int64 out_offset = 0;
+      int64 t = unit / row_tiles;
+      for (int i = ndims - 2; i >= 0; --i) {
+        if (i == tile_col_pos) continue;
+        const int64 index = t % out_dims[i];
+        t /= out_dims[i];
+        in_offset += index * in_strides[perm[i]];
+        out_offset += index * out_strides[i];
+      }
+      const int64 row = (unit % row_tiles) * kTransposeTileSize;
+      const int64 num_rows = std::min(kTransposeTileSize, rows - row);
+      for (int64 col = 0; col < cols; col += kTransposeTileSize) {
+        TransposeTile(in + in_offset + row * in_stride + col, in_stride,
+                      num_rows, std::min(kTransposeTileSize, cols - col),
+                      out + out_offset + col * out_stride + row, out_stride);
+      }
+    }
+  };
+  const int64 unit_size = kTransposeTileSize * cols;
+  d.parallelFor(num_outer * row_tiles,
+                Eigen::TensorOpCost(unit_size * sizeof(T),
+                                    unit_size * sizeof(T), unit_size),
+                work);
 }
 
 }  // end namespace internal
 
-typedef Eigen::ThreadPoolDevice CPUDevice;
-
 template <typename T>
 struct Transpose<CPUDevice, T> {
   static void run(const CPUDevice& d, const Tensor& in,
                   const gtl::ArraySlice<int32> perm, Tensor* out) {
-    switch (in.dims()) {
-      case 2:
-        internal::TransposeUsingEigen<CPUDevice, T, 2>(d, in, perm, out);
-        break;
-      case 3:
-        internal::TransposeUsingEigen<CPUDevice, T, 3>(d, in, perm, out);
-        break;
-      case 4:
-        internal::TransposeUsingEigen<CPUDevice, T, 4>(d, in, perm, out);
-        break;
-      case 5:
-        internal::TransposeUsingEigen<CPUDevice, T, 5>(d, in, perm, out);
-        break;
-      default:
-        internal::TransposeSimple<CPUDevice, T>(d, in, perm, out);
-        break;
+    if (in.NumElements() == 0) return;
+    // ReduceTransposeDimensions() gives the output position of each combined
+    // input dimension; TransposeBlocked() wants the inverse.
+    internal::TransposePermsVec output_positions;
+    internal::TransposeDimsVec dims;
+    internal::ReduceTransposeDimensions(in.shape(), perm, &output_positions,
+                                        &dims);
+    internal::TransposePermsVec new_perm(output_positions.size());
+    for (int i = 0; i < output_positions.size(); ++i) {
+      new_perm[output_positions[i]] = i;
     }
+    internal::TransposeBlocked<T>(
+        d, reinterpret_cast<const T*>(in.tensor_data().data()), dims,
+        new_perm,
+        reinterpret_cast<T*>(const_cast<char*>(out->tensor_data().data())));
   }
 };
 
@@ -0,0 +1,191 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/core/kernels/transpose_functor.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/eigen_thread_pool.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+class TransposeFunctorTest : public ::testing::Test {
+ protected:
+  TransposeFunctorTest()
+      : pool_(Env::Default(), "test", 4),
+        wrapper_(&pool_),
+        device_(&wrapper_, 4 /* num_threads */) {}
+
+  // Transposes a tensor of `shape` by `perm` with DoTranspose and compares
+  // it with a per-element computation of the output.
+  template <typename T>
+  void ExpectTransposeMatchesReference(const TensorShape& shape,
+                                       const std::vector<int32>& perm) {
+    const int ndims = shape.dims();
+    Tensor in(DataTypeToEnum<T>::value, shape);
+    auto in_flat = in.flat<T>();
+    for (int64 i = 0; i < in_flat.size(); ++i) {
+      in_flat(i) = static_cast<T>(i % 251);
+    }
+    TensorShape out_shape;
+    for (int i = 0; i < ndims; ++i) out_shape.AddDim(shape.dim_size(perm[i]));
+
+    std::vector<int64> in_strides(ndims);
+    internal::ComputeStride(shape, in_strides.data());
+    std::vector<int64> out_strides(ndims);
+    internal::ComputeStride(out_shape, out_strides.data());
+    Tensor expected(DataTypeToEnum<T>::value, out_shape);
+    auto expected_flat = expected.flat<T>();
+    for (int64 o = 0; o < expected_flat.size(); ++o) {
+      int64 i = 0;
+      int64 t = o;
+      for (int d = 0; d < ndims; ++d) {
+        i += (t / out_strides[d]) * in_strides[perm[d]];
+        t %= out_strides[d];
+      }
+      expected_flat(o) = in_flat(i);
+    }
+
+    Tensor out(DataTypeToEnum<T>::value, out_shape);
+    TF_ASSERT_OK(DoTranspose(device_, in, perm, &out));
+    test::ExpectTensorEqual<T>(expected, out);
+  }
+
+  thread::ThreadPool pool_;
+  EigenThreadPoolWrapper wrapper_;
+  CPUDevice device_;
+};
+
+TEST_F(TransposeFunctorTest, LayoutPermutations) {
+  // NHWC to NCHW and back, with sizes that don't fill the last tile.
+  ExpectTransposeMatchesReference<float>({2, 13, 11, 67}, {0, 3, 1, 2});
+  ExpectTransposeMatchesReference<float>({2, 67, 13, 11}, {0, 2, 3, 1});
+  ExpectTransposeMatchesReference<float>({100, 37}, {1, 0});
+  ExpectTransposeMatchesReference<double>({3, 40, 5, 9}, {3, 2, 1, 0});
+  // The innermost dimension stays in place.
+  ExpectTransposeMatchesReference<float>({7, 9, 16}, {1, 0, 2});
+}
+
+TEST_F(TransposeFunctorTest, AllPermutations) {
+  std::vector<int32> perm(5);
+  std::iota(perm.begin(), perm.end(), 0);
+  do {
+    ExpectTransposeMatchesReference<int32>({2, 3, 9, 5, 11}, perm);
+  } while (std::next_permutation(perm.begin(), perm.end()));
+}
+
+TEST_F(TransposeFunctorTest, ElementSizes) {
+  ExpectTransposeMatchesReference<uint8>({33, 3, 70}, {2, 0, 1});
+  ExpectTransposeMatchesReference<int16>({33, 3, 70}, {2, 0, 1});
+  ExpectTransposeMatchesReference<int64>({33, 3, 70}, {2, 0, 1});
+  ExpectTransposeMatchesReference<complex128>({33, 3, 70}, {2, 0, 1});
+}
+
+TEST_F(TransposeFunctorTest, RandomShapes) {
+  random::PhiloxRandom philox(7, 11);
+  random::SimplePhilox rnd(&philox);
+  for (int trial = 0; trial < 50; ++trial) {
+    const int ndims = 2 + rnd.Uniform(5);
+    TensorShape shape;
+    for (int i = 0; i < ndims; ++i) {
+      shape.AddDim(1 + rnd.Uniform(ndims <= 3 ? 80 : 10));
+    }
+    std::vector<int32> perm(ndims);
+    std::iota(perm.begin(), perm.end(), 0);
+    for (int i = ndims - 1; i > 0; --i) {
+      std::swap(perm[i], perm[rnd.Uniform(i + 1)]);
+    }
+    ExpectTransposeMatchesReference<float>(shape, perm);
+  }
+}
+
+static Graph* Transpose(const TensorShape& shape,
+                        const std::vector<int32>& perm) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor in(DT_FLOAT, shape);
+  in.flat<float>().setRandom();
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Transpose")
+                  .Input(test::graph::Constant(g, in))
+                  .Input(test::graph::Constant(g, test::AsTensor<int32>(perm)))
+                  .Finalize(g, nullptr));
+  return g;
+}
+
+static void RunTransposeBenchmark(int iters, const TensorShape& shape,
+                                  const std::vector<int32>& perm) {
+  const int64 num_items = static_cast<int64>(iters) * shape.num_elements();
+  testing::ItemsProcessed(num_items);
+  testing::BytesProcessed(num_items * sizeof(float));
+  testing::UseRealTime();
+  test::Benchmark("cpu", Transpose(shape, perm)).Run(iters);
+}
+
+static void BM_TransposeNHWCToNCHW(int iters, int spatial, int depth) {
+  RunTransposeBenchmark(iters, {32, spatial, spatial, depth}, {0, 3, 1, 2});
+}
+
+BENCHMARK(BM_TransposeNHWCToNCHW)
+    ->ArgPair(56, 64)
+    ->ArgPair(28, 256)
+    ->ArgPair(7, 2048);
+
+static void BM_TransposeNCHWToNHWC(int iters, int spatial, int depth) {
+  RunTransposeBenchmark(iters, {32, depth, spatial, spatial}, {0, 2, 3, 1});
+}
+
+BENCHMARK(BM_TransposeNCHWToNHWC)
+    ->ArgPair(56, 64)
+    ->ArgPair(28, 256)
+    ->ArgPair(7, 2048);
+
+static void BM_TransposeMatrix(int iters, int rows, int cols) {
+  RunTransposeBenchmark(iters, {rows, cols}, {1, 0});
+}
+
+BENCHMARK(BM_TransposeMatrix)->ArgPair(1024, 1024)->ArgPair(4096, 1000);
+
+// Filters from HWIO to OIHW.
+static void BM_TransposeFilter(int iters, int size, int depth) {
+  RunTransposeBenchmark(iters, {size, size, depth, depth}, {3, 2, 0, 1});
+}
+
+BENCHMARK(BM_TransposeFilter)->ArgPair(3, 256)->ArgPair(1, 1024);
+
+static void BM_TransposeReverse5D(int iters, int size) {
+  RunTransposeBenchmark(iters, {size, size, size, size, size},
+                        {4, 3, 2, 1, 0});
+}
+
+BENCHMARK(BM_TransposeReverse5D)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/kernels/xent_op.h"
+#include "tensorflow/core/kernels/softmax_op_cpu.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -74,8 +75,8 @@ class SoftmaxXentWithLogitsOp : public OpKernel {
   }
 };
 
-// Partial specialization for a CPUDevice, that uses the Eigen implementation
-// from XentEigenImpl.
+// Partial specialization for a CPUDevice, that uses the row-wise
+// implementation from SoftmaxCpuImpl, which needs no scratch space.
 namespace functor {
 template <typename Device, typename T>
 struct XentFunctorBase {
@@ -90,7 +91,15 @@ struct XentFunctorBase {
 };
 
 template <typename T>
-struct XentFunctor<CPUDevice, T> : XentFunctorBase<CPUDevice, T> {};
+struct XentFunctor<CPUDevice, T> {
+  void operator()(const CPUDevice& d, typename TTypes<T>::ConstMatrix logits,
+                  typename TTypes<T>::ConstMatrix labels,
+                  typename TTypes<T>::Matrix scratch,
+                  typename TTypes<T>::Vec loss,
+                  typename TTypes<T>::Matrix backprop) {
+    SoftmaxCpuImpl<T>::ComputeXent(d, logits, labels, loss, backprop);
+  }
+};
 
 #ifdef TENSORFLOW_USE_SYCL
 template <typename T>
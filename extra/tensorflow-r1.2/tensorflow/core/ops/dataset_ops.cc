@@ -326,6 +326,41 @@ seed: A scalar seed for the random number generator. If either seed or
 seed2: A second scalar seed to avoid seed collision.
 )doc");
 
+REGISTER_OP("SpillingShuffleDataset")
+    .Input("input_dataset: resource")
+    .Input("buffer_size: int64")
+    .Input("max_buffer_bytes: int64")
+    .Input("spill_directory: string")
+    .Input("seed: int64")
+    .Input("seed2: int64")
+    .Output("handle: resource")
+    .Attr("output_types: list(type) >= 1")
+    .Attr("output_shapes: list(shape) >= 1")
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Creates a dataset that shuffles elements from `input_dataset` pseudorandomly,
+bounding the memory used by the shuffle buffer in bytes.
+
+Elements are sampled uniformly at random from a buffer of up to
+`buffer_size` elements, as in `ShuffleDataset`. At most `max_buffer_bytes`
+bytes of element data are kept in memory. If `spill_directory` is non-empty,
+elements that do not fit in memory are written to scratch files in TFRecord
+format in that directory and read back when they are sampled; otherwise the
+buffer holds fewer than `buffer_size` elements when the byte budget is
+exhausted.
+
+buffer_size: The maximum number of elements to sample from.
+max_buffer_bytes: The maximum number of bytes of element data to keep in
+  memory. Must be positive.
+spill_directory: A directory for scratch files holding spilled elements, or
+  the empty string to disable spilling. Files are deleted once all of their
+  elements have been produced, and when the iterator is destroyed.
+seed: A scalar seed for the random number generator. If either seed or
+  seed2 is set to be non-zero, the random number generator is seeded
+  by the given seed.  Otherwise, a random seed is used.
+seed2: A second scalar seed to avoid seed collision.
+)doc");
+
 REGISTER_OP("TextLineDataset")
     .Input("filenames: string")
     .Output("handle: resource")
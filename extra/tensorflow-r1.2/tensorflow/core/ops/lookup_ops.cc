@@ -543,6 +543,37 @@ max_load_factor: The maximum ratio between number of entries and number of
   buckets before growing the table. Must be between 0 and 1.
 )doc");
 
+REGISTER_OP("MemmappedHashTable")
+    .Output("table_handle: resource")
+    .Attr("filename: string")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("use_node_name_sharing: bool = false")
+    .Attr("key_dtype: type")
+    .Attr("value_dtype: type")
+    .SetIsStateful()
+    .SetShapeFn(ScalarOutput)
+    .Doc(R"doc(
+Creates an immutable hash table backed by a memory-mapped table file.
+
+The file is written ahead of time by the build_memmapped_lookup_table tool and
+is mapped rather than parsed, so the table needs no initialization and its
+pages are shared by all processes that open the same file. Keys and values are
+scalars of type int64 or string; the file's types must match key_dtype and
+value_dtype. The table does not support insert, import or export.
+
+table_handle: Handle to a table.
+filename: Path of the table file.
+container: If non-empty, this table is placed in the given container.
+  Otherwise, a default container is used.
+shared_name: If non-empty, this table is shared under the given name across
+  multiple sessions.
+use_node_name_sharing: If true and shared_name is empty, the table is shared
+  using the node name.
+key_dtype: Type of the table keys.
+value_dtype: Type of the table values.
+)doc");
+
 REGISTER_OP("InitializeTable")
     .Input("table_handle: Ref(string)")
     .Input("keys: Tkey")
@@ -147,6 +147,27 @@ Cast x of type SrcT to y of DstT.
 _HostCast requires its input and produces its output in host memory.
 )doc");
 
+REGISTER_OP("_FusedCwise")
+    .Input("x: T")
+    .Output("y: T")
+    .Attr("T: {float}")
+    .Attr("ops: list(string) >= 1")
+    .Attr("scalars: list(float) >= 1")
+    .SetShapeFn(shape_inference::UnchangedShape)
+    .Doc(R"doc(
+Applies a chain of element-wise operations to x in a single pass.
+
+The chain replaces a sequence of unary ops, and of binary ops with a scalar
+constant operand, that the arithmetic optimizer found in the graph. Each
+entry of `ops` is the name of a unary op, or of a binary op (Add, Sub, Mul,
+Div, Maximum, Minimum) applied as `value op scalar`; the binary ops prefixed
+with "R" (RSub, RDiv) are applied as `scalar op value`. `scalars` holds the
+constant operand of each entry, and is ignored for unary ops.
+
+NOTE Do not invoke this operator directly in Python. Graph rewrite pass is
+expected to create this operator.
+)doc");
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("Abs")
@@ -2193,8 +2214,8 @@ REGISTER_OP("QuantizedMatMul")
       ShapeHandle unused;
       TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
       TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
-      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
-      TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(4), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(5), 1, &unused));
 
       c->set_output(1, c->Scalar());
       c->set_output(2, c->Scalar());
@@ -2214,8 +2235,10 @@ transpose_a: If true, `a` is transposed before multiplication.
 transpose_b: If true, `b` is transposed before multiplication.
 min_a: The float value that the lowest quantized `a` value represents.
 max_a: The float value that the highest quantized `a` value represents.
-min_b: The float value that the lowest quantized `b` value represents.
-max_b: The float value that the highest quantized `b` value represents.
+min_b: The float value that the lowest quantized `b` value represents, either
+  for the whole matrix or, as a vector, for each column of the output.
+max_b: The float value that the highest quantized `b` value represents, either
+  for the whole matrix or, as a vector, for each column of the output.
 min_out: The float value that the lowest quantized output value represents.
 max_out: The float value that the highest quantized output value represents.
 Tactivation: The type of output produced by activation function
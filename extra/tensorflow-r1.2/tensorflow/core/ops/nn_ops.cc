@@ -809,6 +809,37 @@ strides: 1-D of length 4.  The stride of the sliding window for each dimension
 padding: The type of padding algorithm to use.
  )doc");
 
+REGISTER_OP("_FusedConv2DBiasActivation")
+    .Input("input: T")
+    .Input("filter: T")
+    .Input("bias: T")
+    .Output("output: T")
+    .Attr("T: {float}")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .Attr("activation: {'None', 'Relu', 'Relu6'} = 'Relu'")
+    .SetShapeFn(shape_inference::Conv2DShape)
+    .Doc(R"doc(
+Computes Conv2D, BiasAdd and an optional Relu or Relu6 in a single pass.
+
+The bias and activation are applied to each tile of the convolution output as
+soon as it has been computed, while it is still in cache, instead of streaming
+the whole output tensor through memory two more times. The data_format
+attribute of Conv2D isn't supported by this op, and 'NHWC' order is used.
+
+NOTE Do not invoke this operator directly in Python. The
+FuseConv2DBiasActivation graph optimization pass is expected to create it.
+
+input: 4-D with shape `[batch, in_height, in_width, in_channels]`.
+filter: 4-D with shape
+  `[filter_height, filter_width, in_channels, out_channels]`.
+bias: 1-D with size `out_channels`.
+strides: 1-D of length 4.  The stride of the sliding window for each dimension
+   of `input`.
+padding: The type of padding algorithm to use.
+activation: The activation applied after the bias is added.
+)doc");
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("DepthwiseConv2dNative")
@@ -2386,8 +2417,8 @@ REGISTER_OP("QuantizedConv2D")
       ShapeHandle unused;
       TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
       TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
-      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
-      TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(4), 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRankAtMost(c->input(5), 1, &unused));
       c->set_output(1, c->Scalar());
       c->set_output(2, c->Scalar());
       return Status::OK();
@@ -2405,8 +2436,10 @@ strides: The stride of the sliding window for each dimension of the input
 padding: The type of padding algorithm to use.
 min_input: The float value that the lowest quantized input value represents.
 max_input: The float value that the highest quantized input value represents.
-min_filter: The float value that the lowest quantized filter value represents.
-max_filter: The float value that the highest quantized filter value represents.
+min_filter: The float value that the lowest quantized filter value represents,
+  either for the whole filter or, as a vector, for each output channel.
+max_filter: The float value that the highest quantized filter value represents,
+  either for the whole filter or, as a vector, for each output channel.
 min_output: The float value that the lowest quantized output value represents.
 max_output: The float value that the highest quantized output value represents.
 
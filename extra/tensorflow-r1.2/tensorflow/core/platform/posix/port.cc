@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 #if defined(__linux__) && !defined(__ANDROID__)
 #include <sched.h>
+#include <sys/sysinfo.h>
 #endif
 #include <stdio.h>
 #include <stdlib.h>
@@ -121,6 +122,17 @@ void MallocExtension_ReleaseToSystem(std::size_t num_bytes) {
 
 std::size_t MallocExtension_GetAllocatedSize(const void* p) { return 0; }
 
+int64 AvailableRam() {
+#if defined(__linux__) && !defined(__ANDROID__)
+  struct sysinfo info;
+  int err = sysinfo(&info);
+  if (err == 0) {
+    return static_cast<int64>(info.freeram) * info.mem_unit;
+  }
+#endif
+  return kint64max;
+}
+
 void AdjustFilenameForLogging(string* filename) {
   // Nothing to do
 }
@@ -113,6 +113,15 @@ void MallocExtension_ReleaseToSystem(std::size_t num_bytes) {
 
 std::size_t MallocExtension_GetAllocatedSize(const void* p) { return 0; }
 
+int64 AvailableRam() {
+  MEMORYSTATUSEX statex;
+  statex.dwLength = sizeof(statex);
+  if (GlobalMemoryStatusEx(&statex)) {
+    return static_cast<int64>(statex.ullAvailPhys);
+  }
+  return kint64max;
+}
+
 void AdjustFilenameForLogging(string* filename) {
   // Nothing to do
 }
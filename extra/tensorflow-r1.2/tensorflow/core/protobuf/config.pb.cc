@@ -82,12 +82,13 @@ void protobuf_AssignDesc_tensorflow_2fcore_2fprotobuf_2fconfig_2eproto() {
       sizeof(GPUOptions),
       GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(GPUOptions, _internal_metadata_));
   OptimizerOptions_descriptor_ = file->message_type(1);
-  static const int OptimizerOptions_offsets_[5] = {
+  static const int OptimizerOptions_offsets_[6] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OptimizerOptions, do_common_subexpression_elimination_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OptimizerOptions, do_constant_folding_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OptimizerOptions, do_function_inlining_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OptimizerOptions, opt_level_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OptimizerOptions, global_jit_level_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(OptimizerOptions, cache_function_graphs_),
   };
   OptimizerOptions_reflection_ =
     ::google::protobuf::internal::GeneratedMessageReflection::NewGeneratedMessageReflection(
@@ -329,56 +330,57 @@ void protobuf_AddDesc_tensorflow_2fcore_2fprotobuf_2fconfig_2eproto_impl() {
     "\033\n\023visible_device_list\030\005 \001(\t\022\"\n\032polling_"
     "active_delay_usecs\030\006 \001(\005\022$\n\034polling_inac"
     "tive_delay_msecs\030\007 \001(\005\022\034\n\024force_gpu_comp"
-    "atible\030\010 \001(\010\"\337\002\n\020OptimizerOptions\022+\n#do_"
+    "atible\030\010 \001(\010\"\376\002\n\020OptimizerOptions\022+\n#do_"
     "common_subexpression_elimination\030\001 \001(\010\022\033"
     "\n\023do_constant_folding\030\002 \001(\010\022\034\n\024do_functi"
     "on_inlining\030\004 \001(\010\0225\n\topt_level\030\003 \001(\0162\".t"
     "ensorflow.OptimizerOptions.Level\022E\n\020glob"
     "al_jit_level\030\005 \001(\0162+.tensorflow.Optimize"
-    "rOptions.GlobalJitLevel\" \n\005Level\022\006\n\002L1\020\000"
-    "\022\017\n\002L0\020\377\377\377\377\377\377\377\377\377\001\"C\n\016GlobalJitLevel\022\013\n\007D"
-    "EFAULT\020\000\022\020\n\003OFF\020\377\377\377\377\377\377\377\377\377\001\022\010\n\004ON_1\020\001\022\010\n\004"
-    "ON_2\020\002\"\356\002\n\014GraphOptions\022\036\n\026enable_recv_s"
-    "cheduling\030\002 \001(\010\0227\n\021optimizer_options\030\003 \001"
-    "(\0132\034.tensorflow.OptimizerOptions\022\030\n\020buil"
-    "d_cost_model\030\004 \001(\003\022\036\n\026build_cost_model_a"
-    "fter\030\t \001(\003\022\024\n\014infer_shapes\030\005 \001(\010\022\032\n\022plac"
-    "e_pruned_graph\030\006 \001(\010\022 \n\030enable_bfloat16_"
-    "sendrecv\030\007 \001(\010\022\025\n\rtimeline_step\030\010 \001(\005\0223\n"
-    "\017rewrite_options\030\n \001(\0132\032.tensorflow.Rewr"
-    "iterConfigJ\004\010\001\020\002R%skip_common_subexpress"
-    "ion_elimination\",\n\025ThreadPoolOptionProto"
-    "\022\023\n\013num_threads\030\001 \001(\005\"2\n\nRPCOptions\022$\n\034u"
-    "se_rpc_for_inprocess_master\030\001 \001(\010\"\376\004\n\013Co"
-    "nfigProto\022>\n\014device_count\030\001 \003(\0132(.tensor"
-    "flow.ConfigProto.DeviceCountEntry\022$\n\034int"
-    "ra_op_parallelism_threads\030\002 \001(\005\022$\n\034inter"
-    "_op_parallelism_threads\030\005 \001(\005\022\037\n\027use_per"
-    "_session_threads\030\t \001(\010\022G\n\034session_inter_"
-    "op_thread_pool\030\014 \003(\0132!.tensorflow.Thread"
-    "PoolOptionProto\022\030\n\020placement_period\030\003 \001("
-    "\005\022\026\n\016device_filters\030\004 \003(\t\022+\n\013gpu_options"
-    "\030\006 \001(\0132\026.tensorflow.GPUOptions\022\034\n\024allow_"
-    "soft_placement\030\007 \001(\010\022\034\n\024log_device_place"
-    "ment\030\010 \001(\010\022/\n\rgraph_options\030\n \001(\0132\030.tens"
-    "orflow.GraphOptions\022\037\n\027operation_timeout"
-    "_in_ms\030\013 \001(\003\022+\n\013rpc_options\030\r \001(\0132\026.tens"
-    "orflow.RPCOptions\022+\n\013cluster_def\030\016 \001(\0132\026"
-    ".tensorflow.ClusterDef\0322\n\020DeviceCountEnt"
-    "ry\022\013\n\003key\030\001 \001(\t\022\r\n\005value\030\002 \001(\005:\0028\001\"\245\002\n\nR"
-    "unOptions\0226\n\013trace_level\030\001 \001(\0162!.tensorf"
-    "low.RunOptions.TraceLevel\022\025\n\rtimeout_in_"
-    "ms\030\002 \001(\003\022\034\n\024inter_op_thread_pool\030\003 \001(\005\022\037"
-    "\n\027output_partition_graphs\030\005 \001(\010\022/\n\rdebug"
-    "_options\030\006 \001(\0132\030.tensorflow.DebugOptions"
-    "\"R\n\nTraceLevel\022\014\n\010NO_TRACE\020\000\022\022\n\016SOFTWARE"
-    "_TRACE\020\001\022\022\n\016HARDWARE_TRACE\020\002\022\016\n\nFULL_TRA"
-    "CE\020\003J\004\010\004\020\005\"\226\001\n\013RunMetadata\022)\n\nstep_stats"
-    "\030\001 \001(\0132\025.tensorflow.StepStats\022,\n\ncost_gr"
-    "aph\030\002 \001(\0132\030.tensorflow.CostGraphDef\022.\n\020p"
-    "artition_graphs\030\003 \003(\0132\024.tensorflow.Graph"
-    "DefB-\n\030org.tensorflow.frameworkB\014ConfigP"
-    "rotosP\001\370\001\001b\006proto3", 2538);
+    "rOptions.GlobalJitLevel\022\035\n\025cache_functio"
+    "n_graphs\030\006 \001(\010\" \n\005Level\022\006\n\002L1\020\000\022\017\n\002L0\020\377\377"
+    "\377\377\377\377\377\377\377\001\"C\n\016GlobalJitLevel\022\013\n\007DEFAULT\020\000\022"
+    "\020\n\003OFF\020\377\377\377\377\377\377\377\377\377\001\022\010\n\004ON_1\020\001\022\010\n\004ON_2\020\002\"\356\002"
+    "\n\014GraphOptions\022\036\n\026enable_recv_scheduling"
+    "\030\002 \001(\010\0227\n\021optimizer_options\030\003 \001(\0132\034.tens"
+    "orflow.OptimizerOptions\022\030\n\020build_cost_mo"
+    "del\030\004 \001(\003\022\036\n\026build_cost_model_after\030\t \001("
+    "\003\022\024\n\014infer_shapes\030\005 \001(\010\022\032\n\022place_pruned_"
+    "graph\030\006 \001(\010\022 \n\030enable_bfloat16_sendrecv\030"
+    "\007 \001(\010\022\025\n\rtimeline_step\030\010 \001(\005\0223\n\017rewrite_"
+    "options\030\n \001(\0132\032.tensorflow.RewriterConfi"
+    "gJ\004\010\001\020\002R%skip_common_subexpression_elimi"
+    "nation\",\n\025ThreadPoolOptionProto\022\023\n\013num_t"
+    "hreads\030\001 \001(\005\"2\n\nRPCOptions\022$\n\034use_rpc_fo"
+    "r_inprocess_master\030\001 \001(\010\"\376\004\n\013ConfigProto"
+    "\022>\n\014device_count\030\001 \003(\0132(.tensorflow.Conf"
+    "igProto.DeviceCountEntry\022$\n\034intra_op_par"
+    "allelism_threads\030\002 \001(\005\022$\n\034inter_op_paral"
+    "lelism_threads\030\005 \001(\005\022\037\n\027use_per_session_"
+    "threads\030\t \001(\010\022G\n\034session_inter_op_thread"
+    "_pool\030\014 \003(\0132!.tensorflow.ThreadPoolOptio"
+    "nProto\022\030\n\020placement_period\030\003 \001(\005\022\026\n\016devi"
+    "ce_filters\030\004 \003(\t\022+\n\013gpu_options\030\006 \001(\0132\026."
+    "tensorflow.GPUOptions\022\034\n\024allow_soft_plac"
+    "ement\030\007 \001(\010\022\034\n\024log_device_placement\030\010 \001("
+    "\010\022/\n\rgraph_options\030\n \001(\0132\030.tensorflow.Gr"
+    "aphOptions\022\037\n\027operation_timeout_in_ms\030\013 "
+    "\001(\003\022+\n\013rpc_options\030\r \001(\0132\026.tensorflow.RP"
+    "COptions\022+\n\013cluster_def\030\016 \001(\0132\026.tensorfl"
+    "ow.ClusterDef\0322\n\020DeviceCountEntry\022\013\n\003key"
+    "\030\001 \001(\t\022\r\n\005value\030\002 \001(\005:\0028\001\"\245\002\n\nRunOptions"
+    "\0226\n\013trace_level\030\001 \001(\0162!.tensorflow.RunOp"
+    "tions.TraceLevel\022\025\n\rtimeout_in_ms\030\002 \001(\003\022"
+    "\034\n\024inter_op_thread_pool\030\003 \001(\005\022\037\n\027output_"
+    "partition_graphs\030\005 \001(\010\022/\n\rdebug_options\030"
+    "\006 \001(\0132\030.tensorflow.DebugOptions\"R\n\nTrace"
+    "Level\022\014\n\010NO_TRACE\020\000\022\022\n\016SOFTWARE_TRACE\020\001\022"
+    "\022\n\016HARDWARE_TRACE\020\002\022\016\n\nFULL_TRACE\020\003J\004\010\004\020"
+    "\005\"\226\001\n\013RunMetadata\022)\n\nstep_stats\030\001 \001(\0132\025."
+    "tensorflow.StepStats\022,\n\ncost_graph\030\002 \001(\013"
+    "2\030.tensorflow.CostGraphDef\022.\n\020partition_"
+    "graphs\030\003 \003(\0132\024.tensorflow.GraphDefB-\n\030or"
+    "g.tensorflow.frameworkB\014ConfigProtosP\001\370\001"
+    "\001b\006proto3", 2569);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "tensorflow/core/protobuf/config.proto", &protobuf_RegisterTypes);
   ::tensorflow::protobuf_AddDesc_tensorflow_2fcore_2fframework_2fcost_5fgraph_2eproto();
@@ -1247,6 +1249,7 @@ const int OptimizerOptions::kDoConstantFoldingFieldNumber;
 const int OptimizerOptions::kDoFunctionInliningFieldNumber;
 const int OptimizerOptions::kOptLevelFieldNumber;
 const int OptimizerOptions::kGlobalJitLevelFieldNumber;
+const int OptimizerOptions::kCacheFunctionGraphsFieldNumber;
 #endif  // !defined(_MSC_VER) || _MSC_VER >= 1900
 
 OptimizerOptions::OptimizerOptions()
@@ -1430,6 +1433,21 @@ bool OptimizerOptions::MergePartialFromCodedStream(
         } else {
           goto handle_unusual;
         }
+        if (input->ExpectTag(48)) goto parse_cache_function_graphs;
+        break;
+      }
+
+      // optional bool cache_function_graphs = 6;
+      case 6: {
+        if (tag == 48) {
+         parse_cache_function_graphs:
+
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &cache_function_graphs_)));
+        } else {
+          goto handle_unusual;
+        }
         if (input->ExpectAtEnd()) goto success;
         break;
       }
@@ -1485,6 +1503,11 @@ void OptimizerOptions::SerializeWithCachedSizes(
       5, this->global_jit_level(), output);
   }
 
+  // optional bool cache_function_graphs = 6;
+  if (this->cache_function_graphs() != 0) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(6, this->cache_function_graphs(), output);
+  }
+
   // @@protoc_insertion_point(serialize_end:tensorflow.OptimizerOptions)
 }
 
@@ -1519,6 +1542,11 @@ void OptimizerOptions::SerializeWithCachedSizes(
       5, this->global_jit_level(), target);
   }
 
+  // optional bool cache_function_graphs = 6;
+  if (this->cache_function_graphs() != 0) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(6, this->cache_function_graphs(), target);
+  }
+
   // @@protoc_insertion_point(serialize_to_array_end:tensorflow.OptimizerOptions)
   return target;
 }
@@ -1554,6 +1582,11 @@ size_t OptimizerOptions::ByteSizeLong() const {
       ::google::protobuf::internal::WireFormatLite::EnumSize(this->global_jit_level());
   }
 
+  // optional bool cache_function_graphs = 6;
+  if (this->cache_function_graphs() != 0) {
+    total_size += 1 + 1;
+  }
+
   int cached_size = ::google::protobuf::internal::ToCachedSize(total_size);
   GOOGLE_SAFE_CONCURRENT_WRITES_BEGIN();
   _cached_size_ = cached_size;
@@ -1602,6 +1635,9 @@ void OptimizerOptions::UnsafeMergeFrom(const OptimizerOptions& from) {
   if (from.global_jit_level() != 0) {
     set_global_jit_level(from.global_jit_level());
   }
+  if (from.cache_function_graphs() != 0) {
+    set_cache_function_graphs(from.cache_function_graphs());
+  }
 }
 
 void OptimizerOptions::CopyFrom(const ::google::protobuf::Message& from) {
@@ -1645,6 +1681,7 @@ void OptimizerOptions::InternalSwap(OptimizerOptions* other) {
   std::swap(do_function_inlining_, other->do_function_inlining_);
   std::swap(opt_level_, other->opt_level_);
   std::swap(global_jit_level_, other->global_jit_level_);
+  std::swap(cache_function_graphs_, other->cache_function_graphs_);
   _internal_metadata_.Swap(&other->_internal_metadata_);
   std::swap(_cached_size_, other->_cached_size_);
 }
@@ -1730,6 +1767,20 @@ void OptimizerOptions::set_global_jit_level(::tensorflow::OptimizerOptions_Globa
   // @@protoc_insertion_point(field_set:tensorflow.OptimizerOptions.global_jit_level)
 }
 
+// optional bool cache_function_graphs = 6;
+void OptimizerOptions::clear_cache_function_graphs() {
+  cache_function_graphs_ = false;
+}
+bool OptimizerOptions::cache_function_graphs() const {
+  // @@protoc_insertion_point(field_get:tensorflow.OptimizerOptions.cache_function_graphs)
+  return cache_function_graphs_;
+}
+void OptimizerOptions::set_cache_function_graphs(bool value) {
+  
+  cache_function_graphs_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.OptimizerOptions.cache_function_graphs)
+}
+
 inline const OptimizerOptions* OptimizerOptions::internal_default_instance() {
   return &OptimizerOptions_default_instance_.get();
 }
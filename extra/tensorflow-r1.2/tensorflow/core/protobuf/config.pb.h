@@ -447,6 +447,12 @@ class OptimizerOptions : public ::google::protobuf::Message /* @@protoc_insertio
   ::tensorflow::OptimizerOptions_GlobalJitLevel global_jit_level() const;
   void set_global_jit_level(::tensorflow::OptimizerOptions_GlobalJitLevel value);
 
+  // optional bool cache_function_graphs = 6;
+  void clear_cache_function_graphs();
+  static const int kCacheFunctionGraphsFieldNumber = 6;
+  bool cache_function_graphs() const;
+  void set_cache_function_graphs(bool value);
+
   // @@protoc_insertion_point(class_scope:tensorflow.OptimizerOptions)
  private:
 
@@ -457,6 +463,7 @@ class OptimizerOptions : public ::google::protobuf::Message /* @@protoc_insertio
   bool do_common_subexpression_elimination_;
   bool do_constant_folding_;
   bool do_function_inlining_;
+  bool cache_function_graphs_;
   int opt_level_;
   int global_jit_level_;
   mutable int _cached_size_;
@@ -1727,6 +1734,20 @@ inline void OptimizerOptions::set_global_jit_level(::tensorflow::OptimizerOption
   // @@protoc_insertion_point(field_set:tensorflow.OptimizerOptions.global_jit_level)
 }
 
+// optional bool cache_function_graphs = 6;
+inline void OptimizerOptions::clear_cache_function_graphs() {
+  cache_function_graphs_ = false;
+}
+inline bool OptimizerOptions::cache_function_graphs() const {
+  // @@protoc_insertion_point(field_get:tensorflow.OptimizerOptions.cache_function_graphs)
+  return cache_function_graphs_;
+}
+inline void OptimizerOptions::set_cache_function_graphs(bool value) {
+  
+  cache_function_graphs_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.OptimizerOptions.cache_function_graphs)
+}
+
 inline const OptimizerOptions* OptimizerOptions::internal_default_instance() {
   return &OptimizerOptions_default_instance_.get();
 }
@@ -193,6 +193,7 @@ void AppendProtoDebugString(
   if (msg.global_jit_level() != 0) {
     o->AppendEnumName("global_jit_level", ::tensorflow::EnumName_OptimizerOptions_GlobalJitLevel(msg.global_jit_level()));
   }
+  o->AppendBoolIfTrue("cache_function_graphs", msg.cache_function_graphs());
 }
 
 }  // namespace internal
@@ -212,7 +213,7 @@ namespace internal {
 bool ProtoParseFromScanner(
     ::tensorflow::strings::Scanner* scanner, bool nested, bool close_curly,
     ::tensorflow::OptimizerOptions* msg) {
-  std::vector<bool> has_seen(5, false);
+  std::vector<bool> has_seen(6, false);
   while(true) {
     ProtoSpaceAndComments(scanner);
     if (nested && (scanner->Peek() == (close_curly ? '}' : '>'))) {
@@ -285,6 +286,13 @@ bool ProtoParseFromScanner(
         return false;
       }
     }
+    else if (identifier == "cache_function_graphs") {
+      if (has_seen[5]) return false;
+      has_seen[5] = true;
+      bool value;
+      if (!parsed_colon || !::tensorflow::strings::ProtoParseBoolFromScanner(scanner, &value)) return false;
+      msg->set_cache_function_graphs(value);
+    }
   }
 }
 
@@ -55,12 +55,15 @@ void protobuf_AssignDesc_tensorflow_2fcore_2fprotobuf_2frewriter_5fconfig_2eprot
       sizeof(AutoParallelOptions),
       GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(AutoParallelOptions, _internal_metadata_));
   RewriterConfig_descriptor_ = file->message_type(1);
-  static const int RewriterConfig_offsets_[6] = {
+  static const int RewriterConfig_offsets_[9] = {
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, optimize_tensor_layout_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, disable_model_pruning_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, constant_folding_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, memory_optimization_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, auto_parallel_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, fold_batch_norms_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, arithmetic_optimization_),
+    GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, critical_path_priority_),
     GOOGLE_PROTOBUF_GENERATED_MESSAGE_FIELD_OFFSET(RewriterConfig, optimizers_),
   };
   RewriterConfig_reflection_ =
@@ -125,15 +128,18 @@ void protobuf_AddDesc_tensorflow_2fcore_2fprotobuf_2frewriter_5fconfig_2eproto_i
     "\n.tensorflow/core/protobuf/rewriter_conf"
     "ig.proto\022\ntensorflow\";\n\023AutoParallelOpti"
     "ons\022\016\n\006enable\030\001 \001(\010\022\024\n\014num_replicas\030\002 \001("
-    "\005\"\243\002\n\016RewriterConfig\022\036\n\026optimize_tensor_"
+    "\005\"\216\003\n\016RewriterConfig\022\036\n\026optimize_tensor_"
     "layout\030\001 \001(\010\022\035\n\025disable_model_pruning\030\002 "
     "\001(\010\022\030\n\020constant_folding\030\003 \001(\010\022B\n\023memory_"
     "optimization\030\004 \001(\0162%.tensorflow.Rewriter"
     "Config.MemOptType\0226\n\rauto_parallel\030\005 \001(\013"
-    "2\037.tensorflow.AutoParallelOptions\022\022\n\nopt"
-    "imizers\030d \003(\t\"(\n\nMemOptType\022\016\n\nNO_MEM_OP"
-    "T\020\000\022\n\n\006MANUAL\020\001B5\n\030org.tensorflow.framew"
-    "orkB\024RewriterConfigProtosP\001\370\001\001b\006proto3", 478);
+    "2\037.tensorflow.AutoParallelOptions\022\030\n\020fol"
+    "d_batch_norms\030\006 \001(\010\022\037\n\027arithmetic_optimi"
+    "zation\030\007 \001(\010\022\036\n\026critical_path_priority\030\010"
+    " \001(\010\022\022\n\noptimizers\030d \003(\t\"8\n\nMemOptType\022\016"
+    "\n\nNO_MEM_OPT\020\000\022\n\n\006MANUAL\020\001\022\016\n\nHEURISTICS"
+    "\020\002B5\n\030org.tensorflow.frameworkB\024Rewriter"
+    "ConfigProtosP\001\370\001\001b\006proto3", 585);
   ::google::protobuf::MessageFactory::InternalRegisterGeneratedFile(
     "tensorflow/core/protobuf/rewriter_config.proto", &protobuf_RegisterTypes);
   ::google::protobuf::internal::OnShutdown(&protobuf_ShutdownFile_tensorflow_2fcore_2fprotobuf_2frewriter_5fconfig_2eproto);
@@ -514,6 +520,7 @@ bool RewriterConfig_MemOptType_IsValid(int value) {
   switch (value) {
     case 0:
     case 1:
+    case 2:
       return true;
     default:
       return false;
@@ -523,6 +530,7 @@ bool RewriterConfig_MemOptType_IsValid(int value) {
 #if !defined(_MSC_VER) || _MSC_VER >= 1900
 const RewriterConfig_MemOptType RewriterConfig::NO_MEM_OPT;
 const RewriterConfig_MemOptType RewriterConfig::MANUAL;
+const RewriterConfig_MemOptType RewriterConfig::HEURISTICS;
 const RewriterConfig_MemOptType RewriterConfig::MemOptType_MIN;
 const RewriterConfig_MemOptType RewriterConfig::MemOptType_MAX;
 const int RewriterConfig::MemOptType_ARRAYSIZE;
@@ -580,6 +588,9 @@ const int RewriterConfig::kDisableModelPruningFieldNumber;
 const int RewriterConfig::kConstantFoldingFieldNumber;
 const int RewriterConfig::kMemoryOptimizationFieldNumber;
 const int RewriterConfig::kAutoParallelFieldNumber;
+const int RewriterConfig::kFoldBatchNormsFieldNumber;
+const int RewriterConfig::kArithmeticOptimizationFieldNumber;
+const int RewriterConfig::kCriticalPathPriorityFieldNumber;
 const int RewriterConfig::kOptimizersFieldNumber;
 #endif  // !defined(_MSC_VER) || _MSC_VER >= 1900
 
@@ -616,8 +627,8 @@ RewriterConfig::RewriterConfig(const RewriterConfig& from)
 
 void RewriterConfig::SharedCtor() {
   auto_parallel_ = NULL;
-  ::memset(&optimize_tensor_layout_, 0, reinterpret_cast<char*>(&memory_optimization_) -
-    reinterpret_cast<char*>(&optimize_tensor_layout_) + sizeof(memory_optimization_));
+  ::memset(&optimize_tensor_layout_, 0, reinterpret_cast<char*>(&critical_path_priority_) -
+    reinterpret_cast<char*>(&optimize_tensor_layout_) + sizeof(critical_path_priority_));
   _cached_size_ = 0;
 }
 
@@ -682,7 +693,7 @@ void RewriterConfig::Clear() {
            ZR_HELPER_(last) - ZR_HELPER_(first) + sizeof(last));\
 } while (0)
 
-  ZR_(optimize_tensor_layout_, memory_optimization_);
+  ZR_(optimize_tensor_layout_, critical_path_priority_);
   if (GetArenaNoVirtual() == NULL && auto_parallel_ != NULL) delete auto_parallel_;
   auto_parallel_ = NULL;
 
@@ -771,6 +782,51 @@ bool RewriterConfig::MergePartialFromCodedStream(
         } else {
           goto handle_unusual;
         }
+        if (input->ExpectTag(48)) goto parse_fold_batch_norms;
+        break;
+      }
+
+      // optional bool fold_batch_norms = 6;
+      case 6: {
+        if (tag == 48) {
+         parse_fold_batch_norms:
+
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &fold_batch_norms_)));
+        } else {
+          goto handle_unusual;
+        }
+        if (input->ExpectTag(56)) goto parse_arithmetic_optimization;
+        break;
+      }
+
+      // optional bool arithmetic_optimization = 7;
+      case 7: {
+        if (tag == 56) {
+         parse_arithmetic_optimization:
+
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &arithmetic_optimization_)));
+        } else {
+          goto handle_unusual;
+        }
+        if (input->ExpectTag(64)) goto parse_critical_path_priority;
+        break;
+      }
+
+      // optional bool critical_path_priority = 8;
+      case 8: {
+        if (tag == 64) {
+         parse_critical_path_priority:
+
+          DO_((::google::protobuf::internal::WireFormatLite::ReadPrimitive<
+                   bool, ::google::protobuf::internal::WireFormatLite::TYPE_BOOL>(
+                 input, &critical_path_priority_)));
+        } else {
+          goto handle_unusual;
+        }
         if (input->ExpectTag(802)) goto parse_optimizers;
         break;
       }
@@ -845,6 +901,21 @@ void RewriterConfig::SerializeWithCachedSizes(
       5, *this->auto_parallel_, output);
   }
 
+  // optional bool fold_batch_norms = 6;
+  if (this->fold_batch_norms() != 0) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(6, this->fold_batch_norms(), output);
+  }
+
+  // optional bool arithmetic_optimization = 7;
+  if (this->arithmetic_optimization() != 0) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(7, this->arithmetic_optimization(), output);
+  }
+
+  // optional bool critical_path_priority = 8;
+  if (this->critical_path_priority() != 0) {
+    ::google::protobuf::internal::WireFormatLite::WriteBool(8, this->critical_path_priority(), output);
+  }
+
   // repeated string optimizers = 100;
   for (int i = 0; i < this->optimizers_size(); i++) {
     ::google::protobuf::internal::WireFormatLite::VerifyUtf8String(
@@ -890,6 +961,21 @@ void RewriterConfig::SerializeWithCachedSizes(
         5, *this->auto_parallel_, false, target);
   }
 
+  // optional bool fold_batch_norms = 6;
+  if (this->fold_batch_norms() != 0) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(6, this->fold_batch_norms(), target);
+  }
+
+  // optional bool arithmetic_optimization = 7;
+  if (this->arithmetic_optimization() != 0) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(7, this->arithmetic_optimization(), target);
+  }
+
+  // optional bool critical_path_priority = 8;
+  if (this->critical_path_priority() != 0) {
+    target = ::google::protobuf::internal::WireFormatLite::WriteBoolToArray(8, this->critical_path_priority(), target);
+  }
+
   // repeated string optimizers = 100;
   for (int i = 0; i < this->optimizers_size(); i++) {
     ::google::protobuf::internal::WireFormatLite::VerifyUtf8String(
@@ -936,6 +1022,21 @@ size_t RewriterConfig::ByteSizeLong() const {
         *this->auto_parallel_);
   }
 
+  // optional bool fold_batch_norms = 6;
+  if (this->fold_batch_norms() != 0) {
+    total_size += 1 + 1;
+  }
+
+  // optional bool arithmetic_optimization = 7;
+  if (this->arithmetic_optimization() != 0) {
+    total_size += 1 + 1;
+  }
+
+  // optional bool critical_path_priority = 8;
+  if (this->critical_path_priority() != 0) {
+    total_size += 1 + 1;
+  }
+
   // repeated string optimizers = 100;
   total_size += 2 *
       ::google::protobuf::internal::FromIntSize(this->optimizers_size());
@@ -993,6 +1094,15 @@ void RewriterConfig::UnsafeMergeFrom(const RewriterConfig& from) {
   if (from.has_auto_parallel()) {
     mutable_auto_parallel()->::tensorflow::AutoParallelOptions::MergeFrom(from.auto_parallel());
   }
+  if (from.fold_batch_norms() != 0) {
+    set_fold_batch_norms(from.fold_batch_norms());
+  }
+  if (from.arithmetic_optimization() != 0) {
+    set_arithmetic_optimization(from.arithmetic_optimization());
+  }
+  if (from.critical_path_priority() != 0) {
+    set_critical_path_priority(from.critical_path_priority());
+  }
 }
 
 void RewriterConfig::CopyFrom(const ::google::protobuf::Message& from) {
@@ -1036,6 +1146,9 @@ void RewriterConfig::InternalSwap(RewriterConfig* other) {
   std::swap(constant_folding_, other->constant_folding_);
   std::swap(memory_optimization_, other->memory_optimization_);
   std::swap(auto_parallel_, other->auto_parallel_);
+  std::swap(fold_batch_norms_, other->fold_batch_norms_);
+  std::swap(arithmetic_optimization_, other->arithmetic_optimization_);
+  std::swap(critical_path_priority_, other->critical_path_priority_);
   optimizers_.UnsafeArenaSwap(&other->optimizers_);
   _internal_metadata_.Swap(&other->_internal_metadata_);
   std::swap(_cached_size_, other->_cached_size_);
@@ -1157,6 +1270,48 @@ const ::tensorflow::AutoParallelOptions& RewriterConfig::auto_parallel() const {
   // @@protoc_insertion_point(field_set_allocated:tensorflow.RewriterConfig.auto_parallel)
 }
 
+// optional bool fold_batch_norms = 6;
+void RewriterConfig::clear_fold_batch_norms() {
+  fold_batch_norms_ = false;
+}
+bool RewriterConfig::fold_batch_norms() const {
+  // @@protoc_insertion_point(field_get:tensorflow.RewriterConfig.fold_batch_norms)
+  return fold_batch_norms_;
+}
+void RewriterConfig::set_fold_batch_norms(bool value) {
+  
+  fold_batch_norms_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.RewriterConfig.fold_batch_norms)
+}
+
+// optional bool arithmetic_optimization = 7;
+void RewriterConfig::clear_arithmetic_optimization() {
+  arithmetic_optimization_ = false;
+}
+bool RewriterConfig::arithmetic_optimization() const {
+  // @@protoc_insertion_point(field_get:tensorflow.RewriterConfig.arithmetic_optimization)
+  return arithmetic_optimization_;
+}
+void RewriterConfig::set_arithmetic_optimization(bool value) {
+  
+  arithmetic_optimization_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.RewriterConfig.arithmetic_optimization)
+}
+
+// optional bool critical_path_priority = 8;
+void RewriterConfig::clear_critical_path_priority() {
+  critical_path_priority_ = false;
+}
+bool RewriterConfig::critical_path_priority() const {
+  // @@protoc_insertion_point(field_get:tensorflow.RewriterConfig.critical_path_priority)
+  return critical_path_priority_;
+}
+void RewriterConfig::set_critical_path_priority(bool value) {
+  
+  critical_path_priority_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.RewriterConfig.critical_path_priority)
+}
+
 // repeated string optimizers = 100;
 int RewriterConfig::optimizers_size() const {
   return optimizers_.size();
@@ -44,12 +44,13 @@ class RewriterConfig;
 enum RewriterConfig_MemOptType {
   RewriterConfig_MemOptType_NO_MEM_OPT = 0,
   RewriterConfig_MemOptType_MANUAL = 1,
+  RewriterConfig_MemOptType_HEURISTICS = 2,
   RewriterConfig_MemOptType_RewriterConfig_MemOptType_INT_MIN_SENTINEL_DO_NOT_USE_ = ::google::protobuf::kint32min,
   RewriterConfig_MemOptType_RewriterConfig_MemOptType_INT_MAX_SENTINEL_DO_NOT_USE_ = ::google::protobuf::kint32max
 };
 bool RewriterConfig_MemOptType_IsValid(int value);
 const RewriterConfig_MemOptType RewriterConfig_MemOptType_MemOptType_MIN = RewriterConfig_MemOptType_NO_MEM_OPT;
-const RewriterConfig_MemOptType RewriterConfig_MemOptType_MemOptType_MAX = RewriterConfig_MemOptType_MANUAL;
+const RewriterConfig_MemOptType RewriterConfig_MemOptType_MemOptType_MAX = RewriterConfig_MemOptType_HEURISTICS;
 const int RewriterConfig_MemOptType_MemOptType_ARRAYSIZE = RewriterConfig_MemOptType_MemOptType_MAX + 1;
 
 const ::google::protobuf::EnumDescriptor* RewriterConfig_MemOptType_descriptor();
@@ -246,6 +247,8 @@ class RewriterConfig : public ::google::protobuf::Message /* @@protoc_insertion_
     RewriterConfig_MemOptType_NO_MEM_OPT;
   static const MemOptType MANUAL =
     RewriterConfig_MemOptType_MANUAL;
+  static const MemOptType HEURISTICS =
+    RewriterConfig_MemOptType_HEURISTICS;
   static inline bool MemOptType_IsValid(int value) {
     return RewriterConfig_MemOptType_IsValid(value);
   }
@@ -311,6 +314,24 @@ class RewriterConfig : public ::google::protobuf::Message /* @@protoc_insertion_
   void unsafe_arena_set_allocated_auto_parallel(
       ::tensorflow::AutoParallelOptions* auto_parallel);
 
+  // optional bool fold_batch_norms = 6;
+  void clear_fold_batch_norms();
+  static const int kFoldBatchNormsFieldNumber = 6;
+  bool fold_batch_norms() const;
+  void set_fold_batch_norms(bool value);
+
+  // optional bool arithmetic_optimization = 7;
+  void clear_arithmetic_optimization();
+  static const int kArithmeticOptimizationFieldNumber = 7;
+  bool arithmetic_optimization() const;
+  void set_arithmetic_optimization(bool value);
+
+  // optional bool critical_path_priority = 8;
+  void clear_critical_path_priority();
+  static const int kCriticalPathPriorityFieldNumber = 8;
+  bool critical_path_priority() const;
+  void set_critical_path_priority(bool value);
+
   // repeated string optimizers = 100;
   int optimizers_size() const;
   void clear_optimizers();
@@ -339,7 +360,10 @@ class RewriterConfig : public ::google::protobuf::Message /* @@protoc_insertion_
   bool optimize_tensor_layout_;
   bool disable_model_pruning_;
   bool constant_folding_;
+  bool fold_batch_norms_;
   int memory_optimization_;
+  bool arithmetic_optimization_;
+  bool critical_path_priority_;
   mutable int _cached_size_;
   friend void  protobuf_InitDefaults_tensorflow_2fcore_2fprotobuf_2frewriter_5fconfig_2eproto_impl();
   friend void  protobuf_AddDesc_tensorflow_2fcore_2fprotobuf_2frewriter_5fconfig_2eproto_impl();
@@ -498,6 +522,48 @@ inline  void RewriterConfig::set_allocated_auto_parallel(::tensorflow::AutoParal
   // @@protoc_insertion_point(field_set_allocated:tensorflow.RewriterConfig.auto_parallel)
 }
 
+// optional bool fold_batch_norms = 6;
+inline void RewriterConfig::clear_fold_batch_norms() {
+  fold_batch_norms_ = false;
+}
+inline bool RewriterConfig::fold_batch_norms() const {
+  // @@protoc_insertion_point(field_get:tensorflow.RewriterConfig.fold_batch_norms)
+  return fold_batch_norms_;
+}
+inline void RewriterConfig::set_fold_batch_norms(bool value) {
+  
+  fold_batch_norms_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.RewriterConfig.fold_batch_norms)
+}
+
+// optional bool arithmetic_optimization = 7;
+inline void RewriterConfig::clear_arithmetic_optimization() {
+  arithmetic_optimization_ = false;
+}
+inline bool RewriterConfig::arithmetic_optimization() const {
+  // @@protoc_insertion_point(field_get:tensorflow.RewriterConfig.arithmetic_optimization)
+  return arithmetic_optimization_;
+}
+inline void RewriterConfig::set_arithmetic_optimization(bool value) {
+  
+  arithmetic_optimization_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.RewriterConfig.arithmetic_optimization)
+}
+
+// optional bool critical_path_priority = 8;
+inline void RewriterConfig::clear_critical_path_priority() {
+  critical_path_priority_ = false;
+}
+inline bool RewriterConfig::critical_path_priority() const {
+  // @@protoc_insertion_point(field_get:tensorflow.RewriterConfig.critical_path_priority)
+  return critical_path_priority_;
+}
+inline void RewriterConfig::set_critical_path_priority(bool value) {
+  
+  critical_path_priority_ = value;
+  // @@protoc_insertion_point(field_set:tensorflow.RewriterConfig.critical_path_priority)
+}
+
 // repeated string optimizers = 100;
 inline int RewriterConfig::optimizers_size() const {
   return optimizers_.size();
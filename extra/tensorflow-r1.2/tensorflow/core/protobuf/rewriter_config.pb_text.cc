@@ -96,6 +96,7 @@ const char* EnumName_RewriterConfig_MemOptType(
   switch (value) {
     case 0: return "NO_MEM_OPT";
     case 1: return "MANUAL";
+    case 2: return "HEURISTICS";
     default: return "";
   }
 }
@@ -134,6 +135,9 @@ void AppendProtoDebugString(
     ::tensorflow::internal::AppendProtoDebugString(o, msg.auto_parallel());
     o->CloseNestedMessage();
   }
+  o->AppendBoolIfTrue("fold_batch_norms", msg.fold_batch_norms());
+  o->AppendBoolIfTrue("arithmetic_optimization", msg.arithmetic_optimization());
+  o->AppendBoolIfTrue("critical_path_priority", msg.critical_path_priority());
   for (int i = 0; i < msg.optimizers_size(); ++i) {
     o->AppendString("optimizers", ProtobufStringToString(msg.optimizers(i)));
   }
@@ -156,7 +160,7 @@ namespace internal {
 bool ProtoParseFromScanner(
     ::tensorflow::strings::Scanner* scanner, bool nested, bool close_curly,
     ::tensorflow::RewriterConfig* msg) {
-  std::vector<bool> has_seen(6, false);
+  std::vector<bool> has_seen(9, false);
   while(true) {
     ProtoSpaceAndComments(scanner);
     if (nested && (scanner->Peek() == (close_curly ? '}' : '>'))) {
@@ -208,6 +212,8 @@ bool ProtoParseFromScanner(
         msg->set_memory_optimization(::tensorflow::RewriterConfig_MemOptType_NO_MEM_OPT);
       } else if (value == "MANUAL" || value == "1") {
         msg->set_memory_optimization(::tensorflow::RewriterConfig_MemOptType_MANUAL);
+      } else if (value == "HEURISTICS" || value == "2") {
+        msg->set_memory_optimization(::tensorflow::RewriterConfig_MemOptType_HEURISTICS);
       } else {
         return false;
       }
@@ -222,6 +228,27 @@ bool ProtoParseFromScanner(
       if (!::tensorflow::internal::ProtoParseFromScanner(
           scanner, true, open_char == '{', msg->mutable_auto_parallel())) return false;
     }
+    else if (identifier == "fold_batch_norms") {
+      if (has_seen[5]) return false;
+      has_seen[5] = true;
+      bool value;
+      if (!parsed_colon || !::tensorflow::strings::ProtoParseBoolFromScanner(scanner, &value)) return false;
+      msg->set_fold_batch_norms(value);
+    }
+    else if (identifier == "arithmetic_optimization") {
+      if (has_seen[6]) return false;
+      has_seen[6] = true;
+      bool value;
+      if (!parsed_colon || !::tensorflow::strings::ProtoParseBoolFromScanner(scanner, &value)) return false;
+      msg->set_arithmetic_optimization(value);
+    }
+    else if (identifier == "critical_path_priority") {
+      if (has_seen[7]) return false;
+      has_seen[7] = true;
+      bool value;
+      if (!parsed_colon || !::tensorflow::strings::ProtoParseBoolFromScanner(scanner, &value)) return false;
+      msg->set_critical_path_priority(value);
+    }
     else if (identifier == "optimizers") {
       const bool is_list = (scanner->Peek() == '[');
       do {
@@ -0,0 +1,447 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/memmapped_lookup_table.h"
+
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'F', 'M', 'M', 'L', 'T', 'B', 'L'};
+constexpr uint32 kVersion = 1;
+
+// Average number of keys per displacement bucket, and the fraction of slots
+// that are occupied. Larger buckets and fuller tables make the file smaller
+// but the perfect hash slower to build.
+constexpr uint64 kKeysPerBucket = 4;
+constexpr double kLoadFactor = 0.8;
+
+// Limits on the search for a perfect hash. A bucket that finds no free
+// slots within kMaxDisplacement tries restarts the build with a new seed.
+constexpr uint32 kMaxDisplacement = 1 << 20;
+constexpr int kMaxSeedAttempts = 8;
+
+struct Header {
+  char magic[8];
+  uint32 version;
+  uint32 key_dtype;
+  uint32 value_dtype;
+  uint32 reserved;
+  uint64 num_entries;
+  uint64 num_buckets;
+  uint64 num_slots;
+  uint64 hash_seed;
+  uint64 displacements_offset;
+  uint64 slots_offset;
+  uint64 string_data_offset;
+  uint64 string_data_size;
+};
+
+static_assert(sizeof(Header) % 8 == 0, "Header must keep sections aligned");
+
+uint64 AlignTo8(uint64 offset) { return (offset + 7) & ~uint64{7}; }
+
+// Fingerprints are never zero, which marks an empty slot.
+uint64 KeyFingerprint(const char* data, size_t size, uint64 seed) {
+  return Hash64(data, size, seed) | 1;
+}
+
+uint64 BucketIndex(uint64 fingerprint, uint64 num_buckets) {
+  return (fingerprint >> 1) % num_buckets;
+}
+
+uint64 SlotIndex(uint64 fingerprint, uint32 displacement, uint64 num_slots) {
+  // MurmurHash3 finalizer over the displaced fingerprint.
+  uint64 h = fingerprint ^ (displacement * 0x9e3779b97f4a7c15ULL);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h % num_slots;
+}
+
+bool IsSupportedDtype(DataType dtype) {
+  return dtype == DT_INT64 || dtype == DT_STRING;
+}
+
+string EncodeElement(const Tensor& t, int64 i) {
+  if (t.dtype() == DT_INT64) {
+    const int64 v = t.flat<int64>()(i);
+    return string(reinterpret_cast<const char*>(&v), sizeof(v));
+  }
+  return t.flat<string>()(i);
+}
+
+// Appends `s` to `string_data` and returns its offset.
+uint64 AppendString(const string& s, string* string_data) {
+  const uint64 offset = string_data->size();
+  const uint32 length = s.size();
+  string_data->append(reinterpret_cast<const char*>(&length), sizeof(length));
+  string_data->append(s);
+  return offset;
+}
+
+// Returns the cell stored in a slot for an encoded key or value.
+uint64 MakeCell(DataType dtype, const string& encoded, string* string_data) {
+  if (dtype == DT_INT64) {
+    uint64 cell;
+    memcpy(&cell, encoded.data(), sizeof(cell));
+    return cell;
+  }
+  return AppendString(encoded, string_data);
+}
+
+}  // namespace
+
+struct MemmappedLookupTable::Slot {
+  uint64 fingerprint;
+  uint64 key;
+  uint64 value;
+};
+
+static_assert(sizeof(MemmappedLookupTable::Slot) == 24,
+              "Slot layout is part of the file format");
+
+MemmappedLookupTableBuilder::MemmappedLookupTableBuilder(DataType key_dtype,
+                                                         DataType value_dtype)
+    : key_dtype_(key_dtype), value_dtype_(value_dtype) {}
+
+Status MemmappedLookupTableBuilder::Add(const Tensor& keys,
+                                        const Tensor& values) {
+  if (!IsSupportedDtype(key_dtype_) || !IsSupportedDtype(value_dtype_)) {
+    return errors::InvalidArgument(
+        "Memmapped lookup tables support int64 and string keys and values, "
+        "got ",
+        DataTypeString(key_dtype_), " -> ", DataTypeString(value_dtype_));
+  }
+  if (keys.dtype() != key_dtype_ || values.dtype() != value_dtype_) {
+    return errors::InvalidArgument(
+        "Expected keys of type ", DataTypeString(key_dtype_),
+        " and values of type ", DataTypeString(value_dtype_), ", got ",
+        DataTypeString(keys.dtype()), " and ", DataTypeString(values.dtype()));
+  }
+  if (keys.NumElements() != values.NumElements()) {
+    return errors::InvalidArgument(
+        "Number of keys and values must match, got ", keys.NumElements(),
+        " and ", values.NumElements());
+  }
+  for (int64 i = 0; i < keys.NumElements(); ++i) {
+    keys_.push_back(EncodeElement(keys, i));
+    values_.push_back(EncodeElement(values, i));
+  }
+  return Status::OK();
+}
+
+Status MemmappedLookupTableBuilder::Finish(Env* env, const string& filename) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Memmapped lookup tables require a little-endian host");
+  }
+  const uint64 num_entries = keys_.size();
+  const uint64 num_buckets =
+      std::max<uint64>(1, (num_entries + kKeysPerBucket - 1) / kKeysPerBucket);
+  const uint64 num_slots = std::max<uint64>(
+      1, static_cast<uint64>(num_entries / kLoadFactor) + 1);
+
+  std::vector<uint32> displacements;
+  std::vector<int64> slot_entries;
+  uint64 hash_seed = 0;
+  bool found = false;
+  for (int attempt = 0; attempt < kMaxSeedAttempts && !found; ++attempt) {
+    hash_seed = Hash64Combine(0x5eed5eed5eed5eedULL, attempt);
+    std::vector<std::pair<uint64, int64>> fingerprints(num_entries);
+    for (uint64 i = 0; i < num_entries; ++i) {
+      fingerprints[i] = {
+          KeyFingerprint(keys_[i].data(), keys_[i].size(), hash_seed), i};
+    }
+    // Keys are placed by fingerprint, so equal fingerprints are either
+    // duplicate keys, which are an error, or a collision that needs a new
+    // seed.
+    std::sort(fingerprints.begin(), fingerprints.end());
+    bool collision = false;
+    for (uint64 i = 1; i < num_entries; ++i) {
+      if (fingerprints[i].first != fingerprints[i - 1].first) continue;
+      const int64 a = fingerprints[i - 1].second;
+      const int64 b = fingerprints[i].second;
+      if (keys_[a] == keys_[b]) {
+        return errors::InvalidArgument(
+            "Duplicate key in memmapped lookup table at positions ", a,
+            " and ", b);
+      }
+      collision = true;
+    }
+    if (collision) continue;
+
+    std::vector<std::vector<int64>> buckets(num_buckets);
+    for (const auto& fp : fingerprints) {
+      buckets[BucketIndex(fp.first, num_buckets)].push_back(fp.second);
+    }
+    std::vector<uint64> fingerprint_of(num_entries);
+    for (const auto& fp : fingerprints) {
+      fingerprint_of[fp.second] = fp.first;
+    }
+    std::vector<uint64> bucket_order(num_buckets);
+    for (uint64 b = 0; b < num_buckets; ++b) bucket_order[b] = b;
+    // Place the largest buckets first, while most slots are still free.
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&buckets](uint64 a, uint64 b) {
+                       return buckets[a].size() > buckets[b].size();
+                     });
+
+    displacements.assign(num_buckets, 0);
+    slot_entries.assign(num_slots, -1);
+    found = true;
+    std::vector<uint64> candidate_slots;
+    for (uint64 b : bucket_order) {
+      const std::vector<int64>& bucket = buckets[b];
+      if (bucket.empty()) break;
+      bool placed = false;
+      for (uint32 d = 0; d < kMaxDisplacement && !placed; ++d) {
+        candidate_slots.clear();
+        placed = true;
+        for (int64 entry : bucket) {
+          const uint64 slot = SlotIndex(fingerprint_of[entry], d, num_slots);
+          if (slot_entries[slot] != -1 ||
+              std::find(candidate_slots.begin(), candidate_slots.end(),
+                        slot) != candidate_slots.end()) {
+            placed = false;
+            break;
+          }
+          candidate_slots.push_back(slot);
+        }
+        if (placed) {
+          displacements[b] = d;
+          for (size_t j = 0; j < bucket.size(); ++j) {
+            slot_entries[candidate_slots[j]] = bucket[j];
+          }
+        }
+      }
+      if (!placed) {
+        found = false;
+        break;
+      }
+    }
+  }
+  if (!found) {
+    return errors::Internal("Failed to build a perfect hash for ",
+                            num_entries, " keys");
+  }
+
+  string string_data;
+  std::vector<MemmappedLookupTable::Slot> slots(num_slots);
+  for (uint64 s = 0; s < num_slots; ++s) {
+    const int64 entry = slot_entries[s];
+    if (entry == -1) {
+      slots[s] = {0, 0, 0};
+      continue;
+    }
+    slots[s].fingerprint =
+        KeyFingerprint(keys_[entry].data(), keys_[entry].size(), hash_seed);
+    slots[s].key = MakeCell(key_dtype_, keys_[entry], &string_data);
+    slots[s].value = MakeCell(value_dtype_, values_[entry], &string_data);
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key_dtype = key_dtype_;
+  header.value_dtype = value_dtype_;
+  header.num_entries = num_entries;
+  header.num_buckets = num_buckets;
+  header.num_slots = num_slots;
+  header.hash_seed = hash_seed;
+  header.displacements_offset = sizeof(Header);
+  header.slots_offset = AlignTo8(header.displacements_offset +
+                                 num_buckets * sizeof(uint32));
+  header.string_data_offset =
+      header.slots_offset + num_slots * sizeof(MemmappedLookupTable::Slot);
+  header.string_data_size = string_data.size();
+
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename, &file));
+  TF_RETURN_IF_ERROR(file->Append(
+      StringPiece(reinterpret_cast<const char*>(&header), sizeof(header))));
+  TF_RETURN_IF_ERROR(file->Append(
+      StringPiece(reinterpret_cast<const char*>(displacements.data()),
+                  num_buckets * sizeof(uint32))));
+  const uint64 padding = header.slots_offset - header.displacements_offset -
+                         num_buckets * sizeof(uint32);
+  TF_RETURN_IF_ERROR(file->Append(string(padding, '\0')));
+  TF_RETURN_IF_ERROR(file->Append(
+      StringPiece(reinterpret_cast<const char*>(slots.data()),
+                  num_slots * sizeof(MemmappedLookupTable::Slot))));
+  TF_RETURN_IF_ERROR(file->Append(string_data));
+  return file->Close();
+}
+
+MemmappedLookupTable::MemmappedLookupTable(
+    std::unique_ptr<ReadOnlyMemoryRegion> region)
+    : region_(std::move(region)) {}
+
+Status MemmappedLookupTable::Create(
+    std::unique_ptr<ReadOnlyMemoryRegion> region,
+    std::unique_ptr<MemmappedLookupTable>* table) {
+  std::unique_ptr<MemmappedLookupTable> result(
+      new MemmappedLookupTable(std::move(region)));
+  TF_RETURN_IF_ERROR(result->Init());
+  *table = std::move(result);
+  return Status::OK();
+}
+
+Status MemmappedLookupTable::Open(
+    Env* env, const string& filename,
+    std::unique_ptr<MemmappedLookupTable>* table) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(env->NewReadOnlyMemoryRegionFromFile(filename, &region));
+  Status s = Create(std::move(region), table);
+  if (!s.ok()) {
+    return errors::DataLoss("Invalid memmapped lookup table ", filename, ": ",
+                            s.error_message());
+  }
+  return Status::OK();
+}
+
+Status MemmappedLookupTable::Init() {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Memmapped lookup tables require a little-endian host");
+  }
+  const char* data = static_cast<const char*>(region_->data());
+  const uint64 length = region_->length();
+  if (length < sizeof(Header)) {
+    return errors::DataLoss("File is too short: ", length, " bytes");
+  }
+  if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+    return errors::InvalidArgument("Memory region is not 8-byte aligned");
+  }
+  Header header;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    return errors::DataLoss("Bad magic number");
+  }
+  if (header.version != kVersion) {
+    return errors::DataLoss("Unsupported version ", header.version);
+  }
+  key_dtype_ = static_cast<DataType>(header.key_dtype);
+  value_dtype_ = static_cast<DataType>(header.value_dtype);
+  if (!IsSupportedDtype(key_dtype_) || !IsSupportedDtype(value_dtype_)) {
+    return errors::DataLoss("Unsupported key or value type ",
+                            header.key_dtype, " -> ", header.value_dtype);
+  }
+  // Bound the counts by the file length before multiplying them, so that
+  // the section size computations below cannot overflow.
+  if (header.num_buckets == 0 || header.num_slots == 0 ||
+      header.num_buckets > length / sizeof(uint32) ||
+      header.num_slots > length / sizeof(Slot) ||
+      header.num_entries > header.num_slots) {
+    return errors::DataLoss("Inconsistent table sizes");
+  }
+  if (header.displacements_offset < sizeof(Header) ||
+      header.displacements_offset % 8 != 0 || header.slots_offset % 8 != 0 ||
+      header.displacements_offset > length ||
+      header.num_buckets * sizeof(uint32) >
+          length - header.displacements_offset ||
+      header.slots_offset <
+          header.displacements_offset + header.num_buckets * sizeof(uint32) ||
+      header.slots_offset > length ||
+      header.num_slots * sizeof(Slot) > length - header.slots_offset ||
+      header.string_data_offset <
+          header.slots_offset + header.num_slots * sizeof(Slot) ||
+      header.string_data_offset > length ||
+      header.string_data_size > length - header.string_data_offset) {
+    return errors::DataLoss("Section offsets are out of bounds");
+  }
+  num_entries_ = header.num_entries;
+  num_buckets_ = header.num_buckets;
+  num_slots_ = header.num_slots;
+  hash_seed_ = header.hash_seed;
+  displacements_ =
+      reinterpret_cast<const uint32*>(data + header.displacements_offset);
+  slots_ = reinterpret_cast<const Slot*>(data + header.slots_offset);
+  string_data_ = data + header.string_data_offset;
+  string_data_size_ = header.string_data_size;
+  return Status::OK();
+}
+
+StringPiece MemmappedLookupTable::StringAt(uint64 offset) const {
+  // Strings are bounds-checked on access rather than when the file is
+  // opened, which would touch every page of the file.
+  uint32 length;
+  if (offset > string_data_size_ ||
+      sizeof(length) > string_data_size_ - offset) {
+    return StringPiece();
+  }
+  memcpy(&length, string_data_ + offset, sizeof(length));
+  offset += sizeof(length);
+  if (length > string_data_size_ - offset) {
+    return StringPiece();
+  }
+  return StringPiece(string_data_ + offset, length);
+}
+
+int64 MemmappedLookupTable::FindSlotForBytes(const char* key,
+                                             size_t size) const {
+  const uint64 fingerprint = KeyFingerprint(key, size, hash_seed_);
+  const uint32 displacement =
+      displacements_[BucketIndex(fingerprint, num_buckets_)];
+  const uint64 slot = SlotIndex(fingerprint, displacement, num_slots_);
+  if (slots_[slot].fingerprint != fingerprint) {
+    return -1;
+  }
+  return slot;
+}
+
+int64 MemmappedLookupTable::FindSlot(int64 key) const {
+  DCHECK_EQ(key_dtype_, DT_INT64);
+  const int64 slot =
+      FindSlotForBytes(reinterpret_cast<const char*>(&key), sizeof(key));
+  if (slot < 0 || static_cast<int64>(slots_[slot].key) != key) {
+    return -1;
+  }
+  return slot;
+}
+
+int64 MemmappedLookupTable::FindSlot(StringPiece key) const {
+  DCHECK_EQ(key_dtype_, DT_STRING);
+  const int64 slot = FindSlotForBytes(key.data(), key.size());
+  if (slot < 0 || StringAt(slots_[slot].key) != key) {
+    return -1;
+  }
+  return slot;
+}
+
+int64 MemmappedLookupTable::Int64Value(int64 slot) const {
+  DCHECK_EQ(value_dtype_, DT_INT64);
+  return static_cast<int64>(slots_[slot].value);
+}
+
+StringPiece MemmappedLookupTable::StringValue(int64 slot) const {
+  DCHECK_EQ(value_dtype_, DT_STRING);
+  return StringAt(slots_[slot].value);
+}
+
+}  // namespace tensorflow
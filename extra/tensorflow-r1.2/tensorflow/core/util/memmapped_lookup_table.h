@@ -0,0 +1,129 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_UTIL_MEMMAPPED_LOOKUP_TABLE_H_
+#define TENSORFLOW_CORE_UTIL_MEMMAPPED_LOOKUP_TABLE_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+
+namespace tensorflow {
+
+// An immutable key->value table stored in a single file that is used by
+// memory-mapping it rather than parsing it, so that opening a table of any
+// size is instant and its pages are shared by every process that maps it.
+//
+// Keys and values are scalars of type DT_INT64 or DT_STRING. Keys are placed
+// with a "hash, displace" perfect hash: a key's fingerprint selects a bucket,
+// and the bucket's displacement selects the key's slot, so a lookup reads the
+// displacement, one slot, and for string keys or values their bytes.
+//
+// File layout (little-endian, sections 8-byte aligned):
+//   Header
+//   uint32 displacements[num_buckets]
+//   Slot   slots[num_slots]    {fingerprint, key cell, value cell}
+//   char   string_data[]       {uint32 length, bytes} per string
+// A slot with fingerprint 0 is empty. An int64 cell holds the value itself;
+// a string cell holds the offset of the string within string_data.
+
+// Accumulates entries and writes them in the memmapped table format.
+class MemmappedLookupTableBuilder {
+ public:
+  MemmappedLookupTableBuilder(DataType key_dtype, DataType value_dtype);
+
+  // Adds the entries keys[i] -> values[i]. `keys` and `values` must have
+  // the table's dtypes and the same number of elements. Keys must be unique
+  // across all calls; duplicates are reported by Finish().
+  Status Add(const Tensor& keys, const Tensor& values);
+
+  // Builds the perfect hash and writes the table to `filename`.
+  Status Finish(Env* env, const string& filename);
+
+  int64 size() const { return keys_.size(); }
+
+ private:
+  const DataType key_dtype_;
+  const DataType value_dtype_;
+  // Canonical byte encodings of keys (8 little-endian bytes for int64) and
+  // values, in insertion order.
+  std::vector<string> keys_;
+  std::vector<string> values_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MemmappedLookupTableBuilder);
+};
+
+// Read-only view of a table written by MemmappedLookupTableBuilder. Lookups
+// only read the mapped memory, so a MemmappedLookupTable may be used by any
+// number of threads concurrently.
+class MemmappedLookupTable {
+ public:
+  // Validates the contents of `region` and returns a table reading from it.
+  static Status Create(std::unique_ptr<ReadOnlyMemoryRegion> region,
+                       std::unique_ptr<MemmappedLookupTable>* table);
+
+  // Maps `filename` with env->NewReadOnlyMemoryRegionFromFile and calls
+  // Create().
+  static Status Open(Env* env, const string& filename,
+                     std::unique_ptr<MemmappedLookupTable>* table);
+
+  DataType key_dtype() const { return key_dtype_; }
+  DataType value_dtype() const { return value_dtype_; }
+  int64 size() const { return num_entries_; }
+
+  // Returns the index of the slot holding `key`, or -1 if it is absent.
+  // The key type must match key_dtype().
+  int64 FindSlot(int64 key) const;
+  int64 FindSlot(StringPiece key) const;
+
+  // Returns the value in slot `slot`, as returned by FindSlot(). The value
+  // type must match value_dtype().
+  int64 Int64Value(int64 slot) const;
+  StringPiece StringValue(int64 slot) const;
+
+  // On-disk slot layout, shared with the builder.
+  struct Slot;
+
+ private:
+  explicit MemmappedLookupTable(std::unique_ptr<ReadOnlyMemoryRegion> region);
+
+  Status Init();
+  int64 FindSlotForBytes(const char* key, size_t size) const;
+  StringPiece StringAt(uint64 offset) const;
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  DataType key_dtype_ = DT_INVALID;
+  DataType value_dtype_ = DT_INVALID;
+  int64 num_entries_ = 0;
+  uint64 num_buckets_ = 0;
+  uint64 num_slots_ = 0;
+  uint64 hash_seed_ = 0;
+  const uint32* displacements_ = nullptr;
+  const Slot* slots_ = nullptr;
+  const char* string_data_ = nullptr;
+  uint64 string_data_size_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MemmappedLookupTable);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_MEMMAPPED_LOOKUP_TABLE_H_
@@ -0,0 +1,144 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/memmapped_lookup_table.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+string TablePath(const string& name) {
+  return io::JoinPath(testing::TmpDir(), name);
+}
+
+TEST(MemmappedLookupTableTest, StringToInt64) {
+  const int64 kNumEntries = 10000;
+  Tensor keys(DT_STRING, TensorShape({kNumEntries}));
+  Tensor values(DT_INT64, TensorShape({kNumEntries}));
+  for (int64 i = 0; i < kNumEntries; ++i) {
+    keys.flat<string>()(i) = strings::StrCat("token_", i);
+    values.flat<int64>()(i) = i * 3;
+  }
+  const string filename = TablePath("string_to_int64");
+  MemmappedLookupTableBuilder builder(DT_STRING, DT_INT64);
+  TF_ASSERT_OK(builder.Add(keys, values));
+  TF_ASSERT_OK(builder.Finish(Env::Default(), filename));
+
+  std::unique_ptr<MemmappedLookupTable> table;
+  TF_ASSERT_OK(MemmappedLookupTable::Open(Env::Default(), filename, &table));
+  EXPECT_EQ(DT_STRING, table->key_dtype());
+  EXPECT_EQ(DT_INT64, table->value_dtype());
+  EXPECT_EQ(kNumEntries, table->size());
+  for (int64 i = 0; i < kNumEntries; ++i) {
+    const int64 slot = table->FindSlot(strings::StrCat("token_", i));
+    ASSERT_GE(slot, 0);
+    EXPECT_EQ(i * 3, table->Int64Value(slot));
+  }
+  EXPECT_EQ(-1, table->FindSlot(StringPiece("token_")));
+  EXPECT_EQ(-1, table->FindSlot(StringPiece("")));
+  EXPECT_EQ(-1, table->FindSlot(strings::StrCat("token_", kNumEntries)));
+}
+
+TEST(MemmappedLookupTableTest, Int64ToString) {
+  Tensor keys = test::AsTensor<int64>({0, -1, 1ll << 40, 7});
+  Tensor values = test::AsTensor<string>({"zero", "minus one", "big", ""});
+  const string filename = TablePath("int64_to_string");
+  MemmappedLookupTableBuilder builder(DT_INT64, DT_STRING);
+  // Entries may be added over several calls.
+  TF_ASSERT_OK(builder.Add(keys.Slice(0, 2), values.Slice(0, 2)));
+  TF_ASSERT_OK(builder.Add(keys.Slice(2, 4), values.Slice(2, 4)));
+  TF_ASSERT_OK(builder.Finish(Env::Default(), filename));
+
+  std::unique_ptr<MemmappedLookupTable> table;
+  TF_ASSERT_OK(MemmappedLookupTable::Open(Env::Default(), filename, &table));
+  EXPECT_EQ(4, table->size());
+  EXPECT_EQ("zero", table->StringValue(table->FindSlot(int64{0})));
+  EXPECT_EQ("minus one", table->StringValue(table->FindSlot(int64{-1})));
+  EXPECT_EQ("big", table->StringValue(table->FindSlot(int64{1ll << 40})));
+  const int64 slot = table->FindSlot(int64{7});
+  ASSERT_GE(slot, 0);
+  EXPECT_EQ("", table->StringValue(slot));
+  EXPECT_EQ(-1, table->FindSlot(int64{1}));
+}
+
+TEST(MemmappedLookupTableTest, EmptyTable) {
+  const string filename = TablePath("empty");
+  MemmappedLookupTableBuilder builder(DT_INT64, DT_INT64);
+  TF_ASSERT_OK(builder.Finish(Env::Default(), filename));
+
+  std::unique_ptr<MemmappedLookupTable> table;
+  TF_ASSERT_OK(MemmappedLookupTable::Open(Env::Default(), filename, &table));
+  EXPECT_EQ(0, table->size());
+  EXPECT_EQ(-1, table->FindSlot(int64{0}));
+}
+
+TEST(MemmappedLookupTableTest, DuplicateKeys) {
+  MemmappedLookupTableBuilder builder(DT_STRING, DT_INT64);
+  TF_ASSERT_OK(builder.Add(test::AsTensor<string>({"a", "b"}),
+                           test::AsTensor<int64>({0, 1})));
+  TF_ASSERT_OK(builder.Add(test::AsTensor<string>({"a"}),
+                           test::AsTensor<int64>({2})));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      builder.Finish(Env::Default(), TablePath("duplicate"))));
+}
+
+TEST(MemmappedLookupTableTest, WrongTypes) {
+  MemmappedLookupTableBuilder builder(DT_STRING, DT_INT64);
+  EXPECT_TRUE(errors::IsInvalidArgument(builder.Add(
+      test::AsTensor<int64>({0}), test::AsTensor<int64>({0}))));
+  EXPECT_TRUE(errors::IsInvalidArgument(builder.Add(
+      test::AsTensor<string>({"a", "b"}), test::AsTensor<int64>({0}))));
+
+  MemmappedLookupTableBuilder float_builder(DT_STRING, DT_FLOAT);
+  EXPECT_TRUE(errors::IsInvalidArgument(float_builder.Add(
+      test::AsTensor<string>({"a"}), test::AsTensor<float>({0}))));
+}
+
+TEST(MemmappedLookupTableTest, CorruptFile) {
+  Env* env = Env::Default();
+  const string filename = TablePath("corrupt");
+  MemmappedLookupTableBuilder builder(DT_STRING, DT_STRING);
+  TF_ASSERT_OK(builder.Add(test::AsTensor<string>({"a", "b", "c"}),
+                           test::AsTensor<string>({"x", "y", "z"})));
+  TF_ASSERT_OK(builder.Finish(env, filename));
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(env, filename, &contents));
+
+  std::unique_ptr<MemmappedLookupTable> table;
+  // Truncated before the end of the slots.
+  const string truncated = TablePath("truncated");
+  TF_ASSERT_OK(WriteStringToFile(env, truncated, contents.substr(0, 100)));
+  EXPECT_TRUE(errors::IsDataLoss(
+      MemmappedLookupTable::Open(env, truncated, &table)));
+
+  // Bad magic number.
+  string bad_magic = contents;
+  bad_magic[0] = 'X';
+  const string bad_magic_file = TablePath("bad_magic");
+  TF_ASSERT_OK(WriteStringToFile(env, bad_magic_file, bad_magic));
+  EXPECT_TRUE(errors::IsDataLoss(
+      MemmappedLookupTable::Open(env, bad_magic_file, &table)));
+
+  EXPECT_FALSE(MemmappedLookupTable::Open(env, TablePath("missing"), &table)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,138 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_UTIL_MPMC_RING_BUFFER_H_
+#define TENSORFLOW_UTIL_MPMC_RING_BUFFER_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Bounded multi-producer multi-consumer FIFO queue that never blocks.
+// TryPush() and TryPop() are lock-free: each claims a slot with a single
+// compare-and-swap on the tail or head position, and a per-slot sequence
+// number tells producers and consumers when the slot is free or full (see
+// Dmitry Vyukov's "Bounded MPMC queue"). Sequence numbers are doubled, so
+// that "full in this lap" and "free in the next lap" differ even when the
+// capacity is 1.
+//
+// Elements are dequeued in the order in which their TryPush() calls claimed
+// a slot. The capacity is exact; it need not be a power of two.
+template <typename T>
+class MpmcRingBuffer {
+ public:
+  explicit MpmcRingBuffer(uint64 capacity)
+      : capacity_(capacity), slots_(new Slot[capacity]) {
+    CHECK_GT(capacity, 0);
+    for (uint64 i = 0; i < capacity; ++i) {
+      slots_[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+  uint64 capacity() const { return capacity_; }
+
+  // Moves *value into the buffer and returns true, or returns false and
+  // leaves *value untouched if the buffer is full.
+  bool TryPush(T* value) {
+    uint64 pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos % capacity_];
+      const uint64 sequence = slot.sequence.load(std::memory_order_acquire);
+      const int64 diff = static_cast<int64>(sequence - 2 * pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = std::move(*value);
+          slot.sequence.store(2 * pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // The slot still holds the element pushed one lap ago.
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Moves the oldest element into *value and returns true, or returns false
+  // if the buffer is empty.
+  bool TryPop(T* value) {
+    uint64 pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos % capacity_];
+      const uint64 sequence = slot.sequence.load(std::memory_order_acquire);
+      const int64 diff = static_cast<int64>(sequence - (2 * pos + 1));
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          *value = std::move(slot.value);
+          // Release whatever the moved-from value still holds now, rather
+          // than when the slot is next overwritten.
+          slot.value = T();
+          slot.sequence.store(2 * (pos + capacity_),
+                             std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // No element has been pushed into this slot yet.
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns the number of elements. Exact when no push or pop is in
+  // progress, otherwise a snapshot that may be stale.
+  uint64 size() const {
+    const uint64 head = head_.load(std::memory_order_acquire);
+    const uint64 tail = tail_.load(std::memory_order_acquire);
+    if (tail <= head) return 0;
+    return tail - head < capacity_ ? tail - head : capacity_;
+  }
+
+ private:
+  // Keeps the positions, which every producer or every consumer writes, on
+  // separate cache lines from each other and from the slots.
+  static constexpr int kCacheLineSize = 64;
+
+  struct Slot {
+    std::atomic<uint64> sequence;
+    T value;
+  };
+
+  const uint64 capacity_;
+  const std::unique_ptr<Slot[]> slots_;
+  char padding0_[kCacheLineSize];
+  std::atomic<uint64> head_;
+  char padding1_[kCacheLineSize];
+  std::atomic<uint64> tail_;
+  char padding2_[kCacheLineSize];
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MpmcRingBuffer);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_UTIL_MPMC_RING_BUFFER_H_
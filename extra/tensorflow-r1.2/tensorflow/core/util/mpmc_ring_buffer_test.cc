@@ -0,0 +1,126 @@
+/* Copyright 2017 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/mpmc_ring_buffer.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(MpmcRingBufferTest, FifoOrder) {
+  MpmcRingBuffer<int> buffer(3);
+  EXPECT_EQ(3, buffer.capacity());
+  EXPECT_EQ(0, buffer.size());
+  int value;
+  EXPECT_FALSE(buffer.TryPop(&value));
+
+  // Wrap around the buffer several times.
+  for (int lap = 0; lap < 5; ++lap) {
+    for (int i = 0; i < 3; ++i) {
+      value = lap * 10 + i;
+      EXPECT_TRUE(buffer.TryPush(&value));
+    }
+    EXPECT_EQ(3, buffer.size());
+    value = -1;
+    EXPECT_FALSE(buffer.TryPush(&value));
+    EXPECT_EQ(-1, value);
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(buffer.TryPop(&value));
+      EXPECT_EQ(lap * 10 + i, value);
+    }
+    EXPECT_FALSE(buffer.TryPop(&value));
+  }
+}
+
+TEST(MpmcRingBufferTest, MovesValues) {
+  MpmcRingBuffer<std::unique_ptr<int>> buffer(1);
+  std::unique_ptr<int> value(new int(7));
+  EXPECT_TRUE(buffer.TryPush(&value));
+  EXPECT_EQ(nullptr, value);
+
+  // A failed push leaves the value with the caller.
+  std::unique_ptr<int> other(new int(8));
+  EXPECT_FALSE(buffer.TryPush(&other));
+  ASSERT_NE(nullptr, other);
+  EXPECT_EQ(8, *other);
+
+  ASSERT_TRUE(buffer.TryPop(&value));
+  EXPECT_EQ(7, *value);
+}
+
+TEST(MpmcRingBufferTest, ConcurrentProducersAndConsumers) {
+  const int kNumProducers = 4;
+  const int kNumConsumers = 4;
+  const int kItemsPerProducer = 20000;
+  MpmcRingBuffer<int64> buffer(64);
+
+  // consumed[c] holds the items popped by consumer c, in order.
+  std::vector<std::vector<int64>> consumed(kNumConsumers);
+  std::atomic<int> num_consumed(0);
+  {
+    thread::ThreadPool pool(Env::Default(), "test",
+                            kNumProducers + kNumConsumers);
+    for (int p = 0; p < kNumProducers; ++p) {
+      pool.Schedule([&buffer, p]() {
+        for (int64 i = 0; i < kItemsPerProducer; ++i) {
+          int64 item = p * kItemsPerProducer + i;
+          while (!buffer.TryPush(&item)) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for (int c = 0; c < kNumConsumers; ++c) {
+      pool.Schedule([&buffer, &consumed, &num_consumed, c]() {
+        while (num_consumed.load() < kNumProducers * kItemsPerProducer) {
+          int64 item;
+          if (buffer.TryPop(&item)) {
+            consumed[c].push_back(item);
+            ++num_consumed;
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+  }
+
+  // Every item is popped exactly once, and each consumer sees the items of
+  // each producer in the order they were pushed.
+  std::vector<int> seen(kNumProducers * kItemsPerProducer, 0);
+  for (const auto& items : consumed) {
+    std::vector<int64> last(kNumProducers, -1);
+    for (int64 item : items) {
+      ++seen[item];
+      const int p = item / kItemsPerProducer;
+      EXPECT_LT(last[p], item);
+      last[p] = item;
+    }
+  }
+  for (int count : seen) {
+    ASSERT_EQ(1, count);
+  }
+  EXPECT_EQ(0, buffer.size());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include <vector>
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/prefetch.h"
 
 namespace tensorflow {
 
@@ -108,7 +109,7 @@ class PresizedCuckooMap {
     for (auto bucket : {b1, b2}) {
       Bucket* bptr = &buckets_[bucket];
       for (int slot = 0; slot < kSlotsPerBucket; slot++) {
-        if (bptr->keys[slot] == k) {  // Duplicates are not allowed.
+        if (bptr->keys[slot] == tk) {  // Duplicates are not allowed.
           return false;
         } else if (target_slot == kNoSpace && bptr->keys[slot] == kUnusedSlot) {
           target_bucket = bucket;
@@ -128,8 +129,18 @@ class PresizedCuckooMap {
   // Returns true if found.  Sets *out = value.
   bool Find(const key_type k, value* out) const {
     uint64 tk = key_transform(k);
-    return FindInBucket(k, fast_map_to_buckets(tk), out) ||
-           FindInBucket(k, fast_map_to_buckets(h2(tk)), out);
+    return FindInBucket(tk, fast_map_to_buckets(tk), out) ||
+           FindInBucket(tk, fast_map_to_buckets(h2(tk)), out);
+  }
+
+  // Prefetches the two buckets that may hold k. Callers doing many
+  // lookups can issue PrefetchKey for a batch of keys before calling Find
+  // on each of them, overlapping the cache misses.
+  void PrefetchKey(const key_type k) const {
+    const uint64 tk = key_transform(k);
+    port::prefetch<port::PREFETCH_HINT_T0>(&buckets_[fast_map_to_buckets(tk)]);
+    port::prefetch<port::PREFETCH_HINT_T0>(
+        &buckets_[fast_map_to_buckets(h2(tk))]);
   }
 
   int64 MemoryUsed() const {
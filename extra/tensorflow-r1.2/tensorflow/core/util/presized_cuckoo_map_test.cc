@@ -146,6 +146,27 @@ TEST(PresizedCuckooMapTest, Duplicates) {
   }
 }
 
+TEST(PresizedCuckooMapTest, UnusedSlotKey) {
+  // The "not occupied" flag must not be found in a table that lacks it.
+  PresizedCuckooMap<int> pscm(100);
+  int out;
+  EXPECT_FALSE(pscm.Find(~0ULL, &out));
+  EXPECT_TRUE(pscm.InsertUnique(~0ULL, 7));
+  EXPECT_TRUE(pscm.Find(~0ULL, &out));
+  EXPECT_EQ(7, out);
+}
+
+TEST(PresizedCuckooMapTest, PrefetchKey) {
+  PresizedCuckooMap<int> pscm(100);
+  EXPECT_TRUE(pscm.InsertUnique(1, 2));
+  pscm.PrefetchKey(1);
+  pscm.PrefetchKey(3);
+  int out;
+  EXPECT_TRUE(pscm.Find(1, &out));
+  EXPECT_EQ(2, out);
+  EXPECT_FALSE(pscm.Find(3, &out));
+}
+
 static void CalculateKeys(uint64 num, std::vector<uint64> *dst) {
   dst->resize(num);
   for (uint64 i = 0; i < num; i++) {
@@ -195,5 +216,35 @@ static void BM_CuckooRead(int iters, int arg) {
 
 BENCHMARK(BM_CuckooRead)->Arg(1000)->Arg(10000000);
 
+static void BM_CuckooReadBatchedPrefetch(int iters, int arg) {
+  static constexpr int kBatchSize = 16;
+  uint64 table_size = arg;
+  testing::StopTiming();
+  std::vector<uint64> calculated_keys;
+  CalculateKeys(table_size, &calculated_keys);
+  PresizedCuckooMap<int> pscm(table_size);
+  for (uint64 i = 0; i < table_size; i++) {
+    pscm.InsertUnique(calculated_keys[i], i);
+  }
+  testing::StartTiming();
+  uint64_t defeat_optimization = 0;
+  for (int i = 0; i < iters; i += kBatchSize) {
+    const int batch_end = std::min(iters, i + kBatchSize);
+    for (int j = i; j < batch_end; j++) {
+      pscm.PrefetchKey(calculated_keys[j % table_size]);
+    }
+    for (int j = i; j < batch_end; j++) {
+      int out = 0;
+      pscm.Find(calculated_keys[j % table_size], &out);
+      defeat_optimization += out;
+    }
+  }
+  if (defeat_optimization == 0) {
+    printf("Preventing the compiler from eliding the inner loop\n");
+  }
+}
+
+BENCHMARK(BM_CuckooReadBatchedPrefetch)->Arg(1000)->Arg(10000000);
+
 }  // namespace
 }  // namespace tensorflow